@@ -0,0 +1,53 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  Binary checkpoint format for RTLIL designs, written by 'write_rtlil_bin'
+ *  and read by 'read_rtlil_bin'.
+ *
+ *  All integers are LEB128 varints (signed values zigzag encoded). IdStrings
+ *  are stored as indices into a string table that is built on the fly: an
+ *  index equal to the current table size is followed by the new string.
+ *  Dictionaries are stored in iteration order and inserted in file order by
+ *  the reader, i.e. a write_rtlil_bin / read_rtlil_bin round trip yields the
+ *  same design as write_ilang / read_ilang.
+ *
+ */
+
+#ifndef RTLIL_BIN_H
+#define RTLIL_BIN_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace RTLIL_BIN {
+	static const char magic[8] = { 'Y', 'S', 'R', 'T', 'L', 'B', 'I', 'N' };
+	static const int version = 2;
+
+	void dump_design(std::ostream &f, RTLIL::Design *design);
+	void load_design(const char *data, size_t size, RTLIL::Design *design, bool flag_nooverwrite = false, bool flag_overwrite = false, bool flag_lib = false);
+
+	// a single module (used by the cache of derived modules in the AST frontend)
+	void dump_module(std::ostream &f, RTLIL::Module *module);
+	void load_module(const char *data, size_t size, RTLIL::Module *module);
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
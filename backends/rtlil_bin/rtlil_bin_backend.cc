@@ -0,0 +1,299 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "rtlil_bin.h"
+#include "kernel/yosys.h"
+
+USING_YOSYS_NAMESPACE
+YOSYS_NAMESPACE_BEGIN
+
+namespace {
+
+struct RtlilBinWriter
+{
+	std::ostream &f;
+	std::string buf;
+	dict<RTLIL::IdString, int> id_index;
+	dict<const RTLIL::Wire*, int> wire_index;
+
+	RtlilBinWriter(std::ostream &f) : f(f) { }
+
+	void flush()
+	{
+		f.write(buf.data(), buf.size());
+		buf.clear();
+	}
+
+	void put_uint(uint64_t v)
+	{
+		while (v >= 0x80) {
+			buf.push_back(char(v | 0x80));
+			v >>= 7;
+		}
+		buf.push_back(char(v));
+	}
+
+	void put_int(int64_t v)
+	{
+		put_uint((uint64_t(v) << 1) ^ uint64_t(v >> 63));
+	}
+
+	void put_id(RTLIL::IdString id)
+	{
+		auto it = id_index.find(id);
+		if (it != id_index.end()) {
+			put_uint(it->second);
+			return;
+		}
+		int idx = GetSize(id_index);
+		id_index[id] = idx;
+		put_uint(idx);
+		put_uint(id.size());
+		buf.append(id.c_str(), id.size());
+	}
+
+	// the bit count is stored with a flag for non-binary data: 0/1 values
+	// are packed eight per byte, everything else two per byte
+	void put_bits(const RTLIL::State *bits, int width)
+	{
+		bool binary = true;
+		for (int i = 0; i < width; i++)
+			if (bits[i] != RTLIL::S0 && bits[i] != RTLIL::S1) {
+				binary = false;
+				break;
+			}
+
+		put_uint((uint64_t(width) << 1) | (binary ? 0 : 1));
+
+		if (binary) {
+			for (int i = 0; i < width; i += 8) {
+				unsigned char byte = 0;
+				for (int j = 0; j < 8 && i+j < width; j++)
+					if (bits[i+j] == RTLIL::S1)
+						byte |= 1 << j;
+				buf.push_back(char(byte));
+			}
+		} else {
+			for (int i = 0; i < width; i += 2) {
+				unsigned char byte = bits[i];
+				if (i+1 < width)
+					byte |= bits[i+1] << 4;
+				buf.push_back(char(byte));
+			}
+		}
+	}
+
+	void put_const(const RTLIL::Const &data)
+	{
+		put_uint(data.flags);
+		put_bits(data.bits.data(), GetSize(data.bits));
+	}
+
+	void put_sigspec(const RTLIL::SigSpec &sig)
+	{
+		put_uint(GetSize(sig.chunks()));
+		for (auto &chunk : sig.chunks()) {
+			if (chunk.wire == nullptr) {
+				put_uint(0);
+				put_bits(chunk.data.data(), chunk.width);
+			} else {
+				put_uint(wire_index.at(chunk.wire) + 1);
+				put_uint(chunk.offset);
+				put_uint(chunk.width);
+			}
+		}
+	}
+
+	void put_sigsig(const RTLIL::SigSig &conn)
+	{
+		put_sigspec(conn.first);
+		put_sigspec(conn.second);
+	}
+
+	void put_consts(const dict<RTLIL::IdString, RTLIL::Const> &consts)
+	{
+		put_uint(consts.size());
+		for (auto &it : consts) {
+			put_id(it.first);
+			put_const(it.second);
+		}
+	}
+
+	void put_case(const RTLIL::CaseRule *cs)
+	{
+		put_consts(cs->attributes);
+		put_uint(cs->compare.size());
+		for (auto &sig : cs->compare)
+			put_sigspec(sig);
+		put_uint(cs->actions.size());
+		for (auto &action : cs->actions)
+			put_sigsig(action);
+		put_uint(cs->switches.size());
+		for (auto sw : cs->switches) {
+			put_consts(sw->attributes);
+			put_sigspec(sw->signal);
+			put_uint(sw->cases.size());
+			for (auto c : sw->cases)
+				put_case(c);
+		}
+	}
+
+	void put_module(RTLIL::Module *module)
+	{
+		put_id(module->name);
+		put_consts(module->attributes);
+
+		put_uint(module->avail_parameters.size());
+		for (auto &it : module->avail_parameters)
+			put_id(it);
+
+		wire_index.clear();
+		put_uint(module->wires_.size());
+		for (auto &it : module->wires_) {
+			RTLIL::Wire *wire = it.second;
+			int idx = GetSize(wire_index);
+			wire_index[wire] = idx;
+			put_id(wire->name);
+			put_uint((wire->port_input ? 1 : 0) | (wire->port_output ? 2 : 0) | (wire->upto ? 4 : 0));
+			put_uint(wire->width);
+			put_int(wire->start_offset);
+			put_uint(wire->port_id);
+			put_consts(wire->attributes);
+		}
+
+		put_uint(module->memories.size());
+		for (auto &it : module->memories) {
+			RTLIL::Memory *memory = it.second;
+			put_id(memory->name);
+			put_uint(memory->width);
+			put_int(memory->start_offset);
+			put_uint(memory->size);
+			put_consts(memory->attributes);
+		}
+
+		put_uint(module->cells_.size());
+		for (auto &it : module->cells_) {
+			RTLIL::Cell *cell = it.second;
+			put_id(cell->name);
+			put_id(cell->type);
+			put_consts(cell->parameters);
+			put_consts(cell->attributes);
+			put_uint(cell->connections_.size());
+			for (auto &conn : cell->connections_) {
+				put_id(conn.first);
+				put_sigspec(conn.second);
+			}
+			if (GetSize(buf) > (1 << 20))
+				flush();
+		}
+
+		put_uint(module->processes.size());
+		for (auto &it : module->processes) {
+			RTLIL::Process *proc = it.second;
+			put_id(proc->name);
+			put_consts(proc->attributes);
+			put_case(&proc->root_case);
+			put_uint(proc->syncs.size());
+			for (auto sync : proc->syncs) {
+				put_uint(sync->type);
+				put_sigspec(sync->signal);
+				put_uint(sync->actions.size());
+				for (auto &action : sync->actions)
+					put_sigsig(action);
+			}
+		}
+
+		put_uint(module->connections().size());
+		for (auto &conn : module->connections()) {
+			put_sigsig(conn);
+			if (GetSize(buf) > (1 << 20))
+				flush();
+		}
+	}
+
+	void put_design(RTLIL::Design *design)
+	{
+		buf.append(RTLIL_BIN::magic, sizeof(RTLIL_BIN::magic));
+		put_uint(RTLIL_BIN::version);
+		put_uint(current_autoidx());
+		put_uint(design->modules_.size());
+		for (auto &it : design->modules_) {
+			put_module(it.second);
+			flush();
+		}
+		flush();
+	}
+
+	void put_single_module(RTLIL::Module *module)
+	{
+		buf.append(RTLIL_BIN::magic, sizeof(RTLIL_BIN::magic));
+		put_uint(RTLIL_BIN::version);
+		put_uint(current_autoidx());
+		put_module(module);
+		flush();
+	}
+};
+
+} /* namespace */
+
+void RTLIL_BIN::dump_design(std::ostream &f, RTLIL::Design *design)
+{
+	RtlilBinWriter writer(f);
+	writer.put_design(design);
+}
+
+void RTLIL_BIN::dump_module(std::ostream &f, RTLIL::Module *module)
+{
+	RtlilBinWriter writer(f);
+	writer.put_single_module(module);
+}
+
+YOSYS_NAMESPACE_END
+PRIVATE_NAMESPACE_BEGIN
+
+struct RtlilBinBackend : public Backend {
+	RtlilBinBackend() : Backend("rtlil_bin", "write design to a binary RTLIL checkpoint") { read_only = true; }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    write_rtlil_bin [filename]\n");
+		log("\n");
+		log("Write the current design to a binary checkpoint file. The file contains the\n");
+		log("same information as the output of 'write_ilang', but is much faster to write\n");
+		log("and to load back with 'read_rtlil_bin'. Like 'write_ilang', all objects are\n");
+		log("written in iteration order and read back in file order.\n");
+		log("\n");
+		log("The format is meant for saving and restoring a design between runs of the\n");
+		log("same version of yosys, use 'write_ilang' for archiving designs.\n");
+		log("\n");
+	}
+	void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		log_header(design, "Executing RTLIL_BIN backend.\n");
+
+		size_t argidx = 1;
+		extra_args(f, filename, args, argidx);
+
+		log("Output filename: %s\n", filename.c_str());
+		RTLIL_BIN::dump_design(*f, design);
+	}
+} RtlilBinBackend;
+
+PRIVATE_NAMESPACE_END
@@ -29,18 +29,20 @@
 #include <sstream>
 #include <set>
 #include <map>
+#include <functional>
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 bool verbose, norename, noattr, attr2comment, noexpr, nodec, nohex, nostr, defparam, decimal, siminit;
 int auto_name_counter, auto_name_offset, auto_name_digits;
-std::map<RTLIL::IdString, int> auto_name_map;
-std::set<RTLIL::IdString> reg_wires, reg_ct;
+dict<RTLIL::IdString, int> auto_name_map;
+pool<RTLIL::IdString> reg_wires, reg_ct;
 std::string auto_prefix;
+int num_threads;
 
 RTLIL::Module *active_module;
-dict<RTLIL::SigBit, RTLIL::State> active_initdata;
+dict<RTLIL::SigBit, RTLIL::State> active_initdata, active_initbits;
 SigMap active_sigmap;
 
 void reset_auto_counter_id(RTLIL::IdString id, bool may_rename)
@@ -93,9 +95,16 @@ void reset_auto_counter(RTLIL::Module *module)
 			log("  renaming `%s' to `%s_%0*d_'.\n", it->first.c_str(), auto_prefix.c_str(), auto_name_digits, auto_name_offset + it->second);
 }
 
+std::string auto_id(int index)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "_%0*d_", auto_name_digits, auto_name_offset + index);
+	return auto_prefix + buffer;
+}
+
 std::string next_auto_id()
 {
-	return stringf("%s_%0*d_", auto_prefix.c_str(), auto_name_digits, auto_name_offset + auto_name_counter++);
+	return auto_id(auto_name_counter++);
 }
 
 std::string id(RTLIL::IdString internal_id, bool may_rename = true)
@@ -103,8 +112,11 @@ std::string id(RTLIL::IdString internal_id, bool may_rename = true)
 	const char *str = internal_id.c_str();
 	bool do_escape = false;
 
-	if (may_rename && auto_name_map.count(internal_id) != 0)
-		return stringf("%s_%0*d_", auto_prefix.c_str(), auto_name_digits, auto_name_offset + auto_name_map[internal_id]);
+	if (may_rename) {
+		auto it = auto_name_map.find(internal_id);
+		if (it != auto_name_map.end())
+			return auto_id(it->second);
+	}
 
 	if (*str == '\\')
 		str++;
@@ -126,7 +138,7 @@ std::string id(RTLIL::IdString internal_id, bool may_rename = true)
 		break;
 	}
 
-	const pool<string> keywords = {
+	static const pool<string> keywords = {
 		// IEEE 1800-2017 Annex B
 		"accept_on", "alias", "always", "always_comb", "always_ff", "always_latch", "and", "assert", "assign", "assume", "automatic", "before",
 		"begin", "bind", "bins", "binsof", "bit", "break", "buf", "bufif0", "bufif1", "byte", "case", "casex", "casez", "cell", "chandle",
@@ -150,7 +162,7 @@ std::string id(RTLIL::IdString internal_id, bool may_rename = true)
 		"untyped", "use", "uwire", "var", "vectored", "virtual", "void", "wait", "wait_order", "wand", "weak", "weak0", "weak1", "while",
 		"wildcard", "wire", "with", "within", "wor", "xnor", "xor",
 	};
-	if (keywords.count(str))
+	if (!do_escape && keywords.count(str))
 		do_escape = true;
 
 	if (do_escape)
@@ -206,16 +218,19 @@ void dump_const(std::ostream &f, const RTLIL::Const &data, int width = -1, int o
 					val |= 1 << (i - offset);
 			}
 			if (decimal)
-				f << stringf("%d", val);
+				f << val;
 			else if (set_signed && val < 0)
-				f << stringf("-32'sd%u", -val);
+				f << "-32'sd" << (0u - uint32_t(val));
 			else
-				f << stringf("32'%sd%u", set_signed ? "s" : "", val);
+				f << (set_signed ? "32'sd" : "32'd") << uint32_t(val);
 		} else {
 	dump_hex:
 			if (nohex)
 				goto dump_bin;
-			vector<char> bin_digits, hex_digits;
+			// reused between calls, this is one of the hottest paths of the backend
+			static thread_local std::string bin_digits, hex_digits;
+			bin_digits.clear();
+			hex_digits.clear();
 			for (int i = offset; i < offset+width; i++) {
 				log_assert(i < (int)data.bits.size());
 				switch (data.bits[i]) {
@@ -261,49 +276,49 @@ void dump_const(std::ostream &f, const RTLIL::Const &data, int width = -1, int o
 				int val = 8*(bit_3 - '0') + 4*(bit_2 - '0') + 2*(bit_1 - '0') + (bit_0 - '0');
 				hex_digits.push_back(val < 10 ? '0' + val : 'a' + val - 10);
 			}
-			f << stringf("%d'%sh", width, set_signed ? "s" : "");
+			f << width << (set_signed ? "'sh" : "'h");
 			for (int i = GetSize(hex_digits)-1; i >= 0; i--)
 				f << hex_digits[i];
 		}
 		if (0) {
 	dump_bin:
-			f << stringf("%d'%sb", width, set_signed ? "s" : "");
+			f << width << (set_signed ? "'sb" : "'b");
 			if (width == 0)
-				f << stringf("0");
+				f << '0';
 			for (int i = offset+width-1; i >= offset; i--) {
 				log_assert(i < (int)data.bits.size());
 				switch (data.bits[i]) {
-				case RTLIL::S0: f << stringf("0"); break;
-				case RTLIL::S1: f << stringf("1"); break;
-				case RTLIL::Sx: f << stringf("x"); break;
-				case RTLIL::Sz: f << stringf("z"); break;
-				case RTLIL::Sa: f << stringf("?"); break;
+				case RTLIL::S0: f << '0'; break;
+				case RTLIL::S1: f << '1'; break;
+				case RTLIL::Sx: f << 'x'; break;
+				case RTLIL::Sz: f << 'z'; break;
+				case RTLIL::Sa: f << '?'; break;
 				case RTLIL::Sm: log_error("Found marker state in final netlist.");
 				}
 			}
 		}
 	} else {
 		if ((data.flags & RTLIL::CONST_FLAG_REAL) == 0)
-			f << stringf("\"");
+			f << '"';
 		std::string str = data.decode_string();
 		for (size_t i = 0; i < str.size(); i++) {
 			if (str[i] == '\n')
-				f << stringf("\\n");
+				f << "\\n";
 			else if (str[i] == '\t')
-				f << stringf("\\t");
+				f << "\\t";
 			else if (str[i] < 32)
 				f << stringf("\\%03o", str[i]);
 			else if (str[i] == '"')
-				f << stringf("\\\"");
+				f << "\\\"";
 			else if (str[i] == '\\')
-				f << stringf("\\\\");
+				f << "\\\\";
 			else if (str[i] == '/' && escape_comment && i > 0 && str[i-1] == '*')
-				f << stringf("\\/");
+				f << "\\/";
 			else
 				f << str[i];
 		}
 		if ((data.flags & RTLIL::CONST_FLAG_REAL) == 0)
-			f << stringf("\"");
+			f << '"';
 	}
 }
 
@@ -312,9 +327,13 @@ void dump_reg_init(std::ostream &f, SigSpec sig)
 	Const initval;
 	bool gotinit = false;
 
-	for (auto bit : active_sigmap(sig)) {
-		if (active_initdata.count(bit)) {
-			initval.bits.push_back(active_initdata.at(bit));
+	// active_initbits holds the init values of the wire bits before sigmap,
+	// so that this can be called from the worker threads in dump_items()
+	for (auto bit : sig) {
+		auto &initdata = bit.wire ? active_initbits : active_initdata;
+		auto it = initdata.find(bit);
+		if (it != initdata.end()) {
+			initval.bits.push_back(it->second);
 			gotinit = true;
 		} else {
 			initval.bits.push_back(State::Sx);
@@ -332,22 +351,21 @@ void dump_sigchunk(std::ostream &f, const RTLIL::SigChunk &chunk, bool no_decima
 	if (chunk.wire == NULL) {
 		dump_const(f, chunk.data, chunk.width, chunk.offset, no_decimal);
 	} else {
+		f << id(chunk.wire->name);
 		if (chunk.width == chunk.wire->width && chunk.offset == 0) {
-			f << stringf("%s", id(chunk.wire->name).c_str());
+			// whole wire
 		} else if (chunk.width == 1) {
 			if (chunk.wire->upto)
-				f << stringf("%s[%d]", id(chunk.wire->name).c_str(), (chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset);
+				f << '[' << (chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset << ']';
 			else
-				f << stringf("%s[%d]", id(chunk.wire->name).c_str(), chunk.offset + chunk.wire->start_offset);
+				f << '[' << chunk.offset + chunk.wire->start_offset << ']';
 		} else {
 			if (chunk.wire->upto)
-				f << stringf("%s[%d:%d]", id(chunk.wire->name).c_str(),
-						(chunk.wire->width - (chunk.offset + chunk.width - 1) - 1) + chunk.wire->start_offset,
-						(chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset);
+				f << '[' << (chunk.wire->width - (chunk.offset + chunk.width - 1) - 1) + chunk.wire->start_offset
+						<< ':' << (chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset << ']';
 			else
-				f << stringf("%s[%d:%d]", id(chunk.wire->name).c_str(),
-						(chunk.offset + chunk.width - 1) + chunk.wire->start_offset,
-						chunk.offset + chunk.wire->start_offset);
+				f << '[' << (chunk.offset + chunk.width - 1) + chunk.wire->start_offset
+						<< ':' << chunk.offset + chunk.wire->start_offset << ']';
 		}
 	}
 }
@@ -361,13 +379,13 @@ void dump_sigspec(std::ostream &f, const RTLIL::SigSpec &sig)
 	if (sig.is_chunk()) {
 		dump_sigchunk(f, sig.as_chunk());
 	} else {
-		f << stringf("{ ");
+		f << "{ ";
 		for (auto it = sig.chunks().rbegin(); it != sig.chunks().rend(); ++it) {
 			if (it != sig.chunks().rbegin())
-				f << stringf(", ");
+				f << ", ";
 			dump_sigchunk(f, *it, true);
 		}
-		f << stringf(" }");
+		f << " }";
 	}
 }
 
@@ -378,15 +396,15 @@ void dump_attributes(std::ostream &f, std::string indent, dict<RTLIL::IdString,
 	if (attr2comment)
 		as_comment = true;
 	for (auto it = attributes.begin(); it != attributes.end(); ++it) {
-		f << stringf("%s" "%s %s", indent.c_str(), as_comment ? "/*" : "(*", id(it->first).c_str());
-		f << stringf(" = ");
+		f << indent << (as_comment ? "/* " : "(* ") << id(it->first);
+		f << " = ";
 		if (modattr && (it->second == Const(0, 1) || it->second == Const(0)))
-			f << stringf(" 0 ");
+			f << " 0 ";
 		else if (modattr && (it->second == Const(1, 1) || it->second == Const(1)))
-			f << stringf(" 1 ");
+			f << " 1 ";
 		else
 			dump_const(f, it->second, -1, 0, false, as_comment);
-		f << stringf(" %s%c", as_comment ? "*/" : "*)", term);
+		f << (as_comment ? " */" : " *)") << term;
 	}
 }
 
@@ -414,21 +432,22 @@ void dump_wire(std::ostream &f, std::string indent, RTLIL::Wire *wire)
 		else
 			range = stringf(" [%d:%d]", wire->width - 1 + wire->start_offset, wire->start_offset);
 	}
+	std::string wire_id = id(wire->name);
 	if (wire->port_input && !wire->port_output)
-		f << stringf("%s" "input%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "input" << range << ' ' << wire_id << ";\n";
 	if (!wire->port_input && wire->port_output)
-		f << stringf("%s" "output%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "output" << range << ' ' << wire_id << ";\n";
 	if (wire->port_input && wire->port_output)
-		f << stringf("%s" "inout%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "inout" << range << ' ' << wire_id << ";\n";
 	if (reg_wires.count(wire->name)) {
-		f << stringf("%s" "reg%s %s", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "reg" << range << ' ' << wire_id;
 		if (wire->attributes.count("\\init")) {
-			f << stringf(" = ");
+			f << " = ";
 			dump_const(f, wire->attributes.at("\\init"));
 		}
-		f << stringf(";\n");
+		f << ";\n";
 	} else if (!wire->port_input && !wire->port_output)
-		f << stringf("%s" "wire%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "wire" << range << ' ' << wire_id << ";\n";
 #endif
 }
 
@@ -1379,25 +1398,26 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 	}
 
 	dump_attributes(f, indent, cell->attributes);
-	f << stringf("%s" "%s", indent.c_str(), id(cell->type, false).c_str());
+	f << indent << id(cell->type, false);
 
 	if (!defparam && cell->parameters.size() > 0) {
-		f << stringf(" #(");
+		f << " #(";
 		for (auto it = cell->parameters.begin(); it != cell->parameters.end(); ++it) {
 			if (it != cell->parameters.begin())
-				f << stringf(",");
-			f << stringf("\n%s  .%s(", indent.c_str(), id(it->first).c_str());
+				f << ',';
+			f << '\n' << indent << "  ." << id(it->first) << '(';
 			dump_const(f, it->second);
-			f << stringf(")");
+			f << ')';
 		}
-		f << stringf("\n%s" ")", indent.c_str());
+		f << '\n' << indent << ')';
 	}
 
 	std::string cell_name = cellname(cell);
-	if (cell_name != id(cell->name))
-		f << stringf(" %s /* %s */ (", cell_name.c_str(), id(cell->name).c_str());
+	std::string cell_id = id(cell->name);
+	if (cell_name != cell_id)
+		f << ' ' << cell_name << " /* " << cell_id << " */ (";
 	else
-		f << stringf(" %s (", cell_name.c_str());
+		f << ' ' << cell_name << " (";
 
 	bool first_arg = true;
 	std::set<RTLIL::IdString> numbered_ports;
@@ -1408,9 +1428,9 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 			if (it->first != str)
 				continue;
 			if (!first_arg)
-				f << stringf(",");
+				f << ',';
 			first_arg = false;
-			f << stringf("\n%s  ", indent.c_str());
+			f << '\n' << indent << "  ";
 			dump_sigspec(f, it->second);
 			numbered_ports.insert(it->first);
 			goto found_numbered_port;
@@ -1422,14 +1442,14 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 		if (numbered_ports.count(it->first))
 			continue;
 		if (!first_arg)
-			f << stringf(",");
+			f << ',';
 		first_arg = false;
-		f << stringf("\n%s  .%s(", indent.c_str(), id(it->first).c_str());
+		f << '\n' << indent << "  ." << id(it->first) << '(';
 		if (it->second.size() > 0)
 			dump_sigspec(f, it->second);
-		f << stringf(")");
+		f << ')';
 	}
-	f << stringf("\n%s" ");\n", indent.c_str());
+	f << '\n' << indent << ");\n";
 
 	if (defparam && cell->parameters.size() > 0) {
 		for (auto it = cell->parameters.begin(); it != cell->parameters.end(); ++it) {
@@ -1452,11 +1472,11 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 
 void dump_conn(std::ostream &f, std::string indent, const RTLIL::SigSpec &left, const RTLIL::SigSpec &right)
 {
-	f << stringf("%s" "assign ", indent.c_str());
+	f << indent << "assign ";
 	dump_sigspec(f, left);
-	f << stringf(" = ");
+	f << " = ";
 	dump_sigspec(f, right);
-	f << stringf(";\n");
+	f << ";\n";
 }
 
 void dump_proc_switch(std::ostream &f, std::string indent, RTLIL::SwitchRule *sw);
@@ -1615,6 +1635,67 @@ void dump_process(std::ostream &f, std::string indent, RTLIL::Process *proc, boo
 	}
 }
 
+// Call dump_item() for the items [0, num_items) of a module. With more than
+// one thread, chunks of items are formatted into separate buffers by worker
+// threads and written in their original order. Items for which is_serial()
+// returns true are always formatted by the calling thread in their original
+// order, because they draw names from next_auto_id().
+void dump_items(std::ostream &f, int num_items, std::function<void(std::ostream&, int)> dump_item, std::function<bool(int)> is_serial = nullptr)
+{
+	const int chunk_size = 1024;
+
+	if (num_threads <= 1 || num_items <= chunk_size) {
+		for (int i = 0; i < num_items; i++)
+			dump_item(f, i);
+		return;
+	}
+
+	struct chunk_t {
+		int begin, end;
+		bool serial;
+		std::string buffer;
+	};
+
+	// limits the amount of formatted text that is held in memory
+	const int batch_size = 8 * num_threads;
+	std::vector<chunk_t> chunks;
+
+	for (int begin = 0; begin < num_items;)
+	{
+		chunks.clear();
+		while (begin < num_items && GetSize(chunks) < batch_size) {
+			chunk_t chunk;
+			chunk.begin = begin;
+			chunk.serial = is_serial && is_serial(begin);
+			chunk.end = begin + 1;
+			if (!chunk.serial)
+				while (chunk.end < num_items && chunk.end - chunk.begin < chunk_size && !(is_serial && is_serial(chunk.end)))
+					chunk.end++;
+			begin = chunk.end;
+			chunks.push_back(chunk);
+		}
+
+		auto dump_chunk = [&](chunk_t &chunk) {
+			std::ostringstream buf;
+			for (int i = chunk.begin; i < chunk.end; i++)
+				dump_item(buf, i);
+			chunk.buffer = buf.str();
+		};
+
+		Pass::run_parallel(GetSize(chunks), [&](int i) {
+			if (!chunks[i].serial)
+				dump_chunk(chunks[i]);
+		}, num_threads);
+
+		for (auto &chunk : chunks) {
+			if (chunk.serial)
+				dump_item(f, chunk.begin);
+			else
+				f << chunk.buffer;
+		}
+	}
+}
+
 void dump_module(std::ostream &f, std::string indent, RTLIL::Module *module)
 {
 	reg_wires.clear();
@@ -1622,6 +1703,7 @@ void dump_module(std::ostream &f, std::string indent, RTLIL::Module *module)
 	active_module = module;
 	active_sigmap.set(module);
 	active_initdata.clear();
+	active_initbits.clear();
 
 	for (auto wire : module->wires())
 		if (wire->attributes.count("\\init")) {
@@ -1632,6 +1714,15 @@ void dump_module(std::ostream &f, std::string indent, RTLIL::Module *module)
 					active_initdata[sig[i]] = val[i];
 		}
 
+	if (!active_initdata.empty())
+		for (auto cell : module->cells())
+			if (cell->hasPort("\\Q"))
+				for (auto bit : cell->getPort("\\Q")) {
+					auto it = active_initdata.find(active_sigmap(bit));
+					if (bit.wire && it != active_initdata.end())
+						active_initbits[bit] = it->second;
+				}
+
 	if (!module->processes.empty())
 		log_warning("Module %s contains unmapped RTLIL processes. RTLIL processes\n"
 				"can't always be mapped directly to Verilog always blocks. Unintended\n"
@@ -1690,25 +1781,36 @@ void dump_module(std::ostream &f, std::string indent, RTLIL::Module *module)
 	}
 	f << stringf(");\n");
 
-	for (auto it = module->wires_.begin(); it != module->wires_.end(); ++it)
-		dump_wire(f, indent + "  ", it->second);
+	std::string item_indent = indent + "  ";
+
+	std::vector<RTLIL::Wire*> wires = module->wires();
+	dump_items(f, GetSize(wires), [&](std::ostream &f, int i) {
+		dump_wire(f, item_indent, wires[i]);
+	});
 
 	for (auto it = module->memories.begin(); it != module->memories.end(); ++it)
-		dump_memory(f, indent + "  ", it->second);
+		dump_memory(f, item_indent, it->second);
 
-	for (auto it = module->cells_.begin(); it != module->cells_.end(); ++it)
-		dump_cell(f, indent + "  ", it->second);
+	std::vector<RTLIL::Cell*> cells = module->cells();
+	dump_items(f, GetSize(cells), [&](std::ostream &f, int i) {
+		dump_cell(f, item_indent, cells[i]);
+	}, [&](int i) {
+		return !noexpr && (cells[i]->type == "$shiftx" || cells[i]->type == "$mem");
+	});
 
 	for (auto it = module->processes.begin(); it != module->processes.end(); ++it)
-		dump_process(f, indent + "  ", it->second);
+		dump_process(f, item_indent, it->second);
 
-	for (auto it = module->connections().begin(); it != module->connections().end(); ++it)
-		dump_conn(f, indent + "  ", it->first, it->second);
+	const std::vector<RTLIL::SigSig> &conns = module->connections();
+	dump_items(f, GetSize(conns), [&](std::ostream &f, int i) {
+		dump_conn(f, item_indent, conns[i].first, conns[i].second);
+	});
 
 	f << stringf("%s" "endmodule\n", indent.c_str());
 	active_module = NULL;
 	active_sigmap.clear();
 	active_initdata.clear();
+	active_initbits.clear();
 }
 
 struct VerilogBackend : public Backend {
@@ -1775,6 +1877,11 @@ struct VerilogBackend : public Backend {
 		log("        only write selected modules. modules must be selected entirely or\n");
 		log("        not at all.\n");
 		log("\n");
+		log("    -j <num>\n");
+		log("        format the wires, cells and connections of large modules with up to\n");
+		log("        <num> threads. the output does not depend on <num>. the default is\n");
+		log("        the value of the yosys -j option.\n");
+		log("\n");
 		log("    -v\n");
 		log("        verbose output (print new names of all renamed wires and cells)\n");
 		log("\n");
@@ -1801,6 +1908,7 @@ struct VerilogBackend : public Backend {
 		decimal = false;
 		siminit = false;
 		auto_prefix = "";
+		num_threads = yosys_threads;
 
 		bool blackboxes = false;
 		bool selected = false;
@@ -1890,6 +1998,10 @@ struct VerilogBackend : public Backend {
 				selected = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				num_threads = std::max(atoi(args[++argidx].c_str()), 1);
+				continue;
+			}
 			if (arg == "-v") {
 				verbose = true;
 				continue;
@@ -1898,6 +2010,10 @@ struct VerilogBackend : public Backend {
 		}
 		extra_args(f, filename, args, argidx);
 
+#ifndef YOSYS_ENABLE_THREADS
+		num_threads = 1;
+#endif
+
 		design->sort();
 
 		*f << stringf("/* Generated by %s */\n", yosys_version_str);
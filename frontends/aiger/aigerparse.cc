@@ -204,8 +204,63 @@ eval_end:
 	}
 };
 
-AigerReader::AigerReader(RTLIL::Design *design, std::istream &f, RTLIL::IdString module_name, RTLIL::IdString clk_name, std::string map_filename, bool wideports)
-	: design(design), f(f), clk_name(clk_name), map_filename(map_filename), wideports(wideports)
+static inline bool aiger_isspace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+bool AigerInput::read(void *dst, size_t n)
+{
+	if (!ok || size_t(end - ptr) < n) {
+		ok = false;
+		return false;
+	}
+	memcpy(dst, ptr, n);
+	ptr += n;
+	return true;
+}
+
+void AigerInput::skip_line()
+{
+	const char *eol = (const char*)memchr(ptr, '\n', end - ptr);
+	ptr = eol ? eol + 1 : end;
+}
+
+AigerInput &AigerInput::operator>>(unsigned &value)
+{
+	while (ptr < end && aiger_isspace(*ptr))
+		ptr++;
+	if (!ok || ptr == end || *ptr < '0' || *ptr > '9') {
+		ok = false;
+		return *this;
+	}
+	uint64_t v = 0;
+	for (; ptr < end && '0' <= *ptr && *ptr <= '9'; ptr++) {
+		v = 10*v + (*ptr - '0');
+		if (v > std::numeric_limits<unsigned>::max())
+			ok = false;
+	}
+	value = v;
+	return *this;
+}
+
+AigerInput &AigerInput::operator>>(std::string &value)
+{
+	while (ptr < end && aiger_isspace(*ptr))
+		ptr++;
+	if (!ok || ptr == end) {
+		ok = false;
+		return *this;
+	}
+	const char *p = ptr;
+	while (ptr < end && !aiger_isspace(*ptr))
+		ptr++;
+	value.assign(p, ptr);
+	return *this;
+}
+
+AigerReader::AigerReader(RTLIL::Design *design, std::istream &stream, RTLIL::IdString module_name, RTLIL::IdString clk_name, std::string map_filename, bool wideports, std::string filename)
+	: design(design), buffer(stream, filename), f(buffer.data, buffer.size), clk_name(clk_name), map_filename(map_filename), wideports(wideports)
 {
 	module = new RTLIL::Module;
 	module->name = module_name;
@@ -236,8 +291,7 @@ void AigerReader::parse_aiger()
 	if (!(f >> F)) log_error("Invalid AIGER header\n");
 end_of_header:
 
-	std::string line;
-	std::getline(f, line); // Ignore up to start of next line, as standard
+	f.skip_line(); // Ignore up to start of next line, as standard
 	// says anything that follows could be used for
 	// optional sections
 
@@ -246,6 +300,7 @@ end_of_header:
 	line_count = 1;
 	piNum = 0;
 	flopNum = 0;
+	reserve_tables();
 
 	if (header == "aag")
 		parse_aiger_ascii();
@@ -290,18 +345,17 @@ end_of_header:
 		}
 		else
 			log_error("Line %u: cannot interpret first character '%c'!\n", line_count, c);
-		std::getline(f, line); // Ignore up to start of next line
+		f.skip_line(); // Ignore up to start of next line
 	}
 
 	post_process();
 }
 
-static uint32_t parse_xaiger_literal(std::istream &f)
+static uint32_t parse_xaiger_literal(AigerInput &f)
 {
 	uint32_t l;
-	f.read(reinterpret_cast<char*>(&l), sizeof(l));
-	if (f.gcount() != sizeof(l))
-		log_error("Offset %" PRId64 ": unable to read literal!\n", static_cast<int64_t>(f.tellg()));
+	if (!f.read(&l, sizeof(l)))
+		log_error("Offset %" PRId64 ": unable to read literal!\n", static_cast<int64_t>(f.tell()));
 	return from_big_endian(l);
 }
 
@@ -347,8 +401,7 @@ void AigerReader::parse_xaiger()
 	// Optional values
 	B = C = J = F = 0;
 
-	std::string line;
-	std::getline(f, line); // Ignore up to start of next line, as standard
+	f.skip_line(); // Ignore up to start of next line, as standard
 	// says anything that follows could be used for
 	// optional sections
 
@@ -357,6 +410,7 @@ void AigerReader::parse_xaiger()
 	line_count = 1;
 	piNum = 0;
 	flopNum = 0;
+	reserve_tables();
 
 	if (header == "aag")
 		parse_aiger_ascii();
@@ -488,7 +542,6 @@ void AigerReader::parse_xaiger()
 
 void AigerReader::parse_aiger_ascii()
 {
-	std::string line;
 	std::stringstream ss;
 
 	unsigned l1, l2, l3;
@@ -581,15 +634,15 @@ void AigerReader::parse_aiger_ascii()
 
 	// TODO: Parse invariant constraints
 	for (unsigned i = 0; i < C; ++i, ++line_count)
-		std::getline(f, line); // Ignore up to start of next line
+		f.skip_line(); // Ignore up to start of next line
 
 	// TODO: Parse justice properties
 	for (unsigned i = 0; i < J; ++i, ++line_count)
-		std::getline(f, line); // Ignore up to start of next line
+		f.skip_line(); // Ignore up to start of next line
 
 	// TODO: Parse fairness constraints
 	for (unsigned i = 0; i < F; ++i, ++line_count)
-		std::getline(f, line); // Ignore up to start of next line
+		f.skip_line(); // Ignore up to start of next line
 
 	// Parse AND
 	for (unsigned i = 0; i < A; ++i) {
@@ -603,22 +656,40 @@ void AigerReader::parse_aiger_ascii()
 		RTLIL::Wire *i2_wire = createWireIfNotExists(module, l3);
 		module->addAndGate(o_wire->name.str() + "$and", i1_wire, i2_wire, o_wire);
 	}
-	std::getline(f, line); // Ignore up to start of next line
+	f.skip_line(); // Ignore up to start of next line
 }
 
-static unsigned parse_next_delta_literal(std::istream &f, unsigned ref)
+static unsigned parse_next_delta_literal(AigerInput &f, unsigned ref)
 {
 	unsigned x = 0, i = 0;
-	unsigned char ch;
-	while ((ch = f.get()) & 0x80)
+	int ch;
+	while ((ch = f.get()) != EOF && (ch & 0x80))
 		x |= (ch & 0x7f) << (7 * i++);
+	if (ch == EOF)
+		log_error("Offset %" PRId64 ": unexpected end of file in AND gate!\n", static_cast<int64_t>(f.tell()));
 	return ref - (x | (ch << (7 * i)));
 }
 
+// Every variable gets a wire (plus one for each output and the clock) and
+// every AND gate and latch a cell, so the header tells us how large the
+// module tables will get before the first object is created. The header is
+// not trusted though: every latch, output and AND gate takes at least two
+// bytes of the remaining input, so larger counts are clamped to that.
+void AigerReader::reserve_tables()
+{
+	size_t max_objects = (f.size() - f.tell()) / 2;
+	size_t num_wires = std::min(size_t(M) + O + B + 2, max_objects + 2);
+	size_t num_cells = std::min(size_t(A) + L, max_objects);
+
+	module->wires_.reserve(num_wires);
+	module->wire_pool_.reserve(num_wires);
+	module->cells_.reserve(num_cells);
+	module->cell_pool_.reserve(num_cells);
+}
+
 void AigerReader::parse_aiger_binary()
 {
 	unsigned l1, l2, l3;
-	std::string line;
 
 	// Parse inputs
 	for (unsigned i = 1; i <= I; ++i) {
@@ -692,7 +763,7 @@ void AigerReader::parse_aiger_binary()
 		wire->port_output = true;
 		outputs.push_back(wire);
 	}
-	std::getline(f, line); // Ignore up to start of next line
+	f.skip_line(); // Ignore up to start of next line
 
 	// Parse bad properties
 	for (unsigned i = 0; i < B; ++i, ++line_count) {
@@ -705,19 +776,19 @@ void AigerReader::parse_aiger_binary()
 		bad_properties.push_back(wire);
 	}
 	if (B > 0)
-		std::getline(f, line); // Ignore up to start of next line
+		f.skip_line(); // Ignore up to start of next line
 
 	// TODO: Parse invariant constraints
 	for (unsigned i = 0; i < C; ++i, ++line_count)
-		std::getline(f, line); // Ignore up to start of next line
+		f.skip_line(); // Ignore up to start of next line
 
 	// TODO: Parse justice properties
 	for (unsigned i = 0; i < J; ++i, ++line_count)
-		std::getline(f, line); // Ignore up to start of next line
+		f.skip_line(); // Ignore up to start of next line
 
 	// TODO: Parse fairness constraints
 	for (unsigned i = 0; i < F; ++i, ++line_count)
-		std::getline(f, line); // Ignore up to start of next line
+		f.skip_line(); // Ignore up to start of next line
 
 	// Parse AND
 	l1 = (I+L+1) << 1;
@@ -1071,7 +1142,7 @@ struct AigerFrontend : public Frontend {
 #endif
 		}
 
-		AigerReader reader(design, *f, module_name, clk_name, map_filename, wideports);
+		AigerReader reader(design, *f, module_name, clk_name, map_filename, wideports, filename);
 		reader.parse_aiger();
 	}
 } AigerFrontend;
@@ -25,10 +25,36 @@
 
 YOSYS_NAMESPACE_BEGIN
 
+// Cursor over the in-memory image of an AIGER file, implementing the subset
+// of std::istream the reader needs without going through the stream buffer
+// for every literal.
+struct AigerInput
+{
+    const char *begin, *ptr, *end;
+    bool ok;
+
+    AigerInput(const char *data, size_t size) : begin(data), ptr(data), end(data + size), ok(true) { }
+
+    explicit operator bool() const { return ok; }
+    bool operator!() const { return !ok; }
+
+    int peek() const { return ok && ptr < end ? (unsigned char)*ptr : EOF; }
+    int get() { return ok && ptr < end ? (unsigned char)*ptr++ : EOF; }
+    void ignore(size_t n) { ptr += std::min(n, size_t(end - ptr)); }
+    size_t tell() const { return ptr - begin; }
+    size_t size() const { return end - begin; }
+
+    bool read(void *dst, size_t n);
+    void skip_line();
+    AigerInput &operator>>(unsigned &value);
+    AigerInput &operator>>(std::string &value);
+};
+
 struct AigerReader
 {
     RTLIL::Design *design;
-    std::istream &f;
+    InputBuffer buffer;
+    AigerInput f;
     RTLIL::IdString clk_name;
     RTLIL::Module *module;
     std::string map_filename;
@@ -45,11 +71,12 @@ struct AigerReader
     std::vector<RTLIL::Wire*> bad_properties;
     std::vector<RTLIL::Cell*> boxes;
 
-    AigerReader(RTLIL::Design *design, std::istream &f, RTLIL::IdString module_name, RTLIL::IdString clk_name, std::string map_filename, bool wideports);
+    AigerReader(RTLIL::Design *design, std::istream &stream, RTLIL::IdString module_name, RTLIL::IdString clk_name, std::string map_filename, bool wideports, std::string filename = std::string());
     void parse_aiger();
     void parse_xaiger();
     void parse_aiger_ascii();
     void parse_aiger_binary();
+    void reserve_tables();
     void post_process();
 };
 
@@ -29,6 +29,7 @@
 
 #include "kernel/yosys.h"
 #include "libs/sha1/sha1.h"
+#include "backends/rtlil_bin/rtlil_bin.h"
 #include "ast.h"
 
 YOSYS_NAMESPACE_BEGIN
@@ -38,22 +39,23 @@ using namespace AST_INTERNAL;
 
 // instantiate global variables (public API)
 namespace AST {
-	std::string current_filename;
-	void (*set_line_num)(int) = NULL;
-	int (*get_line_num)() = NULL;
+	thread_local std::string current_filename;
+	thread_local void (*set_line_num)(int) = NULL;
+	thread_local int (*get_line_num)() = NULL;
 }
 
 // instantiate global variables (private API)
 namespace AST_INTERNAL {
-	bool flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_vlog1, flag_dump_vlog2, flag_dump_rtlil, flag_nolatches, flag_nomeminit;
-	bool flag_nomem2reg, flag_mem2reg, flag_noblackbox, flag_lib, flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_autowire;
-	AstNode *current_ast, *current_ast_mod;
-	std::map<std::string, AstNode*> current_scope;
-	const dict<RTLIL::SigBit, RTLIL::SigBit> *genRTLIL_subst_ptr = NULL;
-	RTLIL::SigSpec ignoreThisSignalsInInitial;
-	AstNode *current_always, *current_top_block, *current_block, *current_block_child;
-	AstModule *current_module;
-	bool current_always_clocked;
+	thread_local bool flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_vlog1, flag_dump_vlog2, flag_dump_rtlil, flag_nolatches, flag_nomeminit;
+	thread_local bool flag_nomem2reg, flag_mem2reg, flag_noblackbox, flag_lib, flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_autowire;
+	thread_local std::string flag_derive_cache;
+	thread_local AstNode *current_ast, *current_ast_mod;
+	thread_local std::map<std::string, AstNode*> current_scope;
+	thread_local const dict<RTLIL::SigBit, RTLIL::SigBit> *genRTLIL_subst_ptr = NULL;
+	thread_local RTLIL::SigSpec ignoreThisSignalsInInitial;
+	thread_local AstNode *current_always, *current_top_block, *current_block, *current_block_child;
+	thread_local AstModule *current_module;
+	thread_local bool current_always_clocked;
 }
 
 // convert node types to string
@@ -182,7 +184,7 @@ bool AstNode::get_bool_attribute(RTLIL::IdString id)
 // (the optional child arguments make it easier to create AST trees)
 AstNode::AstNode(AstNodeType type, AstNode *child1, AstNode *child2, AstNode *child3)
 {
-	static unsigned int hashidx_count = 123456789;
+	static thread_local unsigned int hashidx_count = 123456789;
 	hashidx_count = mkhash_xorshift(hashidx_count);
 	hashidx_ = hashidx_count;
 
@@ -1114,6 +1116,7 @@ static AstModule* process_module(AstNode *ast, bool defer, AstNode *original_ast
 	current_module->icells = flag_icells;
 	current_module->pwires = flag_pwires;
 	current_module->autowire = flag_autowire;
+	current_module->derive_cache = flag_derive_cache;
 	current_module->fixup_ports();
 
 	if (flag_dump_rtlil) {
@@ -1125,28 +1128,78 @@ static AstModule* process_module(AstNode *ast, bool defer, AstNode *original_ast
 	return current_module;
 }
 
+// elaborate the given module ASTs and add them to 'design' in order. set_flags() must
+// set up the AST_INTERNAL flags and is also called by each worker thread.
+static void process_modules(RTLIL::Design *design, const std::vector<AstNode*> &asts, bool defer, int num_threads, std::function<void()> set_flags)
+{
+	if (num_threads <= 1 || GetSize(asts) <= 1) {
+		for (auto ast : asts)
+			design->add(process_module(ast, defer));
+		return;
+	}
+
+	std::string filename = current_filename;
+	std::vector<AstModule*> modules(GetSize(asts));
+
+	Pass::run_parallel(GetSize(asts), [&](int i) {
+		if (get_line_num == NULL) {
+			set_flags();
+			current_filename = filename;
+			use_internal_line_num();
+		}
+		modules[i] = process_module(asts[i], defer);
+	}, num_threads);
+
+	for (auto mod : modules)
+		design->add(mod);
+}
+
 // create AstModule instances for all modules in the AST tree and add them to 'design'
 void AST::process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump_ast2, bool no_dump_ptr, bool dump_vlog1, bool dump_vlog2, bool dump_rtlil,
-		bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool noblackbox, bool lib, bool nowb, bool noopt, bool icells, bool pwires, bool nooverwrite, bool overwrite, bool defer, bool autowire)
+		bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool noblackbox, bool lib, bool nowb, bool noopt, bool icells, bool pwires, bool nooverwrite, bool overwrite, bool defer, bool autowire,
+		int num_threads, std::string derive_cache)
 {
-	current_ast = ast;
-	flag_dump_ast1 = dump_ast1;
-	flag_dump_ast2 = dump_ast2;
-	flag_no_dump_ptr = no_dump_ptr;
-	flag_dump_vlog1 = dump_vlog1;
-	flag_dump_vlog2 = dump_vlog2;
-	flag_dump_rtlil = dump_rtlil;
-	flag_nolatches = nolatches;
-	flag_nomeminit = nomeminit;
-	flag_nomem2reg = nomem2reg;
-	flag_mem2reg = mem2reg;
-	flag_noblackbox = noblackbox;
-	flag_lib = lib;
-	flag_nowb = nowb;
-	flag_noopt = noopt;
-	flag_icells = icells;
-	flag_pwires = pwires;
-	flag_autowire = autowire;
+	auto set_flags = [=]() {
+		current_ast = ast;
+		flag_dump_ast1 = dump_ast1;
+		flag_dump_ast2 = dump_ast2;
+		flag_no_dump_ptr = no_dump_ptr;
+		flag_dump_vlog1 = dump_vlog1;
+		flag_dump_vlog2 = dump_vlog2;
+		flag_dump_rtlil = dump_rtlil;
+		flag_nolatches = nolatches;
+		flag_nomeminit = nomeminit;
+		flag_nomem2reg = nomem2reg;
+		flag_mem2reg = mem2reg;
+		flag_noblackbox = noblackbox;
+		flag_lib = lib;
+		flag_nowb = nowb;
+		flag_noopt = noopt;
+		flag_icells = icells;
+		flag_pwires = pwires;
+		flag_autowire = autowire;
+		flag_derive_cache = derive_cache;
+	};
+	set_flags();
+
+#ifdef YOSYS_ENABLE_THREADS
+	if (num_threads <= 0)
+		num_threads = yosys_threads;
+#else
+	num_threads = 1;
+#endif
+
+	// modules are collected in 'pending' and elaborated in batches. a batch
+	// ends early when a module is redefined, so that the redefinition is
+	// checked against the first definition like in the serial case.
+	std::vector<AstNode*> pending;
+	pool<std::string> pending_names;
+
+	auto flush_pending = [&]() {
+		process_modules(design, pending, defer, num_threads, set_flags);
+		pending.clear();
+		pending_names.clear();
+	};
 
 	log_assert(current_ast->type == AST_DESIGN);
 	for (auto it = current_ast->children.begin(); it != current_ast->children.end(); it++)
@@ -1170,6 +1223,9 @@ void AST::process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump
 			if (defer)
 				(*it)->str = "$abstract" + (*it)->str;
 
+			if (pending_names.count((*it)->str))
+				flush_pending();
+
 			if (design->has((*it)->str)) {
 				RTLIL::Module *existing_mod = design->module((*it)->str);
 				if (!nooverwrite && !overwrite && !existing_mod->get_bool_attribute("\\blackbox")) {
@@ -1186,13 +1242,18 @@ void AST::process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump
 				}
 			}
 
-			design->add(process_module(*it, defer));
+			pending.push_back(*it);
+			pending_names.insert((*it)->str);
+			if (num_threads <= 1)
+				flush_pending();
 		}
 		else if ((*it)->type == AST_PACKAGE)
 			design->verilog_packages.push_back((*it)->clone());
 		else
 			design->verilog_globals.push_back((*it)->clone());
 	}
+
+	flush_pending();
 }
 
 // AstModule destructor
@@ -1366,6 +1427,95 @@ void AstModule::reprocess_module(RTLIL::Design *design, dict<RTLIL::IdString, RT
 	mod->set_bool_attribute("\\interfaces_replaced_in_module");
 }
 
+// append everything that can influence the elaboration of 'node' to 'key'. returns false
+// if the result also depends on files or functions outside of the AST ($readmem*, DPI).
+static bool derive_cache_key(std::string &key, const AstNode *node)
+{
+	if (node->type == AST_DPI_FUNCTION)
+		return false;
+	if ((node->type == AST_TCALL || node->type == AST_FCALL) && (node->str == "\\$readmemh" || node->str == "\\$readmemb"))
+		return false;
+
+	key += stringf("(%d %d:%s %d:%s ", node->type, GetSize(node->str), node->str.c_str(), GetSize(node->filename), node->filename.c_str());
+	for (auto bit : node->bits)
+		key += '0' + bit;
+	key += stringf(" %d%d%d%d%d%d%d%d%d%d%d %d %d %d %d %u %a",
+			node->is_input, node->is_output, node->is_reg, node->is_logic, node->is_signed, node->is_string,
+			node->is_wand, node->is_wor, node->range_valid, node->range_swapped, node->is_unsized,
+			node->port_id, node->range_left, node->range_right, node->linenum, node->integer, node->realvalue);
+	for (int dim : node->multirange_dimensions)
+		key += stringf(" %d", dim);
+
+	for (auto &attr : node->attributes) {
+		key += stringf(" %s=", attr.first.c_str());
+		if (!derive_cache_key(key, attr.second))
+			return false;
+	}
+	for (auto child : node->children)
+		if (!derive_cache_key(key, child))
+			return false;
+
+	key += ")";
+	return true;
+}
+
+// generate the RTLIL for a parametric module variant (the AST_INTERNAL flags must be set up
+// with set_derive_flags()), or load it from the derive cache directory if one is set.
+static AstModule *process_derived_module(AstNode *new_ast)
+{
+	if (flag_derive_cache.empty())
+		return process_module(new_ast, false);
+
+	std::string key = stringf("%s\n%d %d%d%d%d%d%d%d%d%d%d%d\n", yosys_version_str, RTLIL_BIN::version,
+			flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_noblackbox, flag_lib,
+			flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_autowire);
+	if (!derive_cache_key(key, new_ast)) {
+		log("Not caching module `%s' as it reads memory initialization files or uses DPI functions.\n", new_ast->str.c_str());
+		return process_module(new_ast, false);
+	}
+	std::string filename = flag_derive_cache + "/" + sha1(key) + ".rtlb";
+
+	std::ifstream f(filename, std::ios::binary);
+	if (!f.fail()) {
+		log("Loading RTLIL representation for module `%s' from `%s'.\n", new_ast->str.c_str(), filename.c_str());
+		InputBuffer buffer(f, filename);
+		AstModule *mod = new AstModule;
+		RTLIL_BIN::load_module(buffer.data, buffer.size, mod);
+		if (mod->name != new_ast->str)
+			log_error("Cached module in `%s' is `%s', expected `%s'.\n", filename.c_str(), log_id(mod->name), new_ast->str.c_str());
+		mod->ast = new_ast->clone();
+		mod->nolatches = flag_nolatches;
+		mod->nomeminit = flag_nomeminit;
+		mod->nomem2reg = flag_nomem2reg;
+		mod->mem2reg = flag_mem2reg;
+		mod->noblackbox = flag_noblackbox;
+		mod->lib = flag_lib;
+		mod->nowb = flag_nowb;
+		mod->noopt = flag_noopt;
+		mod->icells = flag_icells;
+		mod->pwires = flag_pwires;
+		mod->autowire = flag_autowire;
+		mod->derive_cache = flag_derive_cache;
+		return mod;
+	}
+
+	AstModule *mod = process_module(new_ast, false);
+
+	// write to a temporary file first so that concurrent runs never see a partial file
+	std::string tmp_filename = make_temp_file(flag_derive_cache + "/.tmp_XXXXXX");
+	std::ofstream out(tmp_filename, std::ios::binary);
+	if (!out.fail()) {
+		RTLIL_BIN::dump_module(out, mod);
+		out.close();
+	}
+	if (out.fail() || rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+		log_warning("Can't store module `%s' in derive cache directory `%s'.\n", new_ast->str.c_str(), flag_derive_cache.c_str());
+		remove(tmp_filename.c_str());
+	}
+
+	return mod;
+}
+
 // create a new parametric module (when needed) and return the name of the generated module - WITH support for interfaces
 // This method is used to explode the interface when the interface is a port of the module (not instantiated inside)
 RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, dict<RTLIL::IdString, RTLIL::Module*> interfaces, dict<RTLIL::IdString, RTLIL::IdString> modports, bool mayfail)
@@ -1443,12 +1593,19 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, R
 // create a new parametric module (when needed) and return the name of the generated module - without support for interfaces
 RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, bool mayfail)
 {
+	// the variant may already have been created by derive_modules()
+	std::string modname = derived_name(parameters);
+	if (design->has(modname)) {
+		log("Found cached RTLIL representation for module `%s'.\n", modname.c_str());
+		return modname;
+	}
+
 	AstNode *new_ast = NULL;
-	std::string modname = derive_common(design, parameters, &new_ast, mayfail);
+	modname = derive_common(design, parameters, &new_ast, mayfail);
 
 	if (!design->has(modname)) {
 		new_ast->str = modname;
-		design->add(process_module(new_ast, false));
+		design->add(process_derived_module(new_ast));
 		design->module(modname)->check();
 	} else {
 		log("Found cached RTLIL representation for module `%s'.\n", modname.c_str());
@@ -1458,6 +1615,61 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, R
 	return modname;
 }
 
+// set up the AST_INTERNAL flags for deriving a variant of 'mod'
+static void set_derive_flags(const AstModule *mod)
+{
+	current_ast = NULL;
+	flag_dump_ast1 = false;
+	flag_dump_ast2 = false;
+	flag_dump_vlog1 = false;
+	flag_dump_vlog2 = false;
+	flag_nolatches = mod->nolatches;
+	flag_nomeminit = mod->nomeminit;
+	flag_nomem2reg = mod->nomem2reg;
+	flag_mem2reg = mod->mem2reg;
+	flag_noblackbox = mod->noblackbox;
+	flag_lib = mod->lib;
+	flag_nowb = mod->nowb;
+	flag_noopt = mod->noopt;
+	flag_icells = mod->icells;
+	flag_pwires = mod->pwires;
+	flag_autowire = mod->autowire;
+	flag_derive_cache = mod->derive_cache;
+	use_internal_line_num();
+}
+
+// return the name of the parametric module derive_common() creates for the given parameters
+std::string AstModule::derived_name(dict<RTLIL::IdString, RTLIL::Const> parameters) const
+{
+	std::string stripped_name = name.str();
+
+	if (stripped_name.substr(0, 9) == "$abstract")
+		stripped_name = stripped_name.substr(9);
+
+	std::string para_info;
+
+	int para_counter = 0;
+	int orig_parameters_n = parameters.size();
+	for (auto child : ast->children) {
+		if (child->type != AST_PARAMETER)
+			continue;
+		para_counter++;
+		std::string para_id = child->str;
+		if (parameters.count(para_id) == 0)
+			para_id = stringf("$%d", para_counter);
+		if (parameters.count(para_id) > 0) {
+			para_info += stringf("%s=%s", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[para_id])));
+			parameters.erase(para_id);
+		}
+	}
+
+	if (orig_parameters_n == 0)
+		return stripped_name;
+	if (para_info.size() > 60)
+		return "$paramod$" + sha1(para_info) + stripped_name;
+	return "$paramod" + stripped_name + para_info;
+}
+
 // create a new parametric module (when needed) and return the name of the generated module
 std::string AstModule::derive_common(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, AstNode **new_ast_out, bool)
 {
@@ -1468,29 +1680,12 @@ std::string AstModule::derive_common(RTLIL::Design *design, dict<RTLIL::IdString
 
 	log_header(design, "Executing AST frontend in derive mode using pre-parsed AST for module `%s'.\n", stripped_name.c_str());
 
-	current_ast = NULL;
-	flag_dump_ast1 = false;
-	flag_dump_ast2 = false;
-	flag_dump_vlog1 = false;
-	flag_dump_vlog2 = false;
-	flag_nolatches = nolatches;
-	flag_nomeminit = nomeminit;
-	flag_nomem2reg = nomem2reg;
-	flag_mem2reg = mem2reg;
-	flag_noblackbox = noblackbox;
-	flag_lib = lib;
-	flag_nowb = nowb;
-	flag_noopt = noopt;
-	flag_icells = icells;
-	flag_pwires = pwires;
-	flag_autowire = autowire;
-	use_internal_line_num();
+	set_derive_flags(this);
 
-	std::string para_info;
+	std::string modname = derived_name(parameters);
 	AstNode *new_ast = ast->clone();
 
 	int para_counter = 0;
-	int orig_parameters_n = parameters.size();
 	for (auto it = new_ast->children.begin(); it != new_ast->children.end(); it++) {
 		AstNode *child = *it;
 		if (child->type != AST_PARAMETER)
@@ -1500,7 +1695,6 @@ std::string AstModule::derive_common(RTLIL::Design *design, dict<RTLIL::IdString
 		if (parameters.count(para_id) > 0) {
 			log("Parameter %s = %s\n", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[child->str])));
 	rewrite_parameter:
-			para_info += stringf("%s=%s", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[para_id])));
 			delete child->children.at(0);
 			if ((parameters[para_id].flags & RTLIL::CONST_FLAG_STRING) != 0)
 				child->children[0] = AstNode::mkconst_str(parameters[para_id].decode_string());
@@ -1526,18 +1720,41 @@ std::string AstModule::derive_common(RTLIL::Design *design, dict<RTLIL::IdString
 		new_ast->children.push_back(defparam);
 	}
 
-	std::string modname;
+	(*new_ast_out) = new_ast;
+	return modname;
+}
+
+// create the parametric modules for several derive() calls at once
+void AST::derive_modules(RTLIL::Design *design, const std::vector<std::pair<AstModule*, dict<RTLIL::IdString, RTLIL::Const>>> &jobs, int num_threads)
+{
+	std::vector<AstModule*> sources;
+	std::vector<AstNode*> asts;
+	pool<std::string> modnames;
 
-	if (orig_parameters_n == 0)
-		modname = stripped_name;
-	else if (para_info.size() > 60)
-		modname = "$paramod$" + sha1(para_info) + stripped_name;
-	else
-		modname = "$paramod" + stripped_name + para_info;
+	for (auto &job : jobs) {
+		std::string modname = job.first->derived_name(job.second);
+		if (design->has(modname) || modnames.count(modname))
+			continue;
+		AstNode *new_ast = NULL;
+		job.first->derive_common(design, job.second, &new_ast, false);
+		new_ast->str = modname;
+		modnames.insert(modname);
+		sources.push_back(job.first);
+		asts.push_back(new_ast);
+	}
 
+	std::vector<AstModule*> modules(GetSize(asts));
 
-	(*new_ast_out) = new_ast;
-	return modname;
+	Pass::run_parallel(GetSize(asts), [&](int i) {
+		set_derive_flags(sources[i]);
+		modules[i] = process_derived_module(asts[i]);
+	}, num_threads);
+
+	for (int i = 0; i < GetSize(asts); i++) {
+		design->add(modules[i]);
+		modules[i]->check();
+		delete asts[i];
+	}
 }
 
 RTLIL::Module *AstModule::clone() const
@@ -1558,13 +1775,14 @@ RTLIL::Module *AstModule::clone() const
 	new_mod->icells = icells;
 	new_mod->pwires = pwires;
 	new_mod->autowire = autowire;
+	new_mod->derive_cache = derive_cache;
 
 	return new_mod;
 }
 
 // internal dummy line number callbacks
 namespace {
-	int internal_line_num;
+	thread_local int internal_line_num;
 	void internal_set_line_num(int n) {
 		internal_line_num = n;
 	}
@@ -285,28 +285,38 @@ namespace AST
 	};
 
 	// process an AST tree (ast must point to an AST_DESIGN node) and generate RTLIL code
+	// with num_threads > 1 (default: yosys -j) the modules are elaborated concurrently
+	// a non-empty derive_cache is the directory used for caching the parametric variants of the modules
 	void process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump_ast2, bool no_dump_ptr, bool dump_vlog1, bool dump_vlog2, bool dump_rtlil, bool nolatches, bool nomeminit,
-			bool nomem2reg, bool mem2reg, bool noblackbox, bool lib, bool nowb, bool noopt, bool icells, bool pwires, bool nooverwrite, bool overwrite, bool defer, bool autowire);
+			bool nomem2reg, bool mem2reg, bool noblackbox, bool lib, bool nowb, bool noopt, bool icells, bool pwires, bool nooverwrite, bool overwrite, bool defer, bool autowire,
+			int num_threads = 0, std::string derive_cache = std::string());
 
 	// parametric modules are supported directly by the AST library
 	// therefore we need our own derivate of RTLIL::Module with overloaded virtual functions
 	struct AstModule : RTLIL::Module {
 		AstNode *ast;
 		bool nolatches, nomeminit, nomem2reg, mem2reg, noblackbox, lib, nowb, noopt, icells, pwires, autowire;
+		std::string derive_cache;
 		~AstModule() YS_OVERRIDE;
 		RTLIL::IdString derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, bool mayfail) YS_OVERRIDE;
 		RTLIL::IdString derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, dict<RTLIL::IdString, RTLIL::Module*> interfaces, dict<RTLIL::IdString, RTLIL::IdString> modports, bool mayfail) YS_OVERRIDE;
+		std::string derived_name(dict<RTLIL::IdString, RTLIL::Const> parameters) const;
 		std::string derive_common(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, AstNode **new_ast_out, bool mayfail);
 		void reprocess_module(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Module *> local_interfaces) YS_OVERRIDE;
 		RTLIL::Module *clone() const YS_OVERRIDE;
 	};
 
+	// derive the parametric variants for all (module, parameters) pairs in 'jobs' (like AstModule::derive without
+	// interfaces), using up to num_threads threads. the new modules are added to the design in the order of 'jobs'.
+	void derive_modules(RTLIL::Design *design, const std::vector<std::pair<AstModule*, dict<RTLIL::IdString, RTLIL::Const>>> &jobs, int num_threads = 0);
+
 	// this must be set by the language frontend before parsing the sources
 	// the AstNode constructor then uses current_filename and get_line_num()
 	// to initialize the filename and linenum properties of new nodes
-	extern std::string current_filename;
-	extern void (*set_line_num)(int);
-	extern int (*get_line_num)();
+	// (these are per-thread so that modules can be elaborated concurrently)
+	extern thread_local std::string current_filename;
+	extern thread_local void (*set_line_num)(int);
+	extern thread_local int (*get_line_num)();
 
 	// set set_line_num and get_line_num to internal dummy functions (done by simplify() and AstModule::derive
 	// to control the filename and linenum properties of new nodes not generated by a frontend parser)
@@ -323,16 +333,17 @@ namespace AST
 
 namespace AST_INTERNAL
 {
-	// internal state variables
-	extern bool flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_rtlil, flag_nolatches, flag_nomeminit;
-	extern bool flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_pwires, flag_autowire;
-	extern AST::AstNode *current_ast, *current_ast_mod;
-	extern std::map<std::string, AST::AstNode*> current_scope;
-	extern const dict<RTLIL::SigBit, RTLIL::SigBit> *genRTLIL_subst_ptr;
-	extern RTLIL::SigSpec ignoreThisSignalsInInitial;
-	extern AST::AstNode *current_always, *current_top_block, *current_block, *current_block_child;
-	extern AST::AstModule *current_module;
-	extern bool current_always_clocked;
+	// internal state variables (per-thread, see AST::process())
+	extern thread_local bool flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_rtlil, flag_nolatches, flag_nomeminit;
+	extern thread_local bool flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_pwires, flag_autowire;
+	extern thread_local std::string flag_derive_cache;
+	extern thread_local AST::AstNode *current_ast, *current_ast_mod;
+	extern thread_local std::map<std::string, AST::AstNode*> current_scope;
+	extern thread_local const dict<RTLIL::SigBit, RTLIL::SigBit> *genRTLIL_subst_ptr;
+	extern thread_local RTLIL::SigSpec ignoreThisSignalsInInitial;
+	extern thread_local AST::AstNode *current_always, *current_top_block, *current_block, *current_block_child;
+	extern thread_local AST::AstModule *current_module;
+	extern thread_local bool current_always_clocked;
 	struct ProcessGenerator;
 }
 
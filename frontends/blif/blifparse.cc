@@ -21,35 +21,33 @@
 
 YOSYS_NAMESPACE_BEGIN
 
-static bool read_next_line(char *&buffer, size_t &buffer_size, int &line_count, std::istream &f)
+static bool read_next_line(char *&buffer, size_t &buffer_size, int &line_count, const char *&ptr, const char *end)
 {
-	string strbuf;
-	int buffer_len = 0;
+	size_t buffer_len = 0;
 	buffer[0] = 0;
 
 	while (1)
 	{
-		buffer_len += strlen(buffer + buffer_len);
 		while (buffer_len > 0 && (buffer[buffer_len-1] == ' ' || buffer[buffer_len-1] == '\t' ||
 				buffer[buffer_len-1] == '\r' || buffer[buffer_len-1] == '\n'))
 			buffer[--buffer_len] = 0;
 
-		if (buffer_size-buffer_len < 4096) {
-			buffer_size *= 2;
-			buffer = (char*)realloc(buffer, buffer_size);
-		}
-
 		if (buffer_len == 0 || buffer[buffer_len-1] == '\\') {
 			if (buffer_len > 0 && buffer[buffer_len-1] == '\\')
 				buffer[--buffer_len] = 0;
 			line_count++;
-			if (!std::getline(f, strbuf))
+			if (ptr == end)
 				return false;
-			while (buffer_size-buffer_len < strbuf.size()+1) {
+			const char *eol = (const char*)memchr(ptr, '\n', end - ptr);
+			size_t len = (eol ? eol : end) - ptr;
+			while (buffer_size-buffer_len < len+1) {
 				buffer_size *= 2;
 				buffer = (char*)realloc(buffer, buffer_size);
 			}
-			strcpy(buffer+buffer_len, strbuf.c_str());
+			memcpy(buffer+buffer_len, ptr, len);
+			buffer_len += strnlen(buffer+buffer_len, len);
+			buffer[buffer_len] = 0;
+			ptr = eol ? eol+1 : end;
 		} else
 			return true;
 	}
@@ -78,7 +76,7 @@ failed:
 	return std::pair<RTLIL::IdString, int>("\\" + name, 0);
 }
 
-void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bool run_clean, bool sop_mode, bool wideports)
+void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bool run_clean, bool sop_mode, bool wideports, std::string filename)
 {
 	RTLIL::Module *module = nullptr;
 	RTLIL::Const *lutptr = NULL;
@@ -123,13 +121,16 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 
 	dict<RTLIL::IdString, std::pair<int, bool>> wideports_cache;
 
+	InputBuffer input(f, filename);
+	const char *input_ptr = input.data, *input_end = input.data + input.size;
+
 	size_t buffer_size = 4096;
 	char *buffer = (char*)malloc(buffer_size);
 	int line_count = 0;
 
 	while (1)
 	{
-		if (!read_next_line(buffer, buffer_size, line_count, f)) {
+		if (!read_next_line(buffer, buffer_size, line_count, input_ptr, input_end)) {
 			if (module != nullptr)
 				goto error;
 			free(buffer);
@@ -444,7 +445,7 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 				{
 					RTLIL::State state = RTLIL::State::Sa;
 					while (1) {
-						if (!read_next_line(buffer, buffer_size, line_count, f))
+						if (!read_next_line(buffer, buffer_size, line_count, input_ptr, input_end))
 							goto error;
 						for (int i = 0; buffer[i]; i++) {
 							if (buffer[i] == ' ' || buffer[i] == '\t')
@@ -618,7 +619,7 @@ struct BlifFrontend : public Frontend {
 		}
 		extra_args(f, filename, args, argidx);
 
-		parse_blif(design, *f, "", true, sop_mode, wideports);
+		parse_blif(design, *f, "", true, sop_mode, wideports, filename);
 	}
 } BlifFrontend;
 
@@ -25,7 +25,8 @@
 YOSYS_NAMESPACE_BEGIN
 
 extern void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name,
-		bool run_clean = false, bool sop_mode = false, bool wideports = false);
+		bool run_clean = false, bool sop_mode = false, bool wideports = false,
+		std::string filename = std::string());
 
 YOSYS_NAMESPACE_END
 
@@ -0,0 +1,435 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "backends/rtlil_bin/rtlil_bin.h"
+#include "kernel/register.h"
+#include "kernel/log.h"
+#include <limits>
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace {
+
+struct RtlilBinReader
+{
+	const unsigned char *ptr, *end;
+	std::vector<RTLIL::IdString> id_table;
+	std::vector<RTLIL::Wire*> wire_table;
+	std::vector<RTLIL::State> bits_buf;
+
+	RtlilBinReader(const char *data, size_t size) :
+			ptr((const unsigned char*)data), end((const unsigned char*)data + size) { }
+
+	void need(size_t n)
+	{
+		if (size_t(end - ptr) < n)
+			log_error("Unexpected end of binary RTLIL data.\n");
+	}
+
+	uint64_t get_uint()
+	{
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			need(1);
+			unsigned char byte = *(ptr++);
+			v |= uint64_t(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return v;
+		}
+		log_error("Malformed integer in binary RTLIL data.\n");
+	}
+
+	int get_int()
+	{
+		uint64_t v = get_uint();
+		return int64_t(v >> 1) ^ -int64_t(v & 1);
+	}
+
+	int get_size()
+	{
+		uint64_t v = get_uint();
+		if (v > uint64_t(std::numeric_limits<int>::max()))
+			log_error("Malformed integer in binary RTLIL data.\n");
+		return v;
+	}
+
+	// every element takes at least one byte, which bounds the reservations
+	int get_count()
+	{
+		uint64_t v = get_uint();
+		if (v > uint64_t(end - ptr))
+			log_error("Malformed element count in binary RTLIL data.\n");
+		return v;
+	}
+
+	RTLIL::IdString get_id()
+	{
+		uint64_t idx = get_uint();
+		if (idx < id_table.size())
+			return id_table[idx];
+		if (idx != id_table.size())
+			log_error("Malformed string index in binary RTLIL data.\n");
+		size_t len = get_count();
+		need(len);
+		id_table.push_back(RTLIL::IdString(std::string((const char*)ptr, len)));
+		ptr += len;
+		return id_table.back();
+	}
+
+	void get_bits(std::vector<RTLIL::State> &bits)
+	{
+		uint64_t v = get_uint();
+		if (v > 2 * uint64_t(std::numeric_limits<int>::max()) + 1)
+			log_error("Malformed constant in binary RTLIL data.\n");
+		size_t width = v >> 1;
+		bool binary = (v & 1) == 0;
+
+		need(binary ? (width + 7) / 8 : (width + 1) / 2);
+		bits.resize(width);
+
+		if (binary) {
+			for (size_t i = 0; i < width; i++)
+				bits[i] = (ptr[i / 8] >> (i % 8)) & 1 ? RTLIL::S1 : RTLIL::S0;
+			ptr += (width + 7) / 8;
+		} else {
+			for (size_t i = 0; i < width; i++) {
+				int state = (ptr[i / 2] >> (4 * (i % 2))) & 15;
+				if (state > RTLIL::Sm)
+					log_error("Malformed constant in binary RTLIL data.\n");
+				bits[i] = RTLIL::State(state);
+			}
+			ptr += (width + 1) / 2;
+		}
+	}
+
+	RTLIL::Const get_const()
+	{
+		RTLIL::Const data;
+		data.flags = get_uint();
+		get_bits(data.bits);
+		return data;
+	}
+
+	RTLIL::SigSpec get_sigspec()
+	{
+		RTLIL::SigSpec sig;
+		int num_chunks = get_count();
+		for (int i = 0; i < num_chunks; i++) {
+			uint64_t idx = get_uint();
+			if (idx == 0) {
+				get_bits(bits_buf);
+				// a single chunk is returned as is, also when it has zero width
+				if (num_chunks == 1)
+					return RTLIL::SigSpec(RTLIL::Const(bits_buf));
+				sig.append(RTLIL::SigSpec(RTLIL::Const(bits_buf)));
+				continue;
+			}
+			if (idx > wire_table.size())
+				log_error("Malformed wire index in binary RTLIL data.\n");
+			RTLIL::Wire *wire = wire_table[idx-1];
+			int offset = get_size();
+			int width = get_size();
+			if (int64_t(offset) + width > wire->width)
+				log_error("Malformed wire slice in binary RTLIL data.\n");
+			if (num_chunks == 1)
+				return RTLIL::SigSpec(wire, offset, width);
+			sig.append(RTLIL::SigSpec(wire, offset, width));
+		}
+		return sig;
+	}
+
+	RTLIL::SigSig get_sigsig()
+	{
+		RTLIL::SigSig conn;
+		conn.first = get_sigspec();
+		conn.second = get_sigspec();
+		return conn;
+	}
+
+	void get_consts(dict<RTLIL::IdString, RTLIL::Const> &consts)
+	{
+		int count = get_count();
+		consts.reserve(count);
+		for (int i = 0; i < count; i++) {
+			RTLIL::IdString id = get_id();
+			consts[id] = get_const();
+		}
+	}
+
+	void get_case(RTLIL::CaseRule *cs)
+	{
+		get_consts(cs->attributes);
+		int num_compare = get_count();
+		for (int i = 0; i < num_compare; i++)
+			cs->compare.push_back(get_sigspec());
+		int num_actions = get_count();
+		for (int i = 0; i < num_actions; i++)
+			cs->actions.push_back(get_sigsig());
+		int num_switches = get_count();
+		for (int i = 0; i < num_switches; i++) {
+			RTLIL::SwitchRule *sw = new RTLIL::SwitchRule;
+			cs->switches.push_back(sw);
+			get_consts(sw->attributes);
+			sw->signal = get_sigspec();
+			int num_cases = get_count();
+			for (int j = 0; j < num_cases; j++) {
+				RTLIL::CaseRule *c = new RTLIL::CaseRule;
+				sw->cases.push_back(c);
+				get_case(c);
+			}
+		}
+	}
+
+	// The module is not part of a design yet and has no monitors, so the cell
+	// connections are moved into the cells directly instead of going through
+	// setPort(), which copies every SigSpec and grows the port table one
+	// entry at a time.
+	void get_module(RTLIL::Module *module)
+	{
+		get_consts(module->attributes);
+
+		int num_params = get_count();
+		for (int i = 0; i < num_params; i++)
+			module->avail_parameters.insert(get_id());
+
+		int num_wires = get_count();
+		module->wires_.reserve(num_wires);
+		module->wire_pool_.reserve(num_wires);
+		wire_table.clear();
+		wire_table.reserve(num_wires);
+		for (int i = 0; i < num_wires; i++) {
+			RTLIL::IdString name = get_id();
+			if (module->wires_.count(name))
+				log_error("Duplicate wire %s in module %s.\n", log_id(name), log_id(module));
+			RTLIL::Wire *wire = module->addWire(name);
+			int flags = get_uint();
+			wire->port_input = (flags & 1) != 0;
+			wire->port_output = (flags & 2) != 0;
+			wire->upto = (flags & 4) != 0;
+			wire->width = get_size();
+			wire->start_offset = get_int();
+			wire->port_id = get_size();
+			get_consts(wire->attributes);
+			wire_table.push_back(wire);
+		}
+
+		int num_memories = get_count();
+		for (int i = 0; i < num_memories; i++) {
+			RTLIL::Memory *memory = new RTLIL::Memory;
+			memory->name = get_id();
+			memory->width = get_size();
+			memory->start_offset = get_int();
+			memory->size = get_size();
+			get_consts(memory->attributes);
+			if (module->memories.count(memory->name))
+				log_error("Duplicate memory %s in module %s.\n", log_id(memory->name), log_id(module));
+			module->memories[memory->name] = memory;
+		}
+
+		int num_cells = get_count();
+		module->cells_.reserve(num_cells);
+		module->cell_pool_.reserve(num_cells);
+		for (int i = 0; i < num_cells; i++) {
+			RTLIL::IdString name = get_id();
+			RTLIL::IdString type = get_id();
+			if (module->cells_.count(name))
+				log_error("Duplicate cell %s in module %s.\n", log_id(name), log_id(module));
+			RTLIL::Cell *cell = module->addCell(name, type);
+			get_consts(cell->parameters);
+			get_consts(cell->attributes);
+			int num_conns = get_count();
+			cell->connections_.reserve(num_conns);
+			for (int j = 0; j < num_conns; j++) {
+				RTLIL::IdString port = get_id();
+				if (!cell->connections_.insert(std::make_pair(port, get_sigspec())).second)
+					log_error("Duplicate port %s on cell %s in module %s.\n", log_id(port), log_id(cell), log_id(module));
+			}
+		}
+
+		int num_processes = get_count();
+		for (int i = 0; i < num_processes; i++) {
+			RTLIL::Process *proc = new RTLIL::Process;
+			proc->name = get_id();
+			if (module->processes.count(proc->name))
+				log_error("Duplicate process %s in module %s.\n", log_id(proc->name), log_id(module));
+			module->processes[proc->name] = proc;
+			get_consts(proc->attributes);
+			get_case(&proc->root_case);
+			int num_syncs = get_count();
+			for (int j = 0; j < num_syncs; j++) {
+				RTLIL::SyncRule *sync = new RTLIL::SyncRule;
+				proc->syncs.push_back(sync);
+				int type = get_uint();
+				if (type > RTLIL::STi)
+					log_error("Malformed sync rule in binary RTLIL data.\n");
+				sync->type = RTLIL::SyncType(type);
+				sync->signal = get_sigspec();
+				int num_actions = get_count();
+				for (int k = 0; k < num_actions; k++)
+					sync->actions.push_back(get_sigsig());
+			}
+		}
+
+		int num_conns = get_count();
+		for (int i = 0; i < num_conns; i++)
+			module->connect(get_sigsig());
+	}
+
+	void get_header()
+	{
+		need(sizeof(RTLIL_BIN::magic));
+		if (memcmp(ptr, RTLIL_BIN::magic, sizeof(RTLIL_BIN::magic)))
+			log_error("Input is not a binary RTLIL checkpoint.\n");
+		ptr += sizeof(RTLIL_BIN::magic);
+
+		int version = get_uint();
+		if (version != RTLIL_BIN::version)
+			log_error("Unsupported binary RTLIL version %d (expected %d).\n", version, RTLIL_BIN::version);
+
+		current_autoidx() = max(current_autoidx(), get_size());
+	}
+
+	void get_single_module(RTLIL::Module *module)
+	{
+		get_header();
+		module->name = get_id();
+		get_module(module);
+		module->fixup_ports();
+
+		if (ptr != end)
+			log_error("Trailing data after binary RTLIL checkpoint.\n");
+	}
+
+	void get_design(RTLIL::Design *design, bool flag_nooverwrite, bool flag_overwrite, bool flag_lib)
+	{
+		get_header();
+
+		int num_modules = get_count();
+		for (int i = 0; i < num_modules; i++)
+		{
+			RTLIL::Module *module = new RTLIL::Module;
+			module->name = get_id();
+			get_module(module);
+
+			bool delete_module = false;
+			if (design->has(module->name)) {
+				RTLIL::Module *existing_mod = design->module(module->name);
+				if (!flag_overwrite && (flag_lib || module->get_bool_attribute("\\blackbox"))) {
+					log("Ignoring blackbox re-definition of module %s.\n", log_id(module));
+					delete_module = true;
+				} else if (!flag_nooverwrite && !flag_overwrite && !existing_mod->get_bool_attribute("\\blackbox")) {
+					log_error("Redefinition of module %s.\n", log_id(module));
+				} else if (flag_nooverwrite) {
+					log("Ignoring re-definition of module %s.\n", log_id(module));
+					delete_module = true;
+				} else {
+					log("Replacing existing%s module %s.\n", existing_mod->get_bool_attribute("\\blackbox") ? " blackbox" : "", log_id(module));
+					design->remove(existing_mod);
+				}
+			}
+
+			if (delete_module) {
+				delete module;
+				continue;
+			}
+
+			module->fixup_ports();
+			if (flag_lib)
+				module->makeblackbox();
+			design->add(module);
+		}
+
+		if (ptr != end)
+			log_error("Trailing data after binary RTLIL checkpoint.\n");
+	}
+};
+
+} /* namespace */
+
+void RTLIL_BIN::load_design(const char *data, size_t size, RTLIL::Design *design, bool flag_nooverwrite, bool flag_overwrite, bool flag_lib)
+{
+	RtlilBinReader reader(data, size);
+	reader.get_design(design, flag_nooverwrite, flag_overwrite, flag_lib);
+}
+
+void RTLIL_BIN::load_module(const char *data, size_t size, RTLIL::Module *module)
+{
+	RtlilBinReader reader(data, size);
+	reader.get_single_module(module);
+}
+
+struct RtlilBinFrontend : public Frontend {
+	RtlilBinFrontend() : Frontend("rtlil_bin", "read modules from a binary RTLIL checkpoint") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    read_rtlil_bin [filename]\n");
+		log("\n");
+		log("Load modules from a binary checkpoint file written by 'write_rtlil_bin'.\n");
+		log("\n");
+		log("    -nooverwrite\n");
+		log("        ignore re-definitions of modules. (the default behavior is to\n");
+		log("        create an error message if the existing module is not a blackbox\n");
+		log("        module, and overwrite the existing module if it is a blackbox module.)\n");
+		log("\n");
+		log("    -overwrite\n");
+		log("        overwrite existing modules with the same name\n");
+		log("\n");
+		log("    -lib\n");
+		log("        only create empty blackbox modules\n");
+		log("\n");
+	}
+	void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		bool flag_nooverwrite = false;
+		bool flag_overwrite = false;
+		bool flag_lib = false;
+
+		log_header(design, "Executing RTLIL_BIN frontend.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			std::string arg = args[argidx];
+			if (arg == "-nooverwrite") {
+				flag_nooverwrite = true;
+				flag_overwrite = false;
+				continue;
+			}
+			if (arg == "-overwrite") {
+				flag_nooverwrite = false;
+				flag_overwrite = true;
+				continue;
+			}
+			if (arg == "-lib") {
+				flag_lib = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(f, filename, args, argidx);
+
+		log("Input filename: %s\n", filename.c_str());
+
+		InputBuffer buffer(*f, filename);
+		RTLIL_BIN::load_design(buffer.data, buffer.size, design, flag_nooverwrite, flag_overwrite, flag_lib);
+	}
+} RtlilBinFrontend;
+
+YOSYS_NAMESPACE_END
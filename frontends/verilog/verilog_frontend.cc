@@ -36,7 +36,7 @@ using namespace VERILOG_FRONTEND;
 
 // use the Verilog bison/flex parser to generate an AST and use AST::process() to convert it to RTLIL
 
-static std::vector<std::string> verilog_defaults;
+std::vector<std::string> VERILOG_FRONTEND::verilog_defaults;
 static std::list<std::vector<std::string>> verilog_defaults_stack;
 
 static void error_on_dpi_function(AST::AstNode *node)
@@ -184,6 +184,19 @@ struct VerilogFrontend : public Frontend {
 		log("        to a later 'hierarchy' command. Useful in cases where the default\n");
 		log("        parameters of modules yield invalid or not synthesizable code.\n");
 		log("\n");
+		log("    -j <num>\n");
+		log("        generate the RTLIL for up to <num> modules concurrently. the default\n");
+		log("        is the number of threads given with 'yosys -j'.\n");
+		log("\n");
+		log("    -derive_cache <dir>\n");
+		log("        store the RTLIL of parametric variants of the modules (generated by\n");
+		log("        'hierarchy' for non-default parameters) in the given directory, and\n");
+		log("        load them from there instead of elaborating them again when the\n");
+		log("        module source, the parameter values and the options are unchanged.\n");
+		log("        messages printed during elaboration are not repeated when a module\n");
+		log("        is loaded from the cache. modules that use $readmemh/$readmemb or\n");
+		log("        DPI functions are never cached. the directory must exist.\n");
+		log("\n");
 		log("    -noautowire\n");
 		log("        make the default of `default_nettype be \"none\" instead of \"wire\".\n");
 		log("\n");
@@ -237,6 +250,8 @@ struct VerilogFrontend : public Frontend {
 		bool flag_defer = false;
 		bool flag_noblackbox = false;
 		bool flag_nowb = false;
+		int num_threads = 0;
+		std::string derive_cache;
 		std::map<std::string, std::string> defines_map;
 		std::list<std::string> include_dirs;
 		std::list<std::string> attributes;
@@ -390,6 +405,16 @@ struct VerilogFrontend : public Frontend {
 				flag_defer = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				num_threads = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (arg == "-derive_cache" && argidx+1 < args.size()) {
+				derive_cache = args[++argidx];
+				if (!check_file_exists(derive_cache))
+					log_cmd_error("Derive cache directory `%s' does not exist.\n", derive_cache.c_str());
+				continue;
+			}
 			if (arg == "-noautowire") {
 				default_nettype_wire = false;
 				continue;
@@ -466,7 +491,7 @@ struct VerilogFrontend : public Frontend {
 			error_on_dpi_function(current_ast);
 
 		AST::process(design, current_ast, flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_vlog1, flag_dump_vlog2, flag_dump_rtlil, flag_nolatches,
-				flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_noblackbox, lib_mode, flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_nooverwrite, flag_overwrite, flag_defer, default_nettype_wire);
+				flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_noblackbox, lib_mode, flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_nooverwrite, flag_overwrite, flag_defer, default_nettype_wire, num_threads, derive_cache);
 
 		if (!flag_nopp)
 			delete lexin;
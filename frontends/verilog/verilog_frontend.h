@@ -77,6 +77,9 @@ namespace VERILOG_FRONTEND
 
 	// lexer input stream
 	extern std::istream *lexin;
+
+	// options registered with 'verilog_defaults -add'
+	extern std::vector<std::string> verilog_defaults;
 }
 
 // the pre-processor
@@ -0,0 +1,434 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef BITSIM_H
+#define BITSIM_H
+
+#include "kernel/rtlil.h"
+#include "kernel/sigtools.h"
+#include "kernel/celltypes.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Bit-parallel random simulation of fine-grained ($_AND_, $_XOR_, $_MUX_, ...)
+// logic. Every net carries BitSim::patterns random input patterns at once, so
+// that one pass over the netlist evaluates a gate for all of them. Two nets with
+// different signatures are proven to be not equivalent, which allows SAT based
+// passes to skip all candidate pairs that do not collide in simulation.
+//
+// Only the gates listed in eval() are simulated. The outputs of all other cells,
+// combinational loops and undef constants are "unknown". Unknown nets, and all
+// nets that depend on them, never get a signature and must be handed to SAT.
+
+struct BitSim
+{
+#if defined(__GNUC__) || defined(__clang__)
+	// GCC vector extension, lowered to SSE/AVX/NEON instructions where available
+	typedef uint64_t word_t __attribute__((vector_size(32)));
+#else
+	struct word_t {
+		uint64_t w[4];
+		uint64_t &operator[](int i) { return w[i]; }
+		uint64_t operator[](int i) const { return w[i]; }
+		word_t operator~() const { word_t r; for (int i = 0; i < 4; i++) r.w[i] = ~w[i]; return r; }
+		word_t operator&(const word_t &o) const { word_t r; for (int i = 0; i < 4; i++) r.w[i] = w[i] & o.w[i]; return r; }
+		word_t operator|(const word_t &o) const { word_t r; for (int i = 0; i < 4; i++) r.w[i] = w[i] | o.w[i]; return r; }
+		word_t operator^(const word_t &o) const { word_t r; for (int i = 0; i < 4; i++) r.w[i] = w[i] ^ o.w[i]; return r; }
+	};
+#endif
+	static const int word_lanes = 4;
+	static const int patterns = 64 * word_lanes;
+
+	enum node_type_t : unsigned char {
+		N_INPUT, N_CONST0, N_CONST1, N_UNKNOWN, N_FF,
+		N_BUF, N_NOT, N_AND, N_NAND, N_OR, N_NOR, N_XOR, N_XNOR, N_ANDNOT, N_ORNOT,
+		N_MUX, N_AOI3, N_OAI3, N_AOI4, N_OAI4
+	};
+
+	struct node_t {
+		node_type_t type;
+		bool known;
+		int args[4];
+	};
+
+	const SigMap &sigmap;
+	dict<SigBit, int> bit2node;
+	pool<SigBit> unknown_bits;
+	std::vector<node_t> nodes;
+	std::vector<int> order, ffs, inputs;
+	std::vector<word_t> values;
+	std::vector<uint64_t> sig_pos, sig_neg;
+	std::vector<bool> first_bit;
+	uint64_t rng_state;
+
+	static bool cell_supported(RTLIL::IdString type)
+	{
+		return type.in("$_BUF_", "$_NOT_", "$_AND_", "$_NAND_", "$_OR_", "$_NOR_", "$_XOR_", "$_XNOR_", "$_ANDNOT_", "$_ORNOT_",
+				"$_MUX_", "$_AOI3_", "$_OAI3_", "$_AOI4_", "$_OAI4_", "$equiv");
+	}
+
+	static bool cell_is_ff(RTLIL::IdString type)
+	{
+		return type.in("$ff", "$dff", "$_FF_", "$_DFF_N_", "$_DFF_P_");
+	}
+
+	// Flip-flops are simulated with Q(t) = D(t-1), ignoring the clock, which is
+	// the same model SatGen uses. With model_ffs = false flip-flop outputs are
+	// free inputs in every frame.
+	BitSim(const SigMap &sigmap, RTLIL::Module *module, bool model_ffs = false) : sigmap(sigmap), rng_state(1)
+	{
+		add_node(N_CONST0, true);
+		add_node(N_CONST1, true);
+		add_node(N_UNKNOWN, false);
+
+		dict<SigBit, RTLIL::Cell*> bit2driver;
+
+		for (auto cell : module->cells())
+		{
+			if (!model_ffs && cell_is_ff(cell->type))
+				continue;
+
+			bool supported = cell_supported(cell->type) || cell_is_ff(cell->type);
+			bool known_type = yosys_celltypes.cell_known(cell->type);
+
+			for (auto &conn : cell->connections()) {
+				if (known_type && !yosys_celltypes.cell_output(cell->type, conn.first))
+					continue;
+				for (auto bit : sigmap(conn.second)) {
+					if (bit.wire == nullptr)
+						continue;
+					if (!supported || bit2driver.count(bit))
+						unknown_bits.insert(bit);
+					else
+						bit2driver[bit] = cell;
+				}
+			}
+		}
+
+		// depth-first topological sort, a bit on a combinational loop is unknown
+		dict<SigBit, bool> visited;
+		std::vector<std::pair<SigBit, int>> stack;
+		std::vector<SigBit> ff_bits;
+
+		for (auto &it : bit2driver)
+		{
+			if (visited.count(it.first))
+				continue;
+
+			visited[it.first] = false;
+			stack.push_back(std::pair<SigBit, int>(it.first, 0));
+
+			while (!stack.empty())
+			{
+				SigBit bit = stack.back().first;
+				RTLIL::Cell *cell = bit2driver.at(bit);
+				std::vector<SigBit> args;
+				if (!cell_is_ff(cell->type) && !unknown_bits.count(bit))
+					args = cell_args(cell, bit);
+
+				int &argidx = stack.back().second;
+				if (argidx < GetSize(args)) {
+					SigBit arg = args[argidx++];
+					if (!bit2driver.count(arg))
+						continue;
+					auto visited_it = visited.find(arg);
+					if (visited_it == visited.end()) {
+						visited[arg] = false;
+						stack.push_back(std::pair<SigBit, int>(arg, 0));
+					} else if (!visited_it->second)
+						unknown_bits.insert(arg);
+					continue;
+				}
+
+				visited[bit] = true;
+				stack.pop_back();
+
+				if (cell_is_ff(cell->type) && !unknown_bits.count(bit)) {
+					int idx = add_node(N_FF, true);
+					bit2node[bit] = idx;
+					ffs.push_back(idx);
+					ff_bits.push_back(bit);
+				} else
+					add_cell_node(bit, cell);
+			}
+		}
+
+		// flip-flops are connected after all other nodes exist
+		for (int i = 0; i < GetSize(ffs); i++)
+			nodes[ffs[i]].args[0] = node(ff_input(bit2driver.at(ff_bits[i]), ff_bits[i]));
+
+		// unknown values propagate through flip-flops
+		bool changed = !ffs.empty();
+		while (changed) {
+			changed = false;
+			for (int idx : ffs)
+				if (nodes[idx].known && !nodes[nodes[idx].args[0]].known) {
+					nodes[idx].known = false;
+					changed = true;
+				}
+			if (changed)
+				for (int idx : order)
+					update_known(idx);
+		}
+
+		unknown_bits.clear();
+		values.resize(nodes.size());
+		sig_pos.resize(nodes.size());
+		sig_neg.resize(nodes.size());
+		first_bit.resize(nodes.size());
+	}
+
+	int add_node(node_type_t type, bool known)
+	{
+		node_t n;
+		n.type = type;
+		n.known = known;
+		n.args[0] = n.args[1] = n.args[2] = n.args[3] = -1;
+		nodes.push_back(n);
+		return GetSize(nodes)-1;
+	}
+
+	// Look up the node for a bit, or create an input node for it. Must not be
+	// called with new bits after the constructor returned, use find() instead.
+	int node(SigBit bit)
+	{
+		bit = sigmap(bit);
+		if (bit.wire == nullptr)
+			return bit.data == RTLIL::State::S0 ? 0 : bit.data == RTLIL::State::S1 ? 1 : 2;
+
+		auto it = bit2node.find(bit);
+		if (it != bit2node.end())
+			return it->second;
+
+		int idx;
+		if (unknown_bits.count(bit)) {
+			idx = add_node(N_UNKNOWN, false);
+		} else {
+			idx = add_node(N_INPUT, true);
+			inputs.push_back(idx);
+		}
+		bit2node[bit] = idx;
+		return idx;
+	}
+
+	int find(SigBit bit)
+	{
+		bit = sigmap(bit);
+		if (bit.wire == nullptr)
+			return bit.data == RTLIL::State::S0 ? 0 : bit.data == RTLIL::State::S1 ? 1 : 2;
+		auto it = bit2node.find(bit);
+		return it != bit2node.end() ? it->second : -1;
+	}
+
+	std::vector<SigBit> cell_args(RTLIL::Cell *cell, SigBit out_bit)
+	{
+		std::vector<SigBit> args;
+		if (cell->type == "$equiv") {
+			SigSpec sig_y = sigmap(cell->getPort("\\Y"));
+			for (int i = 0; i < GetSize(sig_y); i++)
+				if (sig_y[i] == out_bit)
+					args.push_back(sigmap(cell->getPort("\\A"))[i]);
+			return args;
+		}
+		for (auto port : {"\\A", "\\B", "\\C", "\\D", "\\S"})
+			if (cell->hasPort(port))
+				args.push_back(sigmap(cell->getPort(port)).as_bit());
+		return args;
+	}
+
+	SigBit ff_input(RTLIL::Cell *cell, SigBit out_bit)
+	{
+		SigSpec sig_q = sigmap(cell->getPort("\\Q"));
+		SigSpec sig_d = sigmap(cell->getPort("\\D"));
+		for (int i = 0; i < GetSize(sig_q); i++)
+			if (sig_q[i] == out_bit)
+				return sig_d[i];
+		log_abort();
+	}
+
+	void add_cell_node(SigBit bit, RTLIL::Cell *cell)
+	{
+		if (unknown_bits.count(bit)) {
+			node(bit);
+			return;
+		}
+
+		std::vector<int> args;
+		for (auto arg : cell_args(cell, bit))
+			args.push_back(node(arg));
+
+		node_type_t type = N_UNKNOWN;
+		if (cell->type.in("$_BUF_", "$equiv")) type = N_BUF;
+		else if (cell->type == "$_NOT_") type = N_NOT;
+		else if (cell->type == "$_AND_") type = N_AND;
+		else if (cell->type == "$_NAND_") type = N_NAND;
+		else if (cell->type == "$_OR_") type = N_OR;
+		else if (cell->type == "$_NOR_") type = N_NOR;
+		else if (cell->type == "$_XOR_") type = N_XOR;
+		else if (cell->type == "$_XNOR_") type = N_XNOR;
+		else if (cell->type == "$_ANDNOT_") type = N_ANDNOT;
+		else if (cell->type == "$_ORNOT_") type = N_ORNOT;
+		else if (cell->type == "$_MUX_") type = N_MUX;
+		else if (cell->type == "$_AOI3_") type = N_AOI3;
+		else if (cell->type == "$_OAI3_") type = N_OAI3;
+		else if (cell->type == "$_AOI4_") type = N_AOI4;
+		else if (cell->type == "$_OAI4_") type = N_OAI4;
+		else log_abort();
+
+		int idx = add_node(type, true);
+		for (int i = 0; i < GetSize(args); i++)
+			nodes[idx].args[i] = args[i];
+		bit2node[sigmap(bit)] = idx;
+		order.push_back(idx);
+		update_known(idx);
+	}
+
+	void update_known(int idx)
+	{
+		node_t &n = nodes[idx];
+		n.known = true;
+		for (int i = 0; i < 4; i++)
+			if (n.args[i] >= 0 && !nodes[n.args[i]].known)
+				n.known = false;
+	}
+
+	uint64_t rng()
+	{
+		// xorshift64*
+		rng_state ^= rng_state >> 12;
+		rng_state ^= rng_state << 25;
+		rng_state ^= rng_state >> 27;
+		return rng_state * 2685821657736338717ULL;
+	}
+
+	void randomize(int idx)
+	{
+		for (int i = 0; i < word_lanes; i++)
+			values[idx][i] = rng();
+	}
+
+	void eval()
+	{
+		word_t *v = values.data();
+		for (int idx : order)
+		{
+			const node_t &n = nodes[idx];
+			const word_t &a = v[n.args[0]];
+			switch (n.type)
+			{
+			case N_BUF:    v[idx] = a; break;
+			case N_NOT:    v[idx] = ~a; break;
+			case N_AND:    v[idx] = a & v[n.args[1]]; break;
+			case N_NAND:   v[idx] = ~(a & v[n.args[1]]); break;
+			case N_OR:     v[idx] = a | v[n.args[1]]; break;
+			case N_NOR:    v[idx] = ~(a | v[n.args[1]]); break;
+			case N_XOR:    v[idx] = a ^ v[n.args[1]]; break;
+			case N_XNOR:   v[idx] = ~(a ^ v[n.args[1]]); break;
+			case N_ANDNOT: v[idx] = a & ~v[n.args[1]]; break;
+			case N_ORNOT:  v[idx] = a | ~v[n.args[1]]; break;
+			case N_MUX:    v[idx] = (a & ~v[n.args[2]]) | (v[n.args[1]] & v[n.args[2]]); break;
+			case N_AOI3:   v[idx] = ~((a & v[n.args[1]]) | v[n.args[2]]); break;
+			case N_OAI3:   v[idx] = ~((a | v[n.args[1]]) & v[n.args[2]]); break;
+			case N_AOI4:   v[idx] = ~((a & v[n.args[1]]) | (v[n.args[2]] & v[n.args[3]])); break;
+			case N_OAI4:   v[idx] = ~((a | v[n.args[1]]) & (v[n.args[2]] | v[n.args[3]])); break;
+			default: log_abort();
+			}
+		}
+	}
+
+	static uint64_t mix(uint64_t h, uint64_t v)
+	{
+		h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+		return h * 0xff51afd7ed558ccdULL;
+	}
+
+	// Run <rounds> times <frames> clock cycles on random input patterns and
+	// accumulate the values of the last frame of every round into the node
+	// signatures. The flip-flop state of the first frame is random.
+	void run(int rounds, int frames = 1, uint64_t seed = 1)
+	{
+		log_assert(frames >= 1);
+		rng_state = seed ? seed : 1;
+
+		std::vector<word_t> ff_next(ffs.size());
+		word_t zero, ones;
+		for (int i = 0; i < word_lanes; i++)
+			zero[i] = 0, ones[i] = ~uint64_t(0);
+		values[0] = zero;
+		values[1] = ones;
+
+		for (int round = 0; round < rounds; round++)
+		{
+			for (int idx : ffs)
+				randomize(idx);
+
+			for (int frame = 0; frame < frames; frame++)
+			{
+				if (frame > 0) {
+					for (int i = 0; i < GetSize(ffs); i++)
+						ff_next[i] = values[nodes[ffs[i]].args[0]];
+					for (int i = 0; i < GetSize(ffs); i++)
+						values[ffs[i]] = ff_next[i];
+				}
+				for (int idx : inputs)
+					randomize(idx);
+				eval();
+			}
+
+			for (int idx = 0; idx < GetSize(nodes); idx++) {
+				if (!nodes[idx].known)
+					continue;
+				if (round == 0)
+					first_bit[idx] = values[idx][0] & 1;
+				for (int i = 0; i < word_lanes; i++) {
+					sig_pos[idx] = mix(sig_pos[idx], values[idx][i]);
+					sig_neg[idx] = mix(sig_neg[idx], ~values[idx][i]);
+				}
+			}
+		}
+	}
+
+	// false if the value of the bit depends on a cell that is not simulated
+	bool known(SigBit bit)
+	{
+		int idx = find(bit);
+		return idx >= 0 && nodes[idx].known;
+	}
+
+	// Equal signatures for the same (or, with inv = true, the same or the
+	// inverted) function. Only meaningful for known bits, see known().
+	uint64_t signature(SigBit bit, bool inv = false)
+	{
+		int idx = find(bit);
+		log_assert(idx >= 0);
+		if (inv && first_bit[idx])
+			return sig_neg[idx];
+		return sig_pos[idx];
+	}
+
+	// true if the simulation found a pattern on which a and b differ
+	bool differ(SigBit a, SigBit b)
+	{
+		return known(a) && known(b) && signature(a) != signature(b);
+	}
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -39,6 +39,173 @@ static void extend_u0(RTLIL::Const &arg, int width, bool is_signed)
 	arg.bits.resize(width);
 }
 
+// Packed two-plane form of a constant, used by the word-level kernels below.
+// Bit i is undefined (any state other than 0 or 1) if undef[i] is set,
+// otherwise its value is value[i]. Bits beyond the width are zero in both
+// planes. Undefined result bits are converted back to Sx. Constants of up to
+// 128 bits are stored inline to avoid heap allocations for the common case.
+struct PackedConst
+{
+	int width, nwords;
+	uint64_t *value, *undef;
+	uint64_t inline_data[4];
+	std::vector<uint64_t> heap_data;
+
+	PackedConst(int width) : width(width), nwords((width + 63) / 64)
+	{
+		uint64_t *data = inline_data;
+		if (nwords > 2) {
+			heap_data.resize(2 * nwords);
+			data = heap_data.data();
+		} else
+			inline_data[0] = inline_data[1] = inline_data[2] = inline_data[3] = 0;
+		value = data;
+		undef = data + nwords;
+	}
+
+	PackedConst(const RTLIL::Const &arg, int width, bool is_signed) : PackedConst(width)
+	{
+		RTLIL::State padding = RTLIL::State::S0;
+		if (!arg.bits.empty() && is_signed)
+			padding = arg.bits.back();
+
+		int arg_width = min(width, GetSize(arg.bits));
+		for (int i = 0; i < arg_width; i++) {
+			RTLIL::State bit = arg.bits[i];
+			if (bit == RTLIL::State::S1)
+				value[i / 64] |= uint64_t(1) << (i % 64);
+			else if (bit != RTLIL::State::S0)
+				undef[i / 64] |= uint64_t(1) << (i % 64);
+		}
+		if (padding != RTLIL::State::S0)
+			for (int i = arg_width; i < width; i++) {
+				if (padding == RTLIL::State::S1)
+					value[i / 64] |= uint64_t(1) << (i % 64);
+				else
+					undef[i / 64] |= uint64_t(1) << (i % 64);
+			}
+	}
+
+	PackedConst(const PackedConst&) = delete;
+	void operator=(const PackedConst&) = delete;
+
+	int words() const {
+		return nwords;
+	}
+
+	uint64_t mask(int word) const {
+		if (word < words() - 1 || width % 64 == 0)
+			return ~uint64_t(0);
+		return (uint64_t(1) << (width % 64)) - 1;
+	}
+
+	RTLIL::Const to_const() const
+	{
+		RTLIL::Const result(RTLIL::State::S0, width);
+		for (int i = 0; i < width; i++) {
+			uint64_t bit = uint64_t(1) << (i % 64);
+			if (undef[i / 64] & bit)
+				result.bits[i] = RTLIL::State::Sx;
+			else if (value[i / 64] & bit)
+				result.bits[i] = RTLIL::State::S1;
+		}
+		return result;
+	}
+};
+
+static bool parity64(uint64_t x)
+{
+	x ^= x >> 32;
+	x ^= x >> 16;
+	x ^= x >> 8;
+	x ^= x >> 4;
+	x ^= x >> 2;
+	x ^= x >> 1;
+	return x & 1;
+}
+
+// Fast path for fully defined operands: returns false if arg contains undefined
+// bits or if its value does not fit into an int64_t.
+static bool const2int64(const RTLIL::Const &arg, bool as_signed, int64_t &result)
+{
+	int width = GetSize(arg.bits);
+	if (width > (as_signed ? 64 : 63))
+		return false;
+
+	uint64_t value = 0;
+	for (int i = 0; i < width; i++)
+		if (arg.bits[i] == RTLIL::State::S1)
+			value |= uint64_t(1) << i;
+		else if (arg.bits[i] != RTLIL::State::S0)
+			return false;
+
+	if (as_signed && 0 < width && width < 64 && arg.bits[width-1] == RTLIL::State::S1)
+		value |= ~uint64_t(0) << width;
+
+	result = int64_t(value);
+	return true;
+}
+
+// Like const2int64(), but for operators that work modulo 2^64 (the result is
+// not wider than 64 bits), so that 64 bit wide unsigned values are accepted.
+static bool const2uint64(const RTLIL::Const &arg, bool as_signed, uint64_t &result)
+{
+	int64_t value;
+	if (!const2int64(arg, as_signed || GetSize(arg.bits) == 64, value))
+		return false;
+	result = uint64_t(value);
+	return true;
+}
+
+// Fast path for comparisons: cmp is set to -1, 0 or 1.
+static bool const_compare64(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int &cmp)
+{
+	int64_t a, b;
+	if (const2int64(arg1, signed1, a) && const2int64(arg2, signed2, b)) {
+		cmp = a < b ? -1 : a > b ? 1 : 0;
+		return true;
+	}
+
+	uint64_t ua, ub;
+	if (!signed1 && !signed2 && const2uint64(arg1, false, ua) && const2uint64(arg2, false, ub)) {
+		cmp = ua < ub ? -1 : ua > ub ? 1 : 0;
+		return true;
+	}
+
+	return false;
+}
+
+// result_len must not be larger than 64
+static RTLIL::Const uint642const(uint64_t value, int result_len)
+{
+	RTLIL::Const result(RTLIL::State::S0, result_len);
+	for (int i = 0; i < result_len; i++)
+		if ((value >> i) & 1)
+			result.bits[i] = RTLIL::State::S1;
+	return result;
+}
+
+// S1 if arg has a bit that is 1, S0 if all bits are 0, Sx otherwise. This is
+// the truth value used by the logic operators.
+static RTLIL::State const2bool(const RTLIL::Const &arg)
+{
+	RTLIL::State result = RTLIL::State::S0;
+	for (auto bit : arg.bits)
+		if (bit == RTLIL::State::S1)
+			return RTLIL::State::S1;
+		else if (bit != RTLIL::State::S0)
+			result = RTLIL::State::Sx;
+	return result;
+}
+
+static RTLIL::Const bool2const(RTLIL::State bit, int result_len)
+{
+	RTLIL::Const result(bit);
+	while (int(result.bits.size()) < result_len)
+		result.bits.push_back(RTLIL::State::S0);
+	return result;
+}
+
 static BigInteger const2big(const RTLIL::Const &val, bool as_signed, int &undef_bit_pos)
 {
 	BigUnsigned mag;
@@ -115,111 +282,122 @@ static RTLIL::State logic_or(RTLIL::State a, RTLIL::State b)
 	return RTLIL::State::S0;
 }
 
-static RTLIL::State logic_xor(RTLIL::State a, RTLIL::State b)
-{
-	if (a != RTLIL::State::S0 && a != RTLIL::State::S1) return RTLIL::State::Sx;
-	if (b != RTLIL::State::S0 && b != RTLIL::State::S1) return RTLIL::State::Sx;
-	return a != b ? RTLIL::State::S1 : RTLIL::State::S0;
-}
-
-static RTLIL::State logic_xnor(RTLIL::State a, RTLIL::State b)
-{
-	if (a != RTLIL::State::S0 && a != RTLIL::State::S1) return RTLIL::State::Sx;
-	if (b != RTLIL::State::S0 && b != RTLIL::State::S1) return RTLIL::State::Sx;
-	return a == b ? RTLIL::State::S1 : RTLIL::State::S0;
-}
-
 RTLIL::Const RTLIL::const_not(const RTLIL::Const &arg1, const RTLIL::Const&, bool signed1, bool, int result_len)
 {
 	if (result_len < 0)
 		result_len = arg1.bits.size();
 
-	RTLIL::Const arg1_ext = arg1;
-	extend_u0(arg1_ext, result_len, signed1);
+	PackedConst a(arg1, result_len, signed1);
+	PackedConst y(result_len);
 
-	RTLIL::Const result(RTLIL::State::Sx, result_len);
-	for (size_t i = 0; i < size_t(result_len); i++) {
-		if (i >= arg1_ext.bits.size())
-			result.bits[i] = RTLIL::State::S0;
-		else if (arg1_ext.bits[i] == RTLIL::State::S0)
-			result.bits[i] = RTLIL::State::S1;
-		else if (arg1_ext.bits[i] == RTLIL::State::S1)
-			result.bits[i] = RTLIL::State::S0;
+	for (int i = 0; i < y.words(); i++) {
+		y.value[i] = ~a.value[i] & ~a.undef[i] & y.mask(i);
+		y.undef[i] = a.undef[i];
 	}
 
-	return result;
+	return y.to_const();
 }
 
-static RTLIL::Const logic_wrapper(RTLIL::State(*logic_func)(RTLIL::State, RTLIL::State),
-		RTLIL::Const arg1, RTLIL::Const arg2, bool signed1, bool signed2, int result_len = -1)
+RTLIL::Const RTLIL::const_and(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
 	if (result_len < 0)
 		result_len = max(arg1.bits.size(), arg2.bits.size());
 
-	extend_u0(arg1, result_len, signed1);
-	extend_u0(arg2, result_len, signed2);
+	PackedConst a(arg1, result_len, signed1), b(arg2, result_len, signed2);
+	PackedConst y(result_len);
 
-	RTLIL::Const result(RTLIL::State::Sx, result_len);
-	for (size_t i = 0; i < size_t(result_len); i++) {
-		RTLIL::State a = i < arg1.bits.size() ? arg1.bits[i] : RTLIL::State::S0;
-		RTLIL::State b = i < arg2.bits.size() ? arg2.bits[i] : RTLIL::State::S0;
-		result.bits[i] = logic_func(a, b);
+	for (int i = 0; i < y.words(); i++) {
+		uint64_t zero_a = ~a.value[i] & ~a.undef[i];
+		uint64_t zero_b = ~b.value[i] & ~b.undef[i];
+		y.value[i] = a.value[i] & b.value[i] & ~a.undef[i] & ~b.undef[i];
+		y.undef[i] = (a.undef[i] | b.undef[i]) & ~zero_a & ~zero_b;
 	}
 
-	return result;
-}
-
-RTLIL::Const RTLIL::const_and(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
-{
-	return logic_wrapper(logic_and, arg1, arg2, signed1, signed2, result_len);
+	return y.to_const();
 }
 
 RTLIL::Const RTLIL::const_or(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_or, arg1, arg2, signed1, signed2, result_len);
+	if (result_len < 0)
+		result_len = max(arg1.bits.size(), arg2.bits.size());
+
+	PackedConst a(arg1, result_len, signed1), b(arg2, result_len, signed2);
+	PackedConst y(result_len);
+
+	for (int i = 0; i < y.words(); i++) {
+		y.value[i] = (a.value[i] & ~a.undef[i]) | (b.value[i] & ~b.undef[i]);
+		y.undef[i] = (a.undef[i] | b.undef[i]) & ~y.value[i];
+	}
+
+	return y.to_const();
 }
 
 RTLIL::Const RTLIL::const_xor(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_xor, arg1, arg2, signed1, signed2, result_len);
+	if (result_len < 0)
+		result_len = max(arg1.bits.size(), arg2.bits.size());
+
+	PackedConst a(arg1, result_len, signed1), b(arg2, result_len, signed2);
+	PackedConst y(result_len);
+
+	for (int i = 0; i < y.words(); i++) {
+		y.undef[i] = a.undef[i] | b.undef[i];
+		y.value[i] = (a.value[i] ^ b.value[i]) & ~y.undef[i];
+	}
+
+	return y.to_const();
 }
 
 RTLIL::Const RTLIL::const_xnor(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_xnor, arg1, arg2, signed1, signed2, result_len);
-}
+	if (result_len < 0)
+		result_len = max(arg1.bits.size(), arg2.bits.size());
 
-static RTLIL::Const logic_reduce_wrapper(RTLIL::State initial, RTLIL::State(*logic_func)(RTLIL::State, RTLIL::State), const RTLIL::Const &arg1, int result_len)
-{
-	RTLIL::State temp = initial;
+	PackedConst a(arg1, result_len, signed1), b(arg2, result_len, signed2);
+	PackedConst y(result_len);
 
-	for (size_t i = 0; i < arg1.bits.size(); i++)
-		temp = logic_func(temp, arg1.bits[i]);
+	for (int i = 0; i < y.words(); i++) {
+		y.undef[i] = a.undef[i] | b.undef[i];
+		y.value[i] = ~(a.value[i] ^ b.value[i]) & ~y.undef[i] & y.mask(i);
+	}
 
-	RTLIL::Const result(temp);
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
-	return result;
+	return y.to_const();
 }
 
 RTLIL::Const RTLIL::const_reduce_and(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S1, logic_and, arg1, result_len);
+	PackedConst a(arg1, GetSize(arg1), false);
+	bool has_zero = false, has_undef = false;
+
+	for (int i = 0; i < a.words(); i++) {
+		has_zero |= (~a.value[i] & ~a.undef[i] & a.mask(i)) != 0;
+		has_undef |= a.undef[i] != 0;
+	}
+
+	return bool2const(has_zero ? RTLIL::State::S0 : has_undef ? RTLIL::State::Sx : RTLIL::State::S1, result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_or(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_or, arg1, result_len);
+	return bool2const(const2bool(arg1), result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_xor(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_xor, arg1, result_len);
+	PackedConst a(arg1, GetSize(arg1), false);
+	bool parity = false, has_undef = false;
+
+	for (int i = 0; i < a.words(); i++) {
+		parity ^= parity64(a.value[i]);
+		has_undef |= a.undef[i] != 0;
+	}
+
+	return bool2const(has_undef ? RTLIL::State::Sx : parity ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_xnor(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	RTLIL::Const buffer = logic_reduce_wrapper(RTLIL::State::S0, logic_xor, arg1, result_len);
+	RTLIL::Const buffer = RTLIL::const_reduce_xor(arg1, RTLIL::Const(), false, false, result_len);
 	if (!buffer.bits.empty()) {
 		if (buffer.bits.front() == RTLIL::State::S0)
 			buffer.bits.front() = RTLIL::State::S1;
@@ -231,58 +409,52 @@ RTLIL::Const RTLIL::const_reduce_xnor(const RTLIL::Const &arg1, const RTLIL::Con
 
 RTLIL::Const RTLIL::const_reduce_bool(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_or, arg1, result_len);
+	return bool2const(const2bool(arg1), result_len);
 }
 
-RTLIL::Const RTLIL::const_logic_not(const RTLIL::Const &arg1, const RTLIL::Const&, bool signed1, bool, int result_len)
+RTLIL::Const RTLIL::const_logic_not(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	int undef_bit_pos_a = -1;
-	BigInteger a = const2big(arg1, signed1, undef_bit_pos_a);
-	RTLIL::Const result(a.isZero() ? undef_bit_pos_a >= 0 ? RTLIL::State::Sx : RTLIL::State::S1 : RTLIL::State::S0);
-
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
-	return result;
+	RTLIL::State bit_a = const2bool(arg1);
+	return bool2const(bit_a == RTLIL::State::S0 ? RTLIL::State::S1 : bit_a == RTLIL::State::S1 ? RTLIL::State::S0 : RTLIL::State::Sx, result_len);
 }
 
-RTLIL::Const RTLIL::const_logic_and(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
+RTLIL::Const RTLIL::const_logic_and(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool, bool, int result_len)
 {
-	int undef_bit_pos_a = -1, undef_bit_pos_b = -1;
-	BigInteger a = const2big(arg1, signed1, undef_bit_pos_a);
-	BigInteger b = const2big(arg2, signed2, undef_bit_pos_b);
-
-	RTLIL::State bit_a = a.isZero() ? undef_bit_pos_a >= 0 ? RTLIL::State::Sx : RTLIL::State::S0 : RTLIL::State::S1;
-	RTLIL::State bit_b = b.isZero() ? undef_bit_pos_b >= 0 ? RTLIL::State::Sx : RTLIL::State::S0 : RTLIL::State::S1;
-	RTLIL::Const result(logic_and(bit_a, bit_b));
-
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
-	return result;
+	return bool2const(logic_and(const2bool(arg1), const2bool(arg2)), result_len);
 }
 
-RTLIL::Const RTLIL::const_logic_or(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
+RTLIL::Const RTLIL::const_logic_or(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool, bool, int result_len)
 {
-	int undef_bit_pos_a = -1, undef_bit_pos_b = -1;
-	BigInteger a = const2big(arg1, signed1, undef_bit_pos_a);
-	BigInteger b = const2big(arg2, signed2, undef_bit_pos_b);
-
-	RTLIL::State bit_a = a.isZero() ? undef_bit_pos_a >= 0 ? RTLIL::State::Sx : RTLIL::State::S0 : RTLIL::State::S1;
-	RTLIL::State bit_b = b.isZero() ? undef_bit_pos_b >= 0 ? RTLIL::State::Sx : RTLIL::State::S0 : RTLIL::State::S1;
-	RTLIL::Const result(logic_or(bit_a, bit_b));
-
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
-	return result;
+	return bool2const(logic_or(const2bool(arg1), const2bool(arg2)), result_len);
 }
 
 static RTLIL::Const const_shift_worker(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool sign_ext, int direction, int result_len)
 {
-	int undef_bit_pos = -1;
-	BigInteger offset = const2big(arg2, false, undef_bit_pos) * direction;
-
 	if (result_len < 0)
 		result_len = arg1.bits.size();
 
+	int64_t offset64;
+	if (const2int64(arg2, false, offset64))
+	{
+		// anything outside of +/- 2^40 shifts out all bits
+		offset64 = min(offset64, int64_t(1) << 40) * direction;
+
+		RTLIL::Const result(RTLIL::State::S0, result_len);
+		for (int i = 0; i < result_len; i++) {
+			int64_t pos = i + offset64;
+			if (pos < 0)
+				result.bits[i] = RTLIL::State::S0;
+			else if (pos >= GetSize(arg1.bits))
+				result.bits[i] = sign_ext ? arg1.bits.back() : RTLIL::State::S0;
+			else
+				result.bits[i] = arg1.bits[pos];
+		}
+		return result;
+	}
+
+	int undef_bit_pos = -1;
+	BigInteger offset = const2big(arg2, false, undef_bit_pos) * direction;
+
 	RTLIL::Const result(RTLIL::State::Sx, result_len);
 	if (undef_bit_pos >= 0)
 		return result;
@@ -330,12 +502,29 @@ RTLIL::Const RTLIL::const_sshr(const RTLIL::Const &arg1, const RTLIL::Const &arg
 
 static RTLIL::Const const_shift_shiftx(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool, bool signed2, int result_len, RTLIL::State other_bits)
 {
-	int undef_bit_pos = -1;
-	BigInteger offset = const2big(arg2, signed2, undef_bit_pos);
-
 	if (result_len < 0)
 		result_len = arg1.bits.size();
 
+	int64_t offset64;
+	if (const2int64(arg2, signed2, offset64))
+	{
+		// anything outside of +/- 2^40 shifts out all bits
+		offset64 = max(min(offset64, int64_t(1) << 40), -(int64_t(1) << 40));
+
+		RTLIL::Const result(RTLIL::State::Sx, result_len);
+		for (int i = 0; i < result_len; i++) {
+			int64_t pos = i + offset64;
+			if (pos < 0 || pos >= GetSize(arg1.bits))
+				result.bits[i] = other_bits;
+			else
+				result.bits[i] = arg1.bits[pos];
+		}
+		return result;
+	}
+
+	int undef_bit_pos = -1;
+	BigInteger offset = const2big(arg2, signed2, undef_bit_pos);
+
 	RTLIL::Const result(RTLIL::State::Sx, result_len);
 	if (undef_bit_pos >= 0)
 		return result;
@@ -363,43 +552,44 @@ RTLIL::Const RTLIL::const_shiftx(const RTLIL::Const &arg1, const RTLIL::Const &a
 
 RTLIL::Const RTLIL::const_lt(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int cmp;
+	if (const_compare64(arg1, arg2, signed1, signed2, cmp))
+		return bool2const(cmp < 0 ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
+
 	int undef_bit_pos = -1;
 	bool y = const2big(arg1, signed1, undef_bit_pos) < const2big(arg2, signed2, undef_bit_pos);
-	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
-
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
-	return result;
+	return bool2const(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
 }
 
 RTLIL::Const RTLIL::const_le(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int cmp;
+	if (const_compare64(arg1, arg2, signed1, signed2, cmp))
+		return bool2const(cmp <= 0 ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
+
 	int undef_bit_pos = -1;
 	bool y = const2big(arg1, signed1, undef_bit_pos) <= const2big(arg2, signed2, undef_bit_pos);
-	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
-
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
-	return result;
+	return bool2const(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
 }
 
 RTLIL::Const RTLIL::const_eq(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	RTLIL::Const arg1_ext = arg1;
-	RTLIL::Const arg2_ext = arg2;
 	RTLIL::Const result(RTLIL::State::S0, result_len);
 
-	int width = max(arg1_ext.bits.size(), arg2_ext.bits.size());
-	extend_u0(arg1_ext, width, signed1 && signed2);
-	extend_u0(arg2_ext, width, signed1 && signed2);
+	uint64_t a64, b64;
+	if (const2uint64(arg1, signed1 && signed2, a64) && const2uint64(arg2, signed1 && signed2, b64)) {
+		result.bits.front() = a64 == b64 ? RTLIL::State::S1 : RTLIL::State::S0;
+		return result;
+	}
+
+	int width = max(arg1.bits.size(), arg2.bits.size());
+	PackedConst a(arg1, width, signed1 && signed2), b(arg2, width, signed1 && signed2);
 
 	RTLIL::State matched_status = RTLIL::State::S1;
-	for (size_t i = 0; i < arg1_ext.bits.size(); i++) {
-		if (arg1_ext.bits.at(i) == RTLIL::State::S0 && arg2_ext.bits.at(i) == RTLIL::State::S1)
-			return result;
-		if (arg1_ext.bits.at(i) == RTLIL::State::S1 && arg2_ext.bits.at(i) == RTLIL::State::S0)
+	for (int i = 0; i < a.words(); i++) {
+		if ((a.value[i] ^ b.value[i]) & ~a.undef[i] & ~b.undef[i])
 			return result;
-		if (arg1_ext.bits.at(i) > RTLIL::State::S1 || arg2_ext.bits.at(i) > RTLIL::State::S1)
+		if (a.undef[i] | b.undef[i])
 			matched_status = RTLIL::State::Sx;
 	}
 
@@ -448,28 +638,36 @@ RTLIL::Const RTLIL::const_nex(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_ge(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int cmp;
+	if (const_compare64(arg1, arg2, signed1, signed2, cmp))
+		return bool2const(cmp >= 0 ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
+
 	int undef_bit_pos = -1;
 	bool y = const2big(arg1, signed1, undef_bit_pos) >= const2big(arg2, signed2, undef_bit_pos);
-	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
-
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
-	return result;
+	return bool2const(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
 }
 
 RTLIL::Const RTLIL::const_gt(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int cmp;
+	if (const_compare64(arg1, arg2, signed1, signed2, cmp))
+		return bool2const(cmp > 0 ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
+
 	int undef_bit_pos = -1;
 	bool y = const2big(arg1, signed1, undef_bit_pos) > const2big(arg2, signed2, undef_bit_pos);
-	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
-
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
-	return result;
+	return bool2const(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
 }
 
+// The fast paths of the arithmetic operators below work modulo 2^64, which is
+// exact as long as the result is not wider than 64 bits.
+
 RTLIL::Const RTLIL::const_add(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t a, b;
+	int len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	if (len <= 64 && const2uint64(arg1, signed1, a) && const2uint64(arg2, signed2, b))
+		return uint642const(a + b, len);
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) + const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), undef_bit_pos);
@@ -477,6 +675,11 @@ RTLIL::Const RTLIL::const_add(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_sub(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t a, b;
+	int len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	if (len <= 64 && const2uint64(arg1, signed1, a) && const2uint64(arg2, signed2, b))
+		return uint642const(a - b, len);
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) - const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), undef_bit_pos);
@@ -484,6 +687,11 @@ RTLIL::Const RTLIL::const_sub(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_mul(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t a, b;
+	int len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	if (len <= 64 && const2uint64(arg1, signed1, a) && const2uint64(arg2, signed2, b))
+		return uint642const(a * b, len);
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) * const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), min(undef_bit_pos, 0));
@@ -491,6 +699,24 @@ RTLIL::Const RTLIL::const_mul(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_div(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int64_t a64, b64;
+	int len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	if (len <= 64 && const2int64(arg1, signed1, a64) && const2int64(arg2, signed2, b64)) {
+		if (b64 == 0)
+			return RTLIL::Const(RTLIL::State::Sx, result_len);
+		uint64_t mag_a = a64 < 0 ? -uint64_t(a64) : uint64_t(a64);
+		uint64_t mag_b = b64 < 0 ? -uint64_t(b64) : uint64_t(b64);
+		uint64_t y = mag_a / mag_b;
+		return uint642const((a64 < 0) != (b64 < 0) ? -y : y, len);
+	}
+
+	uint64_t ua, ub;
+	if (len <= 64 && !signed1 && !signed2 && const2uint64(arg1, false, ua) && const2uint64(arg2, false, ub)) {
+		if (ub == 0)
+			return RTLIL::Const(RTLIL::State::Sx, result_len);
+		return uint642const(ua / ub, len);
+	}
+
 	int undef_bit_pos = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos);
 	BigInteger b = const2big(arg2, signed2, undef_bit_pos);
@@ -504,6 +730,24 @@ RTLIL::Const RTLIL::const_div(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_mod(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int64_t a64, b64;
+	int len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	if (len <= 64 && const2int64(arg1, signed1, a64) && const2int64(arg2, signed2, b64)) {
+		if (b64 == 0)
+			return RTLIL::Const(RTLIL::State::Sx, result_len);
+		uint64_t mag_a = a64 < 0 ? -uint64_t(a64) : uint64_t(a64);
+		uint64_t mag_b = b64 < 0 ? -uint64_t(b64) : uint64_t(b64);
+		uint64_t y = mag_a % mag_b;
+		return uint642const(a64 < 0 ? -y : y, len);
+	}
+
+	uint64_t ua, ub;
+	if (len <= 64 && !signed1 && !signed2 && const2uint64(arg1, false, ua) && const2uint64(arg2, false, ub)) {
+		if (ub == 0)
+			return RTLIL::Const(RTLIL::State::Sx, result_len);
+		return uint642const(ua % ub, len);
+	}
+
 	int undef_bit_pos = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos);
 	BigInteger b = const2big(arg2, signed2, undef_bit_pos);
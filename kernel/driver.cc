@@ -264,6 +264,10 @@ int main(int argc, char **argv)
 		printf("    -m module_file\n");
 		printf("        load the specified module (aka plugin)\n");
 		printf("\n");
+		printf("    -j <num>\n");
+		printf("        run module-local passes (e.g. opt_expr, opt_merge, flowmap) on up to\n");
+		printf("        <num> modules in parallel. the default is 1.\n");
+		printf("\n");
 		printf("    -X\n");
 		printf("        enable tracing of core data structure changes. for debugging\n");
 		printf("\n");
@@ -318,7 +322,7 @@ int main(int argc, char **argv)
 	}
 
 	int opt;
-	while ((opt = getopt(argc, argv, "MXAQTVSgm:f:Hh:b:o:p:l:L:qv:tds:c:W:w:e:D:P:E:")) != -1)
+	while ((opt = getopt(argc, argv, "MXAQTVSgj:m:f:Hh:b:o:p:l:L:qv:tds:c:W:w:e:D:P:E:")) != -1)
 	{
 		switch (opt)
 		{
@@ -328,6 +332,19 @@ int main(int argc, char **argv)
 		case 'X':
 			yosys_xtrace++;
 			break;
+		case 'j':
+			yosys_threads = atoi(optarg);
+			if (yosys_threads < 1) {
+				fprintf(stderr, "%s: invalid number of threads: %s\n", argv[0], optarg);
+				exit(1);
+			}
+#ifndef YOSYS_ENABLE_THREADS
+			if (yosys_threads > 1) {
+				fprintf(stderr, "%s: yosys was built without thread support, ignoring -j %s\n", argv[0], optarg);
+				yosys_threads = 1;
+			}
+#endif
+			break;
 		case 'A':
 			call_abort = true;
 			break;
@@ -291,16 +291,14 @@ class dict
 		return 1;
 	}
 
+	// the hash table is grown in do_insert() and never in do_lookup(), so that
+	// the const member functions do not modify the container and can be called
+	// from several threads at the same time
 	int do_lookup(const K &key, int &hash) const
 	{
 		if (hashtable.empty())
 			return -1;
 
-		if (entries.size() * hashtable_size_trigger > hashtable.size()) {
-			((dict*)this)->do_rehash();
-			hash = do_hash(key);
-		}
-
 		int index = hashtable[hash];
 
 		while (index >= 0 && !ops.cmp(entries[index].udata.first, key)) {
@@ -320,6 +318,10 @@ class dict
 		} else {
 			entries.push_back(entry_t(std::pair<K, T>(key, T()), hashtable[hash]));
 			hashtable[hash] = entries.size() - 1;
+			if (entries.size() * hashtable_size_trigger > hashtable.size()) {
+				do_rehash();
+				hash = do_hash(key);
+			}
 		}
 		return entries.size() - 1;
 	}
@@ -333,6 +335,28 @@ class dict
 		} else {
 			entries.push_back(entry_t(value, hashtable[hash]));
 			hashtable[hash] = entries.size() - 1;
+			if (entries.size() * hashtable_size_trigger > hashtable.size()) {
+				do_rehash();
+				hash = do_hash(value.first);
+			}
+		}
+		return entries.size() - 1;
+	}
+
+	int do_insert(std::pair<K, T> &&rvalue, int &hash)
+	{
+		if (hashtable.empty()) {
+			K key = rvalue.first;
+			entries.push_back(entry_t(std::move(rvalue), -1));
+			do_rehash();
+			hash = do_hash(key);
+		} else {
+			entries.push_back(entry_t(std::move(rvalue), hashtable[hash]));
+			hashtable[hash] = entries.size() - 1;
+			if (entries.size() * hashtable_size_trigger > hashtable.size()) {
+				do_rehash();
+				hash = do_hash(entries.back().udata.first);
+			}
 		}
 		return entries.size() - 1;
 	}
@@ -441,6 +465,16 @@ public:
 		return std::pair<iterator, bool>(iterator(this, i), true);
 	}
 
+	std::pair<iterator, bool> insert(std::pair<K, T> &&rvalue)
+	{
+		int hash = do_hash(rvalue.first);
+		int i = do_lookup(rvalue.first, hash);
+		if (i >= 0)
+			return std::pair<iterator, bool>(iterator(this, i), false);
+		i = do_insert(std::move(rvalue), hash);
+		return std::pair<iterator, bool>(iterator(this, i), true);
+	}
+
 	int erase(const K &key)
 	{
 		int hash = do_hash(key);
@@ -551,6 +585,13 @@ public:
 		return !operator==(other);
 	}
 
+	unsigned int hash() const {
+		unsigned int hashval = mkhash_init;
+		for (auto &it : entries)
+			hashval ^= mkhash(ops.hash(it.udata.first), hash_ops<T>::hash(it.udata.second));
+		return hashval;
+	}
+
 	void reserve(size_t n) { entries.reserve(n); }
 	size_t size() const { return entries.size(); }
 	bool empty() const { return entries.empty(); }
@@ -658,16 +699,12 @@ protected:
 		return 1;
 	}
 
+	// see dict::do_lookup()
 	int do_lookup(const K &key, int &hash) const
 	{
 		if (hashtable.empty())
 			return -1;
 
-		if (entries.size() * hashtable_size_trigger > hashtable.size()) {
-			((pool*)this)->do_rehash();
-			hash = do_hash(key);
-		}
-
 		int index = hashtable[hash];
 
 		while (index >= 0 && !ops.cmp(entries[index].udata, key)) {
@@ -687,6 +724,10 @@ protected:
 		} else {
 			entries.push_back(entry_t(value, hashtable[hash]));
 			hashtable[hash] = entries.size() - 1;
+			if (entries.size() * hashtable_size_trigger > hashtable.size()) {
+				do_rehash();
+				hash = do_hash(value);
+			}
 		}
 		return entries.size() - 1;
 	}
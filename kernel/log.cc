@@ -53,17 +53,22 @@ bool log_error_stderr = false;
 bool log_cmd_error_throw = false;
 bool log_quiet_warnings = false;
 int log_verbose_level;
-string log_last_error;
+thread_local string log_last_error;
 void (*log_error_atexit)() = NULL;
 
 int log_make_debug = 0;
 int log_force_debug = 0;
-int log_debug_suppressed = 0;
+thread_local int log_debug_suppressed = 0;
 
 vector<int> header_count;
-vector<char*> log_id_cache;
-vector<shared_str> string_buf;
-int string_buf_index = -1;
+thread_local vector<char*> log_id_cache;
+thread_local vector<shared_str> string_buf;
+thread_local int string_buf_index = -1;
+
+static thread_local std::string *log_capture_buffer = nullptr;
+#ifdef YOSYS_ENABLE_THREADS
+static std::mutex log_warning_mutex;
+#endif
 
 static struct timeval initial_tv = { 0, 0 };
 static bool next_print_log = false;
@@ -111,6 +116,11 @@ void logv(const char *format, va_list ap)
 	if (str.empty())
 		return;
 
+	if (log_capture_buffer != nullptr) {
+		*log_capture_buffer += str;
+		return;
+	}
+
 	size_t nnl_pos = str.find_last_not_of('\n');
 	if (nnl_pos == std::string::npos)
 		log_newline_count += GetSize(str);
@@ -237,6 +247,11 @@ static void logv_warning_with_prefix(const char *prefix,
 	}
 	else
 	{
+#ifdef YOSYS_ENABLE_THREADS
+		std::unique_lock<std::mutex> lock(log_warning_mutex, std::defer_lock);
+		if (log_capture_buffer != nullptr)
+			lock.lock();
+#endif
 		int bak_log_make_debug = log_make_debug;
 		log_make_debug = 0;
 
@@ -307,6 +322,14 @@ static void logv_error_with_prefix(const char *prefix,
 #ifdef EMSCRIPTEN
 	auto backup_log_files = log_files;
 #endif
+	// errors terminate the process, so the output of a worker thread that
+	// has been captured so far must be written now
+	if (log_capture_buffer != nullptr) {
+		std::string *buffer = log_capture_buffer;
+		log_capture_buffer = nullptr;
+		log("%s", buffer->c_str());
+	}
+
 	int bak_log_make_debug = log_make_debug;
 	log_make_debug = 0;
 	log_suppressed();
@@ -397,6 +420,12 @@ void log_cmd_error(const char *format, ...)
 	va_list ap;
 	va_start(ap, format);
 
+	if (log_capture_buffer != nullptr) {
+		// reported by the main thread once the worker thread has finished
+		log_last_error = vstringf(format, ap);
+		throw log_cmd_error_exception();
+	}
+
 	if (log_cmd_error_throw) {
 		log_last_error = vstringf(format, ap);
 		log("ERROR: %s", log_last_error.c_str());
@@ -524,6 +553,20 @@ void log_backtrace(const char *prefix, int levels)
 void log_backtrace(const char*, int) { }
 #endif
 
+void log_capture_begin(std::string *buffer)
+{
+	log_assert(log_capture_buffer == nullptr);
+	log_capture_buffer = buffer;
+}
+
+void log_capture_end()
+{
+	log_capture_buffer = nullptr;
+	log_id_cache_clear();
+	string_buf.clear();
+	string_buf_index = -1;
+}
+
 void log_reset_stack()
 {
 	while (header_count.size() > 1)
@@ -61,12 +61,12 @@ extern bool log_error_stderr;
 extern bool log_cmd_error_throw;
 extern bool log_quiet_warnings;
 extern int log_verbose_level;
-extern string log_last_error;
+extern thread_local string log_last_error;
 extern void (*log_error_atexit)();
 
 extern int log_make_debug;
 extern int log_force_debug;
-extern int log_debug_suppressed;
+extern thread_local int log_debug_suppressed;
 
 void logv(const char *format, va_list ap);
 void logv_header(RTLIL::Design *design, const char *format, va_list ap);
@@ -134,6 +134,13 @@ void log_backtrace(const char *prefix, int levels);
 void log_reset_stack();
 void log_flush();
 
+// Collect the log output of the calling thread in a buffer instead of writing
+// it. This is used in worker threads, and the buffer is later written to the
+// log by the main thread. log_cmd_error() only sets log_last_error and throws
+// in this mode.
+void log_capture_begin(std::string *buffer);
+void log_capture_end();
+
 const char *log_signal(const RTLIL::SigSpec &sig, bool autoint = true);
 const char *log_const(const RTLIL::Const &value, bool autoint = true);
 const char *log_id(RTLIL::IdString id);
@@ -65,6 +65,7 @@ Pass::Pass(std::string name, std::string short_help) : pass_name(name), short_he
 	first_queued_pass = this;
 	call_counter = 0;
 	runtime_ns = 0;
+	read_only = false;
 }
 
 void Pass::run_register()
@@ -81,8 +82,19 @@ void Pass::init_register()
 	}
 }
 
+void Pass::on_shutdown()
+{
+}
+
+void Pass::on_design_reset()
+{
+}
+
 void Pass::done_register()
 {
+	for (auto &it : pass_register)
+		it.second->on_shutdown();
+
 	frontend_register.clear();
 	pass_register.clear();
 	backend_register.clear();
@@ -173,6 +185,99 @@ void Pass::extra_args(std::vector<std::string> args, size_t argidx, RTLIL::Desig
 	// cmd_log_args(args);
 }
 
+void Pass::run_parallel(int num_jobs, std::function<void(int)> worker, int num_threads)
+{
+	// every job numbers its new objects starting from the same autoidx, so
+	// that the generated names do not depend on the number of threads
+	int *outer_autoidx_local = autoidx_local;
+	int &outer_autoidx = current_autoidx();
+	int base_autoidx = outer_autoidx;
+
+#ifdef YOSYS_ENABLE_THREADS
+	num_threads = std::min(num_threads > 0 ? num_threads : yosys_threads, num_jobs);
+
+	if (num_threads > 1)
+	{
+		struct job_t {
+			std::string log_buffer;
+			std::string cmd_error;
+			std::exception_ptr exception;
+			int autoidx = 0;
+		};
+
+		std::vector<job_t> jobs(num_jobs);
+		std::atomic<int> next_job(0);
+
+		auto thread_main = [&]() {
+			int *thread_autoidx_local = autoidx_local;
+			for (int i = next_job++; i < GetSize(jobs); i = next_job++)
+			{
+				job_t &job = jobs[i];
+				job.autoidx = base_autoidx;
+				autoidx_local = &job.autoidx;
+				log_capture_begin(&job.log_buffer);
+				try {
+					worker(i);
+				} catch (log_cmd_error_exception) {
+					job.cmd_error = log_last_error;
+					if (job.cmd_error.empty())
+						job.cmd_error = "Command failed in worker thread.\n";
+				} catch (...) {
+					job.exception = std::current_exception();
+				}
+				log_capture_end();
+				autoidx_local = thread_autoidx_local;
+			}
+		};
+
+		bool outer_threaded = RTLIL::IdString::global_id_threaded_;
+		RTLIL::IdString::global_id_threaded_ = true;
+
+		std::vector<std::thread> threads;
+		for (int i = 1; i < num_threads; i++)
+			threads.push_back(std::thread(thread_main));
+		thread_main();
+		for (auto &t : threads)
+			t.join();
+
+		RTLIL::IdString::global_id_threaded_ = outer_threaded;
+
+		for (auto &job : jobs)
+			outer_autoidx = std::max(outer_autoidx, job.autoidx);
+
+		for (auto &job : jobs) {
+			if (!job.log_buffer.empty())
+				log("%s", job.log_buffer.c_str());
+			if (!job.cmd_error.empty())
+				log_cmd_error("%s", job.cmd_error.c_str());
+			if (job.exception)
+				std::rethrow_exception(job.exception);
+		}
+		return;
+	}
+#endif
+
+	int job_autoidx = base_autoidx;
+	try {
+		for (int i = 0; i < num_jobs; i++) {
+			job_autoidx = base_autoidx;
+			autoidx_local = &job_autoidx;
+			worker(i);
+			autoidx_local = outer_autoidx_local;
+			outer_autoidx = std::max(outer_autoidx, job_autoidx);
+		}
+	} catch (...) {
+		autoidx_local = outer_autoidx_local;
+		outer_autoidx = std::max(outer_autoidx, job_autoidx);
+		throw;
+	}
+}
+
+void Pass::run_on_modules(const std::vector<RTLIL::Module*> &modules, std::function<void(RTLIL::Module*)> worker)
+{
+	run_parallel(GetSize(modules), [&](int i) { worker(modules[i]); });
+}
+
 void Pass::call(RTLIL::Design *design, std::string command)
 {
 	std::vector<std::string> args;
@@ -235,6 +340,16 @@ void Pass::call(RTLIL::Design *design, std::string command)
 	call(design, args);
 }
 
+// A pass may change the modules of the design unless it is read_only, in which
+// case it only needs the modules to point back to this design.
+static void prepare_shared_modules(RTLIL::Design *design, Pass *pass)
+{
+	if (pass->read_only)
+		design->claim_shared_modules();
+	else
+		design->unshare_modules();
+}
+
 void Pass::call(RTLIL::Design *design, std::vector<std::string> args)
 {
 	if (args.size() == 0 || args[0][0] == '#' || args[0][0] == ':')
@@ -250,6 +365,8 @@ void Pass::call(RTLIL::Design *design, std::vector<std::string> args)
 	if (pass_register.count(args[0]) == 0)
 		log_cmd_error("No such command: %s (type 'help' for a command overview)\n", args[0].c_str());
 
+	prepare_shared_modules(design, pass_register[args[0]]);
+
 	size_t orig_sel_stack_pos = design->selection_stack.size();
 	auto state = pass_register[args[0]]->pre_execute();
 	pass_register[args[0]]->execute(args, design);
@@ -520,6 +637,8 @@ void Frontend::frontend_call(RTLIL::Design *design, std::istream *f, std::string
 	if (frontend_register.count(args[0]) == 0)
 		log_cmd_error("No such frontend: %s\n", args[0].c_str());
 
+	prepare_shared_modules(design, frontend_register[args[0]]);
+
 	if (f != NULL) {
 		auto state = frontend_register[args[0]]->pre_execute();
 		frontend_register[args[0]]->execute(f, filename, args, design);
@@ -626,6 +745,8 @@ void Backend::backend_call(RTLIL::Design *design, std::ostream *f, std::string f
 	if (backend_register.count(args[0]) == 0)
 		log_cmd_error("No such backend: %s\n", args[0].c_str());
 
+	prepare_shared_modules(design, backend_register[args[0]]);
+
 	size_t orig_sel_stack_pos = design->selection_stack.size();
 
 	if (f != NULL) {
@@ -660,7 +781,7 @@ static struct CellHelpMessages {
 } cell_help_messages;
 
 struct HelpPass : public Pass {
-	HelpPass() : Pass("help", "display help messages") { }
+	HelpPass() : Pass("help", "display help messages") { read_only = true; }
 	void help() YS_OVERRIDE
 	{
 		log("\n");
@@ -813,7 +934,7 @@ struct HelpPass : public Pass {
 } HelpPass;
 
 struct EchoPass : public Pass {
-	EchoPass() : Pass("echo", "turning echoing back of commands on and off") { }
+	EchoPass() : Pass("echo", "turning echoing back of commands on and off") { read_only = true; }
 	void help() YS_OVERRIDE
 	{
 		log("\n");
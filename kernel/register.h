@@ -37,6 +37,12 @@ struct Pass
 	int call_counter;
 	int64_t runtime_ns;
 
+	// Set by passes that never change the modules of the design they are
+	// called for. Before any other pass runs, call() gives the design its own
+	// copy of each module it shares with a saved design, see
+	// RTLIL::Design::add_shared().
+	bool read_only;
+
 	struct pre_post_exec_state_t {
 		Pass *parent_pass;
 		int64_t begin_ns;
@@ -49,6 +55,20 @@ struct Pass
 	void cmd_error(const std::vector<std::string> &args, size_t argidx, std::string msg);
 	void extra_args(std::vector<std::string> args, size_t argidx, RTLIL::Design *design, bool select = true);
 
+	// Call worker() once for each of the given modules. When yosys has been
+	// started with -j <num> the modules are processed by several threads, so
+	// worker() must only modify the module it has been called for. The log
+	// output of the workers is written in the order of the modules. Every call
+	// numbers the names it creates with new_id() from the same autoidx, so
+	// the names do not depend on the number of threads (including -j 1).
+	// Monitor callbacks are serialized while the workers run.
+	static void run_on_modules(const std::vector<RTLIL::Module*> &modules, std::function<void(RTLIL::Module*)> worker);
+
+	// Call worker() once for each job index in [0, num_jobs), with the same
+	// threading and log handling as run_on_modules(). num_threads <= 0 means
+	// the yosys -j value.
+	static void run_parallel(int num_jobs, std::function<void(int)> worker, int num_threads = 0);
+
 	static void call(RTLIL::Design *design, std::string command);
 	static void call(RTLIL::Design *design, std::vector<std::string> args);
 
@@ -60,6 +80,8 @@ struct Pass
 
 	Pass *next_queued_pass;
 	virtual void run_register();
+	virtual void on_shutdown();
+	virtual void on_design_reset();
 	static void init_register();
 	static void done_register();
 };
@@ -29,12 +29,306 @@
 YOSYS_NAMESPACE_BEGIN
 
 RTLIL::IdString::destruct_guard_t RTLIL::IdString::destruct_guard;
-std::vector<int> RTLIL::IdString::global_refcount_storage_;
-std::vector<char*> RTLIL::IdString::global_id_storage_;
-dict<char*, int, hash_cstr_ops> RTLIL::IdString::global_id_index_;
-std::vector<int> RTLIL::IdString::global_free_idx_list_;
-int RTLIL::IdString::last_created_idx_[8];
-int RTLIL::IdString::last_created_idx_ptr_;
+std::atomic<RTLIL::IdString::id_chunk_t*> RTLIL::IdString::global_id_chunks_[RTLIL::IdString::id_max_chunks];
+RTLIL::IdString::id_shard_t RTLIL::IdString::global_id_shards_[RTLIL::IdString::id_shards];
+std::atomic<int> RTLIL::IdString::global_id_next_;
+bool RTLIL::IdString::global_id_threaded_;
+
+// Monitors do not expect to be called concurrently. While Pass::run_parallel()
+// workers are running, the notify_connect() calls for a module that has
+// monitors are therefore made with this lock held.
+struct monitor_lock_guard
+{
+#ifdef YOSYS_ENABLE_THREADS
+	static std::recursive_mutex mutex;
+	bool locked;
+
+	monitor_lock_guard(const RTLIL::Module *module) : locked(RTLIL::IdString::global_id_threaded_ &&
+			(!module->monitors.empty() || (module->design && !module->design->monitors.empty()))) {
+		if (locked)
+			mutex.lock();
+	}
+
+	~monitor_lock_guard() {
+		if (locked)
+			mutex.unlock();
+	}
+#else
+	monitor_lock_guard(const RTLIL::Module*) { }
+#endif
+};
+
+#ifdef YOSYS_ENABLE_THREADS
+std::recursive_mutex monitor_lock_guard::mutex;
+#endif
+
+static inline unsigned int id_hash(const char *p)
+{
+	unsigned int h = hash_cstr_ops::hash(p);
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	return h;
+}
+
+// the shard is selected by the top bits of the hash, the slot by the others
+static inline int id_shard_of_hash(unsigned int h)
+{
+	return h >> 28;
+}
+
+// the tables grow by half their size at 3/4 load, which keeps them smaller
+// than power-of-two tables. the slot is found by scaling the hash to the size.
+static inline int id_slot_of_hash(unsigned int h, int size)
+{
+	return ((uint64_t)(h << 4) * size) >> 32;
+}
+
+static inline int id_next_slot(int i, int size)
+{
+	return i + 1 == size ? 0 : i + 1;
+}
+
+static int id_table_find(RTLIL::IdString::id_shard_t &shard, const char *p, unsigned int h)
+{
+	int size = GetSize(shard.slots);
+	if (size == 0)
+		return -1;
+	for (int i = id_slot_of_hash(h, size);; i = id_next_slot(i, size)) {
+		const RTLIL::IdString::id_slot_t &slot = shard.slots[i];
+		if (slot.idx < 0)
+			return -1;
+		if (slot.hash == h && strcmp(RTLIL::IdString::global_id_str(slot.idx), p) == 0)
+			return slot.idx;
+	}
+}
+
+static void id_table_insert(RTLIL::IdString::id_shard_t &shard, unsigned int h, int idx)
+{
+	if (4 * (shard.num_used + 1) > 3 * GetSize(shard.slots)) {
+		std::vector<RTLIL::IdString::id_slot_t> old_slots(std::max(1024, 3 * GetSize(shard.slots) / 2), {0, -1});
+		old_slots.swap(shard.slots);
+		shard.num_used = 0;
+		for (auto &slot : old_slots)
+			if (slot.idx >= 0)
+				id_table_insert(shard, slot.hash, slot.idx);
+	}
+
+	int size = GetSize(shard.slots);
+	int i = id_slot_of_hash(h, size);
+	while (shard.slots[i].idx >= 0)
+		i = id_next_slot(i, size);
+	shard.slots[i].hash = h;
+	shard.slots[i].idx = idx;
+	shard.num_used++;
+}
+
+static void id_table_erase(RTLIL::IdString::id_shard_t &shard, unsigned int h, int idx)
+{
+	int size = GetSize(shard.slots);
+	int i = id_slot_of_hash(h, size);
+	while (shard.slots[i].idx != idx) {
+		log_assert(shard.slots[i].idx >= 0);
+		i = id_next_slot(i, size);
+	}
+
+	// backward shift deletion: move later entries of the same probe
+	// sequence into the gap, so that lookups never see a hole
+	for (int j = id_next_slot(i, size); shard.slots[j].idx >= 0; j = id_next_slot(j, size)) {
+		int k = id_slot_of_hash(shard.slots[j].hash, size);
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		shard.slots[i] = shard.slots[j];
+		i = j;
+	}
+
+	shard.slots[i].idx = -1;
+	shard.num_used--;
+}
+
+// the caller must hold the lock of the shard
+static void id_free_entry(RTLIL::IdString::id_shard_t &shard, int idx)
+{
+	char *&str = RTLIL::IdString::global_id_str(idx);
+
+	// the entry may have been revived (or freed and reused) since the
+	// reference count dropped to zero. immortal entries have a non-zero count.
+	if (str == nullptr || RTLIL::IdString::id_refcount_load(RTLIL::IdString::global_id_refcount(idx)) != 0)
+		return;
+
+	if (yosys_xtrace) {
+		log("#X# Removed IdString '%s' with index %d.\n", str, idx);
+		log_backtrace("-X- ", yosys_xtrace-1);
+	}
+
+	id_table_erase(shard, id_hash(str), idx);
+	free(str);
+	str = nullptr;
+	shard.free_idx_list.push_back(idx);
+}
+
+void RTLIL::IdString::xtrace_db_dump()
+{
+#ifdef YOSYS_XTRACE_GET_PUT
+	for (int idx = 0; idx < global_id_next_.load(std::memory_order_relaxed); idx++)
+	{
+		if (global_id_str(idx) == nullptr)
+			log("#X# DB-DUMP index %d: FREE\n", idx);
+		else if (global_id_immortal(idx))
+			log("#X# DB-DUMP index %d: '%s' (immortal)\n", idx, global_id_str(idx));
+		else
+			log("#X# DB-DUMP index %d: '%s' (ref %d)\n", idx, global_id_str(idx), id_refcount_load(global_id_refcount(idx)));
+	}
+#endif
+}
+
+void RTLIL::IdString::checkpoint()
+{
+	for (auto &shard : global_id_shards_)
+	{
+		id_lock_guard lock(shard);
+		shard.last_created_idx_ptr = 0;
+		for (int i = 0; i < 8; i++) {
+			int idx = shard.last_created_idx[i];
+			shard.last_created_idx[i] = 0;
+			if (idx == 0)
+				continue;
+			id_refcount_t &refcount = global_id_refcount(idx);
+			int value = id_refcount_load(refcount);
+			if ((value & id_immortal_flag) == 0 && id_refcount_dec(refcount, value) == 0)
+				id_free_entry(shard, idx);
+		}
+	#ifdef YOSYS_SORT_ID_FREE_LIST
+		std::sort(shard.free_idx_list.begin(), shard.free_idx_list.end(), std::greater<int>());
+	#endif
+	}
+}
+
+int RTLIL::IdString::get_reference(const char *p)
+{
+	log_assert(destruct_guard.ok);
+
+	// the empty string must end up at index 0 (see yosys_setup())
+	unsigned int h = id_hash(p);
+	int shard_idx = p[0] ? id_shard_of_hash(h) : 0;
+	id_shard_t &shard = global_id_shards_[shard_idx];
+
+	// without worker threads nothing else can change the table, so names
+	// that exist already are looked up without the lock guard
+	if (!global_id_threaded_) {
+		int found_idx = id_table_find(shard, p, h);
+		if (found_idx >= 0) {
+			get_reference(found_idx);
+		#ifdef YOSYS_XTRACE_GET_PUT
+			if (yosys_xtrace) {
+				log("#X# GET-BY-NAME '%s' (index %d, refcount %d)\n", global_id_str(found_idx), found_idx, id_refcount_load(global_id_refcount(found_idx)));
+			}
+		#endif
+			return found_idx;
+		}
+	}
+
+	id_lock_guard lock(shard);
+
+	int found_idx = id_table_find(shard, p, h);
+	if (found_idx >= 0) {
+		get_reference(found_idx);
+	#ifdef YOSYS_XTRACE_GET_PUT
+		if (yosys_xtrace) {
+			log("#X# GET-BY-NAME '%s' (index %d, refcount %d)\n", global_id_str(found_idx), found_idx, id_refcount_load(global_id_refcount(found_idx)));
+		}
+	#endif
+		return found_idx;
+	}
+
+	// only new names need to be checked, the ones in the table already were
+	if (p[0]) {
+		log_assert(p[1] != 0);
+		log_assert(p[0] == '$' || p[0] == '\\');
+	}
+
+	int idx;
+	if (shard.free_idx_list.empty()) {
+		if (global_id_threaded_)
+			idx = global_id_next_.fetch_add(1, std::memory_order_relaxed);
+		else {
+			idx = global_id_next_.load(std::memory_order_relaxed);
+			global_id_next_.store(idx + 1, std::memory_order_relaxed);
+		}
+		log_assert(idx < id_max_chunks * id_chunk_size);
+		std::atomic<id_chunk_t*> &chunk = global_id_chunks_[idx >> id_chunk_bits];
+		if (chunk.load(std::memory_order_acquire) == nullptr) {
+			// chunks are shared between shards, so they are installed atomically
+			id_chunk_t *expected = nullptr;
+			id_chunk_t *new_chunk = new id_chunk_t();
+			if (!chunk.compare_exchange_strong(expected, new_chunk, std::memory_order_acq_rel))
+				delete new_chunk;
+		}
+		global_id_chunk(idx)->shard[idx & (id_chunk_size-1)] = shard_idx;
+	} else {
+		idx = shard.free_idx_list.back();
+		shard.free_idx_list.pop_back();
+	}
+
+	// the empty string is immortal, everything else starts with one reference
+	// for the caller and one for last_created_idx
+	id_refcount_t &refcount = global_id_refcount(idx);
+	global_id_str(idx) = strdup(p);
+#ifdef YOSYS_ENABLE_THREADS
+	refcount.store(p[0] ? 2 : id_immortal_flag, std::memory_order_relaxed);
+#else
+	refcount = p[0] ? 2 : id_immortal_flag;
+#endif
+	id_table_insert(shard, h, idx);
+
+	if (p[0])
+	{
+		// Avoid Create->Delete->Create pattern
+		int &last_idx = shard.last_created_idx[shard.last_created_idx_ptr];
+		if (last_idx) {
+			id_refcount_t &last_refcount = global_id_refcount(last_idx);
+			int value = id_refcount_load(last_refcount);
+			if ((value & id_immortal_flag) == 0 && id_refcount_dec(last_refcount, value) == 0)
+				id_free_entry(shard, last_idx);
+		}
+		last_idx = idx;
+		shard.last_created_idx_ptr = (shard.last_created_idx_ptr + 1) & 7;
+	}
+
+	if (yosys_xtrace) {
+		log("#X# New IdString '%s' with index %d.\n", p, idx);
+		log_backtrace("-X- ", yosys_xtrace-1);
+	}
+
+#ifdef YOSYS_XTRACE_GET_PUT
+	if (yosys_xtrace) {
+		log("#X# GET-BY-NAME '%s' (index %d, refcount %d)\n", global_id_str(idx), idx, id_refcount_load(refcount));
+	}
+#endif
+	return idx;
+}
+
+void RTLIL::IdString::free_reference(int idx)
+{
+	id_shard_t &shard = global_id_shard(idx);
+	id_lock_guard lock(shard);
+	id_free_entry(shard, idx);
+}
+
+void RTLIL::IdString::make_immortal() const
+{
+	if (global_id_immortal(index_))
+		return;
+
+	// the flag is set atomically, so that concurrent changes of the count are
+	// not lost. once the flag is set the count is never changed again.
+	id_refcount_t &refcount = global_id_refcount(index_);
+#ifdef YOSYS_ENABLE_THREADS
+	refcount.fetch_or(id_immortal_flag, std::memory_order_relaxed);
+#else
+	refcount |= id_immortal_flag;
+#endif
+}
 
 RTLIL::Const::Const()
 {
@@ -373,6 +667,7 @@ RTLIL::Design::Design()
 	hashidx_ = hashidx_count;
 
 	refcount_modules_ = 0;
+	shares_modules_ = false;
 	selection_stack.push_back(RTLIL::Selection());
 
 #ifdef WITH_PYTHON
@@ -383,7 +678,7 @@ RTLIL::Design::Design()
 RTLIL::Design::~Design()
 {
 	for (auto it = modules_.begin(); it != modules_.end(); ++it)
-		delete it->second;
+		release(it->second);
 	for (auto n : verilog_packages)
 		delete n;
 	for (auto n : verilog_globals)
@@ -442,6 +737,89 @@ void RTLIL::Design::add(RTLIL::Module *module)
 	}
 }
 
+void RTLIL::Design::add_shared(RTLIL::Module *module)
+{
+	log_assert(module->design != nullptr && module->design != this);
+	log_assert(refcount_modules_ == 0);
+
+	// a module of the same name must have been released by the caller
+	modules_[module->name] = module;
+	module->shared_with_.push_back(this);
+	module->design->shares_modules_ = true;
+	shares_modules_ = true;
+
+	for (auto mon : monitors)
+		mon->notify_module_add(module);
+
+	if (yosys_xtrace) {
+		log("#X# New Module: %s\n", log_id(module));
+		log_backtrace("-X- ", yosys_xtrace-1);
+	}
+}
+
+void RTLIL::Design::unshare_modules()
+{
+	if (!shares_modules_)
+		return;
+	shares_modules_ = false;
+
+	for (auto &it : modules_)
+	{
+		RTLIL::Module *module = it.second;
+		if (module->design == this && module->shared_with_.empty())
+			continue;
+
+		// this design keeps the module, so that pointers to it stay valid,
+		// and the other designs listing it get one copy between them
+		std::vector<RTLIL::Design*> others;
+		if (module->design != this)
+			others.push_back(module->design);
+		for (auto other : module->shared_with_)
+			if (other != this)
+				others.push_back(other);
+
+		RTLIL::Module *copy = module->clone();
+		copy->design = others.front();
+		copy->shared_with_.assign(others.begin() + 1, others.end());
+		for (auto other : others)
+			other->modules_.at(module->name) = copy;
+
+		module->design = this;
+		module->shared_with_.clear();
+	}
+}
+
+void RTLIL::Design::claim_shared_modules()
+{
+	if (!shares_modules_)
+		return;
+
+	for (auto &it : modules_)
+	{
+		RTLIL::Module *module = it.second;
+		if (module->design == this)
+			continue;
+
+		auto this_it = std::find(module->shared_with_.begin(), module->shared_with_.end(), this);
+		log_assert(this_it != module->shared_with_.end());
+		*this_it = module->design;
+		module->design = this;
+	}
+}
+
+void RTLIL::Design::release(RTLIL::Module *module)
+{
+	if (module->design != this) {
+		auto this_it = std::find(module->shared_with_.begin(), module->shared_with_.end(), this);
+		log_assert(this_it != module->shared_with_.end());
+		module->shared_with_.erase(this_it);
+	} else if (!module->shared_with_.empty()) {
+		module->design = module->shared_with_.front();
+		module->shared_with_.erase(module->shared_with_.begin());
+	} else
+		delete module;
+}
+
 RTLIL::Module *RTLIL::Design::addModule(RTLIL::IdString name)
 {
 	log_assert(modules_.count(name) == 0);
@@ -536,7 +914,7 @@ void RTLIL::Design::remove(RTLIL::Module *module)
 
 	log_assert(modules_.at(module->name) == module);
 	modules_.erase(module->name);
-	delete module;
+	release(module);
 }
 
 void RTLIL::Design::rename(RTLIL::Module *module, RTLIL::IdString new_name)
@@ -558,7 +936,7 @@ void RTLIL::Design::check()
 {
 #ifndef NDEBUG
 	for (auto &it : modules_) {
-		log_assert(this == it.second->design);
+		log_assert(this == it.second->design || std::count(it.second->shared_with_.begin(), it.second->shared_with_.end(), this) == 1);
 		log_assert(it.first == it.second->name);
 		log_assert(!it.first.empty());
 		it.second->check();
@@ -647,11 +1025,31 @@ std::vector<RTLIL::Module*> RTLIL::Design::selected_whole_modules_warn() const
 	return result;
 }
 
+// modules, wires, cells and memories may be created by several threads at once
+// (see Pass::run_parallel()), so their hashidx counters must be updated atomically
+
+#ifdef YOSYS_ENABLE_THREADS
+typedef std::atomic<unsigned int> hashidx_counter_t;
+#else
+typedef unsigned int hashidx_counter_t;
+#endif
+
+static unsigned int next_hashidx(hashidx_counter_t &counter)
+{
+#ifdef YOSYS_ENABLE_THREADS
+	unsigned int old_value = counter.load(std::memory_order_relaxed);
+	while (!counter.compare_exchange_weak(old_value, mkhash_xorshift(old_value), std::memory_order_relaxed)) { }
+	return mkhash_xorshift(old_value);
+#else
+	counter = mkhash_xorshift(counter);
+	return counter;
+#endif
+}
+
 RTLIL::Module::Module()
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static hashidx_counter_t hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
 	design = nullptr;
 	refcount_wires_ = 0;
@@ -664,12 +1062,13 @@ RTLIL::Module::Module()
 
 RTLIL::Module::~Module()
 {
+	// the pools release their memory in bulk, so only the destructors are run here
 	for (auto it = wires_.begin(); it != wires_.end(); ++it)
-		delete it->second;
+		it->second->~Wire();
 	for (auto it = memories.begin(); it != memories.end(); ++it)
 		delete it->second;
 	for (auto it = cells_.begin(); it != cells_.end(); ++it)
-		delete it->second;
+		it->second->~Cell();
 	for (auto it = processes.begin(); it != processes.end(); ++it)
 		delete it->second;
 #ifdef WITH_PYTHON
@@ -697,8 +1096,10 @@ void RTLIL::Module::makeblackbox()
 		delete it->second;
 	memories.clear();
 
-	for (auto it = cells_.begin(); it != cells_.end(); ++it)
-		delete it->second;
+	for (auto it = cells_.begin(); it != cells_.end(); ++it) {
+		it->second->~Cell();
+		cell_pool_.deallocate(it->second);
+	}
 	cells_.clear();
 
 	for (auto it = processes.begin(); it != processes.end(); ++it)
@@ -1440,6 +1841,11 @@ void RTLIL::Module::cloneInto(RTLIL::Module *new_mod) const
 	for (auto &attr : attributes)
 		new_mod->attributes[attr.first] = attr.second;
 
+	new_mod->wires_.reserve(GetSize(new_mod->wires_) + GetSize(wires_));
+	new_mod->cells_.reserve(GetSize(new_mod->cells_) + GetSize(cells_));
+	new_mod->wire_pool_.reserve(GetSize(wires_));
+	new_mod->cell_pool_.reserve(GetSize(cells_));
+
 	for (auto &it : wires_)
 		new_mod->addWire(it.first, it.second);
 
@@ -1586,7 +1992,8 @@ void RTLIL::Module::remove(const pool<RTLIL::Wire*> &wires)
 	for (auto &it : wires) {
 		log_assert(wires_.count(it->name) != 0);
 		wires_.erase(it->name);
-		delete it;
+		it->~Wire();
+		wire_pool_.deallocate(it);
 	}
 }
 
@@ -1598,7 +2005,8 @@ void RTLIL::Module::remove(RTLIL::Cell *cell)
 	log_assert(cells_.count(cell->name) != 0);
 	log_assert(refcount_cells_ == 0);
 	cells_.erase(cell->name);
-	delete cell;
+	cell->~Cell();
+	cell_pool_.deallocate(cell);
 }
 
 void RTLIL::Module::rename(RTLIL::Wire *wire, RTLIL::IdString new_name)
@@ -1696,13 +2104,17 @@ static bool fixup_ports_compare(const RTLIL::Wire *a, const RTLIL::Wire *b)
 
 void RTLIL::Module::connect(const RTLIL::SigSig &conn)
 {
-	for (auto mon : monitors)
-		mon->notify_connect(this, conn);
+	{
+		monitor_lock_guard guard(this);
 
-	if (design)
-		for (auto mon : design->monitors)
+		for (auto mon : monitors)
 			mon->notify_connect(this, conn);
 
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_connect(this, conn);
+	}
+
 	// ignore all attempts to assign constants to other constants
 	if (conn.first.has_const()) {
 		RTLIL::SigSig new_conn;
@@ -1732,13 +2144,17 @@ void RTLIL::Module::connect(const RTLIL::SigSpec &lhs, const RTLIL::SigSpec &rhs
 
 void RTLIL::Module::new_connections(const std::vector<RTLIL::SigSig> &new_conn)
 {
-	for (auto mon : monitors)
-		mon->notify_connect(this, new_conn);
+	{
+		monitor_lock_guard guard(this);
 
-	if (design)
-		for (auto mon : design->monitors)
+		for (auto mon : monitors)
 			mon->notify_connect(this, new_conn);
 
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_connect(this, new_conn);
+	}
+
 	if (yosys_xtrace) {
 		log("#X# New connections vector in %s:\n", log_id(this));
 		for (auto &conn: new_conn)
@@ -1775,7 +2191,7 @@ void RTLIL::Module::fixup_ports()
 
 RTLIL::Wire *RTLIL::Module::addWire(RTLIL::IdString name, int width)
 {
-	RTLIL::Wire *wire = new RTLIL::Wire;
+	RTLIL::Wire *wire = new (wire_pool_.allocate()) RTLIL::Wire;
 	wire->name = name;
 	wire->width = width;
 	add(wire);
@@ -1797,19 +2213,29 @@ RTLIL::Wire *RTLIL::Module::addWire(RTLIL::IdString name, const RTLIL::Wire *oth
 
 RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, RTLIL::IdString type)
 {
-	RTLIL::Cell *cell = new RTLIL::Cell;
+	RTLIL::Cell *cell = new (cell_pool_.allocate()) RTLIL::Cell;
 	cell->name = name;
 	cell->type = type;
+
+	// the ports of internal cells are known, so that their connections
+	// can be stored without growing the table port by port
+	auto ct = yosys_celltypes.cell_types.find(type);
+	if (ct != yosys_celltypes.cell_types.end())
+		cell->connections_.reserve(GetSize(ct->second.inputs) + GetSize(ct->second.outputs));
+
 	add(cell);
 	return cell;
 }
 
 RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, const RTLIL::Cell *other)
 {
-	RTLIL::Cell *cell = addCell(name, other->type);
+	RTLIL::Cell *cell = new (cell_pool_.allocate()) RTLIL::Cell;
+	cell->name = name;
+	cell->type = other->type;
 	cell->connections_ = other->connections_;
 	cell->parameters = other->parameters;
 	cell->attributes = other->attributes;
+	add(cell);
 	return cell;
 }
 
@@ -2341,9 +2767,8 @@ RTLIL::SigSpec RTLIL::Module::Initstate(RTLIL::IdString name, const std::string
 
 RTLIL::Wire::Wire()
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static hashidx_counter_t hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
 	module = nullptr;
 	width = 1;
@@ -2375,9 +2800,8 @@ std::map<unsigned int, RTLIL::Wire*> *RTLIL::Wire::get_all_wires(void)
 
 RTLIL::Memory::Memory()
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static hashidx_counter_t hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
 	width = 1;
 	start_offset = 0;
@@ -2389,9 +2813,8 @@ RTLIL::Memory::Memory()
 
 RTLIL::Cell::Cell() : module(nullptr)
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static hashidx_counter_t hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
 	// log("#memtrace# %p\n", this);
 	memhasher();
@@ -2428,13 +2851,17 @@ void RTLIL::Cell::unsetPort(RTLIL::IdString portname)
 
 	if (conn_it != connections_.end())
 	{
-		for (auto mon : module->monitors)
-			mon->notify_connect(this, conn_it->first, conn_it->second, signal);
+		{
+			monitor_lock_guard guard(module);
 
-		if (module->design)
-			for (auto mon : module->design->monitors)
+			for (auto mon : module->monitors)
 				mon->notify_connect(this, conn_it->first, conn_it->second, signal);
 
+			if (module->design)
+				for (auto mon : module->design->monitors)
+					mon->notify_connect(this, conn_it->first, conn_it->second, signal);
+		}
+
 		if (yosys_xtrace) {
 			log("#X# Unconnect %s.%s.%s\n", log_id(this->module), log_id(this), log_id(portname));
 			log_backtrace("-X- ", yosys_xtrace-1);
@@ -2446,29 +2873,29 @@ void RTLIL::Cell::unsetPort(RTLIL::IdString portname)
 
 void RTLIL::Cell::setPort(RTLIL::IdString portname, RTLIL::SigSpec signal)
 {
-	auto conn_it = connections_.find(portname);
+	auto inserted = connections_.insert(std::make_pair(portname, RTLIL::SigSpec()));
+	auto conn_it = inserted.first;
 
-	if (conn_it == connections_.end()) {
-		connections_[portname] = RTLIL::SigSpec();
-		conn_it = connections_.find(portname);
-		log_assert(conn_it != connections_.end());
-	} else
-	if (conn_it->second == signal)
+	if (!inserted.second && conn_it->second == signal)
 		return;
 
-	for (auto mon : module->monitors)
-		mon->notify_connect(this, conn_it->first, conn_it->second, signal);
+	{
+		monitor_lock_guard guard(module);
 
-	if (module->design)
-		for (auto mon : module->design->monitors)
+		for (auto mon : module->monitors)
 			mon->notify_connect(this, conn_it->first, conn_it->second, signal);
 
+		if (module->design)
+			for (auto mon : module->design->monitors)
+				mon->notify_connect(this, conn_it->first, conn_it->second, signal);
+	}
+
 	if (yosys_xtrace) {
 		log("#X# Connect %s.%s.%s = %s (%d)\n", log_id(this->module), log_id(this), log_id(portname), log_signal(signal), GetSize(signal));
 		log_backtrace("-X- ", yosys_xtrace-1);
 	}
 
-	conn_it->second = signal;
+	conn_it->second = std::move(signal);
 }
 
 const RTLIL::SigSpec &RTLIL::Cell::getPort(RTLIL::IdString portname) const
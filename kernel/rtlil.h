@@ -80,6 +80,20 @@ namespace RTLIL
 		#undef YOSYS_SORT_ID_FREE_LIST
 
 		// the global id string cache
+		//
+		// The table is split into shards, and every string is assigned to a shard
+		// by its hash. Each shard has its own hash table, free list and lock. New
+		// indices are taken from a single counter, so that names created one after
+		// another are stored next to each other. Every entry records its shard, and
+		// an index is always recycled by the shard it came from. Entries live in
+		// fixed-size chunks that are never moved, so c_str() and copying an IdString
+		// do not need a lock. Within a chunk the reference counts are stored apart
+		// from the string pointers, so copying an IdString only touches a dense
+		// array of counters.
+		//
+		// Immortal entries (the empty string and the names created with ID() or
+		// make_immortal()) are never freed, and copying them does not change the
+		// reference count. They are marked with id_immortal_flag in the count.
 
 		static struct destruct_guard_t {
 			bool ok; // POD, will be initialized to zero
@@ -87,133 +101,159 @@ namespace RTLIL
 			~destruct_guard_t() { ok = false; }
 		} destruct_guard;
 
-		static std::vector<int> global_refcount_storage_;
-		static std::vector<char*> global_id_storage_;
-		static dict<char*, int, hash_cstr_ops> global_id_index_;
-		static std::vector<int> global_free_idx_list_;
+		enum : int {
+			id_shards = 16,
+			id_chunk_bits = 16,
+			id_chunk_size = 1 << id_chunk_bits,
+			id_max_chunks = 1 << 14,
+			id_immortal_flag = 1 << 30
+		};
 
-		static int last_created_idx_ptr_;
-		static int last_created_idx_[8];
+	#ifdef YOSYS_ENABLE_THREADS
+		typedef std::atomic<int> id_refcount_t;
+	#else
+		typedef int id_refcount_t;
+	#endif
 
-		static inline void xtrace_db_dump()
-		{
-		#ifdef YOSYS_XTRACE_GET_PUT
-			for (int idx = 0; idx < GetSize(global_id_storage_); idx++)
-			{
-				if (global_id_storage_.at(idx) == nullptr)
-					log("#X# DB-DUMP index %d: FREE\n", idx);
-				else
-					log("#X# DB-DUMP index %d: '%s' (ref %d)\n", idx, global_id_storage_.at(idx), global_refcount_storage_.at(idx));
-			}
+		struct id_chunk_t {
+			id_refcount_t refcount[id_chunk_size];
+			char *str[id_chunk_size];
+			unsigned char shard[id_chunk_size];
+		};
+
+		struct id_slot_t {
+			unsigned int hash;
+			int idx;
+		};
+
+		struct id_shard_t {
+			// open addressing with linear probing, empty slots have idx < 0
+			std::vector<id_slot_t> slots;
+			int num_used;
+			std::vector<int> free_idx_list;
+			int last_created_idx_ptr;
+			int last_created_idx[8];
+		#ifdef YOSYS_ENABLE_THREADS
+			std::mutex mutex;
 		#endif
-		}
+		};
 
-		static inline void checkpoint()
-		{
-			last_created_idx_ptr_ = 0;
-			for (int i = 0; i < 8; i++) {
-				if (last_created_idx_[i])
-					put_reference(last_created_idx_[i]);
-				last_created_idx_[i] = 0;
-			}
-		#ifdef YOSYS_SORT_ID_FREE_LIST
-			std::sort(global_free_idx_list_.begin(), global_free_idx_list_.end(), std::greater<int>());
+		static std::atomic<id_chunk_t*> global_id_chunks_[id_max_chunks];
+		static id_shard_t global_id_shards_[id_shards];
+		static std::atomic<int> global_id_next_;
+
+		// set by Pass::run_on_modules() while worker threads are running. the
+		// shard locks are only taken when this is set.
+		static bool global_id_threaded_;
+
+		struct id_lock_guard {
+		#ifdef YOSYS_ENABLE_THREADS
+			std::mutex *mutex;
+			id_lock_guard(id_shard_t &shard) : mutex(global_id_threaded_ ? &shard.mutex : nullptr) { if (mutex) mutex->lock(); }
+			~id_lock_guard() { if (mutex) mutex->unlock(); }
+		#else
+			id_lock_guard(id_shard_t&) { }
 		#endif
+		};
+
+		static inline id_chunk_t *global_id_chunk(int idx) {
+			return global_id_chunks_[idx >> id_chunk_bits].load(std::memory_order_acquire);
 		}
 
-		static inline int get_reference(int idx)
-		{
-			global_refcount_storage_.at(idx)++;
-		#ifdef YOSYS_XTRACE_GET_PUT
-			if (yosys_xtrace) {
-				log("#X# GET-BY-INDEX '%s' (index %d, refcount %d)\n", global_id_storage_.at(idx), idx, global_refcount_storage_.at(idx));
-			}
-		#endif
-			return idx;
+		static inline id_shard_t &global_id_shard(int idx) {
+			return global_id_shards_[global_id_chunk(idx)->shard[idx & (id_chunk_size-1)]];
 		}
 
-		static inline int get_reference(const char *p)
-		{
-			log_assert(destruct_guard.ok);
+		static inline id_refcount_t &global_id_refcount(int idx) {
+			return global_id_chunk(idx)->refcount[idx & (id_chunk_size-1)];
+		}
 
-			if (p[0]) {
-				log_assert(p[1] != 0);
-				log_assert(p[0] == '$' || p[0] == '\\');
-			}
+		static inline char *&global_id_str(int idx) {
+			return global_id_chunk(idx)->str[idx & (id_chunk_size-1)];
+		}
 
-			auto it = global_id_index_.find((char*)p);
-			if (it != global_id_index_.end()) {
-				global_refcount_storage_.at(it->second)++;
-		#ifdef YOSYS_XTRACE_GET_PUT
-				if (yosys_xtrace) {
-					log("#X# GET-BY-NAME '%s' (index %d, refcount %d)\n", global_id_storage_.at(it->second), it->second, global_refcount_storage_.at(it->second));
-				}
+		// reference counts only need atomic read-modify-write operations while
+		// other threads may access the table. the _inc and _dec functions get the
+		// value that the caller has just loaded with id_refcount_load().
+		static inline int id_refcount_load(const id_refcount_t &refcount) {
+		#ifdef YOSYS_ENABLE_THREADS
+			return refcount.load(std::memory_order_relaxed);
+		#else
+			return refcount;
 		#endif
-				return it->second;
-			}
+		}
 
-			if (global_free_idx_list_.empty()) {
-				log_assert(global_id_storage_.size() < 0x40000000);
-				global_free_idx_list_.push_back(global_id_storage_.size());
-				global_id_storage_.push_back(nullptr);
-				global_refcount_storage_.push_back(0);
-			}
+		static inline void id_refcount_inc(id_refcount_t &refcount, int value) {
+		#ifdef YOSYS_ENABLE_THREADS
+			if (global_id_threaded_)
+				refcount.fetch_add(1, std::memory_order_relaxed);
+			else
+				refcount.store(value + 1, std::memory_order_relaxed);
+		#else
+			refcount = value + 1;
+		#endif
+		}
 
-			int idx = global_free_idx_list_.back();
-			global_free_idx_list_.pop_back();
-			global_id_storage_.at(idx) = strdup(p);
-			global_id_index_[global_id_storage_.at(idx)] = idx;
-			global_refcount_storage_.at(idx)++;
+		static inline int id_refcount_dec(id_refcount_t &refcount, int value) {
+		#ifdef YOSYS_ENABLE_THREADS
+			if (global_id_threaded_)
+				return refcount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+			refcount.store(value - 1, std::memory_order_relaxed);
+		#else
+			refcount = value - 1;
+		#endif
+			return value - 1;
+		}
 
-			// Avoid Create->Delete->Create pattern
-			if (last_created_idx_[last_created_idx_ptr_])
-				put_reference(last_created_idx_[last_created_idx_ptr_]);
-			last_created_idx_[last_created_idx_ptr_] = idx;
-			get_reference(last_created_idx_[last_created_idx_ptr_]);
-			last_created_idx_ptr_ = (last_created_idx_ptr_ + 1) & 7;
+		static inline bool global_id_immortal(int idx) {
+			return (id_refcount_load(global_id_refcount(idx)) & id_immortal_flag) != 0;
+		}
 
-			if (yosys_xtrace) {
-				log("#X# New IdString '%s' with index %d.\n", p, idx);
-				log_backtrace("-X- ", yosys_xtrace-1);
-			}
+		static void xtrace_db_dump();
+		static void checkpoint();
 
+		static inline int get_reference(int idx)
+		{
+			id_refcount_t &refcount = global_id_refcount(idx);
+			int value = id_refcount_load(refcount);
+			if ((value & id_immortal_flag) == 0)
+				id_refcount_inc(refcount, value);
 		#ifdef YOSYS_XTRACE_GET_PUT
 			if (yosys_xtrace) {
-				log("#X# GET-BY-NAME '%s' (index %d, refcount %d)\n", global_id_storage_.at(idx), idx, global_refcount_storage_.at(idx));
+				log("#X# GET-BY-INDEX '%s' (index %d, refcount %d)\n", global_id_str(idx), idx, id_refcount_load(refcount));
 			}
 		#endif
 			return idx;
 		}
 
+		static int get_reference(const char *p);
+
 		static inline void put_reference(int idx)
 		{
 			// put_reference() may be called from destructors after the destructor of
-			// global_refcount_storage_ has been run. in this case we simply do nothing.
+			// the shards has been run. in this case we simply do nothing.
 			if (!destruct_guard.ok)
 				return;
 
+			id_refcount_t &refcount = global_id_refcount(idx);
+			int value = id_refcount_load(refcount);
+			if ((value & id_immortal_flag) != 0)
+				return;
+
 		#ifdef YOSYS_XTRACE_GET_PUT
 			if (yosys_xtrace) {
-				log("#X# PUT '%s' (index %d, refcount %d)\n", global_id_storage_.at(idx), idx, global_refcount_storage_.at(idx));
+				log("#X# PUT '%s' (index %d, refcount %d)\n", global_id_str(idx), idx, value);
 			}
 		#endif
 
-			log_assert(global_refcount_storage_.at(idx) > 0);
-
-			if (--global_refcount_storage_.at(idx) != 0)
-				return;
+			log_assert(value > 0);
 
-			if (yosys_xtrace) {
-				log("#X# Removed IdString '%s' with index %d.\n", global_id_storage_.at(idx), idx);
-				log_backtrace("-X- ", yosys_xtrace-1);
-			}
-
-			global_id_index_.erase(global_id_storage_.at(idx));
-			free(global_id_storage_.at(idx));
-			global_id_storage_.at(idx) = nullptr;
-			global_free_idx_list_.push_back(idx);
+			if (id_refcount_dec(refcount, value) == 0)
+				free_reference(idx);
 		}
 
+		static void free_reference(int idx);
+
 		// the actual IdString object is just is a single int
 
 		int index_;
@@ -240,11 +280,20 @@ namespace RTLIL
 		}
 
 		const char *c_str() const {
-			return global_id_storage_.at(index_);
+			return global_id_str(index_);
+		}
+
+		// never free this string, and stop counting references to it
+		void make_immortal() const;
+
+		static IdString immortal(const char *str) {
+			IdString id(str);
+			id.make_immortal();
+			return id;
 		}
 
 		std::string str() const {
-			return std::string(global_id_storage_.at(index_));
+			return std::string(c_str());
 		}
 
 		bool operator<(const IdString &rhs) const {
@@ -289,7 +338,7 @@ namespace RTLIL
 		}
 
 		size_t size() const {
-			return str().size();
+			return strlen(c_str());
 		}
 
 		bool empty() const {
@@ -532,6 +581,68 @@ namespace RTLIL
 		pool<T> to_pool() const { return *this; }
 		std::vector<T> to_vector() const { return *this; }
 	};
+
+	// Allocator for the wires and cells of a module. Objects are carved out of
+	// slabs that grow with the module, the slots of removed objects are reused,
+	// and all slabs are released at once when the module is destroyed. A new
+	// slab holds half as many slots as the pool has already (8 to 1024), so
+	// that small modules do not carry large unused slab tails. T only needs to
+	// be complete where allocate() and reserve() are called.
+	template<typename T>
+	struct ObjPool
+	{
+		std::vector<void*> slabs;
+		void *free_list;
+		int num_slots, num_free;
+
+		ObjPool() : free_list(nullptr), num_slots(0), num_free(0) { }
+		ObjPool(const ObjPool&) = delete;
+		void operator=(const ObjPool&) = delete;
+
+		~ObjPool() {
+			for (auto slab : slabs)
+				::operator delete(slab);
+		}
+
+		static constexpr size_t slot_size() {
+			return ((sizeof(T) > sizeof(void*) ? sizeof(T) : sizeof(void*)) + alignof(T) - 1) / alignof(T) * alignof(T);
+		}
+
+		void add_slab(int n)
+		{
+			char *slab = (char*)::operator new(n * slot_size());
+			slabs.push_back(slab);
+			for (int i = n-1; i >= 0; i--) {
+				*(void**)(slab + i*slot_size()) = free_list;
+				free_list = slab + i*slot_size();
+			}
+			num_slots += n;
+			num_free += n;
+		}
+
+		void *allocate()
+		{
+			if (free_list == nullptr)
+				add_slab(std::max(8, std::min(num_slots / 2, 1024)));
+			void *p = free_list;
+			free_list = *(void**)p;
+			num_free--;
+			return p;
+		}
+
+		void deallocate(T *obj) {
+			*(void**)obj = free_list;
+			free_list = obj;
+			num_free++;
+		}
+
+		// make room for n more objects, in a single slab if needed
+		void reserve(int n)
+		{
+			if (n > num_free)
+				add_slab(n - num_free);
+		}
+	};
 };
 
 struct RTLIL::Const
@@ -587,7 +698,7 @@ struct RTLIL::Const
 	inline unsigned int hash() const {
 		unsigned int h = mkhash_init;
 		for (auto b : bits)
-			mkhash(h, b);
+			h = mkhash(h, b);
 		return h;
 	}
 };
@@ -904,6 +1015,7 @@ struct RTLIL::Design
 
 	int refcount_modules_;
 	dict<RTLIL::IdString, RTLIL::Module*> modules_;
+	bool shares_modules_;
 	std::vector<AST::AstNode*> verilog_packages, verilog_globals;
 	dict<std::string, std::pair<std::string, bool>> verilog_defines;
 
@@ -927,6 +1039,19 @@ struct RTLIL::Design
 	void remove(RTLIL::Module *module);
 	void rename(RTLIL::Module *module, RTLIL::IdString new_name);
 
+	// A module can be listed in more than one design, so that 'design -save'
+	// and 'design -load' do not need to copy it. A shared module must not be
+	// changed: before a pass that may change the modules of this design runs,
+	// unshare_modules() gives this design the shared modules to itself and
+	// the other designs a copy. Before read-only passes, claim_shared_modules()
+	// points module->design of the shared modules to this design.
+	// release() drops this design's reference to a module (without updating
+	// modules_) and deletes the module when no other design lists it.
+	void add_shared(RTLIL::Module *module);
+	void unshare_modules();
+	void claim_shared_modules();
+	void release(RTLIL::Module *module);
+
 	void scratchpad_unset(std::string varname);
 
 	void scratchpad_set_int(std::string varname, int value);
@@ -997,6 +1122,10 @@ public:
 	RTLIL::Design *design;
 	pool<RTLIL::Monitor*> monitors;
 
+	// the designs other than 'design' that list this module, see
+	// RTLIL::Design::add_shared()
+	std::vector<RTLIL::Design*> shared_with_;
+
 	int refcount_wires_;
 	int refcount_cells_;
 
@@ -1004,6 +1133,10 @@ public:
 	dict<RTLIL::IdString, RTLIL::Cell*> cells_;
 	std::vector<RTLIL::SigSig> connections_;
 
+	// storage for the objects in wires_ and cells_
+	RTLIL::ObjPool<RTLIL::Wire> wire_pool_;
+	RTLIL::ObjPool<RTLIL::Cell> cell_pool_;
+
 	RTLIL::IdString name;
 	pool<RTLIL::IdString> avail_parameters;
 	dict<RTLIL::IdString, RTLIL::Memory*> memories;
@@ -41,12 +41,16 @@
 #  include <unistd.h>
 #  include <dirent.h>
 #  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
 #else
 #  include <unistd.h>
 #  include <dirent.h>
 #  include <sys/types.h>
 #  include <sys/wait.h>
 #  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
 #endif
 
 #if !defined(_WIN32) && defined(YOSYS_ENABLE_GLOB)
@@ -74,6 +78,8 @@ YOSYS_NAMESPACE_BEGIN
 
 int autoidx = 1;
 int yosys_xtrace = 0;
+int yosys_threads = 1;
+thread_local int *autoidx_local = nullptr;
 RTLIL::Design *yosys_design = NULL;
 CellTypes yosys_celltypes;
 
@@ -498,6 +504,42 @@ std::string escape_filename_spaces(const std::string& filename)
 	return out;
 }
 
+InputBuffer::InputBuffer(std::istream &f, const std::string &filename) : data(nullptr), size(0), mapped(nullptr)
+{
+#ifndef _WIN32
+	std::ifstream *ff = dynamic_cast<std::ifstream*>(&f);
+	if (ff != nullptr && !filename.empty() && ff->tellg() == std::streampos(0))
+	{
+		int fd = open(filename.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+			void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) {
+				madvise(addr, st.st_size, MADV_SEQUENTIAL);
+				mapped = addr;
+				data = (const char*)addr;
+				size = st.st_size;
+			}
+		}
+		if (fd >= 0)
+			close(fd);
+		if (mapped != nullptr)
+			return;
+	}
+#endif
+	copy.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	data = copy.data();
+	size = copy.size();
+}
+
+InputBuffer::~InputBuffer()
+{
+#ifndef _WIN32
+	if (mapped != nullptr)
+		munmap(mapped, size);
+#endif
+}
+
 int GetSize(RTLIL::Wire *wire)
 {
 	return wire->width;
@@ -524,6 +566,16 @@ void yosys_setup()
 	Pass::init_register();
 	yosys_design = new RTLIL::Design;
 	yosys_celltypes.setup();
+
+	// the names and port names of the internal cell types are used everywhere
+	for (auto &it : yosys_celltypes.cell_types) {
+		it.first.make_immortal();
+		for (auto &port : it.second.inputs)
+			port.make_immortal();
+		for (auto &port : it.second.outputs)
+			port.make_immortal();
+	}
+
 	log_push();
 }
 
@@ -594,7 +646,7 @@ RTLIL::IdString new_id(std::string file, int line, std::string func)
 	if (pos != std::string::npos)
 		func = func.substr(pos+1);
 
-	return stringf("$auto$%s:%d:%s$%d", file.c_str(), line, func.c_str(), autoidx++);
+	return stringf("$auto$%s:%d:%s$%d", file.c_str(), line, func.c_str(), current_autoidx()++);
 }
 
 RTLIL::Design *yosys_get_design()
@@ -1257,7 +1309,7 @@ struct HistoryPass : public Pass {
 #endif
 
 struct ScriptCmdPass : public Pass {
-	ScriptCmdPass() : Pass("script", "execute commands from file or wire") { }
+	ScriptCmdPass() : Pass("script", "execute commands from file or wire") { read_only = true; }
 	void help() YS_OVERRIDE {
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
@@ -53,6 +53,12 @@
 #include <memory>
 #include <cmath>
 #include <cstddef>
+#include <atomic>
+
+#ifdef YOSYS_ENABLE_THREADS
+#  include <mutex>
+#  include <thread>
+#endif
 
 #include <sstream>
 #include <fstream>
@@ -260,11 +266,40 @@ bool is_absolute_path(std::string filename);
 void remove_directory(std::string dirname);
 std::string escape_filename_spaces(const std::string& filename);
 
+// Read-only view of the complete contents of an input stream. When the stream
+// is an unread std::ifstream for the regular file 'filename' the file is
+// mapped with mmap(), otherwise the remaining stream contents are copied.
+struct InputBuffer
+{
+	const char *data;
+	size_t size;
+
+	InputBuffer(std::istream &f, const std::string &filename = std::string());
+	~InputBuffer();
+
+private:
+	void *mapped;
+	std::string copy;
+
+	InputBuffer(const InputBuffer&) = delete;
+	InputBuffer &operator=(const InputBuffer&) = delete;
+};
+
 template<typename T> int GetSize(const T &obj) { return obj.size(); }
 int GetSize(RTLIL::Wire *wire);
 
 extern int autoidx;
 extern int yosys_xtrace;
+extern int yosys_threads;
+
+// When set, new_id() draws from this counter instead of the global autoidx.
+// Used by worker threads (see Pass::run_on_modules()) to create names without
+// racing on autoidx.
+extern thread_local int *autoidx_local;
+
+// The counter new names should be drawn from: autoidx, or the counter of the
+// calling worker thread.
+inline int &current_autoidx() { return autoidx_local ? *autoidx_local : autoidx; }
 
 YOSYS_NAMESPACE_END
 
@@ -302,7 +337,7 @@ RTLIL::IdString new_id(std::string file, int line, std::string func);
 	YOSYS_NAMESPACE_PREFIX new_id(__FILE__, __LINE__, __FUNCTION__)
 
 #define ID(_str) \
-	([]() { static YOSYS_NAMESPACE_PREFIX RTLIL::IdString _id(_str); return _id; })()
+	([]() { static YOSYS_NAMESPACE_PREFIX RTLIL::IdString _id = YOSYS_NAMESPACE_PREFIX RTLIL::IdString::immortal(_str); return _id; })()
 
 RTLIL::Design *yosys_get_design();
 std::string proc_self_dirname();
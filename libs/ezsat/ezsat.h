@@ -167,6 +167,12 @@ public:
 	int bind(int id, bool auto_freeze = true);
 	int bound(int id) const;
 
+	// add clauses directly in CNF variable space, e.g. when copying the cnf() of
+	// another ezSAT instance. unbound_cnf_variable() creates a CNF variable that
+	// is not bound to any literal or expression.
+	int unbound_cnf_variable() { return ++cnfVariableCount; }
+	void add_cnf_clause(const std::vector<int> &clause) { add_clause(clause); }
+
 	int numCnfVariables() const { return cnfVariableCount; }
 	int numCnfClauses() const { return cnfClausesCount; }
 	const std::vector<std::vector<int>> &cnf() const { return cnfClauses; }
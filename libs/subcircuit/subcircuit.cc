@@ -21,6 +21,7 @@
 #include "subcircuit.h"
 
 #include <algorithm>
+#include <functional>
 #include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -32,6 +33,18 @@
 #  define my_printf printf
 #endif
 
+// run worker(0) .. worker(numJobs-1), on up to numThreads threads if possible
+static void my_run_parallel(int numJobs, int numThreads, std::function<void(int)> worker)
+{
+#ifdef _YOSYS_
+	YOSYS_NAMESPACE_PREFIX Pass::run_parallel(numJobs, worker, numThreads);
+#else
+	(void)numThreads;
+	for (int i = 0; i < numJobs; i++)
+		worker(i);
+#endif
+}
+
 using namespace SubCircuit;
 
 #ifndef _YOSYS_
@@ -295,6 +308,33 @@ class SubCircuit::SolverWorker
 		Graph graph;
 		adjMatrix_t adjMatrix;
 		std::vector<bool> usedNodes;
+
+		// node indices by (typeId, number of ports), the initial candidates for a needle node
+		std::map<std::pair<std::string, int>, std::vector<int>> nodesBySignature;
+
+		void indexNodes()
+		{
+			nodesBySignature.clear();
+			for (int i = 0; i < int(graph.nodes.size()); i++) {
+				const Graph::Node &node = graph.nodes[i];
+				nodesBySignature[std::pair<std::string, int>(node.typeId, node.ports.size())].push_back(i);
+			}
+		}
+
+		const std::vector<int> &nodesWithSignature(const std::string &typeId, int numPorts) const
+		{
+			static const std::vector<int> emptyList;
+			auto it = nodesBySignature.find(std::pair<std::string, int>(typeId, numPorts));
+			return it != nodesBySignature.end() ? it->second : emptyList;
+		}
+	};
+
+	// state of a search that is private to one thread of a parallel search
+	struct SearchState {
+		std::vector<bool> *usedNodes;
+		std::map<std::pair<int, int>, bool> *compareCache;
+		SearchState(std::vector<bool> *usedNodes, std::map<std::pair<int, int>, bool> *compareCache = NULL) :
+				usedNodes(usedNodes), compareCache(compareCache) { }
 	};
 
 	static void printAdjMatrix(const adjMatrix_t &matrix)
@@ -689,6 +729,20 @@ class SubCircuit::SolverWorker
 			return compareCache[key];
 		}
 
+		// like above, but the shared cache is only read and new results go to localCache
+		bool compare(int needleEdge, int haystackEdge, const std::map<std::string, std::set<std::set<std::string>>> &swapPorts,
+				const std::map<std::string, std::set<std::map<std::string, std::string>>> &swapPermutations, std::map<std::pair<int, int>, bool> &localCache) const
+		{
+			std::pair<int, int> key(needleEdge, haystackEdge);
+			auto it = compareCache.find(key);
+			if (it != compareCache.end())
+				return it->second;
+			it = localCache.find(key);
+			if (it != localCache.end())
+				return it->second;
+			return localCache[key] = edgeTypes.at(needleEdge).compare(edgeTypes.at(haystackEdge), swapPorts, swapPermutations);
+		}
+
 		bool compare(int needleEdge, int haystackEdge, const std::map<std::string, std::string> &mapFromPorts, const std::map<std::string, std::set<std::set<std::string>>> &swapPorts,
 				const std::map<std::string, std::set<std::map<std::string, std::string>>> &swapPermutations) const
 		{
@@ -717,6 +771,10 @@ class SubCircuit::SolverWorker
 	std::map<std::string, std::set<std::map<std::string, std::string>>> swapPermutations;
 	DiCache diCache;
 	bool verbose;
+	int numThreads;
+
+	// minimum number of top-level branches before a search is split across threads
+	static const int minParallelBranches = 16;
 
 	// main solver functions
 
@@ -848,17 +906,15 @@ class SubCircuit::SolverWorker
 
 	void generateEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, const std::map<std::string, std::set<std::string>> &initialMappings) const
 	{
-		std::map<std::string, std::set<int>> haystackNodesByTypeId;
-		for (int i = 0; i < int(haystack.graph.nodes.size()); i++)
-			haystackNodesByTypeId[haystack.graph.nodes[i].typeId].insert(i);
-
 		enumerationMatrix.clear();
 		enumerationMatrix.resize(needle.graph.nodes.size());
-		for (int i = 0; i < int(needle.graph.nodes.size()); i++)
+
+		auto generateRow = [&](int i)
 		{
 			const Graph::Node &nn = needle.graph.nodes[i];
+			int numPorts = nn.ports.size();
 
-			for (int j : haystackNodesByTypeId[nn.typeId]) {
+			for (int j : haystack.nodesWithSignature(nn.typeId, numPorts)) {
 				const Graph::Node &hn = haystack.graph.nodes[j];
 				if (initialMappings.count(nn.nodeId) > 0 && initialMappings.at(nn.nodeId).count(hn.nodeId) == 0)
 					continue;
@@ -869,7 +925,7 @@ class SubCircuit::SolverWorker
 
 			if (compatibleTypes.count(nn.typeId) > 0)
 				for (const std::string &compatibleTypeId : compatibleTypes.at(nn.typeId))
-					for (int j : haystackNodesByTypeId[compatibleTypeId]) {
+					for (int j : haystack.nodesWithSignature(compatibleTypeId, numPorts)) {
 						const Graph::Node &hn = haystack.graph.nodes[j];
 						if (initialMappings.count(nn.nodeId) > 0 && initialMappings.at(nn.nodeId).count(hn.nodeId) == 0)
 							continue;
@@ -877,10 +933,17 @@ class SubCircuit::SolverWorker
 							continue;
 						enumerationMatrix[i].insert(j);
 					}
-		}
+		};
+
+		// the rows are independent, so large haystacks are scanned in parallel
+		if (numThreads > 1 && haystack.graph.nodes.size() >= 1000 && needle.graph.nodes.size() > 1)
+			my_run_parallel(needle.graph.nodes.size(), numThreads, generateRow);
+		else
+			for (int i = 0; i < int(needle.graph.nodes.size()); i++)
+				generateRow(i);
 	}
 
-	bool checkEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, int i, int j, const GraphData &needle, const GraphData &haystack)
+	bool checkEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, int i, int j, const GraphData &needle, const GraphData &haystack, SearchState &state)
 	{
 		for (const auto &it_needle : needle.adjMatrix.at(i))
 		{
@@ -890,7 +953,8 @@ class SubCircuit::SolverWorker
 			for (int haystackNeighbour : enumerationMatrix[needleNeighbour])
 				if (haystack.adjMatrix.at(j).count(haystackNeighbour) > 0) {
 					int haystackEdgeType = haystack.adjMatrix.at(j).at(haystackNeighbour);
-					if (diCache.compare(needleEdgeType, haystackEdgeType, swapPorts, swapPermutations)) {
+					if (state.compareCache ? diCache.compare(needleEdgeType, haystackEdgeType, swapPorts, swapPermutations, *state.compareCache) :
+							diCache.compare(needleEdgeType, haystackEdgeType, swapPorts, swapPermutations)) {
 						const Graph::Node &needleFromNode = needle.graph.nodes[i];
 						const Graph::Node &needleToNode = needle.graph.nodes[needleNeighbour];
 						const Graph::Node &haystackFromNode = haystack.graph.nodes[j];
@@ -908,7 +972,7 @@ class SubCircuit::SolverWorker
 		return true;
 	}
 
-	bool pruneEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, int &nextRow, bool allowOverlap)
+	bool pruneEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, int &nextRow, bool allowOverlap, SearchState &state)
 	{
 		bool didSomething = true;
 		while (didSomething)
@@ -918,9 +982,9 @@ class SubCircuit::SolverWorker
 			for (int i = 0; i < int(enumerationMatrix.size()); i++) {
 				std::set<int> newRow;
 				for (int j : enumerationMatrix[i]) {
-					if (!checkEnumerationMatrix(enumerationMatrix, i, j, needle, haystack))
+					if (!checkEnumerationMatrix(enumerationMatrix, i, j, needle, haystack, state))
 						didSomething = true;
-					else if (!allowOverlap && haystack.usedNodes[j])
+					else if (!allowOverlap && (*state.usedNodes)[j])
 						didSomething = true;
 					else
 						newRow.insert(j);
@@ -1102,10 +1166,11 @@ class SubCircuit::SolverWorker
 		return false;
 	}
 
-	void ullmannRecursion(std::vector<Solver::Result> &results, std::vector<std::set<int>> &enumerationMatrix, int iter, const GraphData &needle, GraphData &haystack, bool allowOverlap, int limitResults)
+	void ullmannRecursion(std::vector<Solver::Result> &results, std::vector<std::set<int>> &enumerationMatrix, int iter, const GraphData &needle, GraphData &haystack,
+			SearchState &state, bool allowOverlap, int limitResults)
 	{
 		int i = -1;
-		if (!pruneEnumerationMatrix(enumerationMatrix, needle, haystack, i, allowOverlap))
+		if (!pruneEnumerationMatrix(enumerationMatrix, needle, haystack, i, allowOverlap, state))
 			return;
 
 		if (i < 0)
@@ -1165,7 +1230,7 @@ class SubCircuit::SolverWorker
 
 			for (int j = 0; j < int(enumerationMatrix.size()); j++)
 				if (!haystack.graph.nodes[*enumerationMatrix[j].begin()].shared)
-					haystack.usedNodes[*enumerationMatrix[j].begin()] = true;
+					(*state.usedNodes)[*enumerationMatrix[j].begin()] = true;
 
 			if (verbose) {
 				my_printf("\nSolution:\n");
@@ -1185,6 +1250,11 @@ class SubCircuit::SolverWorker
 		std::set<int> activeRow;
 		enumerationMatrix[i].swap(activeRow);
 
+		if (iter == 0 && numThreads > 1 && limitResults < 0 && !verbose && int(activeRow.size()) >= minParallelBranches) {
+			ullmannParallelBranches(results, enumerationMatrix, i, activeRow, needle, haystack, state, allowOverlap);
+			return;
+		}
+
 		for (int j : activeRow)
 		{
 			// found enough?
@@ -1192,7 +1262,7 @@ class SubCircuit::SolverWorker
 				return;
 
 			// already used by other solution -> try next
-			if (!allowOverlap && haystack.usedNodes[j])
+			if (!allowOverlap && (*state.usedNodes)[j])
 				continue;
 
 			// create enumeration matrix for child in recursion tree
@@ -1202,14 +1272,78 @@ class SubCircuit::SolverWorker
 			nextEnumerationMatrix[i].insert(j);
 
 			// recursion
-			ullmannRecursion(results, nextEnumerationMatrix, iter+1, needle, haystack, allowOverlap, limitResults);
+			ullmannRecursion(results, nextEnumerationMatrix, iter+1, needle, haystack, state, allowOverlap, limitResults);
 
 			// we just have found something -> unroll to top recursion level
-			if (!allowOverlap && haystack.usedNodes[j] && iter > 0)
+			if (!allowOverlap && (*state.usedNodes)[j] && iter > 0)
 				return;
 		}
 	}
 
+	void ullmannParallelBranches(std::vector<Solver::Result> &results, const std::vector<std::set<int>> &enumerationMatrix, int i, const std::set<int> &activeRow,
+			const GraphData &needle, GraphData &haystack, SearchState &state, bool allowOverlap)
+	{
+		// The branches of the top recursion level are searched speculatively
+		// in parallel, each starting from the current set of used nodes, and
+		// are then committed in order. Without overlap a branch that found a
+		// solution after an earlier branch of the same batch was committed is
+		// searched again, as the newly used nodes could lead to a different
+		// solution. A branch without a solution stays valid, as more used
+		// nodes only remove candidates. This gives the same results as the
+		// serial search.
+
+		struct Branch {
+			std::vector<Solver::Result> results;
+			std::vector<bool> usedNodes;
+			std::map<std::pair<int, int>, bool> compareCache;
+		};
+
+		std::vector<int> branchNodes(activeRow.begin(), activeRow.end());
+		int batchSize = 4 * numThreads;
+
+		for (int pos = 0; pos < int(branchNodes.size());)
+		{
+			std::vector<Branch> branches(std::min(batchSize, int(branchNodes.size()) - pos));
+			const std::vector<bool> &snapshotUsedNodes = *state.usedNodes;
+
+			my_run_parallel(branches.size(), numThreads, [&](int k) {
+				int j = branchNodes[pos + k];
+				if (!allowOverlap && snapshotUsedNodes[j])
+					return;
+				Branch &branch = branches[k];
+				branch.usedNodes = snapshotUsedNodes;
+				SearchState branchState(&branch.usedNodes, &branch.compareCache);
+				std::vector<std::set<int>> nextEnumerationMatrix = enumerationMatrix;
+				for (auto &row : nextEnumerationMatrix)
+					row.erase(j);
+				nextEnumerationMatrix[i].insert(j);
+				ullmannRecursion(branch.results, nextEnumerationMatrix, 1, needle, haystack, branchState, allowOverlap, -1);
+			});
+
+			bool committedSolution = false;
+			int k;
+			for (k = 0; k < int(branches.size()); k++)
+			{
+				Branch &branch = branches[k];
+				for (auto &it : branch.compareCache)
+					diCache.compareCache.insert(it);
+
+				if (branch.results.empty())
+					continue;
+				if (!allowOverlap && committedSolution)
+					break;
+
+				results.insert(results.end(), branch.results.begin(), branch.results.end());
+				for (int n = 0; n < int(branch.usedNodes.size()); n++)
+					if (branch.usedNodes[n])
+						(*state.usedNodes)[n] = true;
+				committedSolution = true;
+			}
+
+			pos += k;
+		}
+	}
+
 	// additional data structes and functions for mining
 
 	struct NodeSet {
@@ -1272,7 +1406,8 @@ class SubCircuit::SolverWorker
 			generateEnumerationMatrix(enumerationMatrix, needle, haystack, initialMappings);
 
 			haystack.usedNodes.resize(haystack.graph.nodes.size());
-			ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, true, -1);
+			SearchState state(&haystack.usedNodes);
+			ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, state, true, -1);
 		}
 
 		verbose = backupVerbose;
@@ -1469,7 +1604,7 @@ class SubCircuit::SolverWorker
 	// interface to the public solver class
 
 protected:
-	SolverWorker(Solver *userSolver) : userSolver(userSolver), verbose(false)
+	SolverWorker(Solver *userSolver) : userSolver(userSolver), verbose(false), numThreads(1)
 	{
 	}
 
@@ -1478,6 +1613,11 @@ protected:
 		verbose = true;
 	}
 
+	void setNumThreads(int numThreads)
+	{
+		this->numThreads = std::max(1, numThreads);
+	}
+
 	void addGraph(std::string graphId, const Graph &graph)
 	{
 		assert(graphData.count(graphId) == 0);
@@ -1485,6 +1625,7 @@ protected:
 		GraphData &gd = graphData[graphId];
 		gd.graphId = graphId;
 		gd.graph = graph;
+		gd.indexNodes();
 		diCache.add(gd.graph, gd.adjMatrix, graphId, userSolver);
 	}
 
@@ -1552,7 +1693,8 @@ protected:
 		}
 
 		haystack.usedNodes.resize(haystack.graph.nodes.size());
-		ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, allowOverlap, maxSolutions > 0 ? results.size() + maxSolutions : -1);
+		SearchState state(&haystack.usedNodes);
+		ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, state, allowOverlap, maxSolutions > 0 ? results.size() + maxSolutions : -1);
 	}
 
 	void mine(std::vector<Solver::MineResult> &results, int minNodes, int maxNodes, int minMatches, int limitMatchesPerGraph)
@@ -1627,6 +1769,11 @@ void SubCircuit::Solver::setVerbose()
 	worker->setVerbose();
 }
 
+void SubCircuit::Solver::setNumThreads(int numThreads)
+{
+	worker->setNumThreads(numThreads);
+}
+
 void SubCircuit::Solver::addGraph(std::string graphId, const Graph &graph)
 {
 	worker->addGraph(graphId, graph);
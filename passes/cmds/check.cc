@@ -26,7 +26,7 @@ USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 struct CheckPass : public Pass {
-	CheckPass() : Pass("check", "check for obvious problems in the design") { }
+	CheckPass() : Pass("check", "check for obvious problems in the design") { read_only = true; }
 	void help() YS_OVERRIDE
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -26,7 +26,7 @@ std::map<std::string, RTLIL::Design*> saved_designs;
 std::vector<RTLIL::Design*> pushed_designs;
 
 struct DesignPass : public Pass {
-	DesignPass() : Pass("design", "save, restore and reset current design") { }
+	DesignPass() : Pass("design", "save, restore and reset current design") { read_only = true; }
 	~DesignPass() YS_OVERRIDE {
 		for (auto &it : saved_designs)
 			delete it.second;
@@ -41,12 +41,15 @@ struct DesignPass : public Pass {
 		log("\n");
 		log("    design -reset\n");
 		log("\n");
-		log("Clear the current design.\n");
+		log("Clear the current design. This also drops data that passes keep between\n");
+		log("calls, such as the map libraries kept by 'techmap'.\n");
 		log("\n");
 		log("\n");
 		log("    design -save <name>\n");
 		log("\n");
-		log("Save the current design under the given name.\n");
+		log("Save the current design under the given name. The saved design shares the\n");
+		log("modules with the current design, a module is only copied when a command that\n");
+		log("may change it is run on one of the designs.\n");
 		log("\n");
 		log("\n");
 		log("    design -stash <name>\n");
@@ -231,7 +234,7 @@ struct DesignPass : public Pass {
 			dict<IdString, IdString> done;
 
 			if (copy_to_design->modules_.count(prefix))
-				delete copy_to_design->modules_.at(prefix);
+				copy_to_design->release(copy_to_design->modules_.at(prefix));
 
 			if (GetSize(copy_src_modules) != 1)
 				log_cmd_error("No top module found in source design.\n");
@@ -269,7 +272,7 @@ struct DesignPass : public Pass {
 						log("Importing %s as %s.\n", log_id(fmod), log_id(trg_name));
 
 						if (copy_to_design->modules_.count(trg_name))
-							delete copy_to_design->modules_.at(trg_name);
+							copy_to_design->release(copy_to_design->modules_.at(trg_name));
 
 						copy_to_design->modules_[trg_name] = fmod->clone();
 						copy_to_design->modules_[trg_name]->name = trg_name;
@@ -295,7 +298,12 @@ struct DesignPass : public Pass {
 				std::string trg_name = as_name.empty() ? mod->name.str() : RTLIL::escape_id(as_name);
 
 				if (copy_to_design->modules_.count(trg_name))
-					delete copy_to_design->modules_.at(trg_name);
+					copy_to_design->release(copy_to_design->modules_.at(trg_name));
+
+				if (trg_name == mod->name.str()) {
+					copy_to_design->add_shared(mod);
+					continue;
+				}
 
 				copy_to_design->modules_[trg_name] = mod->clone();
 				copy_to_design->modules_[trg_name]->name = trg_name;
@@ -307,8 +315,10 @@ struct DesignPass : public Pass {
 		{
 			RTLIL::Design *design_copy = new RTLIL::Design;
 
+			// with -stash and -push the current design is cleared below and
+			// design_copy is left as the only design listing the modules
 			for (auto &it : design->modules_)
-				design_copy->add(it.second->clone());
+				design_copy->add_shared(it.second);
 
 			design_copy->selection_stack = design->selection_stack;
 			design_copy->selection_vars = design->selection_vars;
@@ -326,7 +336,7 @@ struct DesignPass : public Pass {
 		if (reset_mode || !load_name.empty() || push_mode || pop_mode)
 		{
 			for (auto &it : design->modules_)
-				delete it.second;
+				design->release(it.second);
 			design->modules_.clear();
 
 			design->selection_stack.clear();
@@ -336,6 +346,10 @@ struct DesignPass : public Pass {
 			design->selection_stack.push_back(RTLIL::Selection());
 		}
 
+		if (reset_mode && save_name.empty())
+			for (auto &it : pass_register)
+				it.second->on_design_reset();
+
 		if (reset_mode || reset_vlog_mode || !load_name.empty() || push_mode || pop_mode)
 		{
 			for (auto node : design->verilog_packages)
@@ -354,7 +368,7 @@ struct DesignPass : public Pass {
 			RTLIL::Design *saved_design = pop_mode ? pushed_designs.back() : saved_designs.at(load_name);
 
 			for (auto &it : saved_design->modules_)
-				design->add(it.second->clone());
+				design->add_shared(it.second);
 
 			design->selection_stack = saved_design->selection_stack;
 			design->selection_vars = saved_design->selection_vars;
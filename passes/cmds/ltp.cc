@@ -30,13 +30,16 @@ struct LtpWorker
 	RTLIL::Module *module;
 	SigMap sigmap;
 
-	dict<SigBit, tuple<int, SigBit, Cell*>> bits;
-	dict<SigBit, dict<SigBit, Cell*>> bit2bits;
+	// all selected bits, and the edges between them (via a cell) in CSR format:
+	// the successors of bit i are edge_dst[edge_begin[i] .. edge_begin[i+1]-1]
+	idict<SigBit> bits;
+	std::vector<int> edge_begin, edge_dst;
+	std::vector<Cell*> edge_cell;
 	dict<SigBit, tuple<SigBit, Cell*>> bit2ff;
 
-	int maxlvl;
-	SigBit maxbit;
-	pool<SigBit> busy;
+	// longest path to each bit, and the previous bit and cell on that path
+	std::vector<int> level, from;
+	std::vector<Cell*> via;
 
 	LtpWorker(RTLIL::Module *module, bool noff) : design(module->design), module(module), sigmap(module)
 	{
@@ -49,7 +52,9 @@ struct LtpWorker
 
 		for (auto wire : module->selected_wires())
 			for (auto bit : sigmap(wire))
-				bits[bit] = tuple<int, SigBit, Cell*>(-1, State::Sx, nullptr);
+				bits(bit);
+
+		std::vector<tuple<int, int, Cell*>> edges;
 
 		for (auto cell : module->selected_cells())
 		{
@@ -72,70 +77,135 @@ struct LtpWorker
 				continue;
 			}
 
-			for (auto s : src_bits)
-				for (auto d : dst_bits)
-					bit2bits[s][d] = cell;
+			for (auto s : src_bits) {
+				int s_idx = bits.at(s, -1);
+				if (s_idx < 0)
+					continue;
+				for (auto d : dst_bits) {
+					int d_idx = bits.at(d, -1);
+					if (d_idx >= 0)
+						edges.push_back(tuple<int, int, Cell*>(s_idx, d_idx, cell));
+				}
+			}
 		}
 
-		maxlvl = -1;
-		maxbit = State::Sx;
+		int nbits = GetSize(bits);
+		edge_begin.resize(nbits+1);
+		edge_dst.resize(GetSize(edges));
+		edge_cell.resize(GetSize(edges));
+
+		for (auto &e : edges)
+			edge_begin[get<0>(e)+1]++;
+		for (int i = 0; i < nbits; i++)
+			edge_begin[i+1] += edge_begin[i];
+
+		std::vector<int> fill(edge_begin.begin(), edge_begin.end()-1);
+		for (auto &e : edges) {
+			int k = fill[get<0>(e)]++;
+			edge_dst[k] = get<1>(e);
+			edge_cell[k] = get<2>(e);
+		}
 	}
 
-	void runner(SigBit bit, int level, SigBit from, Cell *via)
+	// levelize the bits in topological order (Kahn's algorithm). when only bits
+	// on (or behind) a loop are left, the loop is reported and broken at the
+	// first such bit, so that every bit still gets a level.
+	void levelize()
 	{
-		auto &bitinfo = bits.at(bit);
+		int nbits = GetSize(bits);
+		std::vector<int> indegree(nbits), queue;
 
-		if (get<0>(bitinfo) >= level)
-			return;
+		level.assign(nbits, 0);
+		from.assign(nbits, -1);
+		via.assign(nbits, nullptr);
 
-		if (busy.count(bit) > 0) {
-			log_warning("Detected loop at %s in %s\n", log_signal(bit), log_id(module));
-			return;
-		}
+		for (int k = 0; k < GetSize(edge_dst); k++)
+			indegree[edge_dst[k]]++;
 
-		busy.insert(bit);
-		get<0>(bitinfo) = level;
-		get<1>(bitinfo) = from;
-		get<2>(bitinfo) = via;
+		queue.reserve(nbits);
+		for (int i = 0; i < nbits; i++)
+			if (indegree[i] == 0)
+				queue.push_back(i);
 
-		if (level > maxlvl) {
-			maxlvl = level;
-			maxbit = bit;
-		}
+		int loop_cursor = 0;
+		for (int head = 0; head < nbits; head++)
+		{
+			if (head == GetSize(queue)) {
+				while (indegree[loop_cursor] <= 0)
+					loop_cursor++;
+				log_warning("Detected loop at %s in %s\n", log_signal(bits[loop_cursor]), log_id(module));
+				indegree[loop_cursor] = 0;
+				queue.push_back(loop_cursor);
+			}
 
-		if (bit2bits.count(bit)) {
-			for (auto &it : bit2bits.at(bit))
-				runner(it.first, level+1, bit, it.second);
+			int i = queue[head];
+			indegree[i] = -1;
+
+			for (int k = edge_begin[i]; k < edge_begin[i+1]; k++) {
+				int j = edge_dst[k];
+				if (indegree[j] < 0)
+					continue;
+				if (level[j] < level[i]+1) {
+					level[j] = level[i]+1;
+					from[j] = i;
+					via[j] = edge_cell[k];
+				}
+				if (--indegree[j] == 0)
+					queue.push_back(j);
+			}
 		}
-
-		busy.erase(bit);
 	}
 
-	void printpath(SigBit bit)
+	void printpath(int i)
 	{
-		auto &bitinfo = bits.at(bit);
-		if (get<2>(bitinfo)) {
-			printpath(get<1>(bitinfo));
-			log("%5d: %s (via %s)\n", get<0>(bitinfo), log_signal(bit), log_id(get<2>(bitinfo)));
-		} else {
-			log("%5d: %s\n", get<0>(bitinfo), log_signal(bit));
+		std::vector<int> path;
+		for (; i >= 0; i = from[i])
+			path.push_back(i);
+
+		for (auto it = path.rbegin(); it != path.rend(); it++) {
+			if (via[*it])
+				log("%5d: %s (via %s)\n", level[*it], log_signal(bits[*it]), log_id(via[*it]));
+			else
+				log("%5d: %s\n", level[*it], log_signal(bits[*it]));
 		}
+
+		SigBit bit = bits[path.front()];
+		if (bit2ff.count(bit))
+			log("%5s: %s (via %s)\n", "ff", log_signal(get<0>(bit2ff.at(bit))), log_id(get<1>(bit2ff.at(bit))));
 	}
 
-	void run()
+	void run(int num_paths)
 	{
-		for (auto &it : bits)
-			if (get<0>(it.second) < 0)
-				runner(it.first, 0, State::Sx, nullptr);
+		levelize();
+
+		int maxlvl = -1, maxbit = -1;
+		for (int i = 0; i < GetSize(bits); i++)
+			if (level[i] > maxlvl)
+				maxlvl = level[i], maxbit = i;
 
 		log("\n");
 		log("Longest topological path in %s (length=%d):\n", log_id(module), maxlvl);
 
-		if (maxlvl >= 0)
-			printpath(maxbit);
+		if (num_paths <= 0) {
+			if (maxbit >= 0)
+				printpath(maxbit);
+			return;
+		}
+
+		// the longest paths ending in the bits that don't drive any other bits
+		std::vector<std::pair<int, int>> endpoints;
+		for (int i = 0; i < GetSize(bits); i++)
+			if (edge_begin[i] == edge_begin[i+1])
+				endpoints.push_back(std::pair<int, int>(-level[i], i));
 
-		if (bit2ff.count(maxbit))
-			log("%5s: %s (via %s)\n", "ff", log_signal(get<0>(bit2ff.at(maxbit))), log_id(get<1>(bit2ff.at(maxbit))));
+		num_paths = std::min(num_paths, GetSize(endpoints));
+		std::partial_sort(endpoints.begin(), endpoints.begin() + num_paths, endpoints.end());
+
+		for (int n = 0; n < num_paths; n++) {
+			log("\n");
+			log("Path %d to %s (length=%d):\n", n+1, log_signal(bits[endpoints[n].second]), -endpoints[n].first);
+			printpath(endpoints[n].second);
+		}
 	}
 };
 
@@ -153,10 +223,16 @@ struct LtpPass : public Pass {
 		log("    -noff\n");
 		log("        automatically exclude FF cell types\n");
 		log("\n");
+		log("    -n <num>\n");
+		log("        print the <num> longest paths to different end points (signal bits\n");
+		log("        that don't drive any other selected cell), instead of just the\n");
+		log("        longest path\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
 	{
 		bool noff = false;
+		int num_paths = 0;
 
 		log_header(design, "Executing LTP pass (find longest path).\n");
 
@@ -166,6 +242,10 @@ struct LtpPass : public Pass {
 				noff = true;
 				continue;
 			}
+			if (args[argidx] == "-n" && argidx+1 < args.size()) {
+				num_paths = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 
@@ -177,7 +257,7 @@ struct LtpPass : public Pass {
 				continue;
 
 			LtpWorker worker(module, noff);
-			worker.run();
+			worker.run(num_paths);
 		}
 	}
 } LtpPass;
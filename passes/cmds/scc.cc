@@ -39,63 +39,81 @@ struct SccWorker
 	SigMap sigmap;
 	CellTypes ct;
 
-	std::set<RTLIL::Cell*> workQueue;
-	std::map<RTLIL::Cell*, std::set<RTLIL::Cell*>> cellToNextCell;
+	// the considered cells, and the cells driven by each of them in CSR format:
+	// the successors of cell i are nextCell[nextBegin[i] .. nextBegin[i+1]-1]
+	std::vector<RTLIL::Cell*> cells;
+	std::vector<int> nextBegin, nextCell;
 	std::map<RTLIL::Cell*, RTLIL::SigSpec> cellToPrevSig, cellToNextSig;
 
-	std::map<RTLIL::Cell*, std::pair<int, int>> cellLabels;
-	std::map<RTLIL::Cell*, int> cellDepth;
-	std::set<RTLIL::Cell*> cellsOnStack;
-	std::vector<RTLIL::Cell*> cellStack;
+	std::vector<std::pair<int, int>> cellLabels;
+	std::vector<int> cellDepth;
+	std::vector<bool> cellsOnStack;
+	std::vector<int> cellStack;
 	int labelCounter;
 
 	std::map<RTLIL::Cell*, int> cell2scc;
 	std::vector<std::set<RTLIL::Cell*>> sccList;
 
-	void run(RTLIL::Cell *cell, int depth, int maxDepth)
+	void found_scc(int cell)
 	{
-		log_assert(workQueue.count(cell) > 0);
-
-		workQueue.erase(cell);
-		cellLabels[cell] = std::pair<int, int>(labelCounter, labelCounter);
-		labelCounter++;
+		log("Found an SCC:");
+		std::set<RTLIL::Cell*> scc;
+		while (cellsOnStack[cell]) {
+			int c = cellStack.back();
+			cellStack.pop_back();
+			cellsOnStack[c] = false;
+			log(" %s", RTLIL::id2cstr(cells[c]->name));
+			cell2scc[cells[c]] = sccList.size();
+			scc.insert(cells[c]);
+		}
+		sccList.push_back(scc);
+		log("\n");
+	}
 
-		cellsOnStack.insert(cell);
-		cellStack.push_back(cell);
+	// Tarjan's algorithm, with an explicit stack of (cell, next edge) pairs
+	// instead of recursion, so that deep cones can't overflow the call stack
+	void run(int root, int maxDepth)
+	{
+		std::vector<std::pair<int, int>> dfsStack;
 
-		if (maxDepth >= 0)
-			cellDepth[cell] = depth;
+		auto visit = [&](int cell) {
+			cellLabels[cell] = std::pair<int, int>(labelCounter, labelCounter);
+			labelCounter++;
+			cellsOnStack[cell] = true;
+			cellStack.push_back(cell);
+			cellDepth[cell] = GetSize(dfsStack);
+			dfsStack.push_back(std::pair<int, int>(cell, nextBegin[cell]));
+		};
 
-		for (auto nextCell : cellToNextCell[cell])
-			if (cellLabels.count(nextCell) == 0) {
-				run(nextCell, depth+1, maxDepth);
-				cellLabels[cell].second = min(cellLabels[cell].second, cellLabels[nextCell].second);
-			} else
-			if (cellsOnStack.count(nextCell) > 0 && (maxDepth < 0 || cellDepth[nextCell] + maxDepth > depth)) {
-					cellLabels[cell].second = min(cellLabels[cell].second, cellLabels[nextCell].second);
-			}
+		visit(root);
 
-		if (cellLabels[cell].first == cellLabels[cell].second)
+		while (!dfsStack.empty())
 		{
-			if (cellStack.back() == cell)
-			{
-				cellStack.pop_back();
-				cellsOnStack.erase(cell);
+			int cell = dfsStack.back().first;
+			int &edge = dfsStack.back().second;
+
+			if (edge < nextBegin[cell+1]) {
+				int next = nextCell[edge++];
+				if (cellLabels[next].first < 0)
+					visit(next);
+				else if (cellsOnStack[next] && (maxDepth < 0 || cellDepth[next] + maxDepth > cellDepth[cell]))
+					cellLabels[cell].second = min(cellLabels[cell].second, cellLabels[next].second);
+				continue;
 			}
-			else
+
+			if (cellLabels[cell].first == cellLabels[cell].second)
 			{
-				log("Found an SCC:");
-				std::set<RTLIL::Cell*> scc;
-				while (cellsOnStack.count(cell) > 0) {
-					RTLIL::Cell *c = cellStack.back();
+				if (cellStack.back() == cell) {
 					cellStack.pop_back();
-					cellsOnStack.erase(c);
-					log(" %s", RTLIL::id2cstr(c->name));
-					cell2scc[c] = sccList.size();
-					scc.insert(c);
-				}
-				sccList.push_back(scc);
-				log("\n");
+					cellsOnStack[cell] = false;
+				} else
+					found_scc(cell);
+			}
+
+			dfsStack.pop_back();
+			if (!dfsStack.empty()) {
+				int parent = dfsStack.back().first;
+				cellLabels[parent].second = min(cellLabels[parent].second, cellLabels[cell].second);
 			}
 		}
 	}
@@ -116,7 +134,7 @@ struct SccWorker
 		}
 
 		SigPool selectedSignals;
-		SigSet<RTLIL::Cell*> sigToNextCells;
+		SigSet<int> sigToNextCells;
 
 		for (auto &it : module->wires_)
 			if (design->selected(module, it.second))
@@ -132,8 +150,6 @@ struct SccWorker
 			if (!allCellTypes && !ct.cell_known(cell->type))
 				continue;
 
-			workQueue.insert(cell);
-
 			RTLIL::SigSpec inputSignals, outputSignals;
 
 			for (auto &conn : cell->connections())
@@ -159,35 +175,38 @@ struct SccWorker
 
 			cellToPrevSig[cell] = inputSignals;
 			cellToNextSig[cell] = outputSignals;
-			sigToNextCells.insert(inputSignals, cell);
+			sigToNextCells.insert(inputSignals, GetSize(cells));
+			cells.push_back(cell);
 		}
 
-		for (auto cell : workQueue)
+		nextBegin.push_back(0);
+		for (int i = 0; i < GetSize(cells); i++)
 		{
-			cellToNextCell[cell] = sigToNextCells.find(cellToNextSig[cell]);
+			std::set<int> next = sigToNextCells.find(cellToNextSig[cells[i]]);
+			nextCell.insert(nextCell.end(), next.begin(), next.end());
+			nextBegin.push_back(GetSize(nextCell));
 
-			if (!nofeedbackMode && cellToNextCell[cell].count(cell)) {
+			if (!nofeedbackMode && next.count(i)) {
 				log("Found an SCC:");
 				std::set<RTLIL::Cell*> scc;
-				log(" %s", RTLIL::id2cstr(cell->name));
-				cell2scc[cell] = sccList.size();
-				scc.insert(cell);
+				log(" %s", RTLIL::id2cstr(cells[i]->name));
+				cell2scc[cells[i]] = sccList.size();
+				scc.insert(cells[i]);
 				sccList.push_back(scc);
 				log("\n");
 			}
 		}
 
 		labelCounter = 0;
-		cellLabels.clear();
-
-		while (!workQueue.empty())
-		{
-			RTLIL::Cell *cell = *workQueue.begin();
-			log_assert(cellStack.size() == 0);
-			cellDepth.clear();
-
-			run(cell, 0, maxDepth);
-		}
+		cellLabels.assign(GetSize(cells), std::pair<int, int>(-1, -1));
+		cellDepth.assign(GetSize(cells), 0);
+		cellsOnStack.assign(GetSize(cells), false);
+
+		for (int i = 0; i < GetSize(cells); i++)
+			if (cellLabels[i].first < 0) {
+				log_assert(cellStack.size() == 0);
+				run(i, maxDepth);
+			}
 
 		log("Found %d SCCs in module %s.\n", int(sccList.size()), RTLIL::id2cstr(module->name));
 	}
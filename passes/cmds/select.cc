@@ -972,7 +972,7 @@ YOSYS_NAMESPACE_END
 PRIVATE_NAMESPACE_BEGIN
 
 struct SelectPass : public Pass {
-	SelectPass() : Pass("select", "modify and view the list of selected objects") { }
+	SelectPass() : Pass("select", "modify and view the list of selected objects") { read_only = true; }
 	void help() YS_OVERRIDE
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -1511,7 +1511,7 @@ struct SelectPass : public Pass {
 } SelectPass;
 
 struct CdPass : public Pass {
-	CdPass() : Pass("cd", "a shortcut for 'select -module <name>'") { }
+	CdPass() : Pass("cd", "a shortcut for 'select -module <name>'") { read_only = true; }
 	void help() YS_OVERRIDE
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -1619,7 +1619,7 @@ static void log_matches(const char *title, Module *module, T list)
 }
 
 struct LsPass : public Pass {
-	LsPass() : Pass("ls", "list modules or objects in modules") { }
+	LsPass() : Pass("ls", "list modules or objects in modules") { read_only = true; }
 	void help() YS_OVERRIDE
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -0,0 +1,1261 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/celledges.h"
+#include "passes/techmap/libparse.h"
+#include <queue>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+// a liberty lookup table (scalar, 1D or 2D), interpolated and extrapolated linearly
+struct StaTable
+{
+	// the variable of each index: 0 = transition at the related pin (the input of
+	// a delay arc, the clock of a constraint), 1 = output load or data transition
+	int var_1 = 0, var_2 = 1;
+	std::vector<double> index_1, index_2, values;
+
+	static void lookup(const std::vector<double> &index, double x, int &i, double &f)
+	{
+		i = 0, f = 0;
+		if (GetSize(index) < 2)
+			return;
+		while (i+2 < GetSize(index) && x >= index[i+1])
+			i++;
+		if (index[i+1] != index[i])
+			f = (x - index[i]) / (index[i+1] - index[i]);
+	}
+
+	double value(int i, int j) const
+	{
+		int n1 = std::max(1, GetSize(index_1)), n2 = std::max(1, GetSize(index_2));
+		return values[std::min(i, n1-1) * n2 + std::min(j, n2-1)];
+	}
+
+	double eval(double tran, double load) const
+	{
+		if (values.empty())
+			return 0;
+
+		int i, j;
+		double fi, fj;
+		lookup(index_1, var_1 == 0 ? tran : load, i, fi);
+		lookup(index_2, var_2 == 0 ? tran : load, j, fj);
+
+		return (1-fi) * ((1-fj) * value(i, j) + fj * value(i, j+1)) +
+				fi * ((1-fj) * value(i+1, j) + fj * value(i+1, j+1));
+	}
+};
+
+// index of the rise and fall values of arrival times, transitions, delays, etc.
+enum { RISE = 0, FALL = 1 };
+
+struct StaArc
+{
+	enum kind_t { COMB, LAUNCH, SETUP };
+	enum sense_t { POSITIVE_UNATE, NEGATIVE_UNATE, NON_UNATE };
+	kind_t kind;
+	sense_t sense = NON_UNATE;
+	IdString from, to;
+
+	// delay and output transition tables for a rising and a falling output, or
+	// the setup constraint for a rising and a falling data input for SETUP arcs.
+	// if only one of the two is given it is used for both.
+	StaTable delay[2], transition[2];
+
+	// combinational_rise and combinational_fall arcs only drive one transition
+	bool drives[2] = {true, true};
+
+	// does transition from_rf at the input cause transition to_rf at the output?
+	bool propagates(int from_rf, int to_rf) const {
+		if (!drives[to_rf])
+			return false;
+		if (sense == POSITIVE_UNATE)
+			return from_rf == to_rf;
+		if (sense == NEGATIVE_UNATE)
+			return from_rf != to_rf;
+		return true;
+	}
+
+	double eval_delay(int rf, double tran, double load) const {
+		return (delay[rf].values.empty() ? delay[rf^1] : delay[rf]).eval(tran, load);
+	}
+
+	double eval_transition(int rf, double tran, double load) const {
+		return (transition[rf].values.empty() ? transition[rf^1] : transition[rf]).eval(tran, load);
+	}
+};
+
+struct StaCell
+{
+	dict<IdString, double> capacitance;
+	std::vector<StaArc> arcs;
+};
+
+struct StaLibrary
+{
+	dict<IdString, StaCell> cells;
+	dict<std::string, StaTable> templates;
+
+	static std::vector<double> parse_numbers(const std::vector<std::string> &args)
+	{
+		std::vector<double> numbers;
+		for (auto &arg : args)
+			for (auto &tok : split_tokens(arg, ", \t\r\n\\"))
+				numbers.push_back(atof(tok.c_str()));
+		return numbers;
+	}
+
+	static int parse_variable(LibertyAst *ast)
+	{
+		if (ast == NULL)
+			return -1;
+		if (ast->value == "input_net_transition" || ast->value == "input_transition_time" || ast->value == "related_pin_transition")
+			return 0;
+		return 1;
+	}
+
+	void parse_template(LibertyAst *ast)
+	{
+		if (ast->args.size() != 1)
+			return;
+
+		StaTable &table = templates[ast->args[0]];
+		int var_1 = parse_variable(ast->find("variable_1"));
+		int var_2 = parse_variable(ast->find("variable_2"));
+		if (var_1 >= 0)
+			table.var_1 = var_1, table.var_2 = var_1 ? 0 : 1;
+		if (var_2 >= 0)
+			table.var_2 = var_2;
+
+		for (auto child : ast->children) {
+			if (child->id == "index_1")
+				table.index_1 = parse_numbers(child->args);
+			if (child->id == "index_2")
+				table.index_2 = parse_numbers(child->args);
+		}
+	}
+
+	bool parse_table(LibertyAst *ast, StaTable &table, const std::string &cell_name)
+	{
+		if (ast->args.size() == 1 && templates.count(ast->args[0]))
+			table = templates.at(ast->args[0]);
+
+		for (auto child : ast->children) {
+			if (child->id == "index_1")
+				table.index_1 = parse_numbers(child->args);
+			if (child->id == "index_2")
+				table.index_2 = parse_numbers(child->args);
+			if (child->id == "values")
+				table.values = parse_numbers(child->args);
+		}
+
+		if (GetSize(table.values) != std::max(1, GetSize(table.index_1)) * std::max(1, GetSize(table.index_2))) {
+			log_warning("Ignoring malformed %s table in liberty cell %s.\n", ast->id.c_str(), cell_name.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	void parse_timing(LibertyAst *ast, IdString pin, StaCell &cell, const std::string &cell_name)
+	{
+		LibertyAst *related_pin = ast->find("related_pin");
+		LibertyAst *timing_type = ast->find("timing_type");
+		if (related_pin == NULL)
+			return;
+
+		StaArc arc;
+		std::string type = timing_type ? timing_type->value : "combinational";
+
+		if (type == "combinational" || type == "combinational_rise" || type == "combinational_fall")
+			arc.kind = StaArc::COMB;
+		else if (type == "rising_edge" || type == "falling_edge")
+			arc.kind = StaArc::LAUNCH;
+		else if (type == "setup_rising" || type == "setup_falling")
+			arc.kind = StaArc::SETUP;
+		else
+			return;
+
+		if (type == "combinational_rise")
+			arc.drives[FALL] = false;
+		if (type == "combinational_fall")
+			arc.drives[RISE] = false;
+
+		LibertyAst *timing_sense = ast->find("timing_sense");
+		if (timing_sense != NULL && timing_sense->value == "positive_unate")
+			arc.sense = StaArc::POSITIVE_UNATE;
+		if (timing_sense != NULL && timing_sense->value == "negative_unate")
+			arc.sense = StaArc::NEGATIVE_UNATE;
+
+		for (auto child : ast->children)
+		{
+			StaTable table;
+			if (child->id != "cell_rise" && child->id != "cell_fall" && child->id != "rise_constraint" && child->id != "fall_constraint" &&
+					child->id != "rise_transition" && child->id != "fall_transition")
+				continue;
+			if (!parse_table(child, table, cell_name))
+				continue;
+			int rf = child->id.compare(0, 4, "fall") == 0 || child->id == "cell_fall" ? FALL : RISE;
+			if (child->id == "rise_transition" || child->id == "fall_transition")
+				arc.transition[rf] = table;
+			else
+				arc.delay[rf] = table;
+		}
+
+		// generic CMOS delay model
+		if (arc.delay[RISE].values.empty() && arc.delay[FALL].values.empty())
+			for (auto child : ast->children)
+				if (child->id == "intrinsic_rise" || child->id == "intrinsic_fall")
+					arc.delay[child->id == "intrinsic_rise" ? RISE : FALL].values.push_back(atof(child->value.c_str()));
+
+		for (auto &from : split_tokens(related_pin->value)) {
+			arc.from = RTLIL::escape_id(from);
+			arc.to = pin;
+			cell.arcs.push_back(arc);
+		}
+	}
+
+	void read(std::string filename)
+	{
+		std::ifstream f;
+		f.open(filename.c_str());
+		yosys_input_files.insert(filename);
+		if (f.fail())
+			log_cmd_error("Can't open liberty file `%s': %s\n", filename.c_str(), strerror(errno));
+		LibertyParser libparser(f);
+		f.close();
+
+		int num_cells = 0, num_arcs = 0;
+
+		for (auto ast : libparser.ast->children)
+			if (ast->id == "lu_table_template")
+				parse_template(ast);
+
+		for (auto ast : libparser.ast->children)
+		{
+			if (ast->id != "cell" || ast->args.size() != 1)
+				continue;
+
+			StaCell &cell = cells[RTLIL::escape_id(ast->args[0])];
+			cell = StaCell();
+
+			for (auto pin_ast : ast->children)
+			{
+				if (pin_ast->id != "pin" || pin_ast->args.size() != 1)
+					continue;
+
+				IdString pin = RTLIL::escape_id(pin_ast->args[0]);
+				LibertyAst *cap = pin_ast->find("capacitance");
+
+				if (cap != NULL)
+					cell.capacitance[pin] = atof(cap->value.c_str());
+
+				for (auto child : pin_ast->children)
+					if (child->id == "timing")
+						parse_timing(child, pin, cell, ast->args[0]);
+			}
+
+			num_cells++;
+			num_arcs += GetSize(cell.arcs);
+		}
+
+		log("Read %d cells with %d timing arcs from liberty file `%s'.\n", num_cells, num_arcs, filename.c_str());
+	}
+};
+
+struct StaConfig
+{
+	std::vector<std::string> liberty_files;
+	std::shared_ptr<StaLibrary> lib;
+	std::vector<std::pair<std::string, double>> clocks;
+	double default_period = -1;
+	double input_slew = 0;
+	double output_load = 0;
+	int num_paths = 1;
+
+	// the options the timing graph depends on (as opposed to the constraints)
+	std::string graph_key() const
+	{
+		std::string key = stringf("%.17g %.17g", input_slew, output_load);
+		for (auto &filename : liberty_files)
+			key += "\n" + filename;
+		return key;
+	}
+
+	void read_liberty()
+	{
+		if (lib != nullptr)
+			return;
+		lib = std::make_shared<StaLibrary>();
+		for (auto &filename : liberty_files)
+			lib->read(filename);
+	}
+};
+
+// the timing graph and the analysis results for one module. with -incremental
+// the timer stays attached to the module as a monitor between calls, so that
+// it can tell which parts of the analysis must be recomputed.
+struct StaTimer : RTLIL::Monitor, AbstractCellEdgesDatabase
+{
+	StaConfig config;
+	std::string graph_key;
+	RTLIL::Module *module;
+	SigMap sigmap;
+
+	// set by the monitor callbacks when the connectivity of the module changed
+	bool rebuild_graph = false;
+
+	// the timing graph: one node per signal bit, edges (cell arcs) in CSR format.
+	// the edges from node i are edge_*[edge_begin[i] .. edge_begin[i+1]-1], the
+	// edges to node i are edge_*[in_edge[in_begin[i] .. in_begin[i+1]-1]].
+	idict<SigBit> nodes;
+	std::vector<int> edge_begin, edge_src, edge_dst, in_begin, in_edge;
+	std::vector<Cell*> edge_cell;
+	std::vector<const StaArc*> edge_arc;
+	std::vector<tuple<int, int, Cell*, const StaArc*>> edges;
+
+	// the topological order of the nodes and the position of each node in it.
+	// edges with pos[src] >= pos[dst] close a loop and are ignored.
+	std::vector<int> order, pos;
+
+	// per node and transition (index 2*node+rf): transition, arrival and required
+	// time, and the edge (as 2*edge+rf at its source) or the startpoint that
+	// determines the arrival time
+	std::vector<double> load, slew, arrival, required;
+	std::vector<int> from_edge, from_start;
+
+	// per edge and pair of input and output transition (index 4*edge+2*rf+rf)
+	std::vector<double> edge_delay;
+
+	// clock domains (domain 0 is used for the paths that don't end in a clocked cell)
+	std::vector<std::string> domain_name;
+	std::vector<SigBit> domain_clock;
+	std::vector<double> domain_period;
+	dict<SigBit, int> clock_domain;
+
+	struct Startpoint {
+		int node, domain;
+		Cell *cell;
+		const StaArc *arc;
+	};
+
+	struct Endpoint {
+		int node, domain;
+		Cell *cell;
+		const StaArc *arc;
+		double required[2];
+	};
+
+	// the start- and endpoints at node i are *points[*_index[*_begin[i] .. *_begin[i+1]-1]]
+	std::vector<Startpoint> startpoints;
+	std::vector<Endpoint> endpoints;
+	std::vector<int> start_begin, start_index, end_begin, end_index;
+
+	// the cells the graph was built from. the edges of a cell are
+	// cell_edges[edges_begin .. edges_end-1], its start- and endpoints are
+	// stored consecutively.
+	struct CellInfo {
+		IdString type;
+		int edges_begin, edges_end;
+		int starts_begin, starts_end;
+		int ends_begin, ends_end;
+	};
+
+	dict<Cell*, CellInfo> cell_info;
+	std::vector<int> cell_edges;
+	std::vector<RTLIL::IdString> ports;
+
+	int num_untimed_cells = 0;
+
+	StaTimer(const StaConfig &config, RTLIL::Module *module) : config(config), graph_key(config.graph_key()), module(module) { }
+
+	void notify_connect(RTLIL::Cell*, const RTLIL::IdString&, const RTLIL::SigSpec&, RTLIL::SigSpec&) YS_OVERRIDE
+	{
+		rebuild_graph = true;
+	}
+
+	void notify_connect(RTLIL::Module*, const RTLIL::SigSig&) YS_OVERRIDE
+	{
+		rebuild_graph = true;
+	}
+
+	void notify_connect(RTLIL::Module*, const std::vector<RTLIL::SigSig>&) YS_OVERRIDE
+	{
+		rebuild_graph = true;
+	}
+
+	void notify_blackout(RTLIL::Module*) YS_OVERRIDE
+	{
+		rebuild_graph = true;
+	}
+
+	int node(SigBit bit)
+	{
+		bit = sigmap(bit);
+		if (bit.wire == NULL)
+			return -1;
+		int idx = nodes(bit);
+		if (idx == GetSize(load))
+			load.push_back(0);
+		return idx;
+	}
+
+	int find_node(SigBit bit)
+	{
+		bit = sigmap(bit);
+		if (bit.wire == NULL)
+			return -1;
+		return nodes.at(bit, -1);
+	}
+
+	int domain(SigBit clk)
+	{
+		clk = sigmap(clk);
+		if (clk.wire == NULL)
+			return 0;
+		if (!clock_domain.count(clk)) {
+			clock_domain[clk] = GetSize(domain_name);
+			domain_name.push_back(log_signal(clk));
+			domain_clock.push_back(clk);
+			domain_period.push_back(config.default_period);
+		}
+		return clock_domain.at(clk);
+	}
+
+	// apply the -clock and -period options, returns true if a period changed
+	bool set_constraints()
+	{
+		dict<SigBit, double> periods;
+		for (auto &clk : config.clocks) {
+			Wire *wire = module->wire(RTLIL::escape_id(clk.first));
+			if (wire == NULL || GetSize(wire) != 1)
+				continue;
+			SigBit bit = sigmap(wire);
+			if (!clock_domain.count(bit)) {
+				clock_domain[bit] = GetSize(domain_name);
+				domain_name.push_back(clk.first);
+				domain_clock.push_back(bit);
+				domain_period.push_back(config.default_period);
+			}
+			periods[bit] = clk.second;
+		}
+
+		bool changed = false;
+		for (int dom = 0; dom < GetSize(domain_name); dom++) {
+			double period = dom > 0 ? periods.at(domain_clock[dom], config.default_period) : config.default_period;
+			if (period != domain_period[dom])
+				domain_period[dom] = period, changed = true;
+		}
+		return changed;
+	}
+
+	void add_edge(int src, int dst, Cell *cell, const StaArc *arc)
+	{
+		if (src >= 0 && dst >= 0)
+			edges.push_back(tuple<int, int, Cell*, const StaArc*>(src, dst, cell, arc));
+	}
+
+	// zero delay edges for internal cells (called by add_edges_from_cell)
+	void add_edge(RTLIL::Cell *cell, RTLIL::IdString from_port, int from_bit, RTLIL::IdString to_port, int to_bit, int) YS_OVERRIDE
+	{
+		add_edge(node(cell->getPort(from_port)[from_bit]), node(cell->getPort(to_port)[to_bit]), cell, nullptr);
+	}
+
+	void add_lib_cell(Cell *cell, const StaCell &lib_cell)
+	{
+		for (auto &conn : cell->connections())
+			if (lib_cell.capacitance.count(conn.first))
+				for (auto bit : conn.second) {
+					int idx = node(bit);
+					if (idx >= 0)
+						load[idx] += lib_cell.capacitance.at(conn.first);
+				}
+
+		for (auto &arc : lib_cell.arcs)
+		{
+			if (!cell->hasPort(arc.from) || !cell->hasPort(arc.to))
+				continue;
+
+			SigSpec from_sig = cell->getPort(arc.from);
+			SigSpec to_sig = cell->getPort(arc.to);
+
+			if (arc.kind == StaArc::COMB) {
+				for (auto from_bit : from_sig)
+					for (auto to_bit : to_sig)
+						add_edge(node(from_bit), node(to_bit), cell, &arc);
+			} else if (arc.kind == StaArc::LAUNCH) {
+				for (auto to_bit : to_sig) {
+					int idx = node(to_bit);
+					if (idx >= 0)
+						startpoints.push_back(Startpoint{idx, domain(from_sig[0]), cell, &arc});
+				}
+			} else {
+				for (auto to_bit : to_sig) {
+					int idx = node(to_bit);
+					if (idx >= 0)
+						endpoints.push_back(Endpoint{idx, domain(from_sig[0]), cell, &arc, {0, 0}});
+				}
+			}
+		}
+	}
+
+	// cells without timing information are treated as timing boundaries: their
+	// outputs start new paths and their inputs end paths (clocked by their
+	// CLK or C port, if they have one)
+	void add_boundary_cell(Cell *cell)
+	{
+		int dom = 0;
+		for (auto port : {"\\CLK", "\\C"})
+			if (cell->hasPort(port) && GetSize(cell->getPort(port)) == 1)
+				dom = domain(cell->getPort(port)[0]);
+
+		for (auto &conn : cell->connections()) {
+			if (conn.first == "\\CLK" || conn.first == "\\C")
+				continue;
+			for (auto bit : conn.second) {
+				int idx = node(bit);
+				if (idx < 0)
+					continue;
+				if (cell->output(conn.first))
+					startpoints.push_back(Startpoint{idx, dom, cell, nullptr});
+				else if (cell->input(conn.first))
+					endpoints.push_back(Endpoint{idx, dom, cell, nullptr, {0, 0}});
+			}
+		}
+
+		num_untimed_cells++;
+	}
+
+	// index[begin[key] .. begin[key+1]-1] are the positions of key in keys
+	static void make_index(int num_keys, const std::vector<int> &keys, std::vector<int> &begin, std::vector<int> &index)
+	{
+		begin.assign(num_keys+1, 0);
+		for (int key : keys)
+			begin[key+1]++;
+		for (int i = 0; i < num_keys; i++)
+			begin[i+1] += begin[i];
+
+		index.resize(GetSize(keys));
+		std::vector<int> fill(begin.begin(), begin.end()-1);
+		for (int i = 0; i < GetSize(keys); i++)
+			index[fill[keys[i]]++] = i;
+	}
+
+	void build()
+	{
+		sigmap.set(module);
+		nodes.clear();
+		load.clear();
+		startpoints.clear();
+		endpoints.clear();
+		cell_info.clear();
+		clock_domain.clear();
+		domain_name = {"<unclocked>"};
+		domain_clock = {State::Sx};
+		domain_period = {config.default_period};
+		num_untimed_cells = 0;
+		rebuild_graph = false;
+
+		set_constraints();
+
+		ports = module->ports;
+		for (auto wire : module->wires()) {
+			if (wire->port_input)
+				for (auto bit : SigSpec(wire)) {
+					int idx = node(bit);
+					if (idx >= 0)
+						startpoints.push_back(Startpoint{idx, 0, nullptr, nullptr});
+				}
+			if (wire->port_output)
+				for (auto bit : SigSpec(wire)) {
+					int idx = node(bit);
+					if (idx >= 0) {
+						endpoints.push_back(Endpoint{idx, 0, nullptr, nullptr, {0, 0}});
+						load[idx] += config.output_load;
+					}
+				}
+		}
+
+		for (auto cell : module->cells())
+		{
+			CellInfo &info = cell_info[cell];
+			info.type = cell->type;
+			info.edges_begin = GetSize(edges);
+			info.starts_begin = GetSize(startpoints);
+			info.ends_begin = GetSize(endpoints);
+
+			if (config.lib->cells.count(cell->type))
+				add_lib_cell(cell, config.lib->cells.at(cell->type));
+			else if (!add_edges_from_cell(cell))
+				add_boundary_cell(cell);
+
+			info.edges_end = GetSize(edges);
+			info.starts_end = GetSize(startpoints);
+			info.ends_end = GetSize(endpoints);
+		}
+
+		int num_nodes = GetSize(nodes);
+		int num_edges = GetSize(edges);
+
+		std::vector<int> keys(num_edges), index;
+		for (int n = 0; n < num_edges; n++)
+			keys[n] = get<0>(edges[n]);
+		make_index(num_nodes, keys, edge_begin, index);
+
+		edge_src.resize(num_edges);
+		edge_dst.resize(num_edges);
+		edge_cell.resize(num_edges);
+		edge_arc.resize(num_edges);
+		cell_edges.resize(num_edges);
+
+		for (int k = 0; k < num_edges; k++) {
+			auto &e = edges[index[k]];
+			edge_src[k] = get<0>(e);
+			edge_dst[k] = get<1>(e);
+			edge_cell[k] = get<2>(e);
+			edge_arc[k] = get<3>(e);
+			cell_edges[index[k]] = k;
+		}
+
+		edges.clear();
+		edges.shrink_to_fit();
+
+		make_index(num_nodes, edge_dst, in_begin, in_edge);
+
+		keys.clear();
+		for (auto &sp : startpoints)
+			keys.push_back(sp.node);
+		make_index(num_nodes, keys, start_begin, start_index);
+
+		keys.clear();
+		for (auto &ep : endpoints)
+			keys.push_back(ep.node);
+		make_index(num_nodes, keys, end_begin, end_index);
+
+		set_constraints();
+		levelize();
+
+		log("Timing graph for module %s: %d nodes, %d edges, %d startpoints, %d endpoints.\n",
+				log_id(module), num_nodes, num_edges, GetSize(startpoints), GetSize(endpoints));
+		if (num_untimed_cells)
+			log("Treating %d cells without timing information as path start and end points.\n", num_untimed_cells);
+	}
+
+	// sort the nodes topologically (Kahn's algorithm, loops are reported and
+	// broken like in the 'ltp' pass)
+	void levelize()
+	{
+		int num_nodes = GetSize(nodes);
+		std::vector<int> indegree(num_nodes);
+
+		for (int k = 0; k < GetSize(edge_dst); k++)
+			indegree[edge_dst[k]]++;
+
+		order.clear();
+		order.reserve(num_nodes);
+		for (int i = 0; i < num_nodes; i++)
+			if (indegree[i] == 0)
+				order.push_back(i);
+
+		int loop_cursor = 0;
+		for (int head = 0; head < num_nodes; head++)
+		{
+			if (head == GetSize(order)) {
+				while (indegree[loop_cursor] <= 0)
+					loop_cursor++;
+				log_warning("Detected loop at %s in %s\n", log_signal(nodes[loop_cursor]), log_id(module));
+				indegree[loop_cursor] = 0;
+				order.push_back(loop_cursor);
+			}
+
+			int i = order[head];
+			indegree[i] = -1;
+
+			for (int k = edge_begin[i]; k < edge_begin[i+1]; k++) {
+				int j = edge_dst[k];
+				if (indegree[j] >= 0 && --indegree[j] == 0)
+					order.push_back(j);
+			}
+		}
+
+		pos.resize(num_nodes);
+		for (int n = 0; n < num_nodes; n++)
+			pos[order[n]] = n;
+	}
+
+	// compute the arrival times and transitions at node j from its fanin,
+	// returns true if any of them changed
+	bool compute_arrival(int j)
+	{
+		double old_arrival[2] = {arrival[2*j], arrival[2*j+1]};
+		double old_slew[2] = {slew[2*j], slew[2*j+1]};
+		bool driven = false;
+
+		for (int rf = 0; rf < 2; rf++) {
+			arrival[2*j+rf] = -INFINITY;
+			slew[2*j+rf] = config.input_slew;
+			from_edge[2*j+rf] = -1;
+			from_start[2*j+rf] = -1;
+		}
+
+		for (int n = start_begin[j]; n < start_begin[j+1]; n++)
+		{
+			auto &sp = startpoints[start_index[n]];
+			driven = true;
+
+			for (int rf = 0; rf < 2; rf++) {
+				double t = 0;
+				if (sp.arc) {
+					t = sp.arc->eval_delay(rf, config.input_slew, load[j]);
+					slew[2*j+rf] = std::max(slew[2*j+rf], sp.arc->eval_transition(rf, config.input_slew, load[j]));
+				}
+				if (t > arrival[2*j+rf])
+					arrival[2*j+rf] = t, from_start[2*j+rf] = start_index[n];
+			}
+		}
+
+		for (int n = in_begin[j]; n < in_begin[j+1]; n++)
+		{
+			int k = in_edge[n], i = edge_src[k];
+			const StaArc *arc = edge_arc[k];
+			if (pos[i] >= pos[j])
+				continue;
+			driven = true;
+
+			for (int from_rf = 0; from_rf < 2; from_rf++)
+			for (int to_rf = 0; to_rf < 2; to_rf++)
+			{
+				if (arc != nullptr && !arc->propagates(from_rf, to_rf))
+					continue;
+
+				double &delay = edge_delay[4*k + 2*from_rf + to_rf];
+				delay = 0;
+				if (arrival[2*i+from_rf] == -INFINITY)
+					continue;
+
+				if (arc != nullptr) {
+					delay = arc->eval_delay(to_rf, slew[2*i+from_rf], load[j]);
+					slew[2*j+to_rf] = std::max(slew[2*j+to_rf], arc->eval_transition(to_rf, slew[2*i+from_rf], load[j]));
+				} else
+					slew[2*j+to_rf] = std::max(slew[2*j+to_rf], slew[2*i+from_rf]);
+
+				if (arrival[2*i+from_rf] + delay > arrival[2*j+to_rf])
+					arrival[2*j+to_rf] = arrival[2*i+from_rf] + delay, from_edge[2*j+to_rf] = 2*k + from_rf, from_start[2*j+to_rf] = -1;
+			}
+		}
+
+		// undriven signals (and signals only driven from loops) start at 0
+		if (!driven)
+			arrival[2*j] = arrival[2*j+1] = 0;
+
+		return arrival[2*j] != old_arrival[0] || arrival[2*j+1] != old_arrival[1] ||
+				slew[2*j] != old_slew[0] || slew[2*j+1] != old_slew[1];
+	}
+
+	// compute the required times at node i from its endpoints and its fanout,
+	// returns true if any of them changed
+	bool compute_required(int i)
+	{
+		double old_required[2] = {required[2*i], required[2*i+1]};
+		required[2*i] = required[2*i+1] = INFINITY;
+
+		for (int n = end_begin[i]; n < end_begin[i+1]; n++)
+		{
+			auto &ep = endpoints[end_index[n]];
+			double period = domain_period[ep.domain];
+
+			for (int rf = 0; rf < 2; rf++) {
+				if (period < 0) {
+					ep.required[rf] = INFINITY;
+					continue;
+				}
+				ep.required[rf] = period;
+				if (ep.arc)
+					ep.required[rf] -= ep.arc->eval_delay(rf, config.input_slew, slew[2*i+rf]);
+				required[2*i+rf] = std::min(required[2*i+rf], ep.required[rf]);
+			}
+		}
+
+		for (int k = edge_begin[i]; k < edge_begin[i+1]; k++)
+		{
+			int j = edge_dst[k];
+			const StaArc *arc = edge_arc[k];
+			if (pos[i] >= pos[j])
+				continue;
+
+			for (int from_rf = 0; from_rf < 2; from_rf++)
+			for (int to_rf = 0; to_rf < 2; to_rf++)
+				if (arc == nullptr || arc->propagates(from_rf, to_rf))
+					required[2*i+from_rf] = std::min(required[2*i+from_rf], required[2*j+to_rf] - edge_delay[4*k + 2*from_rf + to_rf]);
+		}
+
+		return required[2*i] != old_required[0] || required[2*i+1] != old_required[1];
+	}
+
+	void propagate()
+	{
+		int num_nodes = GetSize(nodes);
+
+		arrival.assign(2*num_nodes, -INFINITY);
+		slew.assign(2*num_nodes, config.input_slew);
+		required.assign(2*num_nodes, INFINITY);
+		from_edge.assign(2*num_nodes, -1);
+		from_start.assign(2*num_nodes, -1);
+		edge_delay.assign(4*GetSize(edge_dst), 0);
+
+		for (int i : order)
+			compute_arrival(i);
+		for (auto it = order.rbegin(); it != order.rend(); it++)
+			compute_required(*it);
+	}
+
+	// a cell that was changed into another liberty cell with the same timing
+	// arcs (e.g. a different drive strength) keeps its edges in the graph
+	bool retype_cell(Cell *cell, CellInfo &info)
+	{
+		auto old_it = config.lib->cells.find(info.type);
+		auto new_it = config.lib->cells.find(cell->type);
+		if (old_it == config.lib->cells.end() || new_it == config.lib->cells.end())
+			return false;
+
+		std::vector<const StaArc*> old_arcs, new_arcs;
+		for (auto &arc : old_it->second.arcs)
+			if (cell->hasPort(arc.from) && cell->hasPort(arc.to))
+				old_arcs.push_back(&arc);
+		for (auto &arc : new_it->second.arcs)
+			if (cell->hasPort(arc.from) && cell->hasPort(arc.to))
+				new_arcs.push_back(&arc);
+
+		if (GetSize(old_arcs) != GetSize(new_arcs))
+			return false;
+		for (int n = 0; n < GetSize(old_arcs); n++)
+			if (old_arcs[n]->kind != new_arcs[n]->kind || old_arcs[n]->from != new_arcs[n]->from || old_arcs[n]->to != new_arcs[n]->to)
+				return false;
+
+		auto map_arc = [&](const StaArc *arc) {
+			int n = std::find(old_arcs.begin(), old_arcs.end(), arc) - old_arcs.begin();
+			log_assert(n < GetSize(new_arcs));
+			return new_arcs[n];
+		};
+
+		for (int n = info.edges_begin; n < info.edges_end; n++)
+			edge_arc[cell_edges[n]] = map_arc(edge_arc[cell_edges[n]]);
+		for (int n = info.starts_begin; n < info.starts_end; n++)
+			startpoints[n].arc = map_arc(startpoints[n].arc);
+		for (int n = info.ends_begin; n < info.ends_end; n++)
+			endpoints[n].arc = map_arc(endpoints[n].arc);
+
+		for (auto &conn : cell->connections()) {
+			double delta = new_it->second.capacitance.at(conn.first, 0) - old_it->second.capacitance.at(conn.first, 0);
+			if (delta == 0)
+				continue;
+			for (auto bit : conn.second) {
+				int idx = find_node(bit);
+				if (idx >= 0)
+					load[idx] += delta;
+			}
+		}
+
+		info.type = cell->type;
+		return true;
+	}
+
+	// bring the analysis up to date with the netlist and the given constraints,
+	// recomputing the arrival times only in the fanout and the required times
+	// only in the fanin of changed cells. returns false if the timing graph
+	// must be rebuilt instead.
+	bool update(const StaConfig &new_config)
+	{
+		if (rebuild_graph || graph_key != new_config.graph_key() || module->ports != ports || GetSize(module->cells()) != GetSize(cell_info))
+			return false;
+
+		std::vector<Cell*> changed_cells;
+		for (auto cell : module->cells()) {
+			auto it = cell_info.find(cell);
+			if (it == cell_info.end())
+				return false;
+			if (it->second.type != cell->type) {
+				if (!retype_cell(cell, it->second))
+					return false;
+				changed_cells.push_back(cell);
+			}
+		}
+
+		config.clocks = new_config.clocks;
+		config.default_period = new_config.default_period;
+		config.num_paths = new_config.num_paths;
+
+		int num_nodes = GetSize(nodes);
+		int num_arrival = 0, num_required = 0;
+
+		std::vector<bool> forward_queued(num_nodes), backward_queued(num_nodes);
+		std::priority_queue<int, std::vector<int>, std::greater<int>> forward_queue;
+		std::priority_queue<int> backward_queue;
+
+		auto queue_forward = [&](int i) {
+			if (!forward_queued[i])
+				forward_queued[i] = true, forward_queue.push(pos[i]);
+		};
+		auto queue_backward = [&](int i) {
+			if (!backward_queued[i])
+				backward_queued[i] = true, backward_queue.push(pos[i]);
+		};
+
+		for (auto cell : changed_cells)
+			for (auto &conn : cell->connections())
+				for (auto bit : conn.second) {
+					int idx = find_node(bit);
+					if (idx >= 0)
+						queue_forward(idx), queue_backward(idx);
+				}
+
+		// the queues are sorted by topological position, so every node is
+		// visited at most once in each direction
+		while (!forward_queue.empty())
+		{
+			int j = order[forward_queue.top()];
+			forward_queue.pop();
+			num_arrival++;
+
+			bool changed = compute_arrival(j);
+
+			// the delays of the edges into j, and with the transition at j
+			// the setup times of its endpoints, may have changed
+			queue_backward(j);
+			for (int n = in_begin[j]; n < in_begin[j+1]; n++)
+				if (pos[edge_src[in_edge[n]]] < pos[j])
+					queue_backward(edge_src[in_edge[n]]);
+
+			if (changed)
+				for (int k = edge_begin[j]; k < edge_begin[j+1]; k++)
+					if (pos[j] < pos[edge_dst[k]])
+						queue_forward(edge_dst[k]);
+		}
+
+		if (set_constraints()) {
+			for (auto it = order.rbegin(); it != order.rend(); it++)
+				compute_required(*it);
+			num_required = num_nodes;
+		} else
+			while (!backward_queue.empty())
+			{
+				int i = order[backward_queue.top()];
+				backward_queue.pop();
+				num_required++;
+
+				if (compute_required(i))
+					for (int n = in_begin[i]; n < in_begin[i+1]; n++)
+						if (pos[edge_src[in_edge[n]]] < pos[i])
+							queue_backward(edge_src[in_edge[n]]);
+			}
+
+		log("Updated timing of module %s: %d changed cells, %d of %d arrival and %d of %d required times recomputed.\n",
+				log_id(module), GetSize(changed_cells), num_arrival, num_nodes, num_required, num_nodes);
+		return true;
+	}
+
+	// the slack of a node (or an endpoint) for the given transition
+	double slack(int i, int rf, double required) const
+	{
+		if (arrival[2*i+rf] == -INFINITY)
+			return INFINITY;
+		return required < INFINITY ? required - arrival[2*i+rf] : -arrival[2*i+rf];
+	}
+
+	void report_path(const Endpoint &ep, int ep_rf)
+	{
+		std::vector<std::pair<int, int>> path;
+		int i = ep.node, rf = ep_rf;
+		while (1) {
+			path.push_back(std::make_pair(i, rf));
+			int from = from_edge[2*i+rf];
+			if (from < 0)
+				break;
+			i = edge_src[from / 2], rf = from % 2;
+		}
+
+		log("    %10s %10s  %-4s  %s\n", "arrival", "slack", "edge", "signal");
+
+		int start = from_start[2*path.back().first + path.back().second];
+		if (start >= 0 && startpoints[start].cell)
+			log("    %10s %10s        %s (launched by %s)\n", "", "", log_signal(nodes[path.back().first]), log_id(startpoints[start].cell));
+
+		for (auto it = path.rbegin(); it != path.rend(); it++) {
+			int idx = 2*it->first + it->second;
+			int from = from_edge[idx];
+			std::string slack = required[idx] < INFINITY ? stringf("%10.3f", required[idx] - arrival[idx]) : stringf("%10s", "-");
+			const char *edge = it->second == RISE ? "rise" : "fall";
+			if (from >= 0)
+				log("    %10.3f %s  %-4s  %s (via %s)\n", arrival[idx], slack.c_str(), edge, log_signal(nodes[it->first]), log_id(edge_cell[from / 2]));
+			else
+				log("    %10.3f %s  %-4s  %s\n", arrival[idx], slack.c_str(), edge, log_signal(nodes[it->first]));
+		}
+
+		if (ep.cell)
+			log("    %10s %10s        captured by %s (required %.3f)\n", "", "", log_id(ep.cell), ep.required[ep_rf]);
+	}
+
+	void report(pool<Cell*> *critical_cells)
+	{
+		log("\n");
+		log("Timing report for module %s:\n", log_id(module));
+
+		std::vector<std::vector<int>> domain_endpoints(GetSize(domain_name));
+		for (int i = 0; i < GetSize(endpoints); i++)
+			domain_endpoints[endpoints[i].domain].push_back(i);
+
+		// the worse transition of each endpoint
+		std::vector<int> endpoint_rf(GetSize(endpoints));
+		for (int i = 0; i < GetSize(endpoints); i++) {
+			auto &ep = endpoints[i];
+			endpoint_rf[i] = slack(ep.node, FALL, ep.required[FALL]) < slack(ep.node, RISE, ep.required[RISE]) ? FALL : RISE;
+		}
+
+		for (int dom = 0; dom < GetSize(domain_name); dom++)
+		{
+			auto &eps = domain_endpoints[dom];
+			if (eps.empty())
+				continue;
+
+			bool constrained = domain_period[dom] >= 0;
+			auto endpoint_slack = [&](int idx) {
+				auto &ep = endpoints[idx];
+				return slack(ep.node, endpoint_rf[idx], ep.required[endpoint_rf[idx]]);
+			};
+
+			log("\n");
+			if (constrained) {
+				double wns = INFINITY, tns = 0;
+				int failing = 0;
+				for (int idx : eps) {
+					double s = endpoint_slack(idx);
+					wns = std::min(wns, s);
+					if (s < 0)
+						tns += s, failing++;
+				}
+				log("  Clock domain %s (period %.3f): %d endpoints, %d failing, WNS %.3f, TNS %.3f\n",
+						domain_name[dom].c_str(), domain_period[dom], GetSize(eps), failing, wns, tns);
+			} else
+				log("  Clock domain %s (unconstrained): %d endpoints\n", domain_name[dom].c_str(), GetSize(eps));
+
+			int num_paths = std::min(config.num_paths, GetSize(eps));
+			std::partial_sort(eps.begin(), eps.begin() + num_paths, eps.end(), [&](int a, int b) {
+				return endpoint_slack(a) < endpoint_slack(b);
+			});
+
+			for (int n = 0; n < num_paths; n++) {
+				auto &ep = endpoints[eps[n]];
+				int rf = endpoint_rf[eps[n]];
+				log("\n");
+				if (constrained)
+					log("  Path %d to %s %s (arrival %.3f, slack %.3f):\n", n+1, log_signal(nodes[ep.node]), rf == RISE ? "rise" : "fall",
+							arrival[2*ep.node+rf], endpoint_slack(eps[n]));
+				else
+					log("  Path %d to %s %s (arrival %.3f):\n", n+1, log_signal(nodes[ep.node]), rf == RISE ? "rise" : "fall", arrival[2*ep.node+rf]);
+				report_path(ep, rf);
+			}
+		}
+
+		if (critical_cells != nullptr)
+			for (int k = 0; k < GetSize(edge_dst); k++) {
+				int j = edge_dst[k];
+				if (required[2*j] - arrival[2*j] < 0 || required[2*j+1] - arrival[2*j+1] < 0)
+					critical_cells->insert(edge_cell[k]);
+			}
+	}
+};
+
+struct StaPass : public Pass {
+	// the timers attached to modules by 'sta -incremental'
+	pool<RTLIL::Monitor*> timers;
+
+	StaPass() : Pass("sta", "static timing analysis using liberty timing arcs") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    sta [options] [selection]\n");
+		log("\n");
+		log("This command performs a static timing analysis of the selected modules, using\n");
+		log("the timing arcs from the given liberty files for the cells of a mapped netlist.\n");
+		log("(Only considers paths within a single module, so the design must be flattened.)\n");
+		log("\n");
+		log("Delays are looked up in the NLDM tables of the liberty file (cell_rise/fall\n");
+		log("and rise/fall_transition, or intrinsic_rise/fall) using the propagated input\n");
+		log("transition and the sum of the input pin capacitances driven by the output.\n");
+		log("Rising and falling transitions are propagated separately, following the\n");
+		log("timing_sense of the arcs (non_unate if not given). Paths start at the module\n");
+		log("inputs and at the outputs of rising_edge/falling_edge arcs, and end at the\n");
+		log("module outputs and at pins with setup_rising/setup_falling constraints. Cells\n");
+		log("without timing arcs are treated as path start and end points, internal cells\n");
+		log("such as $and or $_XOR_ as zero-delay non-unate logic.\n");
+		log("\n");
+		log("For every clock domain (identified by the capturing clock signal) the number\n");
+		log("of failing endpoints, the worst and total negative slack and the worst paths\n");
+		log("are reported. The slack of an endpoint is the slack of its worse transition,\n");
+		log("the reported paths list the transition at every signal.\n");
+		log("\n");
+		log("    -liberty <liberty_file>\n");
+		log("        read timing arcs from the given liberty file (can be used multiple\n");
+		log("        times)\n");
+		log("\n");
+		log("    -clock <signal> <period>\n");
+		log("        set the period of the clock domain clocked by the given signal (can\n");
+		log("        be used multiple times)\n");
+		log("\n");
+		log("    -period <period>\n");
+		log("        default period for clock domains without a -clock option and for\n");
+		log("        paths between module ports. without this option these paths are\n");
+		log("        reported as unconstrained.\n");
+		log("\n");
+		log("    -slew <value>\n");
+		log("        transition at the module inputs and the clock pins (default: 0)\n");
+		log("\n");
+		log("    -load <value>\n");
+		log("        capacitive load of the module outputs (default: 0)\n");
+		log("\n");
+		log("    -n <num>\n");
+		log("        report the <num> worst paths for every clock domain (default: 1)\n");
+		log("\n");
+		log("    -select\n");
+		log("        replace the current selection with all cells on paths with negative\n");
+		log("        slack\n");
+		log("\n");
+		log("    -incremental\n");
+		log("        keep the timing graph and the arrival and required times of the\n");
+		log("        modules in memory. the next 'sta -incremental' with the same -liberty,\n");
+		log("        -slew and -load options then only recomputes the arrival times in the\n");
+		log("        fanout and the required times in the fanin of cells that were changed\n");
+		log("        to a liberty cell with the same timing arcs (e.g. by 'chtype' for gate\n");
+		log("        sizing), and only the required times if just -clock or -period changed.\n");
+		log("        the timing graph is rebuilt after any other change of the module. an\n");
+		log("        'sta' call without this option discards the kept data.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		StaConfig config;
+		bool select_mode = false;
+		bool incremental_mode = false;
+
+		log_header(design, "Executing STA pass (static timing analysis).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-liberty" && argidx+1 < args.size()) {
+				string liberty_file = args[++argidx];
+				rewrite_filename(liberty_file);
+				config.liberty_files.push_back(liberty_file);
+				continue;
+			}
+			if (args[argidx] == "-clock" && argidx+2 < args.size()) {
+				config.clocks.push_back(std::pair<std::string, double>(args[argidx+1], atof(args[argidx+2].c_str())));
+				argidx += 2;
+				continue;
+			}
+			if (args[argidx] == "-period" && argidx+1 < args.size()) {
+				config.default_period = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-slew" && argidx+1 < args.size()) {
+				config.input_slew = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-load" && argidx+1 < args.size()) {
+				config.output_load = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-n" && argidx+1 < args.size()) {
+				config.num_paths = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-select") {
+				select_mode = true;
+				continue;
+			}
+			if (args[argidx] == "-incremental") {
+				incremental_mode = true;
+				continue;
+			}
+			break;
+		}
+		int orig_select_pos = design->selection_stack.size() - 1;
+		extra_args(args, argidx, design);
+
+		RTLIL::Selection new_selection(false);
+
+		for (auto module : design->selected_whole_modules_warn())
+		{
+			if (module->has_processes_warn())
+				continue;
+
+			StaTimer *timer = nullptr;
+			for (auto mon : module->monitors)
+				if (dynamic_cast<StaTimer*>(mon) != nullptr)
+					timer = dynamic_cast<StaTimer*>(mon);
+
+			if (timer != nullptr && (!incremental_mode || !timer->update(config))) {
+				if (incremental_mode)
+					log("Rebuilding the timing graph of module %s.\n", log_id(module));
+				module->monitors.erase(timer);
+				timers.erase(timer);
+				delete timer;
+				timer = nullptr;
+			}
+
+			if (timer == nullptr) {
+				config.read_liberty();
+				timer = new StaTimer(config, module);
+				timer->build();
+				timer->propagate();
+				if (incremental_mode) {
+					module->monitors.insert(timer);
+					timers.insert(timer);
+				}
+			}
+
+			pool<Cell*> critical_cells;
+			timer->report(select_mode ? &critical_cells : nullptr);
+
+			if (!incremental_mode)
+				delete timer;
+
+			for (auto cell : critical_cells)
+				new_selection.selected_members[module->name].insert(cell->name);
+		}
+
+		if (select_mode) {
+			log_assert(orig_select_pos >= 0);
+			design->selection_stack[orig_select_pos] = new_selection;
+			design->selection_stack[orig_select_pos].optimize(design);
+		}
+	}
+	void on_shutdown() YS_OVERRIDE
+	{
+		// timers of modules that were deleted in the meantime are only freed here
+		for (auto timer : timers)
+			delete timer;
+		timers.clear();
+	}
+} StaPass;
+
+PRIVATE_NAMESPACE_END
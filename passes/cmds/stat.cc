@@ -293,7 +293,7 @@ void read_liberty_cellarea(dict<IdString, double> &cell_area, string liberty_fil
 }
 
 struct StatPass : public Pass {
-	StatPass() : Pass("stat", "print some statistics") { }
+	StatPass() : Pass("stat", "print some statistics") { read_only = true; }
 	void help() YS_OVERRIDE
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
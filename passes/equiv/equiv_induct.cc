@@ -36,15 +36,19 @@ struct EquivInductWorker
 	SatGen satgen;
 
 	int max_seq;
+	int num_threads;
 	int success_counter;
 
+	// set for the copies of the model used by the worker threads
+	bool quiet;
+
 	dict<int, int> ez_step_is_consistent;
 	pool<Cell*> cell_warn_cache;
 	SigPool undriven_signals;
 
-	EquivInductWorker(Module *module, const pool<Cell*> &unproven_equiv_cells, bool model_undef, int max_seq) : module(module), sigmap(module),
-			cells(module->selected_cells()), workset(unproven_equiv_cells),
-			satgen(ez.get(), &sigmap), max_seq(max_seq), success_counter(0)
+	EquivInductWorker(Module *module, const vector<Cell*> &cells, const pool<Cell*> &unproven_equiv_cells, bool model_undef, int max_seq, int num_threads) :
+			module(module), sigmap(module), cells(cells), workset(unproven_equiv_cells),
+			satgen(ez.get(), &sigmap), max_seq(max_seq), num_threads(num_threads), success_counter(0), quiet(false)
 	{
 		satgen.model_undef = model_undef;
 	}
@@ -54,7 +58,7 @@ struct EquivInductWorker
 		vector<int> ez_equal_terms;
 
 		for (auto cell : cells) {
-			if (!satgen.importCell(cell, step) && !cell_warn_cache.count(cell)) {
+			if (!satgen.importCell(cell, step) && !cell_warn_cache.count(cell) && !quiet) {
 				log_warning("No SAT model available for cell %s (%s).\n", log_id(cell), log_id(cell->type));
 				cell_warn_cache.insert(cell);
 			}
@@ -81,10 +85,9 @@ struct EquivInductWorker
 		ez_step_is_consistent[step] = ez->expression(ez->OpAnd, ez_equal_terms);
 	}
 
-	void run()
+	// set up the undef constraints and the first time step
+	void init_model()
 	{
-		log("Found %d unproven $equiv cells in module %s:\n", GetSize(workset), log_id(module));
-
 		if (satgen.model_undef) {
 			for (auto cell : cells)
 				if (yosys_celltypes.cell_known(cell->type))
@@ -103,9 +106,83 @@ struct EquivInductWorker
 		if (satgen.model_undef) {
 			for (auto bit : satgen.initial_state.export_all())
 				ez->assume(ez->NOT(satgen.importUndefSigBit(bit, 1)));
-			log("  Undef modelling: force def on %d initial reg values and %d inputs.\n",
-				GetSize(satgen.initial_state), GetSize(undriven_signals));
+			if (!quiet)
+				log("  Undef modelling: force def on %d initial reg values and %d inputs.\n",
+					GetSize(satgen.initial_state), GetSize(undriven_signals));
 		}
+	}
+
+	bool prove_cell(Cell *cell)
+	{
+		SigBit bit_a = sigmap(cell->getPort("\\A")).as_bit();
+		SigBit bit_b = sigmap(cell->getPort("\\B")).as_bit();
+
+		log("  Trying to prove $equiv for %s:", log_signal(sigmap(cell->getPort("\\Y"))));
+
+		int ez_a = satgen.importSigBit(bit_a, max_seq+1);
+		int ez_b = satgen.importSigBit(bit_b, max_seq+1);
+		int cond = ez->XOR(ez_a, ez_b);
+
+		if (satgen.model_undef)
+			cond = ez->AND(cond, ez->NOT(satgen.importUndefSigBit(bit_a, max_seq+1)));
+
+		if (!ez->solve(cond)) {
+			log(" success!\n");
+			return true;
+		}
+
+		log(" failed.\n");
+		return false;
+	}
+
+	// prove the cells in the workset individually, using num_threads copies of the
+	// model with all time steps. every thread gets a contiguous range of cells,
+	// so that the log messages come out in the same order as with one thread.
+	void prove_workset()
+	{
+		workset.sort();
+		vector<Cell*> workset_cells(workset.begin(), workset.end());
+
+		int num_jobs = std::min(num_threads, GetSize(workset_cells));
+		if (num_jobs <= 1) {
+			for (auto cell : workset_cells)
+				if (prove_cell(cell)) {
+					cell->setPort("\\B", cell->getPort("\\A"));
+					success_counter++;
+				}
+			return;
+		}
+
+		vector<vector<Cell*>> proven_cells(num_jobs);
+
+		Pass::run_parallel(num_jobs, [&](int i) {
+			EquivInductWorker worker(module, cells, pool<Cell*>(), satgen.model_undef, max_seq, 1);
+			worker.quiet = true;
+			worker.init_model();
+			for (int step = 1; step <= max_seq; step++) {
+				worker.ez->assume(worker.ez_step_is_consistent[step]);
+				worker.create_timestep(step+1);
+			}
+
+			int begin = i * GetSize(workset_cells) / num_jobs;
+			int end = (i+1) * GetSize(workset_cells) / num_jobs;
+			for (int k = begin; k < end; k++)
+				if (worker.prove_cell(workset_cells[k]))
+					proven_cells[i].push_back(workset_cells[k]);
+		}, num_jobs);
+
+		for (auto &job_cells : proven_cells)
+			for (auto cell : job_cells) {
+				cell->setPort("\\B", cell->getPort("\\A"));
+				success_counter++;
+			}
+	}
+
+	void run()
+	{
+		log("Found %d unproven $equiv cells in module %s:\n", GetSize(workset), log_id(module));
+
+		init_model();
 
 		for (int step = 1; step <= max_seq; step++)
 		{
@@ -133,30 +210,7 @@ struct EquivInductWorker
 			log("  Proof for induction step failed. %s\n", step != max_seq ? "Extending to next time step." : "Trying to prove individual $equiv from workset.");
 		}
 
-		workset.sort();
-
-		for (auto cell : workset)
-		{
-			SigBit bit_a = sigmap(cell->getPort("\\A")).as_bit();
-			SigBit bit_b = sigmap(cell->getPort("\\B")).as_bit();
-
-			log("  Trying to prove $equiv for %s:", log_signal(sigmap(cell->getPort("\\Y"))));
-
-			int ez_a = satgen.importSigBit(bit_a, max_seq+1);
-			int ez_b = satgen.importSigBit(bit_b, max_seq+1);
-			int cond = ez->XOR(ez_a, ez_b);
-
-			if (satgen.model_undef)
-				cond = ez->AND(cond, ez->NOT(satgen.importUndefSigBit(bit_a, max_seq+1)));
-
-			if (!ez->solve(cond)) {
-				log(" success!\n");
-				cell->setPort("\\B", cell->getPort("\\A"));
-				success_counter++;
-			} else {
-				log(" failed.\n");
-			}
-		}
+		prove_workset();
 	}
 };
 
@@ -179,6 +233,11 @@ struct EquivInductPass : public Pass {
 		log("    -seq <N>\n");
 		log("        the max. number of time steps to be considered (default = 4)\n");
 		log("\n");
+		log("    -j <num>\n");
+		log("        when the $equiv cells have to be proven individually, do this using\n");
+		log("        up to <num> threads, each with its own copy of the SAT model. the\n");
+		log("        default is the number of threads given with 'yosys -j'.\n");
+		log("\n");
 		log("This command is very effective in proving complex sequential circuits, when\n");
 		log("the internal state of the circuit quickly propagates to $equiv cells.\n");
 		log("\n");
@@ -197,6 +256,7 @@ struct EquivInductPass : public Pass {
 		int success_counter = 0;
 		bool model_undef = false;
 		int max_seq = 4;
+		int num_threads = yosys_threads;
 
 		log_header(design, "Executing EQUIV_INDUCT pass.\n");
 
@@ -210,10 +270,18 @@ struct EquivInductPass : public Pass {
 				max_seq = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_threads = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
+#ifndef YOSYS_ENABLE_THREADS
+		num_threads = 1;
+#endif
+
 		for (auto module : design->selected_modules())
 		{
 			pool<Cell*> unproven_equiv_cells;
@@ -229,7 +297,7 @@ struct EquivInductPass : public Pass {
 				continue;
 			}
 
-			EquivInductWorker worker(module, unproven_equiv_cells, model_undef, max_seq);
+			EquivInductWorker worker(module, module->selected_cells(), unproven_equiv_cells, model_undef, max_seq, num_threads);
 			worker.run();
 			success_counter += worker.success_counter;
 		}
@@ -19,10 +19,37 @@
 
 #include "kernel/yosys.h"
 #include "kernel/satgen.h"
+#include "kernel/bitsim.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+// a SAT solver with the cells imported so far. used for one group of $equiv cells,
+// or with -share for all $equiv cells of a module. every proof only adds clauses
+// conditional on its own context literal, so the imported cones can be reused.
+struct EquivSimpleSolver
+{
+	ezSatPtr ez;
+	SatGen satgen;
+	pool<pair<Cell*, int>> imported_cells_cache;
+
+	EquivSimpleSolver(SigMap &sigmap, bool model_undef) : satgen(ez.get(), &sigmap)
+	{
+		satgen.model_undef = model_undef;
+	}
+};
+
+// the per-thread state for running workers concurrently: a copy of the sigmap
+// (SigMap lookups are not thread-safe) and the solver used with -share.
+// contexts are kept in a pool and reused by the following jobs.
+struct EquivSimpleContext
+{
+	SigMap sigmap;
+	std::unique_ptr<EquivSimpleSolver> solver;
+
+	EquivSimpleContext(const SigMap &sigmap) : sigmap(sigmap) { }
+};
+
 struct EquivSimpleWorker
 {
 	Module *module;
@@ -30,21 +57,25 @@ struct EquivSimpleWorker
 	Cell *equiv_cell;
 
 	SigMap &sigmap;
-	dict<SigBit, Cell*> &bit2driver;
+	const dict<SigBit, Cell*> &bit2driver;
+	const pool<Cell*> &sim_failed;
 
-	ezSatPtr ez;
-	SatGen satgen;
+	ezSatPtr &ez;
+	SatGen &satgen;
 	int max_seq;
 	bool short_cones;
 	bool verbose;
 
-	pool<pair<Cell*, int>> imported_cells_cache;
+	pool<pair<Cell*, int>> &imported_cells_cache;
+
+	// the proven cells, their B input is connected to A by the caller
+	vector<Cell*> proven_cells;
 
-	EquivSimpleWorker(const vector<Cell*> &equiv_cells, SigMap &sigmap, dict<SigBit, Cell*> &bit2driver, int max_seq, bool short_cones, bool verbose, bool model_undef) :
+	EquivSimpleWorker(const vector<Cell*> &equiv_cells, EquivSimpleSolver &solver, SigMap &sigmap, const dict<SigBit, Cell*> &bit2driver, const pool<Cell*> &sim_failed, int max_seq, bool short_cones, bool verbose) :
 			module(equiv_cells.front()->module), equiv_cells(equiv_cells), equiv_cell(nullptr),
-			sigmap(sigmap), bit2driver(bit2driver), satgen(ez.get(), &sigmap), max_seq(max_seq), short_cones(short_cones), verbose(verbose)
+			sigmap(sigmap), bit2driver(bit2driver), sim_failed(sim_failed), ez(solver.ez), satgen(solver.satgen), max_seq(max_seq), short_cones(short_cones), verbose(verbose),
+			imported_cells_cache(solver.imported_cells_cache)
 	{
-		satgen.model_undef = model_undef;
 	}
 
 	bool find_input_cone(pool<SigBit> &next_seed, pool<Cell*> &cells_cone, pool<SigBit> &bits_cone, const pool<Cell*> &cells_stop, const pool<SigBit> &bits_stop, pool<SigBit> *input_bits, Cell *cell)
@@ -92,6 +123,16 @@ struct EquivSimpleWorker
 	{
 		SigBit bit_a = sigmap(equiv_cell->getPort("\\A")).as_bit();
 		SigBit bit_b = sigmap(equiv_cell->getPort("\\B")).as_bit();
+
+		if (sim_failed.count(equiv_cell)) {
+			if (verbose) {
+				log("  Trying to prove $equiv cell %s:\n", log_id(equiv_cell));
+				log("    Simulation found a counterexample, skipping SAT.\n");
+			} else
+				log("  Trying to prove $equiv for %s: failed (simulation).\n", log_signal(equiv_cell->getPort("\\Y")));
+			return false;
+		}
+
 		int ez_context = ez->frozen_literal();
 
 		if (satgen.model_undef)
@@ -191,7 +232,7 @@ struct EquivSimpleWorker
 
 			if (satgen.model_undef) {
 				for (auto bit : input_bits)
-					ez->assume(ez->NOT(satgen.importUndefSigBit(bit, step+1)));
+					ez->assume(ez->NOT(satgen.importUndefSigBit(bit, step+1)), ez_context);
 			}
 
 			if (verbose)
@@ -199,7 +240,7 @@ struct EquivSimpleWorker
 
 			if (!ez->solve(ez_context)) {
 				log(verbose ? "    Proved equivalence! Marking $equiv cell as proven.\n" : " success!\n");
-				equiv_cell->setPort("\\B", equiv_cell->getPort("\\A"));
+				proven_cells.push_back(equiv_cell);
 				ez->assume(ez->NOT(ez_context));
 				return true;
 			}
@@ -251,7 +292,7 @@ struct EquivSimpleWorker
 		return false;
 	}
 
-	int run()
+	void run()
 	{
 		if (GetSize(equiv_cells) > 1) {
 			SigSpec sig;
@@ -260,13 +301,10 @@ struct EquivSimpleWorker
 			log(" Grouping SAT models for %s:\n", log_signal(sig));
 		}
 
-		int counter = 0;
 		for (auto c : equiv_cells) {
 			equiv_cell = c;
-			if (run_cell())
-				counter++;
+			run_cell();
 		}
-		return counter;
 	}
 
 };
@@ -297,12 +335,28 @@ struct EquivSimplePass : public Pass {
 		log("    -seq <N>\n");
 		log("        the max. number of time steps to be considered (default = 1)\n");
 		log("\n");
+		log("    -nosim\n");
+		log("        do not use random simulation to find counterexamples before running\n");
+		log("        the SAT solver\n");
+		log("\n");
+		log("    -share\n");
+		log("        use one SAT solver for all $equiv cells in a module, instead of one\n");
+		log("        per group. the input cones are then only imported once, which is much\n");
+		log("        faster when many $equiv cells have overlapping cones. (with -j there\n");
+		log("        is one such solver per thread.)\n");
+		log("\n");
+		log("    -j <num>\n");
+		log("        prove the groups of $equiv cells using up to <num> threads. the results\n");
+		log("        and the order of the log messages do not depend on <num>. the default\n");
+		log("        is the number of threads given with 'yosys -j'.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, Design *design) YS_OVERRIDE
 	{
-		bool verbose = false, short_cones = false, model_undef = false, nogroup = false;
+		bool verbose = false, short_cones = false, model_undef = false, nogroup = false, nosim = false, share = false;
 		int success_counter = 0;
 		int max_seq = 1;
+		int num_threads = yosys_threads;
 
 		log_header(design, "Executing EQUIV_SIMPLE pass.\n");
 
@@ -324,6 +378,18 @@ struct EquivSimplePass : public Pass {
 				nogroup = true;
 				continue;
 			}
+			if (args[argidx] == "-nosim") {
+				nosim = true;
+				continue;
+			}
+			if (args[argidx] == "-share") {
+				share = true;
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_threads = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
 			if (args[argidx] == "-seq" && argidx+1 < args.size()) {
 				max_seq = atoi(args[++argidx].c_str());
 				continue;
@@ -332,6 +398,10 @@ struct EquivSimplePass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
+#ifndef YOSYS_ENABLE_THREADS
+		num_threads = 1;
+#endif
+
 		CellTypes ct;
 		ct.setup_internals();
 		ct.setup_stdcells();
@@ -368,18 +438,73 @@ struct EquivSimplePass : public Pass {
 							bit2driver[bit] = cell;
 			}
 
+			pool<Cell*> sim_failed;
+			if (!nosim) {
+				BitSim sim(sigmap, module, true);
+				sim.run(4, max_seq+1);
+				for (auto &it : unproven_equiv_cells)
+					for (auto &it2 : it.second)
+						if (sim.differ(sigmap(it2.second->getPort("\\A")).as_bit(), sigmap(it2.second->getPort("\\B")).as_bit()))
+							sim_failed.insert(it2.second);
+			}
+
 			unproven_equiv_cells.sort();
+			vector<vector<Cell*>> groups;
 			for (auto it : unproven_equiv_cells)
 			{
 				it.second.sort();
-
-				vector<Cell*> cells;
+				groups.push_back(vector<Cell*>());
 				for (auto it2 : it.second)
-					cells.push_back(it2.second);
-
-				EquivSimpleWorker worker(cells, sigmap, bit2driver, max_seq, short_cones, verbose, model_undef);
-				success_counter += worker.run();
+					groups.back().push_back(it2.second);
 			}
+
+			std::vector<std::unique_ptr<EquivSimpleContext>> free_contexts;
+#ifdef YOSYS_ENABLE_THREADS
+			std::mutex free_contexts_mutex;
+#endif
+			vector<vector<Cell*>> proven_cells(GetSize(groups));
+
+			Pass::run_parallel(GetSize(groups), [&](int i) {
+				std::unique_ptr<EquivSimpleContext> context;
+				{
+#ifdef YOSYS_ENABLE_THREADS
+					std::lock_guard<std::mutex> lock(free_contexts_mutex);
+#endif
+					if (!free_contexts.empty()) {
+						context = std::move(free_contexts.back());
+						free_contexts.pop_back();
+					}
+				}
+				if (!context) {
+					context.reset(new EquivSimpleContext(sigmap));
+					if (share)
+						context->solver.reset(new EquivSimpleSolver(context->sigmap, model_undef));
+				}
+
+				std::unique_ptr<EquivSimpleSolver> group_solver;
+				if (!share)
+					group_solver.reset(new EquivSimpleSolver(context->sigmap, model_undef));
+
+				EquivSimpleWorker worker(groups[i], share ? *context->solver : *group_solver, context->sigmap, bit2driver, sim_failed, max_seq, short_cones, verbose);
+				worker.run();
+				proven_cells[i] = worker.proven_cells;
+
+#ifdef YOSYS_ENABLE_THREADS
+				std::lock_guard<std::mutex> lock(free_contexts_mutex);
+#endif
+				free_contexts.push_back(std::move(context));
+			}, num_threads);
+
+			for (auto &cells : proven_cells)
+				for (auto cell : cells) {
+					cell->setPort("\\B", cell->getPort("\\A"));
+					success_counter++;
+				}
+
+			if (share && verbose)
+				for (auto &context : free_contexts)
+					log("Shared SAT solver for %s: %d cells imported, %d literals, %d clauses.\n", log_id(module),
+							GetSize(context->solver->imported_cells_cache), context->solver->ez->numCnfVariables(), context->solver->ez->numCnfClauses());
 		}
 
 		log("Proved %d previously unproven $equiv cells.\n", success_counter);
@@ -20,6 +20,7 @@
 
 #include "kernel/yosys.h"
 #include "frontends/verific/verific.h"
+#include "frontends/ast/ast.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <set>
@@ -444,6 +445,65 @@ bool expand_module(RTLIL::Design *design, RTLIL::Module *module, bool flag_check
 	return did_something;
 }
 
+// Derive the parametric modules needed by the cells in 'modules' ahead of expand_module(), using several
+// threads. expand_module() then finds them in the design. Cells connected to SV interfaces are left to
+// expand_module(), as are modules that still have interfaces to be replaced.
+void derive_parallel(RTLIL::Design *design, const std::set<RTLIL::Module*, IdString::compare_ptr_by_name<Module>> &modules, bool flag_check, int num_threads)
+{
+	std::vector<std::pair<AST::AstModule*, dict<RTLIL::IdString, RTLIL::Const>>> jobs;
+	std::set<std::pair<RTLIL::IdString, std::map<RTLIL::IdString, RTLIL::Const>>> seen;
+
+	auto has_interfaces = [](RTLIL::Module *mod) {
+		for (auto wire : mod->wires())
+			if (wire->get_bool_attribute("\\is_interface"))
+				return true;
+		for (auto cell : mod->cells())
+			if (cell->get_bool_attribute("\\is_interface"))
+				return true;
+		return false;
+	};
+
+	for (auto module : modules)
+	{
+		if (has_interfaces(module))
+			continue;
+
+		for (auto cell : module->cells())
+		{
+			if (cell->parameters.empty() || cell->type.begins_with("$array:"))
+				continue;
+
+			bool abstract = false;
+			RTLIL::Module *mod = design->module(cell->type);
+			if (mod == nullptr) {
+				mod = design->module("$abstract" + cell->type.str());
+				abstract = true;
+			}
+
+			AST::AstModule *ast_mod = dynamic_cast<AST::AstModule*>(mod);
+			if (ast_mod == nullptr || ast_mod->get_bool_attribute("\\is_interface") || has_interfaces(ast_mod))
+				continue;
+			if (!abstract && ast_mod->get_blackbox_attribute())
+				continue;
+
+			bool bad_param = false;
+			if (flag_check && !abstract)
+				for (auto &param : cell->parameters)
+					if (ast_mod->avail_parameters.count(param.first) == 0 && param.first[0] != '$' && strchr(param.first.c_str(), '.') == NULL)
+						bad_param = true;
+			if (bad_param)
+				continue;
+
+			std::map<RTLIL::IdString, RTLIL::Const> key_params(cell->parameters.begin(), cell->parameters.end());
+			if (seen.insert(std::make_pair(ast_mod->name, key_params)).second)
+				jobs.push_back(std::make_pair(ast_mod, cell->parameters));
+		}
+	}
+
+	if (GetSize(jobs) > 1)
+		AST::derive_modules(design, jobs, num_threads);
+}
+
 void hierarchy_worker(RTLIL::Design *design, std::set<RTLIL::Module*, IdString::compare_ptr_by_name<Module>> &used, RTLIL::Module *mod, int indent)
 {
 	if (used.count(mod) > 0)
@@ -610,6 +670,10 @@ struct HierarchyPass : public Pass {
 		log("    -auto-top\n");
 		log("        automatically determine the top of the design hierarchy and mark it.\n");
 		log("\n");
+		log("    -j <num>\n");
+		log("        derive parametric modules using up to <num> threads. the default is\n");
+		log("        the number of threads given with 'yosys -j'.\n");
+		log("\n");
 		log("    -chparam name value \n");
 		log("       elaborate the top module using this parameter value. Modules on which\n");
 		log("       this parameter does not exist may cause a warning message to be output.\n");
@@ -650,6 +714,7 @@ struct HierarchyPass : public Pass {
 		bool keep_portwidths = false;
 		bool nodefaults = false;
 		bool nokeep_asserts = false;
+		int num_threads = yosys_threads;
 		std::vector<std::string> generate_cells;
 		std::vector<generate_port_decl_t> generate_ports;
 		std::map<std::string, std::string> parameters;
@@ -724,6 +789,10 @@ struct HierarchyPass : public Pass {
 				nokeep_asserts = true;
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_threads = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
 			if (args[argidx] == "-libdir" && argidx+1 < args.size()) {
 				libdirs.push_back(args[++argidx]);
 				continue;
@@ -752,6 +821,10 @@ struct HierarchyPass : public Pass {
 		}
 		extra_args(args, argidx, design, false);
 
+#ifndef YOSYS_ENABLE_THREADS
+		num_threads = 1;
+#endif
+
 		if (!load_top_mod.empty())
 		{
 			IdString top_name = RTLIL::escape_id(load_top_mod);
@@ -848,6 +921,9 @@ struct HierarchyPass : public Pass {
 					used_modules.insert(mod);
 			}
 
+			if (num_threads > 1)
+				derive_parallel(design, used_modules, flag_check || flag_simcheck, num_threads);
+
 			for (auto module : used_modules) {
 				if (expand_module(design, module, flag_check, flag_simcheck, libdirs))
 					did_something = true;
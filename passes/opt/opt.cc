@@ -18,6 +18,7 @@
  */
 
 #include "kernel/register.h"
+#include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -25,6 +26,195 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+// Keeps track of the cells of a module that "opt -incremental" must revisit
+// in the next iteration: cells with changed connections or a changed type,
+// and the cells on the nets they are connected to. Cells are recorded by name
+// because the opt_* passes remove cells while the monitor is installed.
+//
+// The index of the cells on each net is kept up to date from the
+// notify_connect() callbacks, so it is built only once. It uses the bits as
+// they appear on the cell ports: opt_clean maps all cell ports to the same
+// representative of each net (and tells the monitor), so cells on the same
+// net share the same bits after the first iteration. Index entries are
+// removed as soon as no cell uses a bit anymore, so the index never refers
+// to a wire that opt_clean has removed. Changed nets must be translated to
+// cells before the wires go away, so while opt_clean is running this happens
+// immediately (flush_always).
+struct OptDirtyMonitor : public RTLIL::Monitor
+{
+	// unchanged nets of a changed cell are not followed if they have more
+	// cells than this (clock and reset nets)
+	static const int max_neighbour_fanout = 64;
+
+	RTLIL::Module *module;
+	dict<RTLIL::SigBit, pool<RTLIL::IdString>> bit2cells;
+	dict<RTLIL::IdString, RTLIL::IdString> cell_types;
+	pool<RTLIL::SigBit> dirty_bits, neighbour_bits, flushed_bits;
+	pool<RTLIL::IdString> dirty_cells;
+	bool dirty_module, flush_always;
+
+	OptDirtyMonitor(RTLIL::Module *module) : module(module), dirty_module(true), flush_always(false)
+	{
+		for (auto cell : module->cells()) {
+			cell_types[cell->name] = cell->type;
+			for (auto &conn : cell->connections())
+				index_sig(cell->name, conn.second);
+		}
+		module->monitors.insert(this);
+	}
+
+	~OptDirtyMonitor()
+	{
+		module->monitors.erase(this);
+	}
+
+	void index_sig(RTLIL::IdString cell, const RTLIL::SigSpec &sig)
+	{
+		for (auto bit : sig)
+			if (bit.wire)
+				bit2cells[bit].insert(cell);
+	}
+
+	void unindex_sig(RTLIL::IdString cell, const RTLIL::SigSpec &sig)
+	{
+		for (auto bit : sig) {
+			if (bit.wire == nullptr)
+				continue;
+			auto it = bit2cells.find(bit);
+			if (it == bit2cells.end())
+				continue;
+			it->second.erase(cell);
+			if (it->second.empty())
+				bit2cells.erase(it);
+		}
+	}
+
+	static void mark_sig(pool<RTLIL::SigBit> &bits, const RTLIL::SigSpec &sig)
+	{
+		for (auto bit : sig)
+			if (bit.wire)
+				bits.insert(bit);
+	}
+
+	void mark_cell(RTLIL::Cell *cell)
+	{
+		dirty_cells.insert(cell->name);
+		for (auto &conn : cell->connections())
+			mark_sig(neighbour_bits, conn.second);
+	}
+
+	// translate the changed nets into cells, must be called before the
+	// wires of the nets can be removed
+	void flush()
+	{
+		for (auto bit : dirty_bits) {
+			if (flush_always && !flushed_bits.insert(bit).second)
+				continue;
+			auto it = bit2cells.find(bit);
+			if (it != bit2cells.end())
+				dirty_cells.insert(it->second.begin(), it->second.end());
+		}
+		for (auto bit : neighbour_bits) {
+			if (flush_always && !flushed_bits.insert(bit).second)
+				continue;
+			auto it = bit2cells.find(bit);
+			if (it != bit2cells.end() && GetSize(it->second) <= max_neighbour_fanout)
+				dirty_cells.insert(it->second.begin(), it->second.end());
+		}
+		// pool::clear() keeps the capacity, and so the rehash cost, of the
+		// largest set so far
+		dirty_bits = pool<RTLIL::SigBit>();
+		neighbour_bits = pool<RTLIL::SigBit>();
+	}
+
+	// called once opt_clean is done, flushed_bits may refer to removed wires
+	void end_flush_always()
+	{
+		flush_always = false;
+		flushed_bits = pool<RTLIL::SigBit>();
+	}
+
+	// the opt_* passes change the type of cells in place, without notifying
+	// the monitors
+	void check_types()
+	{
+		for (auto cell : module->cells()) {
+			RTLIL::IdString &type = cell_types[cell->name];
+			if (type == cell->type)
+				continue;
+			if (!type.empty()) {
+				mark_cell(cell);
+				for (auto &conn : cell->connections())
+					mark_sig(dirty_bits, conn.second);
+			}
+			type = cell->type;
+		}
+	}
+
+	bool dirty()
+	{
+		return dirty_module || !dirty_cells.empty() || !dirty_bits.empty() || !neighbour_bits.empty();
+	}
+
+	void clear()
+	{
+		dirty_bits = pool<RTLIL::SigBit>();
+		neighbour_bits = pool<RTLIL::SigBit>();
+		dirty_cells = pool<RTLIL::IdString>();
+		dirty_module = false;
+	}
+
+	void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString &port, const RTLIL::SigSpec &old_sig, RTLIL::SigSpec &sig) YS_OVERRIDE
+	{
+		dirty_cells.insert(cell->name);
+		mark_sig(dirty_bits, old_sig);
+		mark_sig(dirty_bits, sig);
+		for (auto &conn : cell->connections())
+			if (conn.first != port)
+				mark_sig(neighbour_bits, conn.second);
+
+		// the old bits must be flushed while they are still in the index
+		if (flush_always)
+			flush();
+
+		unindex_sig(cell->name, old_sig);
+		for (auto &conn : cell->connections())
+			if (conn.first != port)
+				index_sig(cell->name, conn.second);
+		index_sig(cell->name, sig);
+	}
+
+	void notify_connect(RTLIL::Module *mod YS_ATTRIBUTE(unused), const RTLIL::SigSig &sigsig) YS_OVERRIDE
+	{
+		// opt_clean re-adds the connections it keeps. the cells that it moves
+		// to another bit of the same net are reported through setPort().
+		if (flush_always)
+			return;
+
+		for (int i = 0; i < GetSize(sigsig.first); i++)
+		{
+			RTLIL::SigBit lhs = sigsig.first[i];
+			RTLIL::SigBit rhs = sigsig.second[i];
+			if (lhs == rhs)
+				continue;
+			if (lhs.wire)
+				dirty_bits.insert(lhs);
+			if (rhs.wire)
+				dirty_bits.insert(rhs);
+		}
+	}
+
+	void notify_connect(RTLIL::Module *mod YS_ATTRIBUTE(unused), const std::vector<RTLIL::SigSig>&) YS_OVERRIDE
+	{
+		dirty_module = true;
+	}
+
+	void notify_blackout(RTLIL::Module *mod YS_ATTRIBUTE(unused)) YS_OVERRIDE
+	{
+		dirty_module = true;
+	}
+};
+
 struct OptPass : public Pass {
 	OptPass() : Pass("opt", "perform simple optimizations") { }
 	void help() YS_OVERRIDE
@@ -58,6 +248,13 @@ struct OptPass : public Pass {
 		log("        opt_clean [-purge]\n");
 		log("    while <changed design in opt_rmdff>\n");
 		log("\n");
+		log("With -incremental, the first iteration of the loop runs on the whole\n");
+		log("selection. Later iterations only revisit the cells that have been changed in\n");
+		log("the previous iteration and the cells connected to them. opt_muxtree runs\n");
+		log("on the modules with changed $mux or $pmux cells, and opt_clean on all\n");
+		log("modules with changes.\n");
+		log("This option can not be combined with -fast.\n");
+		log("\n");
 		log("Note: Options in square brackets (such as [-keepdc]) are passed through to\n");
 		log("the opt_* commands when given to 'opt'.\n");
 		log("\n");
@@ -71,6 +268,7 @@ struct OptPass : public Pass {
 		std::string opt_merge_args;
 		std::string opt_rmdff_args;
 		bool fast_mode = false;
+		bool incr_mode = false;
 
 		log_header(design, "Executing OPT pass (performing simple optimizations).\n");
 		log_push();
@@ -124,10 +322,17 @@ struct OptPass : public Pass {
 				fast_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-incremental") {
+				incr_mode = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
+		if (fast_mode && incr_mode)
+			log_cmd_error("Options -fast and -incremental are exclusive.\n");
+
 		if (fast_mode)
 		{
 			while (1) {
@@ -142,6 +347,89 @@ struct OptPass : public Pass {
 			}
 			Pass::call(design, "opt_clean" + opt_clean_args);
 		}
+		else if (incr_mode)
+		{
+			RTLIL::Selection orig_selection = design->selection();
+			std::vector<OptDirtyMonitor*> monitors;
+			for (auto module : design->selected_whole_modules())
+				monitors.push_back(new OptDirtyMonitor(module));
+
+			Pass::call(design, "opt_expr" + opt_expr_args);
+			Pass::call(design, "opt_merge -nomux" + opt_merge_args);
+			while (1) {
+				// cells for opt_reduce, opt_merge, opt_rmdff and opt_expr, whole
+				// modules for opt_clean, and the modules with changed $mux or
+				// $pmux cells for opt_muxtree
+				RTLIL::Selection cell_sel(false), module_sel(false), muxtree_sel(false);
+				std::vector<OptDirtyMonitor*> dirty_monitors;
+				int num_cells = 0;
+
+				for (auto mon : monitors) {
+					mon->check_types();
+					if (!mon->dirty())
+						continue;
+					if (mon->dirty_module) {
+						cell_sel.selected_modules.insert(mon->module->name);
+						muxtree_sel.selected_modules.insert(mon->module->name);
+						num_cells += GetSize(mon->module->cells_);
+					} else {
+						mon->flush();
+						pool<RTLIL::IdString> cells;
+						bool has_mux = false;
+						for (auto name : mon->dirty_cells) {
+							RTLIL::Cell *cell = mon->module->cell(name);
+							if (cell == nullptr)
+								continue;
+							cells.insert(name);
+							if (cell->type.in("$mux", "$pmux"))
+								has_mux = true;
+						}
+						if (!cells.empty())
+							cell_sel.selected_members[mon->module->name] = cells;
+						if (has_mux)
+							muxtree_sel.selected_modules.insert(mon->module->name);
+						num_cells += GetSize(cells);
+					}
+					mon->clear();
+					module_sel.selected_modules.insert(mon->module->name);
+					dirty_monitors.push_back(mon);
+				}
+
+				// partially selected modules are not tracked
+				for (auto &it : orig_selection.selected_members) {
+					cell_sel.selected_members[it.first] = it.second;
+					muxtree_sel.selected_members[it.first] = it.second;
+				}
+
+				if (dirty_monitors.empty() && orig_selection.selected_members.empty())
+					break;
+
+				log("Revisiting %d cells in %d modules.\n", num_cells, GetSize(dirty_monitors));
+
+				design->scratchpad_unset("opt.did_something");
+				Pass::call_on_selection(design, muxtree_sel, "opt_muxtree");
+				Pass::call_on_selection(design, cell_sel, "opt_reduce" + opt_reduce_args);
+				Pass::call_on_selection(design, cell_sel, "opt_merge" + opt_merge_args);
+				Pass::call_on_selection(design, cell_sel, "opt_rmdff" + opt_rmdff_args);
+
+				// opt_clean removes wires without notifying the monitors
+				for (auto mon : dirty_monitors) {
+					mon->flush();
+					mon->flush_always = true;
+				}
+				Pass::call_on_selection(design, module_sel, "opt_clean" + opt_clean_args);
+				for (auto mon : dirty_monitors)
+					mon->end_flush_always();
+
+				Pass::call_on_selection(design, cell_sel, "opt_expr" + opt_expr_args);
+				if (design->scratchpad_get_bool("opt.did_something") == false)
+					break;
+				log_header(design, "Rerunning OPT passes on changed cells.\n");
+			}
+
+			for (auto mon : monitors)
+				delete mon;
+		}
 		else
 		{
 			Pass::call(design, "opt_expr" + opt_expr_args);
@@ -274,13 +274,21 @@ bool rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 
 	module->connections_.clear();
 
+	// monitors (opt -incremental) must see the cell ports that are changed
+	bool notify = !module->monitors.empty() || (module->design && !module->design->monitors.empty());
+
 	SigPool used_signals;
 	SigPool raw_used_signals;
 	SigPool used_signals_nodrivers;
 	for (auto &it : module->cells_) {
 		RTLIL::Cell *cell = it.second;
 		for (auto &it2 : cell->connections_) {
-			assign_map.apply(it2.second);
+			if (notify) {
+				RTLIL::SigSpec sig = assign_map(it2.second);
+				if (sig != it2.second)
+					cell->setPort(it2.first, sig);
+			} else
+				assign_map.apply(it2.second);
 			raw_used_signals.add(it2.second);
 			used_signals.add(it2.second);
 			if (!ct_all.cell_output(cell->type, it2.first))
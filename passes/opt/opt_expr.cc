@@ -29,11 +29,10 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-bool did_something;
+thread_local bool did_something;
 
-void replace_undriven(RTLIL::Design *design, RTLIL::Module *module)
+void replace_undriven(const CellTypes &ct, RTLIL::Module *module)
 {
-	CellTypes ct(design);
 	SigMap sigmap(module);
 	SigPool driven_signals;
 	SigPool used_signals;
@@ -1642,15 +1641,21 @@ struct OptExprPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		for (auto module : design->selected_modules())
+		CellTypes ct;
+		if (undriven)
+			ct.setup(design);
+
+		std::atomic<bool> any_did_something(false);
+
+		run_on_modules(design->selected_modules(), [&](RTLIL::Module *module)
 		{
 			log("Optimizing module %s.\n", log_id(module));
 
 			if (undriven) {
 				did_something = false;
-				replace_undriven(design, module);
+				replace_undriven(ct, module);
 				if (did_something)
-					design->scratchpad_set_bool("opt.did_something", true);
+					any_did_something = true;
 			}
 
 			do {
@@ -1658,15 +1663,18 @@ struct OptExprPass : public Pass {
 					did_something = false;
 					replace_const_cells(design, module, false, mux_undef, mux_bool, do_fine, keepdc, clkinv);
 					if (did_something)
-						design->scratchpad_set_bool("opt.did_something", true);
+						any_did_something = true;
 				} while (did_something);
 				replace_const_cells(design, module, true, mux_undef, mux_bool, do_fine, keepdc, clkinv);
 				if (did_something)
-					design->scratchpad_set_bool("opt.did_something", true);
+					any_did_something = true;
 			} while (did_something);
 
 			log_suppressed();
-		}
+		});
+
+		if (any_did_something)
+			design->scratchpad_set_bool("opt.did_something", true);
 
 		log_pop();
 	}
@@ -21,13 +21,10 @@
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include "kernel/celltypes.h"
-#include "libs/sha1/sha1.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <set>
 
-#define USE_CELL_HASH_CACHE
-
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
@@ -41,9 +38,7 @@ struct OptMergeWorker
 
 	CellTypes ct;
 	int total_count;
-#ifdef USE_CELL_HASH_CACHE
-	dict<const RTLIL::Cell*, std::string> cell_hash_cache;
-#endif
+	dict<const RTLIL::Cell*, unsigned int> cell_hash_cache;
 
 	static void sort_pmux_conn(dict<RTLIL::IdString, RTLIL::SigSpec> &conn)
 	{
@@ -68,199 +63,128 @@ struct OptMergeWorker
 		}
 	}
 
-#ifdef USE_CELL_HASH_CACHE
-	std::string int_to_hash_string(unsigned int v)
+	static unsigned int hash_const(const RTLIL::Const &value)
 	{
-		if (v == 0)
-			return "0";
-		std::string str = "";
-		while (v > 0) {
-			str += 'a' + (v & 15);
-			v = v >> 4;
-		}
-		return str;
+		unsigned int h = mkhash_init;
+		for (auto bit : value.bits)
+			h = mkhash(h, bit);
+		return h;
 	}
 
-	std::string hash_cell_parameters_and_connections(const RTLIL::Cell *cell)
+	// Bring the connections of a cell into a canonical form, so that two cells
+	// that compute the same function have identical connections. Outputs are
+	// removed and all inputs are mapped through assign_map.
+	void canonical_connections(const RTLIL::Cell *cell, dict<RTLIL::IdString, RTLIL::SigSpec> &conn)
 	{
-		if (cell_hash_cache.count(cell) > 0)
-			return cell_hash_cache[cell];
-
-		std::string hash_string = cell->type.str() + "\n";
-
-		for (auto &it : cell->parameters)
-			hash_string += "P " + it.first.str() + "=" + it.second.as_string() + "\n";
+		conn = cell->connections();
 
-		const dict<RTLIL::IdString, RTLIL::SigSpec> *conn = &cell->connections();
-		dict<RTLIL::IdString, RTLIL::SigSpec> alt_conn;
+		for (auto &it : conn) {
+			if (cell->output(it.first))
+				it.second = RTLIL::SigSpec();
+			else
+				assign_map.apply(it.second);
+		}
 
-		if (cell->type == "$and" || cell->type == "$or" || cell->type == "$xor" || cell->type == "$xnor" || cell->type == "$add" || cell->type == "$mul" ||
-				cell->type == "$logic_and" || cell->type == "$logic_or" || cell->type == "$_AND_" || cell->type == "$_OR_" || cell->type == "$_XOR_") {
-			alt_conn = *conn;
-			if (assign_map(alt_conn.at("\\A")) < assign_map(alt_conn.at("\\B"))) {
-				alt_conn["\\A"] = conn->at("\\B");
-				alt_conn["\\B"] = conn->at("\\A");
-			}
-			conn = &alt_conn;
+		if (cell->type.in("$and", "$or", "$xor", "$xnor", "$add", "$mul", "$logic_and", "$logic_or", "$_AND_", "$_OR_", "$_XOR_")) {
+			if (conn.at("\\A") < conn.at("\\B"))
+				std::swap(conn.at("\\A"), conn.at("\\B"));
 		} else
-		if (cell->type == "$reduce_xor" || cell->type == "$reduce_xnor") {
-			alt_conn = *conn;
-			assign_map.apply(alt_conn.at("\\A"));
-			alt_conn.at("\\A").sort();
-			conn = &alt_conn;
+		if (cell->type.in("$reduce_xor", "$reduce_xnor")) {
+			conn.at("\\A").sort();
 		} else
-		if (cell->type == "$reduce_and" || cell->type == "$reduce_or" || cell->type == "$reduce_bool") {
-			alt_conn = *conn;
-			assign_map.apply(alt_conn.at("\\A"));
-			alt_conn.at("\\A").sort_and_unify();
-			conn = &alt_conn;
+		if (cell->type.in("$reduce_and", "$reduce_or", "$reduce_bool")) {
+			conn.at("\\A").sort_and_unify();
 		} else
 		if (cell->type == "$pmux") {
-			alt_conn = *conn;
-			assign_map.apply(alt_conn.at("\\A"));
-			assign_map.apply(alt_conn.at("\\B"));
-			assign_map.apply(alt_conn.at("\\S"));
-			sort_pmux_conn(alt_conn);
-			conn = &alt_conn;
-		}
-
-		vector<string> hash_conn_strings;
-
-		for (auto &it : *conn) {
-			if (cell->output(it.first))
-				continue;
-			RTLIL::SigSpec sig = it.second;
-			assign_map.apply(sig);
-			string s = "C " + it.first.str() + "=";
-			for (auto &chunk : sig.chunks()) {
-				if (chunk.wire)
-					s += "{" + chunk.wire->name.str() + " " +
-							int_to_hash_string(chunk.offset) + " " +
-							int_to_hash_string(chunk.width) + "}";
-				else
-					s += RTLIL::Const(chunk.data).as_string();
-			}
-			hash_conn_strings.push_back(s + "\n");
+			sort_pmux_conn(conn);
 		}
-
-		std::sort(hash_conn_strings.begin(), hash_conn_strings.end());
-
-		for (auto it : hash_conn_strings)
-			hash_string += it;
-
-		cell_hash_cache[cell] = sha1(hash_string);
-		return cell_hash_cache[cell];
 	}
-#endif
 
-	bool compare_cell_parameters_and_connections(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2, bool &lt)
+	// Structural hash over cell type, parameters and canonical input
+	// connections. Parameters and ports are combined order-independently,
+	// cells with equal hashes are compared exactly before they are merged.
+	unsigned int hash_cell_parameters_and_connections(const RTLIL::Cell *cell)
 	{
-#ifdef USE_CELL_HASH_CACHE
-		std::string hash1 = hash_cell_parameters_and_connections(cell1);
-		std::string hash2 = hash_cell_parameters_and_connections(cell2);
-
-		if (hash1 != hash2) {
-			lt = hash1 < hash2;
-			return true;
-		}
-#endif
+		auto cache_it = cell_hash_cache.find(cell);
+		if (cache_it != cell_hash_cache.end())
+			return cache_it->second;
 
-		if (cell1->parameters != cell2->parameters) {
-			std::map<RTLIL::IdString, RTLIL::Const> p1(cell1->parameters.begin(), cell1->parameters.end());
-			std::map<RTLIL::IdString, RTLIL::Const> p2(cell2->parameters.begin(), cell2->parameters.end());
-			lt = p1 < p2;
-			return true;
-		}
+		unsigned int h = mkhash_init;
+		h = mkhash(h, cell->type.hash());
 
-		dict<RTLIL::IdString, RTLIL::SigSpec> conn1 = cell1->connections();
-		dict<RTLIL::IdString, RTLIL::SigSpec> conn2 = cell2->connections();
-
-		for (auto &it : conn1) {
-			if (cell1->output(it.first))
-				it.second = RTLIL::SigSpec();
-			else
-				assign_map.apply(it.second);
-		}
+		unsigned int h_params = 0;
+		for (auto &it : cell->parameters)
+			h_params += mkhash(it.first.hash(), hash_const(it.second));
+		h = mkhash(h, h_params);
 
-		for (auto &it : conn2) {
-			if (cell2->output(it.first))
-				it.second = RTLIL::SigSpec();
-			else
-				assign_map.apply(it.second);
+		unsigned int h_conn = 0;
+		if (cell->type.in("$reduce_xor", "$reduce_xnor", "$reduce_and", "$reduce_or", "$reduce_bool", "$pmux"))
+		{
+			dict<RTLIL::IdString, RTLIL::SigSpec> conn;
+			canonical_connections(cell, conn);
+			for (auto &it : conn)
+				if (!it.second.empty())
+					h_conn += mkhash(it.first.hash(), it.second.hash());
 		}
-
-		if (cell1->type == "$and" || cell1->type == "$or" || cell1->type == "$xor" || cell1->type == "$xnor" || cell1->type == "$add" || cell1->type == "$mul" ||
-				cell1->type == "$logic_and" || cell1->type == "$logic_or" || cell1->type == "$_AND_" || cell1->type == "$_OR_" || cell1->type == "$_XOR_") {
-			if (conn1.at("\\A") < conn1.at("\\B")) {
-				RTLIL::SigSpec tmp = conn1["\\A"];
-				conn1["\\A"] = conn1["\\B"];
-				conn1["\\B"] = tmp;
-			}
-			if (conn2.at("\\A") < conn2.at("\\B")) {
-				RTLIL::SigSpec tmp = conn2["\\A"];
-				conn2["\\A"] = conn2["\\B"];
-				conn2["\\B"] = tmp;
+		else
+		{
+			// A and B of commutative cells are hashed under the same port name,
+			// which makes the sum independent of the order of the inputs
+			bool commutative = cell->type.in("$and", "$or", "$xor", "$xnor", "$add", "$mul", "$logic_and", "$logic_or", "$_AND_", "$_OR_", "$_XOR_");
+			for (auto &it : cell->connections()) {
+				if (cell->output(it.first))
+					continue;
+				unsigned int h_port = commutative && it.first == "\\B" ? RTLIL::IdString("\\A").hash() : it.first.hash();
+				h_conn += mkhash(h_port, assign_map(it.second).hash());
 			}
-		} else
-		if (cell1->type == "$reduce_xor" || cell1->type == "$reduce_xnor") {
-			conn1["\\A"].sort();
-			conn2["\\A"].sort();
-		} else
-		if (cell1->type == "$reduce_and" || cell1->type == "$reduce_or" || cell1->type == "$reduce_bool") {
-			conn1["\\A"].sort_and_unify();
-			conn2["\\A"].sort_and_unify();
-		} else
-		if (cell1->type == "$pmux") {
-			sort_pmux_conn(conn1);
-			sort_pmux_conn(conn2);
 		}
+		h = mkhash(h, h_conn);
 
-		if (conn1 != conn2) {
-			std::map<RTLIL::IdString, RTLIL::SigSpec> c1(conn1.begin(), conn1.end());
-			std::map<RTLIL::IdString, RTLIL::SigSpec> c2(conn2.begin(), conn2.end());
-			lt = c1 < c2;
-			return true;
-		}
+		cell_hash_cache[cell] = h;
+		return h;
+	}
+
+	bool compare_cell_parameters_and_connections(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2)
+	{
+		if (cell1->parameters != cell2->parameters)
+			return false;
+
+		dict<RTLIL::IdString, RTLIL::SigSpec> conn1, conn2;
+		canonical_connections(cell1, conn1);
+		canonical_connections(cell2, conn2);
 
-		if (cell1->type.substr(0, 1) == "$" && conn1.count("\\Q") != 0) {
+		if (conn1 != conn2)
+			return false;
+
+		if (cell1->type.begins_with("$") && conn1.count("\\Q") != 0) {
 			std::vector<RTLIL::SigBit> q1 = dff_init_map(cell1->getPort("\\Q")).to_sigbit_vector();
 			std::vector<RTLIL::SigBit> q2 = dff_init_map(cell2->getPort("\\Q")).to_sigbit_vector();
 			for (size_t i = 0; i < q1.size(); i++)
-				if ((q1.at(i).wire == NULL || q2.at(i).wire == NULL) && q1.at(i) != q2.at(i)) {
-					lt = q1.at(i) < q2.at(i);
-					return true;
-				}
+				if ((q1.at(i).wire == NULL || q2.at(i).wire == NULL) && q1.at(i) != q2.at(i))
+					return false;
 		}
 
-		return false;
+		return true;
+	}
+
+	bool mergeable(const RTLIL::Cell *cell)
+	{
+		if ((!mode_share_all && !ct.cell_known(cell->type)) || !cell->known())
+			return false;
+		if (cell->has_keep_attr())
+			return false;
+		return true;
 	}
 
 	bool compare_cells(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2)
 	{
 		if (cell1->type != cell2->type)
-			return cell1->type < cell2->type;
-
-		if ((!mode_share_all && !ct.cell_known(cell1->type)) || !cell1->known())
-			return cell1 < cell2;
-
-		if (cell1->has_keep_attr() || cell2->has_keep_attr())
-			return cell1 < cell2;
-
-		bool lt;
-		if (compare_cell_parameters_and_connections(cell1, cell2, lt))
-			return lt;
-
-		return false;
+			return false;
+		if (!mergeable(cell1) || !mergeable(cell2))
+			return false;
+		return compare_cell_parameters_and_connections(cell1, cell2);
 	}
 
-	struct CompareCells {
-		OptMergeWorker *that;
-		CompareCells(OptMergeWorker *that) : that(that) {}
-		bool operator()(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2) const {
-			return that->compare_cells(cell1, cell2);
-		}
-	};
-
 	OptMergeWorker(RTLIL::Design *design, RTLIL::Module *module, bool mode_nomux, bool mode_share_all) :
 		design(design), module(module), assign_map(module), mode_share_all(mode_share_all)
 	{
@@ -297,9 +221,7 @@ struct OptMergeWorker
 		bool did_something = true;
 		while (did_something)
 		{
-#ifdef USE_CELL_HASH_CACHE
 			cell_hash_cache.clear();
-#endif
 			std::vector<RTLIL::Cell*> cells;
 			cells.reserve(module->cells_.size());
 			for (auto &it : module->cells_) {
@@ -310,15 +232,27 @@ struct OptMergeWorker
 			}
 
 			did_something = false;
-			std::map<RTLIL::Cell*, RTLIL::Cell*, CompareCells> sharemap(CompareCells(this));
+			dict<int, std::vector<RTLIL::Cell*>> sharemap;
 			for (auto cell : cells)
 			{
-				if (sharemap.count(cell) > 0) {
+				RTLIL::Cell *other_cell = nullptr;
+				std::vector<RTLIL::Cell*> *bucket = nullptr;
+
+				if (mergeable(cell)) {
+					bucket = &sharemap[hash_cell_parameters_and_connections(cell)];
+					for (auto c : *bucket)
+						if (compare_cells(cell, c)) {
+							other_cell = c;
+							break;
+						}
+				}
+
+				if (other_cell != nullptr) {
 					did_something = true;
-					log_debug("  Cell `%s' is identical to cell `%s'.\n", cell->name.c_str(), sharemap[cell]->name.c_str());
+					log_debug("  Cell `%s' is identical to cell `%s'.\n", cell->name.c_str(), other_cell->name.c_str());
 					for (auto &it : cell->connections()) {
 						if (cell->output(it.first)) {
-							RTLIL::SigSpec other_sig = sharemap[cell]->getPort(it.first);
+							RTLIL::SigSpec other_sig = other_cell->getPort(it.first);
 							log_debug("    Redirecting output %s: %s = %s\n", it.first.c_str(),
 									log_signal(it.second), log_signal(other_sig));
 							module->connect(RTLIL::SigSig(it.second, other_sig));
@@ -326,13 +260,11 @@ struct OptMergeWorker
 						}
 					}
 					log_debug("    Removing %s cell `%s' from module `%s'.\n", cell->type.c_str(), cell->name.c_str(), module->name.c_str());
-#ifdef USE_CELL_HASH_CACHE
 					cell_hash_cache.erase(cell);
-#endif
 					module->remove(cell);
 					total_count++;
-				} else {
-					sharemap[cell] = cell;
+				} else if (bucket != nullptr) {
+					bucket->push_back(cell);
 				}
 			}
 		}
@@ -381,15 +313,15 @@ struct OptMergePass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		int total_count = 0;
-		for (auto module : design->selected_modules()) {
+		std::atomic<int> total_count(0);
+		run_on_modules(design->selected_modules(), [&](RTLIL::Module *module) {
 			OptMergeWorker worker(design, module, mode_nomux, mode_share_all);
 			total_count += worker.total_count;
-		}
+		});
 
 		if (total_count)
 			design->scratchpad_set_bool("opt.did_something", true);
-		log("Removed a total of %d cells.\n", total_count);
+		log("Removed a total of %d cells.\n", total_count.load());
 	}
 } OptMergePass;
 
@@ -36,6 +36,8 @@ struct ShareWorkerConfig
 	bool opt_force;
 	bool opt_aggressive;
 	bool opt_fast;
+	bool opt_shared_sat;
+	int max_cone;
 	pool<RTLIL::IdString> generic_uni_ops, generic_bin_ops, generic_cbin_ops, generic_other_ops;
 };
 
@@ -60,6 +62,23 @@ struct ShareWorker
 
 	std::vector<std::pair<RTLIL::SigBit, RTLIL::SigBit>> exclusive_ctrls;
 
+	// SAT problem for the control logic of a pair of cells. With -shared_sat one
+	// instance is kept for the whole module and only grows: cells and exclusive
+	// control constraints are imported once, and the per-pair activation checks
+	// are passed to the solver as assumptions.
+	struct ShareSatSolver
+	{
+		ezSatPtr ez;
+		SatGen satgen;
+		pool<RTLIL::Cell*> imported_cells;
+		pool<int> imported_exclusive_ctrls;
+
+		ShareSatSolver(SigMap *sigmap) : satgen(ez.get(), sigmap) { }
+	};
+
+	std::unique_ptr<ShareSatSolver> shared_sat;
+	int shared_sat_queries = 0;
+
 
 	// ------------------------------------------------------------------------------
 	// Find terminal bits -- i.e. bits that do not (exclusively) feed into a mux tree
@@ -1152,6 +1171,9 @@ struct ShareWorker
 		log("Found %d cells in module %s that may be considered for resource sharing.\n",
 				GetSize(shareable_cells), log_id(module));
 
+		if (config.opt_shared_sat)
+			shared_sat.reset(new ShareSatSolver(&modwalker.sigmap));
+
 		for (auto cell : module->cells())
 			if (cell->type == "$pmux")
 				for (auto bit : cell->getPort("\\S"))
@@ -1237,11 +1259,17 @@ struct ShareWorker
 				optimize_activation_patterns(filtered_cell_activation_patterns);
 				optimize_activation_patterns(filtered_other_cell_activation_patterns);
 
-				ezSatPtr ez;
-				SatGen satgen(ez.get(), &modwalker.sigmap);
+				std::unique_ptr<ShareSatSolver> pair_sat;
+				if (shared_sat == nullptr)
+					pair_sat.reset(new ShareSatSolver(&modwalker.sigmap));
+
+				ShareSatSolver &sat = shared_sat ? *shared_sat : *pair_sat;
+				ezSatPtr &ez = sat.ez;
+				SatGen &satgen = sat.satgen;
 
 				pool<RTLIL::Cell*> sat_cells;
 				std::set<RTLIL::SigBit> bits_queue;
+				bool cone_too_large = false;
 
 				std::vector<int> cell_active, other_cell_active;
 				RTLIL::SigSpec all_ctrl_signals;
@@ -1276,21 +1304,40 @@ struct ShareWorker
 								continue;
 							// log("      Adding cell %s (%s) to SAT problem.\n", log_id(pbit.cell), log_id(pbit.cell->type));
 							bits_queue.insert(modwalker.cell_inputs[pbit.cell].begin(), modwalker.cell_inputs[pbit.cell].end());
-							satgen.importCell(pbit.cell);
+							if (sat.imported_cells.count(pbit.cell) == 0) {
+								satgen.importCell(pbit.cell);
+								sat.imported_cells.insert(pbit.cell);
+							}
 							sat_cells.insert(pbit.cell);
 						}
 
 					if (config.opt_fast && sat_cells.size() > 100)
 						break;
+
+					if (config.max_cone > 0 && GetSize(sat_cells) > config.max_cone) {
+						cone_too_large = true;
+						break;
+					}
 				}
 
-				for (auto it : exclusive_ctrls)
-					if (satgen.importedSigBit(it.first) && satgen.importedSigBit(it.second)) {
+				if (cone_too_large) {
+					log("      Control logic cone has more than %d cells. Not sharing this pair of cells.\n", config.max_cone);
+					continue;
+				}
+
+				for (int i = 0; i < GetSize(exclusive_ctrls); i++) {
+					auto &it = exclusive_ctrls[i];
+					if (sat.imported_exclusive_ctrls.count(i) == 0 && satgen.importedSigBit(it.first) && satgen.importedSigBit(it.second)) {
 						log("      Adding exclusive control bits: %s vs. %s\n", log_signal(it.first), log_signal(it.second));
 						int sub1 = satgen.importSigBit(it.first);
 						int sub2 = satgen.importSigBit(it.second);
 						ez->assume(ez->NOT(ez->AND(sub1, sub2)));
+						sat.imported_exclusive_ctrls.insert(i);
 					}
+				}
+
+				if (shared_sat)
+					shared_sat_queries++;
 
 				if (!ez->solve(ez->expression(ez->OpOr, cell_active))) {
 					log("      According to the SAT solver the cell %s is never active. Sharing is pointless, we simply remove it.\n", log_id(cell));
@@ -1305,7 +1352,8 @@ struct ShareWorker
 					continue;
 				}
 
-				ez->non_incremental();
+				if (shared_sat == nullptr)
+					ez->non_incremental();
 
 				all_ctrl_signals.sort_and_unify();
 				std::vector<int> sat_model = satgen.importSigSpec(all_ctrl_signals);
@@ -1313,12 +1361,11 @@ struct ShareWorker
 
 				int sub1 = ez->expression(ez->OpOr, cell_active);
 				int sub2 = ez->expression(ez->OpOr, other_cell_active);
-				ez->assume(ez->AND(sub1, sub2));
 
 				log("      Size of SAT problem: %d cells, %d variables, %d clauses\n",
 						GetSize(sat_cells), ez->numCnfVariables(), ez->numCnfClauses());
 
-				if (ez->solve(sat_model, sat_model_values)) {
+				if (ez->solve(sat_model, sat_model_values, ez->AND(sub1, sub2))) {
 					log("      According to the SAT solver this pair of cells can not be shared.\n");
 					log("      Model from SAT solver: %s = %d'", log_signal(all_ctrl_signals), GetSize(sat_model_values));
 					for (int i = GetSize(sat_model_values)-1; i >= 0; i--)
@@ -1406,6 +1453,10 @@ struct ShareWorker
 			}
 		}
 
+		if (shared_sat != nullptr && shared_sat_queries > 0)
+			log("Shared SAT solver for module %s: %d queries, %d cells, %d variables, %d clauses.\n", log_id(module),
+					shared_sat_queries, GetSize(shared_sat->imported_cells), shared_sat->ez->numCnfVariables(), shared_sat->ez->numCnfClauses());
+
 		if (!cells_to_remove.empty()) {
 			log("Removing %d cells in module %s:\n", GetSize(cells_to_remove), log_id(module));
 			for (auto c : cells_to_remove) {
@@ -1453,6 +1504,15 @@ struct SharePass : public Pass {
 		log("    in much easier SAT problems at the cost of maybe missing some opportunities\n");
 		log("    for resource sharing.\n");
 		log("\n");
+		log("  -shared_sat\n");
+		log("    Use one incremental SAT solver per module instead of a new solver for each\n");
+		log("    pair of cells. The control logic is imported into the solver only once and\n");
+		log("    the activation checks for each pair are solved under assumptions.\n");
+		log("\n");
+		log("  -max_cone N\n");
+		log("    Do not share a pair of cells if the control logic cone that would need to\n");
+		log("    be considered in SAT solving has more than N cells.\n");
+		log("\n");
 		log("  -limit N\n");
 		log("    Only perform the first N merges, then stop. This is useful for debugging.\n");
 		log("\n");
@@ -1465,6 +1525,8 @@ struct SharePass : public Pass {
 		config.opt_force = false;
 		config.opt_aggressive = false;
 		config.opt_fast = false;
+		config.opt_shared_sat = false;
+		config.max_cone = -1;
 
 		config.generic_uni_ops.insert("$not");
 		// config.generic_uni_ops.insert("$pos");
@@ -1520,6 +1582,14 @@ struct SharePass : public Pass {
 				config.opt_fast = true;
 				continue;
 			}
+			if (args[argidx] == "-shared_sat") {
+				config.opt_shared_sat = true;
+				continue;
+			}
+			if (args[argidx] == "-max_cone" && argidx+1 < args.size()) {
+				config.max_cone = atoi(args[++argidx].c_str());
+				continue;
+			}
 			if (args[argidx] == "-limit" && argidx+1 < args.size()) {
 				config.limit = atoi(args[++argidx].c_str());
 				continue;
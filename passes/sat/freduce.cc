@@ -23,6 +23,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include "kernel/satgen.h"
+#include "kernel/bitsim.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -31,7 +32,7 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-bool inv_mode;
+bool inv_mode, sim_mode;
 int verbose_level, reduce_counter, reduce_stop_at;
 typedef std::map<RTLIL::SigBit, std::pair<RTLIL::Cell*, std::set<RTLIL::SigBit>>> drivers_t;
 std::string dump_prefix;
@@ -604,6 +605,27 @@ struct FreduceWorker
 		Pass::call(design, stringf("dump -outfile %s %s", filename.c_str(), design->selected_active_module.empty() ? module->name.c_str() : ""));
 	}
 
+	// Split a bucket into groups of signals with the same simulation signature.
+	// Signals from different groups are known to be not equivalent.
+	void split_bucket(BitSim &sim, const std::vector<RTLIL::SigBit> &bucket, std::vector<std::vector<RTLIL::SigBit>> &parts)
+	{
+		for (auto &bit : bucket)
+			if (!sim.known(bit)) {
+				parts.push_back(bucket);
+				return;
+			}
+
+		std::map<uint64_t, int> sig2part;
+		for (auto &bit : bucket) {
+			uint64_t sig = sim.signature(bit, inv_mode);
+			if (sig2part.count(sig) == 0) {
+				sig2part[sig] = GetSize(parts);
+				parts.push_back(std::vector<RTLIL::SigBit>());
+			}
+			parts[sig2part.at(sig)].push_back(bit);
+		}
+	}
+
 	int run()
 	{
 		log("Running functional reduction on module %s:\n", RTLIL::id2cstr(module->name));
@@ -665,7 +687,13 @@ struct FreduceWorker
 		}
 		log("  Sorted %d signal bits into %d buckets.\n", bits_count, int(buckets.size()));
 
-		int bucket_count = 0;
+		BitSim *sim = nullptr;
+		if (sim_mode) {
+			sim = new BitSim(sigmap, module);
+			sim->run(4);
+		}
+
+		int bucket_count = 0, sim_split_count = 0;
 		std::vector<std::vector<equiv_bit_t>> equiv;
 		for (auto &bucket : buckets)
 		{
@@ -680,12 +708,33 @@ struct FreduceWorker
 				for (size_t idx = 0; idx < bucket.second.size(); idx++)
 					worker.analyze_const(equiv, idx);
 			} else {
-				log("  Trying to shatter bucket %s%c\n", log_signal(bucket.second), verbose_level ? ':' : '.');
-				PerformReduction worker(sigmap, drivers, inv_pairs, bucket.second, bucket.first.size());
-				worker.analyze(equiv, 100 * bucket_count / (buckets.size() + 1));
+				std::vector<std::vector<RTLIL::SigBit>> parts;
+				if (sim != nullptr)
+					split_bucket(*sim, bucket.second, parts);
+				else
+					parts.push_back(bucket.second);
+
+				if (parts.size() > 1) {
+					if (verbose_level)
+						log("  Simulation split bucket %s into %d buckets.\n", log_signal(bucket.second), int(parts.size()));
+					sim_split_count++;
+				}
+
+				for (auto &part : parts) {
+					if (part.size() == 1)
+						continue;
+					log("  Trying to shatter bucket %s%c\n", log_signal(part), verbose_level ? ':' : '.');
+					PerformReduction worker(sigmap, drivers, inv_pairs, part, bucket.first.size());
+					worker.analyze(equiv, 100 * bucket_count / (buckets.size() + 1));
+				}
 			}
 		}
 
+		if (sim != nullptr) {
+			log("  Simulation with %d patterns split %d buckets.\n", 4 * BitSim::patterns, sim_split_count);
+			delete sim;
+		}
+
 		std::map<RTLIL::SigBit, int> bitusage;
 		CountBitUsage bitusage_worker(sigmap, bitusage);
 		module->rewrite_sigspecs(bitusage_worker);
@@ -780,6 +829,10 @@ struct FreducePass : public Pass {
 		log("        stop after <n> reduction operations. this is mostly used for\n");
 		log("        debugging the freduce command itself.\n");
 		log("\n");
+		log("    -nosim\n");
+		log("        do not use random simulation to split buckets of candidate signals\n");
+		log("        before running the SAT solver on them.\n");
+		log("\n");
 		log("    -dump <prefix>\n");
 		log("        dump the design to <prefix>_<module>_<num>.il after each reduction\n");
 		log("        operation. this is mostly used for debugging the freduce command.\n");
@@ -797,6 +850,7 @@ struct FreducePass : public Pass {
 		reduce_stop_at = 0;
 		verbose_level = 0;
 		inv_mode = false;
+		sim_mode = true;
 		dump_prefix = std::string();
 
 		log_header(design, "Executing FREDUCE pass (perform functional reduction).\n");
@@ -815,6 +869,10 @@ struct FreducePass : public Pass {
 				inv_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-nosim") {
+				sim_mode = false;
+				continue;
+			}
 			if (args[argidx] == "-stop" && argidx+1 < args.size()) {
 				reduce_stop_at = atoi(args[++argidx].c_str());
 				continue;
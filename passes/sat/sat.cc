@@ -65,6 +65,21 @@ struct SatHelper
 	int max_timestep, timeout;
 	bool gotTimeout;
 
+	// transition relation for -unroll: all cells are imported once (at time step 2,
+	// relating step 1 to step 2) into a separate CNF, and the clauses of that CNF
+	// are copied into the SAT problem for each further time step
+	struct UnrollLiteral {
+		bool undef;
+		int step;
+		std::string name;
+	};
+
+	bool unroll;
+	std::unique_ptr<ezSAT> unroll_ez;
+	std::unique_ptr<SatGen> unroll_satgen;
+	std::vector<UnrollLiteral> unroll_literals;
+	int unroll_cell_counter;
+
 	SatHelper(RTLIL::Design *design, RTLIL::Module *module, bool enable_undef) :
 		design(design), module(module), sigmap(module), ct(design), satgen(ez.get(), &sigmap)
 	{
@@ -77,6 +92,8 @@ struct SatHelper
 		max_timestep = -1;
 		timeout = 0;
 		gotTimeout = false;
+		unroll = false;
+		unroll_cell_counter = 0;
 	}
 
 	void check_undef_enabled(const RTLIL::SigSpec &sig)
@@ -228,20 +245,13 @@ struct SatHelper
 				ez->assume(ez->expression(ezSAT::OpAnd, undef_sig));
 		}
 
-		int import_cell_counter = 0;
-		for (auto cell : module->cells())
-			if (design->selected(module, cell)) {
-				// log("Import cell: %s\n", RTLIL::id2cstr(cell->name));
-				if (satgen.importCell(cell, timestep)) {
-					for (auto &p : cell->connections())
-						if (ct.cell_output(cell->type, p.first))
-							show_drivers.insert(sigmap(p.second), cell);
-					import_cell_counter++;
-				} else if (ignore_unknown_cells)
-					log_warning("Failed to import cell %s (type %s) to SAT database.\n", RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
-				else
-					log_error("Failed to import cell %s (type %s) to SAT database.\n", RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
-		}
+		int import_cell_counter;
+		if (unroll && timestep > 1 && !initstate) {
+			if (unroll_ez == nullptr)
+				setup_unroll();
+			import_cell_counter = unroll_step(timestep);
+		} else
+			import_cell_counter = import_cells(satgen, timestep);
 		log("Imported %d cells to SAT database.\n", import_cell_counter);
 
 		if (set_assumes) {
@@ -344,6 +354,131 @@ struct SatHelper
 		}
 	}
 
+	int import_cells(SatGen &gen, int timestep)
+	{
+		int import_cell_counter = 0;
+		for (auto cell : module->cells())
+			if (design->selected(module, cell)) {
+				// log("Import cell: %s\n", RTLIL::id2cstr(cell->name));
+				if (gen.importCell(cell, timestep)) {
+					for (auto &p : cell->connections())
+						if (ct.cell_output(cell->type, p.first))
+							show_drivers.insert(sigmap(p.second), cell);
+					import_cell_counter++;
+				} else if (ignore_unknown_cells)
+					log_warning("Failed to import cell %s (type %s) to SAT database.\n", RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
+				else
+					log_error("Failed to import cell %s (type %s) to SAT database.\n", RTLIL::id2cstr(cell->name), RTLIL::id2cstr(cell->type));
+		}
+		return import_cell_counter;
+	}
+
+	// split a literal name or signal prefix of the transition relation, such as
+	// "undef:@1:\foo [3]", into the undef flag, the step (0 = previous time step,
+	// 1 = current time step) and the remaining name
+	static void split_unroll_name(const std::string &name, bool &undef, int &step, std::string *rest = nullptr)
+	{
+		size_t pos = 0;
+		undef = name.compare(0, 6, "undef:") == 0;
+		if (undef)
+			pos = 6;
+		size_t colon = name.find(':', pos);
+		log_assert(pos < name.size() && name[pos] == '@' && colon != std::string::npos);
+		step = atoi(name.c_str() + pos + 1) - 1;
+		log_assert(step == 0 || step == 1);
+		if (rest != nullptr)
+			*rest = name.substr(colon + 1);
+	}
+
+	void setup_unroll()
+	{
+		log("Importing transition relation for unrolling:\n");
+
+		unroll_ez.reset(new ezSAT);
+		unroll_satgen.reset(new SatGen(unroll_ez.get(), &sigmap));
+		unroll_satgen->model_undef = satgen.model_undef;
+		unroll_satgen->ignore_div_by_zero = satgen.ignore_div_by_zero;
+
+		unroll_cell_counter = import_cells(*unroll_satgen, 2);
+
+		unroll_literals.resize(unroll_ez->numLiterals());
+		for (int id = 1; id <= unroll_ez->numLiterals(); id++) {
+			UnrollLiteral &ul = unroll_literals[id-1];
+			ul.undef = false;
+			ul.step = -1;
+			if (id == ezSAT::CONST_TRUE || id == ezSAT::CONST_FALSE || unroll_ez->lookup_literal(id).empty())
+				continue;
+			split_unroll_name(unroll_ez->lookup_literal(id), ul.undef, ul.step, &ul.name);
+		}
+
+		log("Transition relation has %d cells, %d variables and %d clauses.\n",
+				unroll_cell_counter, unroll_ez->numCnfVariables(), GetSize(unroll_ez->cnf()));
+	}
+
+	int unroll_step(int timestep)
+	{
+		const ezSAT &tmpl = *unroll_ez;
+
+		std::string prefixes[2][2];
+		for (int undef = 0; undef < 2; undef++)
+		for (int step = 0; step < 2; step++)
+			prefixes[undef][step] = stringf("%s@%d:", undef ? "undef:" : "", timestep - 1 + step);
+
+		// named literals are shared with the rest of the SAT problem (and previous
+		// and next time steps), everything else gets fresh CNF variables
+		std::vector<int> literal_map(tmpl.numLiterals() + 1);
+		for (int id = 1; id <= tmpl.numLiterals(); id++) {
+			const UnrollLiteral &ul = unroll_literals[id-1];
+			if (id == ezSAT::CONST_TRUE || id == ezSAT::CONST_FALSE)
+				literal_map[id] = id;
+			else if (ul.step >= 0)
+				literal_map[id] = ez->frozen_literal(prefixes[ul.undef][ul.step] + ul.name);
+		}
+
+		std::vector<int> var_map(tmpl.numCnfVariables() + 1);
+		for (int id = 1; id <= tmpl.numLiterals(); id++) {
+			int idx = tmpl.bound(id);
+			if (idx != 0 && literal_map[id] != 0)
+				var_map[idx] = ez->bind(literal_map[id]);
+		}
+		for (int idx = 1; idx <= tmpl.numCnfVariables(); idx++)
+			if (var_map[idx] == 0)
+				var_map[idx] = ez->unbound_cnf_variable();
+
+		std::vector<int> clause;
+		for (auto &tmpl_clause : tmpl.cnf()) {
+			clause.clear();
+			for (int idx : tmpl_clause)
+				clause.push_back(idx > 0 ? var_map[idx] : -var_map[-idx]);
+			ez->add_cnf_clause(clause);
+		}
+
+		for (auto &it : unroll_satgen->imported_signals) {
+			bool undef;
+			int step;
+			split_unroll_name(it.first, undef, step);
+			auto &signals = satgen.imported_signals[prefixes[undef][step]];
+			for (auto &it2 : it.second)
+				signals[it2.first] = literal_map[it2.second];
+		}
+
+		std::string tmpl_pf = "@2:", pf = prefixes[0][1];
+		if (unroll_satgen->asserts_a.count(tmpl_pf)) {
+			satgen.asserts_a[pf].append(unroll_satgen->asserts_a.at(tmpl_pf));
+			satgen.asserts_en[pf].append(unroll_satgen->asserts_en.at(tmpl_pf));
+		}
+		if (unroll_satgen->assumes_a.count(tmpl_pf)) {
+			satgen.assumes_a[pf].append(unroll_satgen->assumes_a.at(tmpl_pf));
+			satgen.assumes_en[pf].append(unroll_satgen->assumes_en.at(tmpl_pf));
+		}
+
+		auto initstate_key = std::make_pair(std::string(), timestep);
+		if (unroll_satgen->initstates.count(std::make_pair(std::string(), 2)) && !satgen.initstates.count(initstate_key))
+			satgen.initstates[initstate_key] = false;
+
+		return unroll_cell_counter;
+	}
+
 	int setup_proof(int timestep = -1)
 	{
 		log_assert(prove.size() || prove_x.size() || prove_asserts);
@@ -956,6 +1091,12 @@ struct SatPass : public Pass {
 		log("        note: for large <N> it can be significantly faster to use\n");
 		log("        -tempinduct-baseonly -maxsteps <N> instead of -seq <N>.\n");
 		log("\n");
+		log("    -unroll\n");
+		log("        import the cells of the design only once as a transition relation\n");
+		log("        from one time step to the next, and add each further time step by\n");
+		log("        copying the clauses of that transition relation. this makes setting\n");
+		log("        up problems with many time steps (large -seq or -maxsteps) faster.\n");
+		log("\n");
 		log("    -set-at <N> <signal> <value>\n");
 		log("    -unset-at <N> <signal>\n");
 		log("        set or unset the specified signal to the specified value in the\n");
@@ -1071,7 +1212,7 @@ struct SatPass : public Pass {
 		bool tempinduct = false, prove_asserts = false, show_inputs = false, show_outputs = false;
 		bool show_regs = false, show_public = false, show_all = false;
 		bool ignore_unknown_cells = false, falsify = false, tempinduct_def = false, set_init_def = false;
-		bool tempinduct_baseonly = false, tempinduct_inductonly = false, set_assumes = false;
+		bool tempinduct_baseonly = false, tempinduct_inductonly = false, set_assumes = false, unroll = false;
 		int tempinduct_skip = 0, stepsize = 1;
 		std::string vcd_file_name, json_file_name, cnf_file_name;
 
@@ -1213,6 +1354,10 @@ struct SatPass : public Pass {
 				seq_len = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-unroll") {
+				unroll = true;
+				continue;
+			}
 			if (args[argidx] == "-set-at" && argidx+3 < args.size()) {
 				int timestep = atoi(args[++argidx].c_str());
 				std::string lhs = args[++argidx];
@@ -1402,6 +1547,7 @@ struct SatPass : public Pass {
 			basecase.set_init_zero = set_init_zero;
 			basecase.satgen.ignore_div_by_zero = ignore_div_by_zero;
 			basecase.ignore_unknown_cells = ignore_unknown_cells;
+			basecase.unroll = unroll;
 
 			for (int timestep = 1; timestep <= seq_len; timestep++)
 				if (!tempinduct_inductonly)
@@ -1419,6 +1565,7 @@ struct SatPass : public Pass {
 			inductstep.sets_all_undef = sets_all_undef;
 			inductstep.satgen.ignore_div_by_zero = ignore_div_by_zero;
 			inductstep.ignore_unknown_cells = ignore_unknown_cells;
+			inductstep.unroll = unroll;
 
 			if (!tempinduct_baseonly) {
 				inductstep.setup(1);
@@ -1438,6 +1585,7 @@ struct SatPass : public Pass {
 
 				if (!tempinduct_inductonly)
 				{
+					int64_t begin_ns = PerformanceTimer::query();
 					basecase.setup(seq_len + inductlen, seq_len + inductlen == 1);
 					int property = basecase.setup_proof(seq_len + inductlen);
 					basecase.generate_model();
@@ -1451,7 +1599,11 @@ struct SatPass : public Pass {
 								inductlen, basecase.ez->numCnfVariables(), basecase.ez->numCnfClauses());
 						log_flush();
 
-						if (basecase.solve(basecase.ez->NOT(property))) {
+						bool basecase_failed = basecase.solve(basecase.ez->NOT(property));
+						log("[base case %d] CPU time for this step: %.2f seconds.\n",
+								inductlen, (PerformanceTimer::query() - begin_ns) * 1e-9);
+
+						if (basecase_failed) {
 							log("SAT temporal induction proof finished - model found for base case: FAIL!\n");
 							print_proof_failed();
 							basecase.print_model();
@@ -1481,6 +1633,7 @@ struct SatPass : public Pass {
 
 				if (!tempinduct_baseonly)
 				{
+					int64_t begin_ns = PerformanceTimer::query();
 					inductstep.setup(inductlen + 1);
 					int property = inductstep.setup_proof(inductlen + 1);
 					inductstep.generate_model();
@@ -1523,7 +1676,11 @@ struct SatPass : public Pass {
 								inductlen, inductstep.ez->numCnfVariables(), inductstep.ez->numCnfClauses());
 						log_flush();
 
-						if (!inductstep.solve(inductstep.ez->NOT(property))) {
+						bool inductstep_failed = inductstep.solve(inductstep.ez->NOT(property));
+						log("[induction step %d] CPU time for this step: %.2f seconds.\n",
+								inductlen, (PerformanceTimer::query() - begin_ns) * 1e-9);
+
+						if (!inductstep_failed) {
 							if (inductstep.gotTimeout)
 								goto timeout;
 							log("Induction step proven: SUCCESS!\n");
@@ -1591,6 +1748,7 @@ struct SatPass : public Pass {
 			sathelper.set_init_zero = set_init_zero;
 			sathelper.satgen.ignore_div_by_zero = ignore_div_by_zero;
 			sathelper.ignore_unknown_cells = ignore_unknown_cells;
+			sathelper.unroll = unroll;
 
 			if (seq_len == 0) {
 				sathelper.setup();
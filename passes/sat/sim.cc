@@ -30,6 +30,7 @@ struct SimShared
 	bool hide_internal = true;
 	bool writeback = false;
 	bool zinit = false;
+	bool compiled = false;
 	int rstlen = 1;
 };
 
@@ -128,8 +129,12 @@ struct SimInstance
 
 			for (auto &port : cell->connections()) {
 				if (cell->input(port.first))
-					for (auto bit : sigmap(port.second))
+					for (auto bit : sigmap(port.second)) {
 						upd_cells[bit].insert(cell);
+						// cells with constant inputs must be evaluated once at the start
+						if (bit.wire == nullptr)
+							dirty_bits.insert(bit);
+					}
 			}
 
 			if (cell->type.in("$dff")) {
@@ -621,15 +626,1221 @@ struct SimInstance
 	}
 };
 
+struct SimCompiled
+{
+	// All instances of the hierarchy are flattened into one array of net
+	// states, and all combinational cells are compiled into one levelized
+	// array of instructions over that array. Like SimInstance, the engine
+	// is event-driven (a cell is only evaluated after one of its inputs has
+	// changed, or at the start when it reads a net that SimInstance marks
+	// dirty in its constructor), so both engines produce identical results.
+	//
+	// The nets are packed into three bit planes that hold the bits of the
+	// State values, interleaved so that the planes of 64 nets share a cache
+	// line. The nets of a wire are allocated back to back, so copies, muxes
+	// and bitwise cells over whole wires are evaluated 64 nets at a time.
+
+	typedef RTLIL::Const (*calc_func_t)(const RTLIL::Const&, const RTLIL::Const&, bool, bool, int);
+
+	enum opcode_t {
+		OP_COPY,	// y = a
+		OP_TABLE,	// y = table[a,b,c], for cells with up to 4 input bits
+		OP_MUX,		// $mux and $pmux
+		OP_CALC,	// word-level cells, using the const_* functions
+		OP_EVAL,	// everything else, using CellTypes::eval()
+		OP_MEMRD,	// asynchronous $mem read ports
+		OP_BITWISE	// $not, $and, $or, $xor and $xnor on packed words
+	};
+
+	enum bitwise_t {
+		BIT_NOT,
+		BIT_AND,
+		BIT_OR,
+		BIT_XOR,
+		BIT_XNOR
+	};
+
+	struct sig_t
+	{
+		// run is the first net if the nets of the signal are consecutive,
+		// otherwise -1
+		int ofs, len, run;
+	};
+
+	struct instr_t
+	{
+		opcode_t opcode;
+		int nargs;
+		sig_t a, b, c, y, trig;
+		int aux;
+		bool signed1, signed2;
+		bool packed;	// a, b and y are runs and y does not overlap a or b
+		int group;	// fanout group of y, see add_fanout_group()
+		int result_len;
+		calc_func_t func;
+		Cell *cell;
+		int inst;	// instance whose nets trigger it (the child for output port copies)
+	};
+
+	struct ff_t
+	{
+		Cell *cell;
+		bool clkpol;
+		sig_t clk, d, q;
+		int group;
+		State past_clock;
+		std::vector<State> past_d;
+	};
+
+	struct mem_t
+	{
+		Cell *cell;
+		int size, offset, abits, width, num_rd_ports, num_wr_ports;
+		Const wr_clk_enable, wr_clk_polarity;
+		sig_t rd_addr, rd_data, wr_clk, wr_en, wr_addr, wr_data;
+		int rd_instr;
+		std::vector<State> past_wr_clk, past_wr_en, past_wr_addr, past_wr_data;
+		Const data;
+	};
+
+	struct formal_t
+	{
+		Cell *cell;
+		sig_t a, en;
+		string label;
+	};
+
+	struct inst_t
+	{
+		Module *module;
+		Cell *instance;
+		std::string hiername;
+		dict<Wire*, sig_t> wires;
+		std::vector<int> children, ffs, mems;
+		std::vector<formal_t> formal;
+		pool<int> init_dirty;	// nets of output ports, init values and constants, dirty at the start
+	};
+
+	struct vcd_var_t
+	{
+		int id;
+		sig_t sig;
+		std::vector<State> value;
+	};
+
+	SimShared *shared;
+
+	static const int num_const_nets = 6;
+	int num_nets;
+	std::vector<uint64_t> net_bits;
+	std::vector<int> operands;
+	std::vector<instr_t> instrs;
+	std::vector<State> tables;
+	dict<std::string, int> table_cache;
+	dict<IdString, calc_func_t> calc_funcs;
+
+	std::vector<int> fanout_start, fanout;
+	std::vector<int> group_start, group_fanout;
+	std::vector<uint64_t> dirty;
+	int scan_pos, rescan_from;
+
+	std::vector<ff_t> ffs;
+	std::vector<mem_t> mems;
+	std::vector<inst_t> instances;
+	std::vector<vcd_var_t> vcd_vars;
+
+	SimCompiled(SimShared *shared, Module *topmod) : shared(shared)
+	{
+#define CALC_FUNC(_t) calc_funcs["$" #_t] = RTLIL::const_ ## _t;
+		CALC_FUNC(not) CALC_FUNC(and) CALC_FUNC(or) CALC_FUNC(xor) CALC_FUNC(xnor)
+		CALC_FUNC(reduce_and) CALC_FUNC(reduce_or) CALC_FUNC(reduce_xor) CALC_FUNC(reduce_xnor) CALC_FUNC(reduce_bool)
+		CALC_FUNC(logic_not) CALC_FUNC(logic_and) CALC_FUNC(logic_or)
+		CALC_FUNC(shl) CALC_FUNC(shr) CALC_FUNC(sshl) CALC_FUNC(sshr) CALC_FUNC(shift) CALC_FUNC(shiftx)
+		CALC_FUNC(lt) CALC_FUNC(le) CALC_FUNC(eq) CALC_FUNC(ne) CALC_FUNC(eqx) CALC_FUNC(nex) CALC_FUNC(ge) CALC_FUNC(gt)
+		CALC_FUNC(add) CALC_FUNC(sub) CALC_FUNC(mul) CALC_FUNC(div) CALC_FUNC(mod) CALC_FUNC(pow) CALC_FUNC(pos) CALC_FUNC(neg)
+#undef CALC_FUNC
+
+		// one constant net for each State value (num_const_nets)
+		num_nets = 0;
+		for (auto s : {State::S0, State::S1, State::Sx, State::Sz, State::Sa, State::Sm})
+			add_net(s);
+
+		add_instance(topmod, nullptr, -1);
+		levelize();
+
+		scan_pos = INT_MAX;
+		rescan_from = INT_MAX;
+		dirty.resize((GetSize(instrs) + 63) / 64);
+
+		for (int k = 0; k < GetSize(instrs); k++) {
+			const instr_t &instr = instrs[k];
+			const pool<int> &init_dirty = instances[instr.inst].init_dirty;
+			bool is_dirty = false;
+			for (auto s : {instr.a, instr.b, instr.c, instr.trig})
+				for (int i = 0; i < s.len && !is_dirty; i++)
+					if (init_dirty.count(operands[s.ofs + i]))
+						is_dirty = true;
+			if (is_dirty)
+				mark(k);
+		}
+
+		for (auto &inst : instances)
+			inst.init_dirty.clear();
+
+		if (shared->zinit)
+		{
+			for (auto &ff : ffs) {
+				for (auto &bit : ff.past_d)
+					zinit(bit);
+				for (int i = 0; i < ff.q.len; i++) {
+					State bit = get_net(operands[ff.q.ofs + i]);
+					zinit(bit);
+					set_net(operands[ff.q.ofs + i], bit);
+				}
+			}
+
+			for (auto &mem : mems) {
+				for (auto &bit : mem.past_wr_en)
+					zinit(bit);
+				zinit(mem.data);
+			}
+		}
+
+		log("Compiled %d instances into %d nets and %d instructions.\n", GetSize(instances), num_nets, GetSize(instrs));
+	}
+
+	int add_net(State value)
+	{
+		if (num_nets % 64 == 0)
+			net_bits.resize(net_bits.size() + 3);
+		put_net(num_nets, value);
+		return num_nets++;
+	}
+
+	sig_t make_sig(int ofs, int len) const
+	{
+		sig_t s = { ofs, len, len > 0 ? operands[ofs] : -1 };
+		for (int i = 1; i < len && s.run >= 0; i++)
+			if (operands[ofs + i] != s.run + i)
+				s.run = -1;
+		return s;
+	}
+
+	static bool runs_disjoint(sig_t s1, sig_t s2)
+	{
+		if (s1.len == 0 || s2.len == 0)
+			return true;
+		if (s1.run < 0 || s2.run < 0)
+			return false;
+		return s1.run + s1.len <= s2.run || s2.run + s2.len <= s1.run;
+	}
+
+	sig_t add_sig(SigMap &sigmap, dict<SigBit, int> &bit2net, const SigSpec &sig, bool output = false)
+	{
+		int ofs = GetSize(operands);
+		for (auto bit : sigmap(sig)) {
+			if (bit.wire != nullptr) {
+				auto it = bit2net.find(bit);
+				if (it != bit2net.end()) {
+					operands.push_back(it->second);
+					continue;
+				}
+			}
+			// outputs driving constants get a net of their own that is never read
+			if (output || bit.wire != nullptr) {
+				operands.push_back(add_net(State::Sx));
+				if (bit.wire != nullptr)
+					bit2net[bit] = operands.back();
+				continue;
+			}
+			operands.push_back(int(bit.data));
+		}
+		return make_sig(ofs, GetSize(sig));
+	}
+
+	sig_t add_operands(const std::vector<int> &list)
+	{
+		int ofs = GetSize(operands);
+		operands.insert(operands.end(), list.begin(), list.end());
+		return make_sig(ofs, GetSize(list));
+	}
+
+	static Const eval_cell(Cell *cell, int nargs, const Const &a, const Const &b, const Const &c)
+	{
+		if (nargs == 2)
+			return CellTypes::eval(cell, a, b);
+		return CellTypes::eval(cell, a, b, c);
+	}
+
+	int add_instance(Module *module, Cell *instance, int parent)
+	{
+		int idx = GetSize(instances);
+		instances.push_back(inst_t());
+		instances[idx].module = module;
+		instances[idx].instance = instance;
+		instances[idx].hiername = parent < 0 ? log_id(module->name) : instances[parent].hiername + "." + log_id(instance->name);
+		if (parent >= 0)
+			instances[parent].children.push_back(idx);
+
+		SigMap sigmap(module);
+		dict<SigBit, int> bit2net;
+
+		// cells with constant inputs are evaluated once at the start
+		for (int n = 0; n < num_const_nets; n++)
+			instances[idx].init_dirty.insert(n);
+
+		for (auto wire : module->wires())
+		{
+			sig_t s = add_sig(sigmap, bit2net, wire);
+			instances[idx].wires[wire] = s;
+
+			// the nets of this instance are its own, only the constant nets
+			// are shared, so init_dirty is kept per instance
+			if (wire->port_output)
+				for (int i = 0; i < s.len; i++)
+					instances[idx].init_dirty.insert(operands[s.ofs + i]);
+
+			if (wire->attributes.count("\\init")) {
+				Const initval = wire->attributes.at("\\init");
+				for (int i = 0; i < s.len && i < GetSize(initval); i++)
+					if (initval[i] == State::S0 || initval[i] == State::S1) {
+						if (operands[s.ofs + i] >= num_const_nets)
+							put_net(operands[s.ofs + i], initval[i]);
+						instances[idx].init_dirty.insert(operands[s.ofs + i]);
+					}
+			}
+		}
+
+		for (auto cell : module->cells())
+		{
+			Module *mod = module->design->module(cell->type);
+
+			if (mod != nullptr)
+			{
+				int child = add_instance(mod, cell, idx);
+
+				std::vector<int> parent_nets, child_nets;
+				for (auto &conn : cell->connections()) {
+					if (!cell->input(conn.first))
+						continue;
+					sig_t s = add_sig(sigmap, bit2net, conn.second);
+					Wire *w = mod->wire(conn.first);
+					if (w == nullptr || GetSize(w) != s.len)
+						log_error("Port %s of cell %s.%s does not match module %s.\n", log_id(conn.first), log_id(module), log_id(cell), log_id(mod));
+					sig_t t = instances[child].wires.at(w);
+					for (int i = 0; i < s.len; i++) {
+						parent_nets.push_back(operands[s.ofs + i]);
+						child_nets.push_back(operands[t.ofs + i]);
+					}
+				}
+
+				instr_t in_copy = instr_t();
+				in_copy.opcode = OP_COPY;
+				in_copy.a = add_operands(parent_nets);
+				in_copy.y = add_operands(child_nets);
+				in_copy.packed = runs_disjoint(in_copy.a, in_copy.y);
+				in_copy.cell = cell;
+				in_copy.inst = idx;
+				instrs.push_back(in_copy);
+
+				for (auto wire : mod->wires())
+				{
+					if (!wire->port_output || !cell->hasPort(wire->name))
+						continue;
+
+					sig_t s = add_sig(sigmap, bit2net, cell->getPort(wire->name), true);
+					if (GetSize(wire) != s.len)
+						log_error("Port %s of cell %s.%s does not match module %s.\n", log_id(wire), log_id(module), log_id(cell), log_id(mod));
+
+					instr_t out_copy = instr_t();
+					out_copy.opcode = OP_COPY;
+					out_copy.a = instances[child].wires.at(wire);
+					out_copy.y = s;
+					out_copy.packed = runs_disjoint(out_copy.a, out_copy.y);
+					out_copy.cell = cell;
+					out_copy.inst = child;
+					instrs.push_back(out_copy);
+				}
+				continue;
+			}
+
+			if (cell->type == "$dff")
+			{
+				ff_t ff;
+				ff.cell = cell;
+				ff.clkpol = cell->getParam("\\CLK_POLARITY").as_bool();
+				ff.clk = add_sig(sigmap, bit2net, cell->getPort("\\CLK"));
+				ff.d = add_sig(sigmap, bit2net, cell->getPort("\\D"));
+				ff.q = add_sig(sigmap, bit2net, cell->getPort("\\Q"), true);
+				ff.past_clock = State::Sx;
+				ff.past_d = std::vector<State>(cell->getParam("\\WIDTH").as_int(), State::Sx);
+				instances[idx].ffs.push_back(GetSize(ffs));
+				ffs.push_back(ff);
+				continue;
+			}
+
+			if (cell->type == "$mem")
+			{
+				if (cell->getParam("\\RD_CLK_ENABLE").as_bool())
+					log_error("Memory %s.%s has clocked read ports. Run 'memory' with -nordff.\n", log_id(module), log_id(cell));
+
+				mem_t mem;
+				mem.cell = cell;
+				mem.size = cell->getParam("\\SIZE").as_int();
+				mem.offset = cell->getParam("\\OFFSET").as_int();
+				mem.abits = cell->getParam("\\ABITS").as_int();
+				mem.width = cell->getParam("\\WIDTH").as_int();
+				mem.num_rd_ports = cell->getParam("\\RD_PORTS").as_int();
+				mem.num_wr_ports = cell->getParam("\\WR_PORTS").as_int();
+				mem.wr_clk_enable = cell->getParam("\\WR_CLK_ENABLE");
+				mem.wr_clk_polarity = cell->getParam("\\WR_CLK_POLARITY");
+
+				mem.rd_addr = add_sig(sigmap, bit2net, cell->getPort("\\RD_ADDR"));
+				mem.rd_data = add_sig(sigmap, bit2net, cell->getPort("\\RD_DATA"), true);
+				mem.wr_clk = add_sig(sigmap, bit2net, cell->getPort("\\WR_CLK"));
+				mem.wr_en = add_sig(sigmap, bit2net, cell->getPort("\\WR_EN"));
+				mem.wr_addr = add_sig(sigmap, bit2net, cell->getPort("\\WR_ADDR"));
+				mem.wr_data = add_sig(sigmap, bit2net, cell->getPort("\\WR_DATA"));
+
+				mem.past_wr_clk = std::vector<State>(mem.wr_clk.len, State::Sx);
+				mem.past_wr_en = std::vector<State>(mem.wr_en.len, State::Sx);
+				mem.past_wr_addr = std::vector<State>(mem.wr_addr.len, State::Sx);
+				mem.past_wr_data = std::vector<State>(mem.wr_data.len, State::Sx);
+
+				mem.data = cell->getParam("\\INIT");
+				int sz = mem.size * mem.width;
+				if (GetSize(mem.data) > sz)
+					mem.data.bits.resize(sz);
+				while (GetSize(mem.data) < sz)
+					mem.data.bits.push_back(State::Sx);
+
+				// the read ports are re-evaluated whenever any input changes,
+				// but only the read addresses are used for levelization
+				instr_t instr = instr_t();
+				instr.opcode = OP_MEMRD;
+				instr.a = mem.rd_addr;
+				instr.y = mem.rd_data;
+				instr.trig = add_input_ports(sigmap, bit2net, cell);
+				instr.aux = GetSize(mems);
+				instr.cell = cell;
+				instr.inst = idx;
+
+				mem.rd_instr = GetSize(instrs);
+				instrs.push_back(instr);
+
+				instances[idx].mems.push_back(GetSize(mems));
+				mems.push_back(mem);
+				continue;
+			}
+
+			if (cell->type.in("$assert", "$cover", "$assume"))
+			{
+				formal_t f;
+				f.cell = cell;
+				f.a = add_sig(sigmap, bit2net, cell->getPort("\\A"));
+				f.en = add_sig(sigmap, bit2net, cell->getPort("\\EN"));
+				f.label = log_id(cell);
+				if (cell->attributes.count("\\src"))
+					f.label = cell->attributes.at("\\src").decode_string();
+				instances[idx].formal.push_back(f);
+				continue;
+			}
+
+			if (!yosys_celltypes.cell_evaluable(cell->type))
+				log_error("Unsupported cell type: %s (%s.%s)\n", log_id(cell->type), log_id(module), log_id(cell));
+
+			add_cell(sigmap, bit2net, module, cell, idx);
+		}
+
+		// SimInstance visits children and formal cells in dict/pool order,
+		// which is the reverse insertion order. Do the same to get identical logs.
+		std::reverse(instances[idx].children.begin(), instances[idx].children.end());
+		std::reverse(instances[idx].formal.begin(), instances[idx].formal.end());
+
+		return idx;
+	}
+
+	sig_t add_input_ports(SigMap &sigmap, dict<SigBit, int> &bit2net, Cell *cell)
+	{
+		std::vector<int> list;
+		for (auto &conn : cell->connections())
+			if (cell->input(conn.first)) {
+				sig_t s = add_sig(sigmap, bit2net, conn.second);
+				list.insert(list.end(), operands.begin() + s.ofs, operands.begin() + s.ofs + s.len);
+			}
+		return add_operands(list);
+	}
+
+	void add_cell(SigMap &sigmap, dict<SigBit, int> &bit2net, Module *module, Cell *cell, int inst)
+	{
+		bool has_a = cell->hasPort("\\A");
+		bool has_b = cell->hasPort("\\B");
+		bool has_c = cell->hasPort("\\C");
+		bool has_d = cell->hasPort("\\D");
+		bool has_s = cell->hasPort("\\S");
+		bool has_y = cell->hasPort("\\Y");
+
+		instr_t instr = instr_t();
+		instr.cell = cell;
+		instr.inst = inst;
+
+		// same cell shapes as in SimInstance::update_cell()
+		if (has_a && !has_c && !has_d && !has_s && has_y)
+			instr.nargs = 2;
+		else if (has_a && has_b && has_c && !has_d && !has_s && has_y)
+			instr.nargs = 3;
+		else if (has_a && has_b && !has_c && !has_d && has_s && has_y)
+			instr.nargs = 3;
+		else {
+			log_warning("Unsupported evaluable cell type: %s (%s.%s)\n", log_id(cell->type), log_id(module), log_id(cell));
+			return;
+		}
+
+		instr.a = add_sig(sigmap, bit2net, cell->getPort("\\A"));
+		instr.b = add_sig(sigmap, bit2net, has_b ? cell->getPort("\\B") : SigSpec());
+		instr.c = add_sig(sigmap, bit2net, has_c ? cell->getPort("\\C") : has_s ? cell->getPort("\\S") : SigSpec());
+		instr.y = add_sig(sigmap, bit2net, cell->getPort("\\Y"), true);
+
+		int num_inputs = instr.a.len + instr.b.len + instr.c.len;
+
+		if (num_inputs <= 4 && instr.y.len <= 64)
+		{
+			std::string key = stringf("%s %d %d %d %d %d", log_id(cell->type), instr.nargs, instr.a.len, instr.b.len, instr.c.len, instr.y.len);
+			for (auto &it : cell->parameters)
+				key += stringf(" %s=%s", log_id(it.first), it.second.as_string().c_str());
+
+			if (table_cache.count(key) == 0)
+			{
+				table_cache[key] = GetSize(tables);
+				for (int idx = 0; idx < (1 << (2*num_inputs)); idx++)
+				{
+					Const in;
+					for (int i = 0; i < num_inputs; i++)
+						in.bits.push_back(State((idx >> (2*i)) & 3));
+
+					Const y = eval_cell(cell, instr.nargs, in.extract(0, instr.a.len),
+							in.extract(instr.a.len, instr.b.len), in.extract(instr.a.len + instr.b.len, instr.c.len));
+					log_assert(GetSize(y) == instr.y.len);
+					tables.insert(tables.end(), y.bits.begin(), y.bits.end());
+				}
+			}
+
+			instr.opcode = OP_TABLE;
+			instr.aux = table_cache.at(key);
+		}
+		else if (cell->type.in("$mux", "$pmux") && instr.b.len == instr.a.len * instr.c.len && instr.y.len == instr.a.len)
+		{
+			instr.opcode = OP_MUX;
+			instr.packed = runs_disjoint(instr.a, instr.y) && runs_disjoint(instr.b, instr.y);
+		}
+		else if (cell->type.in("$slice", "$concat"))
+		{
+			instr.opcode = OP_COPY;
+			instr.trig = add_operands(std::vector<int>(operands.begin() + instr.a.ofs, operands.begin() + instr.a.ofs + instr.a.len));
+			if (cell->type == "$slice") {
+				int offset = cell->getParam("\\OFFSET").as_int();
+				instr.a = make_sig(instr.a.ofs + offset, instr.y.len);
+			} else {
+				instr.a = make_sig(instr.a.ofs, instr.a.len + instr.b.len);
+				instr.b.len = 0;
+			}
+			log_assert(instr.a.len == instr.y.len);
+			instr.packed = runs_disjoint(instr.a, instr.y);
+		}
+		else if (cell->type.in("$not", "$and", "$or", "$xor", "$xnor") && instr.a.len == instr.y.len &&
+				(cell->type == "$not" || instr.b.len == instr.y.len) && runs_disjoint(instr.a, instr.y) && runs_disjoint(instr.b, instr.y))
+		{
+			// operands of the same width as the result need no extension,
+			// so the signedness does not matter
+			instr.opcode = OP_BITWISE;
+			instr.aux = cell->type == "$not" ? BIT_NOT : cell->type == "$and" ? BIT_AND :
+					cell->type == "$or" ? BIT_OR : cell->type == "$xor" ? BIT_XOR : BIT_XNOR;
+		}
+		else if (instr.nargs == 2 && calc_funcs.count(cell->type))
+		{
+			// same as CellTypes::eval(), without looking up parameters and names
+			IdString type = cell->type;
+			instr.signed1 = cell->parameters.count("\\A_SIGNED") > 0 && cell->parameters["\\A_SIGNED"].as_bool();
+			instr.signed2 = cell->parameters.count("\\B_SIGNED") > 0 && cell->parameters["\\B_SIGNED"].as_bool();
+			instr.result_len = cell->parameters.count("\\Y_WIDTH") > 0 ? cell->parameters["\\Y_WIDTH"].as_int() : -1;
+
+			if (type == "$sshr" && !instr.signed1)
+				type = "$shr";
+			if (type == "$sshl" && !instr.signed1)
+				type = "$shl";
+
+			if (!type.in("$sshr", "$sshl", "$shr", "$shl", "$shift", "$shiftx", "$pos", "$neg", "$not")) {
+				if (!instr.signed1 || !instr.signed2)
+					instr.signed1 = false, instr.signed2 = false;
+			}
+
+			instr.opcode = OP_CALC;
+			instr.func = calc_funcs.at(type);
+		}
+		else
+		{
+			instr.opcode = OP_EVAL;
+		}
+
+		instrs.push_back(instr);
+	}
+
+	void levelize()
+	{
+		int num_instrs = GetSize(instrs);
+
+		// nets -> instructions that drive them, and that use them as operands
+		std::vector<int> drv_start(num_nets+1), drv(num_nets);
+		std::vector<int> rd_start(num_nets+1), rd;
+
+		for (auto &instr : instrs) {
+			for (int i = 0; i < instr.y.len; i++)
+				drv_start[operands[instr.y.ofs + i]]++;
+			for (auto s : {instr.a, instr.b, instr.c})
+				for (int i = 0; i < s.len; i++)
+					rd_start[operands[s.ofs + i]]++;
+		}
+
+		for (int n = 0; n < num_nets; n++) {
+			drv_start[n+1] += drv_start[n];
+			rd_start[n+1] += rd_start[n];
+		}
+
+		drv.resize(drv_start[num_nets]);
+		rd.resize(rd_start[num_nets]);
+
+		for (int k = num_instrs-1; k >= 0; k--) {
+			auto &instr = instrs[k];
+			for (int i = 0; i < instr.y.len; i++)
+				drv[--drv_start[operands[instr.y.ofs + i]]] = k;
+			for (auto s : {instr.a, instr.b, instr.c})
+				for (int i = 0; i < s.len; i++)
+					rd[--rd_start[operands[s.ofs + i]]] = k;
+		}
+
+		// topological sort, loops are broken in the original cell order
+		std::vector<int> indegree(num_instrs), order;
+		std::vector<bool> done(num_instrs);
+		order.reserve(num_instrs);
+
+		for (int k = 0; k < num_instrs; k++)
+			for (auto s : {instrs[k].a, instrs[k].b, instrs[k].c})
+				for (int i = 0; i < s.len; i++) {
+					int n = operands[s.ofs + i];
+					indegree[k] += drv_start[n+1] - drv_start[n];
+				}
+
+		std::vector<int> queue;
+		for (int k = 0; k < num_instrs; k++)
+			if (indegree[k] == 0)
+				queue.push_back(k);
+
+		for (int next_forced = 0, queue_pos = 0; GetSize(order) < num_instrs;)
+		{
+			if (queue_pos == GetSize(queue)) {
+				while (done[next_forced])
+					next_forced++;
+				queue.push_back(next_forced);
+			}
+
+			int k = queue[queue_pos++];
+			if (done[k])
+				continue;
+
+			done[k] = true;
+			order.push_back(k);
+
+			auto &instr = instrs[k];
+			for (int i = 0; i < instr.y.len; i++) {
+				int n = operands[instr.y.ofs + i];
+				for (int j = rd_start[n]; j < rd_start[n+1]; j++)
+					if (--indegree[rd[j]] == 0 && !done[rd[j]])
+						queue.push_back(rd[j]);
+			}
+		}
+
+		std::vector<instr_t> new_instrs;
+		std::vector<int> new_index(num_instrs);
+		new_instrs.reserve(num_instrs);
+		for (int k : order) {
+			new_index[k] = GetSize(new_instrs);
+			new_instrs.push_back(instrs[k]);
+		}
+		instrs.swap(new_instrs);
+
+		for (auto &mem : mems)
+			mem.rd_instr = new_index[mem.rd_instr];
+
+		// nets -> instructions that need to be re-evaluated when they change
+		fanout_start.assign(num_nets+1, 0);
+		for (auto &instr : instrs)
+			for (auto s : {instr.a, instr.b, instr.c, instr.trig})
+				for (int i = 0; i < s.len; i++)
+					fanout_start[operands[s.ofs + i]]++;
+
+		for (int n = 0; n < num_nets; n++)
+			fanout_start[n+1] += fanout_start[n];
+
+		fanout.resize(fanout_start[num_nets]);
+		for (int k = num_instrs-1; k >= 0; k--) {
+			auto &instr = instrs[k];
+			for (auto s : {instr.a, instr.b, instr.c, instr.trig})
+				for (int i = 0; i < s.len; i++)
+					fanout[--fanout_start[operands[s.ofs + i]]] = k;
+		}
+
+		std::vector<bool> in_group(num_instrs);
+		group_start.assign(1, 0);
+		for (auto &instr : instrs)
+			instr.group = add_fanout_group(instr.y, in_group);
+		for (auto &ff : ffs)
+			ff.group = add_fanout_group(ff.q, in_group);
+	}
+
+	// The fanout of all nets of a run, so that a changed word of nets marks
+	// each reader only once. This also marks readers of nets that did not
+	// change, which is harmless: evaluating them again changes no net.
+	int add_fanout_group(sig_t s, std::vector<bool> &in_group)
+	{
+		if (s.run < 0 || s.len < 2)
+			return -1;
+
+		int begin = GetSize(group_fanout);
+		for (int n = s.run; n < s.run + s.len; n++)
+			for (int j = fanout_start[n]; j < fanout_start[n+1]; j++)
+				if (!in_group[fanout[j]]) {
+					in_group[fanout[j]] = true;
+					group_fanout.push_back(fanout[j]);
+				}
+
+		for (int j = begin; j < GetSize(group_fanout); j++)
+			in_group[group_fanout[j]] = false;
+
+		group_start.push_back(GetSize(group_fanout));
+		return GetSize(group_start) - 2;
+	}
+
+	void mark(int k)
+	{
+		dirty[k >> 6] |= uint64_t(1) << (k & 63);
+		if (k <= scan_pos)
+			rescan_from = std::min(rescan_from, k);
+	}
+
+	void mark_fanout(int n)
+	{
+		for (int j = fanout_start[n]; j < fanout_start[n+1]; j++)
+			mark(fanout[j]);
+	}
+
+	void mark_group(int group)
+	{
+		for (int j = group_start[group]; j < group_start[group+1]; j++)
+			mark(group_fanout[j]);
+	}
+
+	// word w of plane k is stored at net_bits[3*w + k]
+	State get_net(int n) const
+	{
+		const uint64_t *p = net_bits.data() + 3*(n >> 6);
+		int b = n & 63;
+		return State(((p[0] >> b) & 1) | (((p[1] >> b) & 1) << 1) | (((p[2] >> b) & 1) << 2));
+	}
+
+	void put_net(int n, State value)
+	{
+		uint64_t *p = net_bits.data() + 3*(n >> 6);
+		uint64_t bit = uint64_t(1) << (n & 63);
+		for (int k = 0; k < 3; k++)
+			p[k] = (int(value) >> k) & 1 ? p[k] | bit : p[k] & ~bit;
+	}
+
+	bool set_net(int n, State value)
+	{
+		if (get_net(n) == value)
+			return false;
+		put_net(n, value);
+		mark_fanout(n);
+		return true;
+	}
+
+	static uint64_t word_mask(int len)
+	{
+		return len == 64 ? ~uint64_t(0) : (uint64_t(1) << len) - 1;
+	}
+
+	// len (at most 64) bits of plane k, starting at net n
+	uint64_t get_bits(int k, int n, int len) const
+	{
+		int w = n >> 6, b = n & 63;
+		uint64_t bits = net_bits[3*w + k] >> b;
+		if (b != 0 && b + len > 64)
+			bits |= net_bits[3*w + 3 + k] << (64 - b);
+		return bits & word_mask(len);
+	}
+
+	void put_bits(int k, int n, int len, uint64_t bits)
+	{
+		int w = n >> 6, b = n & 63;
+		uint64_t mask = word_mask(len);
+		net_bits[3*w + k] = (net_bits[3*w + k] & ~(mask << b)) | (bits << b);
+		if (b != 0 && b + len > 64)
+			net_bits[3*w + 3 + k] = (net_bits[3*w + 3 + k] & ~(mask >> (64 - b))) | (bits >> (64 - b));
+	}
+
+	// the three planes of bits ofs .. ofs+len-1 of a signal that is a run,
+	// len is at most 64
+	void get_word(sig_t s, int ofs, int len, uint64_t *word) const
+	{
+		for (int k = 0; k < 3; k++)
+			word[k] = get_bits(k, s.run + ofs, len);
+	}
+
+	// marks the readers of the changed nets, or of the whole fanout group
+	bool set_word(sig_t s, int ofs, int len, const uint64_t *word, int group)
+	{
+		int n = s.run + ofs;
+		uint64_t changed = 0;
+		for (int k = 0; k < 3; k++)
+			changed |= get_bits(k, n, len) ^ word[k];
+		if (changed == 0)
+			return false;
+		for (int k = 0; k < 3; k++)
+			put_bits(k, n, len, word[k]);
+		if (group >= 0)
+			mark_group(group);
+		else
+			for (int i = 0; changed != 0; i++, changed >>= 1)
+				if (changed & 1)
+					mark_fanout(n + i);
+		return true;
+	}
+
+	void copy_sig(sig_t from, sig_t to, bool packed, int group)
+	{
+		if (packed) {
+			uint64_t word[3];
+			for (int i = 0; i < to.len; i += 64) {
+				int len = std::min(64, to.len - i);
+				get_word(from, i, len, word);
+				set_word(to, i, len, word, group);
+			}
+			return;
+		}
+		for (int i = 0; i < to.len; i++)
+			set_net(operands[to.ofs + i], get_net(operands[from.ofs + i]));
+	}
+
+	void get_states(sig_t s, int ofs, int len, State *states) const
+	{
+		if (s.run < 0) {
+			for (int i = 0; i < len; i++)
+				states[i] = get_net(operands[s.ofs + ofs + i]);
+			return;
+		}
+		uint64_t word[3];
+		for (int i = 0; i < len; i += 64) {
+			int n = std::min(64, len - i);
+			get_word(s, ofs + i, n, word);
+			for (int j = 0; j < n; j++)
+				states[i + j] = State(((word[0] >> j) & 1) | (((word[1] >> j) & 1) << 1) | (((word[2] >> j) & 1) << 2));
+		}
+	}
+
+	bool set_states(sig_t s, int ofs, int len, const State *states, int group)
+	{
+		bool did_something = false;
+		if (s.run < 0) {
+			for (int i = 0; i < len; i++)
+				if (set_net(operands[s.ofs + ofs + i], states[i]))
+					did_something = true;
+			return did_something;
+		}
+		for (int i = 0; i < len; i += 64) {
+			int n = std::min(64, len - i);
+			uint64_t word[3] = {0, 0, 0};
+			for (int j = 0; j < n; j++)
+				for (int k = 0; k < 3; k++)
+					word[k] |= uint64_t((int(states[i + j]) >> k) & 1) << j;
+			if (set_word(s, ofs + i, n, word, group))
+				did_something = true;
+		}
+		return did_something;
+	}
+
+	Const get_sig(sig_t s, int ofs = 0, int len = -1) const
+	{
+		Const value;
+		if (len < 0)
+			len = s.len - ofs;
+		value.bits.resize(len);
+		get_states(s, ofs, len, value.bits.data());
+		return value;
+	}
+
+	bool set_sig(sig_t s, const Const &value, int ofs, int group)
+	{
+		return set_states(s, ofs, GetSize(value), value.bits.data(), group);
+	}
+
+	void eval(const instr_t &instr)
+	{
+		switch (instr.opcode)
+		{
+		case OP_COPY:
+			copy_sig(instr.a, instr.y, instr.packed, instr.group);
+			break;
+
+		case OP_TABLE: {
+			// inputs a, b and c are stored back to back
+			int num_inputs = instr.a.len + instr.b.len + instr.c.len;
+			int idx = 0;
+			for (int i = num_inputs-1; i >= 0; i--) {
+				State bit = get_net(operands[instr.a.ofs + i]);
+				if (bit > State::Sz) {
+					set_sig(instr.y, eval_cell(instr.cell, instr.nargs, get_sig(instr.a), get_sig(instr.b), get_sig(instr.c)), 0, instr.group);
+					return;
+				}
+				idx = 4*idx + bit;
+			}
+			set_states(instr.y, 0, instr.y.len, tables.data() + instr.aux + idx*instr.y.len, instr.group);
+			break;
+		}
+
+		case OP_MUX: {
+			int width = instr.a.len;
+			sig_t sel = instr.a;
+			for (int i = 0; i < instr.c.len; i++)
+				if (get_net(operands[instr.c.ofs + i]) == State::S1)
+					sel = { instr.b.ofs + i*width, width, instr.b.run < 0 ? -1 : instr.b.run + i*width };
+			copy_sig(sel, instr.y, instr.packed, instr.group);
+			break;
+		}
+
+		case OP_BITWISE:
+			for (int i = 0; i < instr.y.len; i += 64)
+			{
+				// same as the const_* functions: S0 and S1 are defined, all
+				// other states are undefined inputs and give Sx results
+				int len = std::min(64, instr.y.len - i);
+				uint64_t a[3], b[3] = {0, 0, 0}, y[3] = {0, 0, 0};
+				get_word(instr.a, i, len, a);
+				if (instr.aux != BIT_NOT)
+					get_word(instr.b, i, len, b);
+
+				uint64_t mask = word_mask(len);
+				uint64_t undef_a = a[1] | a[2], undef_b = b[1] | b[2];
+				uint64_t one_a = a[0] & ~undef_a, one_b = b[0] & ~undef_b;
+
+				switch (instr.aux) {
+				case BIT_NOT:
+					y[0] = ~one_a & ~undef_a & mask;
+					y[1] = undef_a;
+					break;
+				case BIT_AND:
+					y[0] = one_a & one_b;
+					y[1] = (undef_a | undef_b) & (one_a | undef_a) & (one_b | undef_b);
+					break;
+				case BIT_OR:
+					y[0] = one_a | one_b;
+					y[1] = (undef_a | undef_b) & ~y[0];
+					break;
+				case BIT_XOR:
+					y[1] = undef_a | undef_b;
+					y[0] = (one_a ^ one_b) & ~y[1];
+					break;
+				case BIT_XNOR:
+					y[1] = undef_a | undef_b;
+					y[0] = ~(one_a ^ one_b) & ~y[1] & mask;
+					break;
+				}
+
+				set_word(instr.y, i, len, y, instr.group);
+			}
+			break;
+
+		case OP_CALC:
+			set_sig(instr.y, instr.func(get_sig(instr.a), get_sig(instr.b), instr.signed1, instr.signed2, instr.result_len), 0, instr.group);
+			break;
+
+		case OP_EVAL:
+			set_sig(instr.y, eval_cell(instr.cell, instr.nargs, get_sig(instr.a), get_sig(instr.b), get_sig(instr.c)), 0, instr.group);
+			break;
+
+		case OP_MEMRD: {
+			mem_t &mem = mems[instr.aux];
+			for (int port_idx = 0; port_idx < mem.num_rd_ports; port_idx++)
+			{
+				Const addr = get_sig(mem.rd_addr, port_idx*mem.abits, mem.abits);
+				Const data = Const(State::Sx, mem.width);
+
+				if (addr.is_fully_def()) {
+					int index = addr.as_int() - mem.offset;
+					if (index >= 0 && index < mem.size)
+						data = mem.data.extract(index*mem.width, mem.width);
+				}
+
+				set_sig(mem.rd_data, data, port_idx*mem.width, instr.group);
+			}
+			break;
+		}
+		}
+	}
+
+	void update_ph1()
+	{
+		while (rescan_from != INT_MAX)
+		{
+			int w = rescan_from >> 6;
+			rescan_from = INT_MAX;
+
+			for (; w < GetSize(dirty); w++)
+				for (int i = 0; dirty[w] != 0 && i < 64; i++)
+					if ((dirty[w] >> i) & 1) {
+						dirty[w] &= ~(uint64_t(1) << i);
+						scan_pos = 64*w + i;
+						eval(instrs[scan_pos]);
+					}
+
+			scan_pos = INT_MAX;
+		}
+	}
+
+	bool update_ph2()
+	{
+		bool did_something = false;
+
+		for (auto &ff : ffs)
+		{
+			State current_clock = get_net(operands[ff.clk.ofs]);
+
+			if (ff.clkpol ? (ff.past_clock == State::S1 || current_clock != State::S1) :
+					(ff.past_clock == State::S0 || current_clock != State::S0))
+				continue;
+
+			if (set_states(ff.q, 0, ff.q.len, ff.past_d.data(), ff.group))
+				did_something = true;
+		}
+
+		for (auto &mem : mems)
+		{
+			for (int port_idx = 0; port_idx < mem.num_wr_ports; port_idx++)
+			{
+				Const addr, data, enable;
+
+				if (mem.wr_clk_enable[port_idx] == State::S0)
+				{
+					addr = get_sig(mem.wr_addr, port_idx*mem.abits, mem.abits);
+					data = get_sig(mem.wr_data, port_idx*mem.width, mem.width);
+					enable = get_sig(mem.wr_en, port_idx*mem.width, mem.width);
+				}
+				else
+				{
+					State current_wr_clk = get_net(operands[mem.wr_clk.ofs + port_idx]);
+
+					if (mem.wr_clk_polarity[port_idx] == State::S1 ?
+							(mem.past_wr_clk[port_idx] == State::S1 || current_wr_clk != State::S1) :
+							(mem.past_wr_clk[port_idx] == State::S0 || current_wr_clk != State::S0))
+						continue;
+
+					addr = Const(std::vector<State>(mem.past_wr_addr.begin() + port_idx*mem.abits, mem.past_wr_addr.begin() + (port_idx+1)*mem.abits));
+					data = Const(std::vector<State>(mem.past_wr_data.begin() + port_idx*mem.width, mem.past_wr_data.begin() + (port_idx+1)*mem.width));
+					enable = Const(std::vector<State>(mem.past_wr_en.begin() + port_idx*mem.width, mem.past_wr_en.begin() + (port_idx+1)*mem.width));
+				}
+
+				if (addr.is_fully_def())
+				{
+					int index = addr.as_int() - mem.offset;
+					if (index >= 0 && index < mem.size)
+						for (int i = 0; i < mem.width; i++)
+							if (enable[i] == State::S1 && mem.data.bits.at(index*mem.width+i) != data[i]) {
+								mem.data.bits.at(index*mem.width+i) = data[i];
+								mark(mem.rd_instr);
+								did_something = true;
+							}
+				}
+			}
+		}
+
+		return did_something;
+	}
+
+	void update_ph3(int idx = 0)
+	{
+		inst_t &inst = instances[idx];
+
+		for (int k : inst.ffs) {
+			ff_t &ff = ffs[k];
+			ff.past_clock = get_net(operands[ff.clk.ofs]);
+			get_states(ff.d, 0, ff.d.len, ff.past_d.data());
+		}
+
+		for (int k : inst.mems) {
+			mem_t &mem = mems[k];
+			mem.past_wr_clk = get_sig(mem.wr_clk).bits;
+			mem.past_wr_en = get_sig(mem.wr_en).bits;
+			mem.past_wr_addr = get_sig(mem.wr_addr).bits;
+			mem.past_wr_data = get_sig(mem.wr_data).bits;
+		}
+
+		for (auto &f : inst.formal)
+		{
+			State a = get_net(operands[f.a.ofs]);
+			State en = get_net(operands[f.en.ofs]);
+
+			if (f.cell->type == "$cover" && en == State::S1 && a != State::S1)
+				log("Cover %s.%s (%s) reached.\n", inst.hiername.c_str(), log_id(f.cell), f.label.c_str());
+
+			if (f.cell->type == "$assume" && en == State::S1 && a != State::S1)
+				log("Assumption %s.%s (%s) failed.\n", inst.hiername.c_str(), log_id(f.cell), f.label.c_str());
+
+			if (f.cell->type == "$assert" && en == State::S1 && a != State::S1)
+				log_warning("Assert %s.%s (%s) failed.\n", inst.hiername.c_str(), log_id(f.cell), f.label.c_str());
+		}
+
+		for (int child : inst.children)
+			update_ph3(child);
+	}
+
+	void update()
+	{
+		while (1)
+		{
+			update_ph1();
+
+			if (!update_ph2())
+				break;
+		}
+
+		update_ph3();
+	}
+
+	void set_state(Wire *wire, State value)
+	{
+		sig_t s = instances.front().wires.at(wire);
+		log_assert(s.len == 1);
+		set_net(operands[s.ofs], value);
+	}
+
+	void writeback(pool<Module*> &wbmods, int idx = 0)
+	{
+		inst_t &inst = instances[idx];
+
+		if (wbmods.count(inst.module))
+			log_error("Instance %s of module %s is not unique: Writeback not possible. (Fix by running 'uniquify'.)\n", inst.hiername.c_str(), log_id(inst.module));
+
+		wbmods.insert(inst.module);
+
+		for (auto wire : inst.module->wires())
+			wire->attributes.erase("\\init");
+
+		for (int k : inst.ffs)
+		{
+			ff_t &ff = ffs[k];
+			SigSpec sig_q = ff.cell->getPort("\\Q");
+			Const initval = get_sig(ff.q);
+
+			for (int i = 0; i < GetSize(sig_q); i++)
+			{
+				Wire *w = sig_q[i].wire;
+
+				if (w->attributes.count("\\init") == 0)
+					w->attributes["\\init"] = Const(State::Sx, GetSize(w));
+
+				w->attributes["\\init"][sig_q[i].offset] = initval[i];
+			}
+		}
+
+		for (int k : inst.mems)
+		{
+			mem_t &mem = mems[k];
+			Const initval = mem.data;
+
+			while (GetSize(initval) >= 2) {
+				if (initval[GetSize(initval)-1] != State::Sx) break;
+				if (initval[GetSize(initval)-2] != State::Sx) break;
+				initval.bits.pop_back();
+			}
+
+			mem.cell->setParam("\\INIT", initval);
+		}
+
+		for (int child : inst.children)
+			writeback(wbmods, child);
+	}
+
+	void write_vcd_header(std::ofstream &f, int &id, int idx = 0)
+	{
+		inst_t &inst = instances[idx];
+
+		f << stringf("$scope module %s $end\n", log_id(inst.instance ? inst.instance->name : inst.module->name));
+
+		int first_var = GetSize(vcd_vars);
+		for (auto wire : inst.module->wires())
+		{
+			if (shared->hide_internal && wire->name[0] == '$')
+				continue;
+
+			f << stringf("$var wire %d n%d %s%s $end\n", GetSize(wire), id, wire->name[0] == '$' ? "\\" : "", log_id(wire));
+
+			vcd_var_t var;
+			var.id = id++;
+			var.sig = inst.wires.at(wire);
+			vcd_vars.push_back(var);
+		}
+
+		// SimInstance dumps the values in reverse order
+		std::reverse(vcd_vars.begin() + first_var, vcd_vars.end());
+
+		for (int child : inst.children)
+			write_vcd_header(f, id, child);
+
+		f << stringf("$upscope $end\n");
+	}
+
+	void write_vcd_step(std::ofstream &f)
+	{
+		for (auto &var : vcd_vars)
+		{
+			bool changed = GetSize(var.value) != var.sig.len;
+			var.value.resize(var.sig.len);
+
+			for (int i = 0; i < var.sig.len; i++) {
+				State bit = get_net(operands[var.sig.ofs + i]);
+				if (var.value[i] != bit)
+					var.value[i] = bit, changed = true;
+			}
+
+			if (!changed)
+				continue;
+
+			f << "b";
+			for (int i = var.sig.len-1; i >= 0; i--) {
+				switch (var.value[i]) {
+					case State::S0: f << "0"; break;
+					case State::S1: f << "1"; break;
+					case State::Sx: f << "x"; break;
+					default: f << "z";
+				}
+			}
+
+			f << stringf(" n%d\n", var.id);
+		}
+	}
+};
+
 struct SimWorker : SimShared
 {
 	SimInstance *top = nullptr;
+	SimCompiled *top_compiled = nullptr;
+	Module *top_module = nullptr;
 	std::ofstream vcdfile;
 	pool<IdString> clock, clockn, reset, resetn;
 
 	~SimWorker()
 	{
 		delete top;
+		delete top_compiled;
 	}
 
 	void write_vcd_header()
@@ -638,7 +1849,10 @@ struct SimWorker : SimShared
 			return;
 
 		int id = 1;
-		top->write_vcd_header(vcdfile, id);
+		if (top_compiled)
+			top_compiled->write_vcd_header(vcdfile, id);
+		else
+			top->write_vcd_header(vcdfile, id);
 
 		vcdfile << stringf("$enddefinitions $end\n");
 	}
@@ -649,11 +1863,19 @@ struct SimWorker : SimShared
 			return;
 
 		vcdfile << stringf("#%d\n", t);
-		top->write_vcd_step(vcdfile);
+		if (top_compiled)
+			top_compiled->write_vcd_step(vcdfile);
+		else
+			top->write_vcd_step(vcdfile);
 	}
 
 	void update()
 	{
+		if (top_compiled) {
+			top_compiled->update();
+			return;
+		}
+
 		while (1)
 		{
 			if (debug)
@@ -678,19 +1900,27 @@ struct SimWorker : SimShared
 	{
 		for (auto portname : ports)
 		{
-			Wire *w = top->module->wire(portname);
+			Wire *w = top_module->wire(portname);
 
 			if (w == nullptr)
-				log_error("Can't find port %s on module %s.\n", log_id(portname), log_id(top->module));
+				log_error("Can't find port %s on module %s.\n", log_id(portname), log_id(top_module));
 
-			top->set_state(w, value);
+			if (top_compiled)
+				top_compiled->set_state(w, value);
+			else
+				top->set_state(w, value);
 		}
 	}
 
 	void run(Module *topmod, int numcycles)
 	{
-		log_assert(top == nullptr);
-		top = new SimInstance(this, topmod);
+		log_assert(top == nullptr && top_compiled == nullptr);
+		top_module = topmod;
+
+		if (compiled)
+			top_compiled = new SimCompiled(this, topmod);
+		else
+			top = new SimInstance(this, topmod);
 
 		if (debug)
 			log("\n===== 0 =====\n");
@@ -740,7 +1970,10 @@ struct SimWorker : SimShared
 
 		if (writeback) {
 			pool<Module*> wbmods;
-			top->writeback(wbmods);
+			if (top_compiled)
+				top_compiled->writeback(wbmods);
+			else
+				top->writeback(wbmods);
 		}
 	}
 };
@@ -788,6 +2021,11 @@ struct SimPass : public Pass {
 		log("    -d\n");
 		log("        enable debug output\n");
 		log("\n");
+		log("    -compiled\n");
+		log("        flatten the hierarchy and compile the netlist into a levelized array of\n");
+		log("        instructions before simulating. this is much faster for long runs and\n");
+		log("        produces the same results, but -d has no effect in this mode.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
 	{
@@ -842,6 +2080,10 @@ struct SimPass : public Pass {
 				worker.zinit = true;
 				continue;
 			}
+			if (args[argidx] == "-compiled") {
+				worker.compiled = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -61,10 +61,38 @@
 #include "frontends/blif/blifparse.h"
 
 #ifdef YOSYS_LINK_ABC
-extern "C" int Abc_RealMain(int argc, char *argv[]);
+extern "C" void Abc_Start();
+extern "C" void Abc_Stop();
+extern "C" void *Abc_FrameGetGlobalFrame();
+extern "C" int Cmd_CommandExecute(void *pAbc, const char *sCommand);
 #endif
 
 USING_YOSYS_NAMESPACE
+
+#ifdef YOSYS_LINK_ABC
+YOSYS_NAMESPACE_BEGIN
+
+// Same as "yosys-abc -s -f <script_file>", but without starting a process. The
+// frame is started for each script and stopped after it, so that nothing a
+// script leaves in the frame (networks, gate and box libraries, read_constr
+// settings, aliases and variables) is seen by the next one. The networks are
+// still exchanged through the files in the temp directory.
+int run_linked_abc(std::string script_file)
+{
+	Abc_Start();
+
+	std::string command = stringf("source %s", script_file.c_str());
+	fflush(stdout);
+	int ret = Cmd_CommandExecute(Abc_FrameGetGlobalFrame(), command.c_str());
+	fflush(stdout);
+
+	Abc_Stop();
+	return ret;
+}
+
+YOSYS_NAMESPACE_END
+#endif
+
 PRIVATE_NAMESPACE_BEGIN
 
 enum class gate_type_t {
@@ -656,7 +684,44 @@ struct abc_output_filter
 	}
 };
 
-void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::string script_file, std::string exe_file,
+typedef tuple<bool, RTLIL::SigSpec, bool, RTLIL::SigSpec> clkdomain_t;
+
+struct abc_job_t
+{
+	int map_autoidx;
+	std::vector<gate_t> signal_list;
+	std::map<RTLIL::SigBit, int> signal_map;
+	dict<int, std::string> pi_map, po_map;
+	bool recover_init;
+	bool clk_polarity, en_polarity;
+	RTLIL::SigSpec clk_sig, en_sig;
+
+	RTLIL::Module *module;
+	std::string tempdir_name;
+	int count_output;
+	int abc_retval;
+	std::vector<std::string> abc_output;
+
+	abc_job_t() : map_autoidx(0), recover_init(false), clk_polarity(true), en_polarity(true),
+			module(nullptr), count_output(0), abc_retval(0) { }
+};
+
+// exchange the per-invocation global state with the state stored in a job
+void swap_abc_state(abc_job_t &job)
+{
+	std::swap(map_autoidx, job.map_autoidx);
+	std::swap(signal_list, job.signal_list);
+	std::swap(signal_map, job.signal_map);
+	std::swap(pi_map, job.pi_map);
+	std::swap(po_map, job.po_map);
+	std::swap(recover_init, job.recover_init);
+	std::swap(clk_polarity, job.clk_polarity);
+	std::swap(en_polarity, job.en_polarity);
+	std::swap(clk_sig, job.clk_sig);
+	std::swap(en_sig, job.en_sig);
+}
+
+std::string abc_module_prepare(RTLIL::Design *design, RTLIL::Module *current_module, std::string script_file,
 		std::string liberty_file, std::string constr_file, bool cleanup, vector<int> lut_costs, bool dff_mode, std::string clk_str,
 		bool keepff, std::string delay_target, std::string sop_inputs, std::string sop_products, std::string lutin_shared, bool fast_mode,
 		const std::vector<RTLIL::Cell*> &cells, bool show_tempdir, bool sop_mode, bool abc_dress)
@@ -802,10 +867,15 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 	if (en_sig.size() != 0)
 		mark_port(en_sig);
 
+	return tempdir_name;
+}
+
+int abc_module_write(std::string tempdir_name, vector<int> lut_costs)
+{
 	handle_loops();
 
 	std::string buffer = stringf("%s/input.blif", tempdir_name.c_str());
-	f = fopen(buffer.c_str(), "wt");
+	FILE *f = fopen(buffer.c_str(), "wt");
 	if (f == NULL)
 		log_error("Opening %s for writing failed: %s\n", buffer.c_str(), strerror(errno));
 
@@ -920,11 +990,9 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 
 	log("Extracted %d gates and %d wires to a netlist network with %d inputs and %d outputs.\n",
 			count_gates, GetSize(signal_list), count_input, count_output);
-	log_push();
+
 	if (count_output > 0)
 	{
-		log_header(design, "Executing ABC.\n");
-
 		buffer = stringf("%s/stdcells.genlib", tempdir_name.c_str());
 		f = fopen(buffer.c_str(), "wt");
 		if (f == NULL)
@@ -976,214 +1044,185 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 				fprintf(f, "%d %d.00 1.00\n", i+1, lut_costs.at(i));
 			fclose(f);
 		}
+	}
 
-		buffer = stringf("%s -s -f %s/abc.script 2>&1", exe_file.c_str(), tempdir_name.c_str());
-		log("Running ABC command: %s\n", replace_tempdir(buffer, tempdir_name, show_tempdir).c_str());
+	return count_output;
+}
 
+std::string abc_command(std::string exe_file, std::string tempdir_name)
+{
+	return stringf("%s -s -f %s/abc.script 2>&1", exe_file.c_str(), tempdir_name.c_str());
+}
+
+// does not write to the log, so that it can be called from worker threads
+int run_abc(std::string exe_file, std::string tempdir_name, std::function<void(const std::string&)> process_line)
+{
 #ifndef YOSYS_LINK_ABC
-		abc_output_filter filt(tempdir_name, show_tempdir);
-		int ret = run_command(buffer, std::bind(&abc_output_filter::next_line, filt, std::placeholders::_1));
+	return run_command(abc_command(exe_file, tempdir_name), process_line);
 #else
-		// These needs to be mutable, supposedly due to getopt
-		char *abc_argv[5];
-		string tmp_script_name = stringf("%s/abc.script", tempdir_name.c_str());
-		abc_argv[0] = strdup(exe_file.c_str());
-		abc_argv[1] = strdup("-s");
-		abc_argv[2] = strdup("-f");
-		abc_argv[3] = strdup(tmp_script_name.c_str());
-		abc_argv[4] = 0;
-		int ret = Abc_RealMain(4, abc_argv);
-		free(abc_argv[0]);
-		free(abc_argv[1]);
-		free(abc_argv[2]);
-		free(abc_argv[3]);
+	// The linked ABC writes directly to stdout
+	(void)exe_file;
+	(void)process_line;
+	return run_linked_abc(stringf("%s/abc.script", tempdir_name.c_str()));
 #endif
-		if (ret != 0)
-			log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
+}
 
-		buffer = stringf("%s/%s", tempdir_name.c_str(), "output.blif");
-		std::ifstream ifs;
-		ifs.open(buffer);
-		if (ifs.fail())
-			log_error("Can't open ABC output file `%s'.\n", buffer.c_str());
-
-		bool builtin_lib = liberty_file.empty();
-		RTLIL::Design *mapped_design = new RTLIL::Design;
-		parse_blif(mapped_design, ifs, builtin_lib ? "\\DFF" : "\\_dff_", false, sop_mode);
-
-		ifs.close();
-
-		log_header(design, "Re-integrating ABC results.\n");
-		RTLIL::Module *mapped_mod = mapped_design->modules_["\\netlist"];
-		if (mapped_mod == NULL)
-			log_error("ABC output file does not contain a module `netlist'.\n");
-		for (auto &it : mapped_mod->wires_) {
-			RTLIL::Wire *w = it.second;
-			RTLIL::Wire *orig_wire = nullptr;
-			RTLIL::Wire *wire = module->addWire(remap_name(w->name, &orig_wire));
-			if (orig_wire != nullptr && orig_wire->attributes.count("\\src"))
-				wire->attributes["\\src"] = orig_wire->attributes["\\src"];
-			if (markgroups) wire->attributes["\\abcgroup"] = map_autoidx;
-			design->select(module, wire);
-		}
+void abc_module_integrate(RTLIL::Design *design, std::string tempdir_name, std::string liberty_file, bool sop_mode)
+{
+	std::string buffer = stringf("%s/%s", tempdir_name.c_str(), "output.blif");
+	std::ifstream ifs;
+	ifs.open(buffer);
+	if (ifs.fail())
+		log_error("Can't open ABC output file `%s'.\n", buffer.c_str());
+
+	bool builtin_lib = liberty_file.empty();
+	RTLIL::Design *mapped_design = new RTLIL::Design;
+	parse_blif(mapped_design, ifs, builtin_lib ? "\\DFF" : "\\_dff_", false, sop_mode, false, buffer);
+
+	ifs.close();
+
+	log_header(design, "Re-integrating ABC results.\n");
+	RTLIL::Module *mapped_mod = mapped_design->modules_["\\netlist"];
+	if (mapped_mod == NULL)
+		log_error("ABC output file does not contain a module `netlist'.\n");
+	for (auto &it : mapped_mod->wires_) {
+		RTLIL::Wire *w = it.second;
+		RTLIL::Wire *orig_wire = nullptr;
+		RTLIL::Wire *wire = module->addWire(remap_name(w->name, &orig_wire));
+		if (orig_wire != nullptr && orig_wire->attributes.count("\\src"))
+			wire->attributes["\\src"] = orig_wire->attributes["\\src"];
+		if (markgroups) wire->attributes["\\abcgroup"] = map_autoidx;
+		design->select(module, wire);
+	}
 
-		std::map<std::string, int> cell_stats;
-		for (auto c : mapped_mod->cells())
+	std::map<std::string, int> cell_stats;
+	for (auto c : mapped_mod->cells())
+	{
+		if (builtin_lib)
 		{
-			if (builtin_lib)
-			{
-				cell_stats[RTLIL::unescape_id(c->type)]++;
-				if (c->type == "\\ZERO" || c->type == "\\ONE") {
-					RTLIL::SigSig conn;
-					conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]);
-					conn.second = RTLIL::SigSpec(c->type == "\\ZERO" ? 0 : 1, 1);
-					module->connect(conn);
-					continue;
-				}
-				if (c->type == "\\BUF") {
-					RTLIL::SigSig conn;
-					conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]);
-					conn.second = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]);
-					module->connect(conn);
-					continue;
-				}
-				if (c->type == "\\NOT") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_NOT_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\AND" || c->type == "\\OR" || c->type == "\\XOR" || c->type == "\\NAND" || c->type == "\\NOR" ||
-						c->type == "\\XNOR" || c->type == "\\ANDNOT" || c->type == "\\ORNOT") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\MUX") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\MUX4") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX4_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
-					cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\MUX8") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX8_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\E", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\E").as_wire()->name)]));
-					cell->setPort("\\F", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\F").as_wire()->name)]));
-					cell->setPort("\\G", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\G").as_wire()->name)]));
-					cell->setPort("\\H", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\H").as_wire()->name)]));
-					cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
-					cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
-					cell->setPort("\\U", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\U").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\MUX16") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX16_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\E", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\E").as_wire()->name)]));
-					cell->setPort("\\F", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\F").as_wire()->name)]));
-					cell->setPort("\\G", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\G").as_wire()->name)]));
-					cell->setPort("\\H", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\H").as_wire()->name)]));
-					cell->setPort("\\I", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\I").as_wire()->name)]));
-					cell->setPort("\\J", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\J").as_wire()->name)]));
-					cell->setPort("\\K", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\K").as_wire()->name)]));
-					cell->setPort("\\L", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\L").as_wire()->name)]));
-					cell->setPort("\\M", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\M").as_wire()->name)]));
-					cell->setPort("\\N", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\N").as_wire()->name)]));
-					cell->setPort("\\O", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\O").as_wire()->name)]));
-					cell->setPort("\\P", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\P").as_wire()->name)]));
-					cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
-					cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
-					cell->setPort("\\U", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\U").as_wire()->name)]));
-					cell->setPort("\\V", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\V").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\AOI3" || c->type == "\\OAI3") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\AOI4" || c->type == "\\OAI4") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\DFF") {
-					log_assert(clk_sig.size() == 1);
-					RTLIL::Cell *cell;
-					if (en_sig.size() == 0) {
-						cell = module->addCell(remap_name(c->name), clk_polarity ? "$_DFF_P_" : "$_DFF_N_");
-					} else {
-						log_assert(en_sig.size() == 1);
-						cell = module->addCell(remap_name(c->name), stringf("$_DFFE_%c%c_", clk_polarity ? 'P' : 'N', en_polarity ? 'P' : 'N'));
-						cell->setPort("\\E", en_sig);
-					}
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\Q", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Q").as_wire()->name)]));
-					cell->setPort("\\C", clk_sig);
-					design->select(module, cell);
-					continue;
-				}
+			cell_stats[RTLIL::unescape_id(c->type)]++;
+			if (c->type == "\\ZERO" || c->type == "\\ONE") {
+				RTLIL::SigSig conn;
+				conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]);
+				conn.second = RTLIL::SigSpec(c->type == "\\ZERO" ? 0 : 1, 1);
+				module->connect(conn);
+				continue;
 			}
-			else
-				cell_stats[RTLIL::unescape_id(c->type)]++;
-
-			if (c->type == "\\_const0_" || c->type == "\\_const1_") {
+			if (c->type == "\\BUF") {
 				RTLIL::SigSig conn;
-				conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->connections().begin()->second.as_wire()->name)]);
-				conn.second = RTLIL::SigSpec(c->type == "\\_const0_" ? 0 : 1, 1);
+				conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]);
+				conn.second = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]);
 				module->connect(conn);
 				continue;
 			}
-
-			if (c->type == "\\_dff_") {
+			if (c->type == "\\NOT") {
+				RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_NOT_");
+				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+				cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+				cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+				design->select(module, cell);
+				continue;
+			}
+			if (c->type == "\\AND" || c->type == "\\OR" || c->type == "\\XOR" || c->type == "\\NAND" || c->type == "\\NOR" ||
+					c->type == "\\XNOR" || c->type == "\\ANDNOT" || c->type == "\\ORNOT") {
+				RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
+				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+				cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+				cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+				cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+				design->select(module, cell);
+				continue;
+			}
+			if (c->type == "\\MUX") {
+				RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX_");
+				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+				cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+				cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+				cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
+				cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+				design->select(module, cell);
+				continue;
+			}
+			if (c->type == "\\MUX4") {
+				RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX4_");
+				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+				cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+				cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+				cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+				cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+				cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
+				cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
+				cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+				design->select(module, cell);
+				continue;
+			}
+			if (c->type == "\\MUX8") {
+				RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX8_");
+				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+				cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+				cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+				cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+				cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+				cell->setPort("\\E", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\E").as_wire()->name)]));
+				cell->setPort("\\F", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\F").as_wire()->name)]));
+				cell->setPort("\\G", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\G").as_wire()->name)]));
+				cell->setPort("\\H", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\H").as_wire()->name)]));
+				cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
+				cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
+				cell->setPort("\\U", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\U").as_wire()->name)]));
+				cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+				design->select(module, cell);
+				continue;
+			}
+			if (c->type == "\\MUX16") {
+				RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX16_");
+				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+				cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+				cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+				cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+				cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+				cell->setPort("\\E", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\E").as_wire()->name)]));
+				cell->setPort("\\F", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\F").as_wire()->name)]));
+				cell->setPort("\\G", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\G").as_wire()->name)]));
+				cell->setPort("\\H", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\H").as_wire()->name)]));
+				cell->setPort("\\I", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\I").as_wire()->name)]));
+				cell->setPort("\\J", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\J").as_wire()->name)]));
+				cell->setPort("\\K", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\K").as_wire()->name)]));
+				cell->setPort("\\L", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\L").as_wire()->name)]));
+				cell->setPort("\\M", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\M").as_wire()->name)]));
+				cell->setPort("\\N", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\N").as_wire()->name)]));
+				cell->setPort("\\O", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\O").as_wire()->name)]));
+				cell->setPort("\\P", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\P").as_wire()->name)]));
+				cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
+				cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
+				cell->setPort("\\U", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\U").as_wire()->name)]));
+				cell->setPort("\\V", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\V").as_wire()->name)]));
+				cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+				design->select(module, cell);
+				continue;
+			}
+			if (c->type == "\\AOI3" || c->type == "\\OAI3") {
+				RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
+				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+				cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+				cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+				cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+				cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+				design->select(module, cell);
+				continue;
+			}
+			if (c->type == "\\AOI4" || c->type == "\\OAI4") {
+				RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
+				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+				cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+				cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+				cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+				cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+				cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+				design->select(module, cell);
+				continue;
+			}
+			if (c->type == "\\DFF") {
 				log_assert(clk_sig.size() == 1);
 				RTLIL::Cell *cell;
 				if (en_sig.size() == 0) {
@@ -1200,71 +1239,125 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 				design->select(module, cell);
 				continue;
 			}
+		}
+		else
+			cell_stats[RTLIL::unescape_id(c->type)]++;
 
-			if (c->type == "$lut" && GetSize(c->getPort("\\A")) == 1 && c->getParam("\\LUT").as_int() == 2) {
-				SigSpec my_a = module->wires_[remap_name(c->getPort("\\A").as_wire()->name)];
-				SigSpec my_y = module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)];
-				module->connect(my_y, my_a);
-				continue;
-			}
+		if (c->type == "\\_const0_" || c->type == "\\_const1_") {
+			RTLIL::SigSig conn;
+			conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->connections().begin()->second.as_wire()->name)]);
+			conn.second = RTLIL::SigSpec(c->type == "\\_const0_" ? 0 : 1, 1);
+			module->connect(conn);
+			continue;
+		}
 
-			RTLIL::Cell *cell = module->addCell(remap_name(c->name), c->type);
-			if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-			cell->parameters = c->parameters;
-			for (auto &conn : c->connections()) {
-				RTLIL::SigSpec newsig;
-				for (auto &c : conn.second.chunks()) {
-					if (c.width == 0)
-						continue;
-					log_assert(c.width == 1);
-					newsig.append(module->wires_[remap_name(c.wire->name)]);
-				}
-				cell->setPort(conn.first, newsig);
+		if (c->type == "\\_dff_") {
+			log_assert(clk_sig.size() == 1);
+			RTLIL::Cell *cell;
+			if (en_sig.size() == 0) {
+				cell = module->addCell(remap_name(c->name), clk_polarity ? "$_DFF_P_" : "$_DFF_N_");
+			} else {
+				log_assert(en_sig.size() == 1);
+				cell = module->addCell(remap_name(c->name), stringf("$_DFFE_%c%c_", clk_polarity ? 'P' : 'N', en_polarity ? 'P' : 'N'));
+				cell->setPort("\\E", en_sig);
 			}
+			if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+			cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+			cell->setPort("\\Q", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Q").as_wire()->name)]));
+			cell->setPort("\\C", clk_sig);
 			design->select(module, cell);
+			continue;
 		}
 
-		for (auto conn : mapped_mod->connections()) {
-			if (!conn.first.is_fully_const())
-				conn.first = RTLIL::SigSpec(module->wires_[remap_name(conn.first.as_wire()->name)]);
-			if (!conn.second.is_fully_const())
-				conn.second = RTLIL::SigSpec(module->wires_[remap_name(conn.second.as_wire()->name)]);
-			module->connect(conn);
+		if (c->type == "$lut" && GetSize(c->getPort("\\A")) == 1 && c->getParam("\\LUT").as_int() == 2) {
+			SigSpec my_a = module->wires_[remap_name(c->getPort("\\A").as_wire()->name)];
+			SigSpec my_y = module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)];
+			module->connect(my_y, my_a);
+			continue;
 		}
 
-		if (recover_init)
-			for (auto wire : mapped_mod->wires()) {
-				if (wire->attributes.count("\\init")) {
-					Wire *w = module->wires_[remap_name(wire->name)];
-					log_assert(w->attributes.count("\\init") == 0);
-					w->attributes["\\init"] = wire->attributes.at("\\init");
-				}
+		RTLIL::Cell *cell = module->addCell(remap_name(c->name), c->type);
+		if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+		cell->parameters = c->parameters;
+		for (auto &conn : c->connections()) {
+			RTLIL::SigSpec newsig;
+			for (auto &c : conn.second.chunks()) {
+				if (c.width == 0)
+					continue;
+				log_assert(c.width == 1);
+				newsig.append(module->wires_[remap_name(c.wire->name)]);
 			}
+			cell->setPort(conn.first, newsig);
+		}
+		design->select(module, cell);
+	}
 
-		for (auto &it : cell_stats)
-			log("ABC RESULTS:   %15s cells: %8d\n", it.first.c_str(), it.second);
-		int in_wires = 0, out_wires = 0;
-		for (auto &si : signal_list)
-			if (si.is_port) {
-				char buffer[100];
-				snprintf(buffer, 100, "\\ys__n%d", si.id);
-				RTLIL::SigSig conn;
-				if (si.type != G(NONE)) {
-					conn.first = si.bit;
-					conn.second = RTLIL::SigSpec(module->wires_[remap_name(buffer)]);
-					out_wires++;
-				} else {
-					conn.first = RTLIL::SigSpec(module->wires_[remap_name(buffer)]);
-					conn.second = si.bit;
-					in_wires++;
-				}
-				module->connect(conn);
+	for (auto conn : mapped_mod->connections()) {
+		if (!conn.first.is_fully_const())
+			conn.first = RTLIL::SigSpec(module->wires_[remap_name(conn.first.as_wire()->name)]);
+		if (!conn.second.is_fully_const())
+			conn.second = RTLIL::SigSpec(module->wires_[remap_name(conn.second.as_wire()->name)]);
+		module->connect(conn);
+	}
+
+	if (recover_init)
+		for (auto wire : mapped_mod->wires()) {
+			if (wire->attributes.count("\\init")) {
+				Wire *w = module->wires_[remap_name(wire->name)];
+				log_assert(w->attributes.count("\\init") == 0);
+				w->attributes["\\init"] = wire->attributes.at("\\init");
 			}
-		log("ABC RESULTS:        internal signals: %8d\n", int(signal_list.size()) - in_wires - out_wires);
-		log("ABC RESULTS:           input signals: %8d\n", in_wires);
-		log("ABC RESULTS:          output signals: %8d\n", out_wires);
+		}
 
-		delete mapped_design;
+	for (auto &it : cell_stats)
+		log("ABC RESULTS:   %15s cells: %8d\n", it.first.c_str(), it.second);
+	int in_wires = 0, out_wires = 0;
+	for (auto &si : signal_list)
+		if (si.is_port) {
+			char buffer[100];
+			snprintf(buffer, 100, "\\ys__n%d", si.id);
+			RTLIL::SigSig conn;
+			if (si.type != G(NONE)) {
+				conn.first = si.bit;
+				conn.second = RTLIL::SigSpec(module->wires_[remap_name(buffer)]);
+				out_wires++;
+			} else {
+				conn.first = RTLIL::SigSpec(module->wires_[remap_name(buffer)]);
+				conn.second = si.bit;
+				in_wires++;
+			}
+			module->connect(conn);
+		}
+	log("ABC RESULTS:        internal signals: %8d\n", int(signal_list.size()) - in_wires - out_wires);
+	log("ABC RESULTS:           input signals: %8d\n", in_wires);
+	log("ABC RESULTS:          output signals: %8d\n", out_wires);
+
+	delete mapped_design;
+}
+
+void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::string script_file, std::string exe_file,
+		std::string liberty_file, std::string constr_file, bool cleanup, vector<int> lut_costs, bool dff_mode, std::string clk_str,
+		bool keepff, std::string delay_target, std::string sop_inputs, std::string sop_products, std::string lutin_shared, bool fast_mode,
+		const std::vector<RTLIL::Cell*> &cells, bool show_tempdir, bool sop_mode, bool abc_dress)
+{
+	std::string tempdir_name = abc_module_prepare(design, current_module, script_file, liberty_file, constr_file, cleanup, lut_costs,
+			dff_mode, clk_str, keepff, delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, cells, show_tempdir, sop_mode, abc_dress);
+	int count_output = abc_module_write(tempdir_name, lut_costs);
+
+	log_push();
+	if (count_output > 0)
+	{
+		log_header(design, "Executing ABC.\n");
+
+		std::string buffer = abc_command(exe_file, tempdir_name);
+		log("Running ABC command: %s\n", replace_tempdir(buffer, tempdir_name, show_tempdir).c_str());
+
+		abc_output_filter filt(tempdir_name, show_tempdir);
+		int ret = run_abc(exe_file, tempdir_name, std::bind(&abc_output_filter::next_line, filt, std::placeholders::_1));
+		if (ret != 0)
+			log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
+
+		abc_module_integrate(design, tempdir_name, liberty_file, sop_mode);
 	}
 	else
 	{
@@ -1280,6 +1373,132 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 	log_pop();
 }
 
+// Extract the cells of one module into new jobs, one job for each entry in
+// assigned_cells. With clk_str == "$" the clock domain is taken from the key.
+void abc_module_extract_jobs(std::vector<abc_job_t> &jobs, RTLIL::Design *design, RTLIL::Module *current_module,
+		std::string script_file, std::string liberty_file, std::string constr_file, bool cleanup, vector<int> lut_costs,
+		bool dff_mode, std::string clk_str, bool keepff, std::string delay_target, std::string sop_inputs, std::string sop_products,
+		std::string lutin_shared, bool fast_mode, const std::map<clkdomain_t, std::vector<RTLIL::Cell*>> &assigned_cells,
+		bool show_tempdir, bool sop_mode, bool abc_dress)
+{
+	int first_job = GetSize(jobs);
+
+	// Extract all domains before any results are re-integrated. Signals shared
+	// between domains must become ports of all netlists involved, as the cells
+	// driving or reading them are no longer in the module at this point.
+
+	for (auto &it : assigned_cells) {
+		jobs.push_back(abc_job_t());
+		abc_job_t &job = jobs.back();
+		bool job_dff_mode = dff_mode;
+		if (clk_str == "$") {
+			clk_polarity = std::get<0>(it.first);
+			clk_sig = assign_map(std::get<1>(it.first));
+			en_polarity = std::get<2>(it.first);
+			en_sig = assign_map(std::get<3>(it.first));
+			job_dff_mode = !clk_sig.empty();
+		}
+		job.module = current_module;
+		job.tempdir_name = abc_module_prepare(design, current_module, script_file, liberty_file, constr_file, cleanup, lut_costs,
+				job_dff_mode, clk_str, keepff, delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, it.second,
+				show_tempdir, sop_mode, abc_dress);
+		swap_abc_state(job);
+	}
+
+	dict<RTLIL::SigBit, int> bit_domain_count;
+	for (int i = first_job; i < GetSize(jobs); i++)
+		for (auto &si : jobs[i].signal_list)
+			if (si.bit.wire != nullptr)
+				bit_domain_count[si.bit]++;
+
+	for (int i = first_job; i < GetSize(jobs); i++) {
+		abc_job_t &job = jobs[i];
+		for (auto &si : job.signal_list)
+			if (si.bit.wire != nullptr && bit_domain_count.at(si.bit) > 1)
+				si.is_port = true;
+		swap_abc_state(job);
+		job.count_output = abc_module_write(job.tempdir_name, lut_costs);
+		swap_abc_state(job);
+	}
+}
+
+// Run ABC for all extracted jobs (possibly from several modules) and
+// re-integrate the results in the order in which the jobs were created.
+void abc_run_jobs(RTLIL::Design *design, std::vector<abc_job_t> &jobs, std::string exe_file, std::string liberty_file,
+		bool cleanup, bool show_tempdir, bool sop_mode, int num_threads)
+{
+	log_header(design, "Executing %d ABC processes using %d threads.\n", GetSize(jobs), num_threads);
+
+#if defined(YOSYS_ENABLE_THREADS) && !defined(YOSYS_LINK_ABC)
+	std::atomic<int> next_job(0);
+	auto worker = [&]() {
+		while (1) {
+			int idx = next_job++;
+			if (idx >= GetSize(jobs))
+				break;
+			abc_job_t &job = jobs[idx];
+			if (job.count_output > 0)
+				job.abc_retval = run_abc(exe_file, job.tempdir_name, [&job](const std::string &line) {
+					job.abc_output.push_back(line);
+				});
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < std::min(num_threads, GetSize(jobs)); i++)
+		threads.push_back(std::thread(worker));
+	worker();
+	for (auto &t : threads)
+		t.join();
+#else
+	for (auto &job : jobs)
+		if (job.count_output > 0)
+			job.abc_retval = run_abc(exe_file, job.tempdir_name, [&job](const std::string &line) {
+				job.abc_output.push_back(line);
+			});
+#endif
+
+	// Re-integration modifies the modules and is done in the original order.
+
+	for (auto &job : jobs)
+	{
+		swap_abc_state(job);
+		module = job.module;
+
+		log_push();
+		if (job.count_output > 0)
+		{
+			log_header(design, "Executing ABC for module %s.\n", log_id(module));
+
+			std::string buffer = abc_command(exe_file, job.tempdir_name);
+			log("Running ABC command: %s\n", replace_tempdir(buffer, job.tempdir_name, show_tempdir).c_str());
+
+			abc_output_filter filt(job.tempdir_name, show_tempdir);
+			for (auto &line : job.abc_output)
+				filt.next_line(line);
+			if (job.abc_retval != 0)
+				log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), job.abc_retval);
+
+			abc_module_integrate(design, job.tempdir_name, liberty_file, sop_mode);
+		}
+		else
+		{
+			log("Don't call ABC as there is nothing to map.\n");
+		}
+
+		if (cleanup)
+		{
+			log("Removing temp directory.\n");
+			remove_directory(job.tempdir_name);
+		}
+
+		log_pop();
+		swap_abc_state(job);
+	}
+
+	jobs.clear();
+}
+
 struct AbcPass : public Pass {
 	AbcPass() : Pass("abc", "use ABC for technology mapping") { }
 	void help() YS_OVERRIDE
@@ -1420,6 +1639,13 @@ struct AbcPass : public Pass {
 		log("        clock domains are automatically partitioned in clock domains and each\n");
 		log("        domain is passed through ABC independently.\n");
 		log("\n");
+		log("    -j <num>\n");
+		log("        run up to <num> ABC processes in parallel. all selected modules (and all\n");
+		log("        clock domains, see -dff) are extracted first, then ABC is executed for\n");
+		log("        them concurrently, and then the results are re-integrated in a fixed\n");
+		log("        order. the result does not depend on <num>. the default is the value\n");
+		log("        of the -j option of the yosys executable, if it is larger than 1.\n");
+		log("\n");
 		log("    -clk [!]<clock-signal-name>[,[!]<enable-signal-name>]\n");
 		log("        use only the specified clock domain. this is like -dff, but only FF\n");
 		log("        cells that belong to the specified clock domain are used.\n");
@@ -1482,6 +1708,7 @@ struct AbcPass : public Pass {
 		bool show_tempdir = false, sop_mode = false;
 		bool abc_dress = false;
 		vector<int> lut_costs;
+		int num_threads = 0;
 		markgroups = false;
 
 		map_mux4 = false;
@@ -1698,6 +1925,12 @@ struct AbcPass : public Pass {
 				keepff = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				num_threads = atoi(args[++argidx].c_str());
+				if (num_threads < 1)
+					log_cmd_error("Invalid number of threads: %s\n", args[argidx].c_str());
+				continue;
+			}
 			if (arg == "-nocleanup") {
 				cleanup = false;
 				continue;
@@ -1719,6 +1952,11 @@ struct AbcPass : public Pass {
 		if (!constr_file.empty() && liberty_file.empty())
 			log_cmd_error("Got -constr but no -liberty!\n");
 
+		if (num_threads == 0 && yosys_threads > 1)
+			num_threads = yosys_threads;
+
+		std::vector<abc_job_t> jobs;
+
 		for (auto mod : design->selected_modules())
 		{
 			if (mod->processes.size() > 0) {
@@ -1747,6 +1985,13 @@ struct AbcPass : public Pass {
 				}
 
 			if (!dff_mode || !clk_str.empty()) {
+				if (num_threads > 0) {
+					std::map<clkdomain_t, std::vector<RTLIL::Cell*>> single_domain;
+					single_domain[clkdomain_t()] = mod->selected_cells();
+					abc_module_extract_jobs(jobs, design, mod, script_file, liberty_file, constr_file, cleanup, lut_costs, dff_mode, clk_str,
+							keepff, delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, single_domain, show_tempdir, sop_mode, abc_dress);
+					continue;
+				}
 				abc_module(design, mod, script_file, exe_file, liberty_file, constr_file, cleanup, lut_costs, dff_mode, clk_str, keepff,
 						delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, mod->selected_cells(), show_tempdir, sop_mode, abc_dress);
 				continue;
@@ -1761,7 +2006,6 @@ struct AbcPass : public Pass {
 			std::set<RTLIL::Cell*> expand_queue_up, next_expand_queue_up;
 			std::set<RTLIL::Cell*> expand_queue_down, next_expand_queue_down;
 
-			typedef tuple<bool, RTLIL::SigSpec, bool, RTLIL::SigSpec> clkdomain_t;
 			std::map<clkdomain_t, std::vector<RTLIL::Cell*>> assigned_cells;
 			std::map<RTLIL::Cell*, clkdomain_t> assigned_cells_reverse;
 
@@ -1887,6 +2131,12 @@ struct AbcPass : public Pass {
 						std::get<0>(it.first) ? "" : "!", log_signal(std::get<1>(it.first)),
 						std::get<2>(it.first) ? "" : "!", log_signal(std::get<3>(it.first)));
 
+			if (num_threads > 0) {
+				abc_module_extract_jobs(jobs, design, mod, script_file, liberty_file, constr_file, cleanup, lut_costs, true, "$",
+						keepff, delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, assigned_cells, show_tempdir, sop_mode, abc_dress);
+				continue;
+			}
+
 			for (auto &it : assigned_cells) {
 				clk_polarity = std::get<0>(it.first);
 				clk_sig = assign_map(std::get<1>(it.first));
@@ -1898,6 +2148,9 @@ struct AbcPass : public Pass {
 			}
 		}
 
+		if (!jobs.empty())
+			abc_run_jobs(design, jobs, exe_file, liberty_file, cleanup, show_tempdir, sop_mode, num_threads);
+
 		assign_map.clear();
 		signal_list.clear();
 		signal_map.clear();
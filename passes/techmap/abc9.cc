@@ -56,11 +56,13 @@
 #include "frontends/aiger/aigerparse.h"
 #include "kernel/utils.h"
 
+USING_YOSYS_NAMESPACE
+
 #ifdef YOSYS_LINK_ABC
-extern "C" int Abc_RealMain(int argc, char *argv[]);
+YOSYS_NAMESPACE_BEGIN
+extern int run_linked_abc(std::string script_file);
+YOSYS_NAMESPACE_END
 #endif
-
-USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 bool markgroups;
@@ -496,31 +498,19 @@ void abc9_module(RTLIL::Design *design, RTLIL::Module *current_module, std::stri
 		abc_output_filter filt(tempdir_name, show_tempdir);
 		int ret = run_command(buffer, std::bind(&abc_output_filter::next_line, filt, std::placeholders::_1));
 #else
-		// These needs to be mutable, supposedly due to getopt
-		char *abc_argv[5];
-		string tmp_script_name = stringf("%s/abc.script", tempdir_name.c_str());
-		abc_argv[0] = strdup(exe_file.c_str());
-		abc_argv[1] = strdup("-s");
-		abc_argv[2] = strdup("-f");
-		abc_argv[3] = strdup(tmp_script_name.c_str());
-		abc_argv[4] = 0;
-		int ret = Abc_RealMain(4, abc_argv);
-		free(abc_argv[0]);
-		free(abc_argv[1]);
-		free(abc_argv[2]);
-		free(abc_argv[3]);
+		int ret = run_linked_abc(stringf("%s/abc.script", tempdir_name.c_str()));
 #endif
 		if (ret != 0)
 			log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
 
-		buffer = stringf("%s/%s", tempdir_name.c_str(), "output.aig");
-		ifs.open(buffer);
+		std::string output_aig = stringf("%s/%s", tempdir_name.c_str(), "output.aig");
+		ifs.open(output_aig);
 		if (ifs.fail())
-			log_error("Can't open ABC output file `%s'.\n", buffer.c_str());
+			log_error("Can't open ABC output file `%s'.\n", output_aig.c_str());
 
 		buffer = stringf("%s/%s", tempdir_name.c_str(), "input.sym");
 		log_assert(!design->module("$__abc9__"));
-		AigerReader reader(design, ifs, "$__abc9__", "" /* clk_name */, buffer.c_str() /* map_filename */, true /* wideports */);
+		AigerReader reader(design, ifs, "$__abc9__", "" /* clk_name */, buffer.c_str() /* map_filename */, true /* wideports */, output_aig);
 		reader.parse_xaiger();
 		ifs.close();
 
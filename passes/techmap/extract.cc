@@ -409,6 +409,12 @@ struct ExtractPass : public Pass {
 		log("    -ignore_param <cell_type> <parameter_name>\n");
 		log("        Do not use this parameter when matching cells.\n");
 		log("\n");
+		log("    -j <num>\n");
+		log("        search for matches using up to <num> threads. the matches that are\n");
+		log("        found do not depend on <num>. the default is the number of threads\n");
+		log("        given with 'yosys -j'. -cell_attr and -wire_attr always use a\n");
+		log("        single thread.\n");
+		log("\n");
 		log("This pass does not operate on modules with unprocessed processes in it.\n");
 		log("(I.e. the 'proc' pass should be used first to convert processes to netlists.)\n");
 		log("\n");
@@ -458,6 +464,7 @@ struct ExtractPass : public Pass {
 		int mine_min_freq = 10;
 		int mine_limit_mod = -1;
 		int mine_max_fanout = -1;
+		int num_threads = yosys_threads;
 		std::set<std::pair<RTLIL::IdString, RTLIL::IdString>> mine_split;
 
 		size_t argidx;
@@ -562,10 +569,25 @@ struct ExtractPass : public Pass {
 				argidx += 2;
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_threads = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
+#ifndef YOSYS_ENABLE_THREADS
+		num_threads = 1;
+#endif
+		// userCompareNodes() looks up attributes and ports of the design cells
+		// from the solver threads, so only allow that from a single thread
+		if (num_threads > 1 && (solver.cell_attr.size() > 0 || solver.wire_attr.size() > 0)) {
+			log("Using a single thread because of -cell_attr/-wire_attr.\n");
+			num_threads = 1;
+		}
+		solver.setNumThreads(num_threads);
+
 		if (!nodefaultswaps) {
 			solver.addSwappablePorts("$and",       "\\A", "\\B");
 			solver.addSwappablePorts("$or",        "\\A", "\\B");
@@ -1592,9 +1592,9 @@ struct FlowmapPass : public Pass {
 		const char *algo_r = relax ? "-r" : "";
 		log_header(design, "Executing FLOWMAP pass (pack LUTs with FlowMap%s).\n", algo_r);
 
-		int gate_count = 0, lut_count = 0, packed_count = 0;
-		int gate_area = 0, lut_area = 0;
-		for (auto module : design->selected_modules())
+		std::atomic<int> gate_count(0), lut_count(0), packed_count(0);
+		std::atomic<int> gate_area(0), lut_area(0);
+		run_on_modules(design->selected_modules(), [&](RTLIL::Module *module)
 		{
 			FlowmapWorker worker(order, minlut, cell_types, r_alpha, r_beta, r_gamma, relax, optarea, debug, debug_relax, module);
 			gate_count += worker.gate_count;
@@ -1602,10 +1602,10 @@ struct FlowmapPass : public Pass {
 			packed_count += worker.packed_count;
 			gate_area += worker.gate_area;
 			lut_area += worker.lut_area;
-		}
+		});
 
 		log("\n");
-		log("Packed %d cells (%d of them duplicated) into %d LUTs.\n", packed_count, packed_count - gate_count, lut_count);
+		log("Packed %d cells (%d of them duplicated) into %d LUTs.\n", packed_count.load(), packed_count - gate_count, lut_count.load());
 		log("Solution takes %.1f%% of original gate area.\n", lut_area * 100.0 / gate_area);
 	}
 } FlowmapPass;
@@ -21,6 +21,7 @@
 #include "kernel/utils.h"
 #include "kernel/sigtools.h"
 #include "libs/sha1/sha1.h"
+#include "frontends/verilog/verilog_frontend.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -63,8 +64,8 @@ void apply_prefix(std::string prefix, RTLIL::SigSpec &sig, RTLIL::Module *module
 struct TechmapWorker
 {
 	std::map<RTLIL::IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> simplemap_mappers;
-	std::map<std::pair<RTLIL::IdString, std::map<RTLIL::IdString, RTLIL::Const>>, RTLIL::Module*> techmap_cache;
-	std::map<RTLIL::Module*, bool> techmap_do_cache;
+	dict<std::pair<RTLIL::IdString, dict<RTLIL::IdString, RTLIL::Const>>, RTLIL::Module*> techmap_cache;
+	dict<RTLIL::Module*, bool> techmap_do_cache;
 	std::set<RTLIL::Module*, RTLIL::IdString::compare_ptr_by_name<RTLIL::Module>> module_queue;
 	dict<Module*, SigMap> sigmaps;
 
@@ -80,6 +81,7 @@ struct TechmapWorker
 	};
 
 	typedef std::map<std::string, std::vector<TechmapWireData>> TechmapWires;
+	typedef dict<RTLIL::IdString, std::set<RTLIL::IdString, RTLIL::sort_by_id_str>> CelltypeMap;
 
 	bool extern_mode;
 	bool assert_mode;
@@ -101,7 +103,7 @@ struct TechmapWorker
 	std::string constmap_tpl_name(SigMap &sigmap, RTLIL::Module *tpl, RTLIL::Cell *cell, bool verbose)
 	{
 		std::string constmap_info;
-		std::map<RTLIL::SigBit, std::pair<RTLIL::IdString, int>> connbits_map;
+		dict<RTLIL::SigBit, std::pair<RTLIL::IdString, int>> connbits_map;
 
 		for (auto conn : cell->connections())
 			for (int i = 0; i < GetSize(conn.second); i++) {
@@ -382,8 +384,8 @@ struct TechmapWorker
 		module->remove(cell);
 	}
 
-	bool techmap_module(RTLIL::Design *design, RTLIL::Module *module, RTLIL::Design *map, std::set<RTLIL::Cell*> &handled_cells,
-			const std::map<RTLIL::IdString, std::set<RTLIL::IdString, RTLIL::sort_by_id_str>> &celltypeMap, bool in_recursion)
+	bool techmap_module(RTLIL::Design *design, RTLIL::Module *module, RTLIL::Design *map, pool<RTLIL::Cell*> &handled_cells,
+			const CelltypeMap &celltypeMap, bool in_recursion)
 	{
 		std::string mapmsg_prefix = in_recursion ? "Recursively mapping" : "Mapping";
 
@@ -396,21 +398,20 @@ struct TechmapWorker
 
 		SigMap sigmap(module);
 
-		TopoSort<RTLIL::Cell*, RTLIL::IdString::compare_ptr_by_name<RTLIL::Cell>> cells;
-		std::map<RTLIL::Cell*, std::set<RTLIL::SigBit>> cell_to_inbit;
-		std::map<RTLIL::SigBit, std::set<RTLIL::Cell*>> outbit_to_cell;
+		// cells to be mapped, indexed in the order of their names
+		std::vector<RTLIL::Cell*> cells;
 
 		for (auto cell : module->cells())
 		{
 			if (!design->selected(module, cell) || handled_cells.count(cell) > 0)
 				continue;
 
-			std::string cell_type = cell->type.str();
-			if (in_recursion && cell_type.substr(0, 2) == "\\$")
+			RTLIL::IdString cell_type = cell->type;
+			if (in_recursion && cell_type.begins_with("\\$"))
 				cell_type = cell_type.substr(1);
 
 			if (celltypeMap.count(cell_type) == 0) {
-				if (assert_mode && cell_type.back() != '_')
+				if (assert_mode && cell_type.str().back() != '_')
 					log_error("(ASSERT MODE) No matching template cell for type %s found.\n", log_id(cell_type));
 				continue;
 			}
@@ -431,6 +432,22 @@ struct TechmapWorker
 				}
 			}
 
+			cells.push_back(cell);
+		}
+
+		std::sort(cells.begin(), cells.end(), RTLIL::IdString::compare_ptr_by_name<RTLIL::Cell>());
+
+		std::vector<pool<RTLIL::SigBit>> cell_to_inbit(GetSize(cells));
+		dict<RTLIL::SigBit, std::vector<int>> outbit_to_cell;
+
+		for (int i = 0; i < GetSize(cells); i++)
+		{
+			RTLIL::Cell *cell = cells[i];
+
+			RTLIL::IdString cell_type = cell->type;
+			if (in_recursion && cell_type.begins_with("\\$"))
+				cell_type = cell_type.substr(1);
+
 			for (auto &conn : cell->connections())
 			{
 				RTLIL::SigSpec sig = sigmap(conn.second);
@@ -443,39 +460,84 @@ struct TechmapWorker
 					RTLIL::Module *tpl = map->modules_[tpl_name];
 					RTLIL::Wire *port = tpl->wire(conn.first);
 					if (port && port->port_input)
-						cell_to_inbit[cell].insert(sig.begin(), sig.end());
+						cell_to_inbit[i].insert(sig.begin(), sig.end());
 					if (port && port->port_output)
-						for (auto &bit : sig)
-							outbit_to_cell[bit].insert(cell);
+						for (auto &bit : sig) {
+							auto &drivers = outbit_to_cell[bit];
+							if (drivers.empty() || drivers.back() != i)
+								drivers.push_back(i);
+						}
 				}
 			}
+		}
 
-			cells.node(cell);
+		// the cells driving the inputs of each cell, in the order of their names
+		std::vector<std::vector<int>> cell_drivers(GetSize(cells));
+		for (int i = 0; i < GetSize(cells); i++) {
+			auto &drivers = cell_drivers[i];
+			for (auto &bit : cell_to_inbit[i]) {
+				auto it = outbit_to_cell.find(bit);
+				if (it != outbit_to_cell.end())
+					drivers.insert(drivers.end(), it->second.begin(), it->second.end());
+			}
+			std::sort(drivers.begin(), drivers.end());
+			drivers.erase(std::unique(drivers.begin(), drivers.end()), drivers.end());
 		}
+		cell_to_inbit.clear();
+		outbit_to_cell.clear();
+
+		// depth-first post-order over the drivers, visiting cells by name; this
+		// is the order TopoSort produces, using an explicit stack so that long
+		// chains of cells can't overflow the call stack. Edges back to a cell
+		// that is still on the stack (logic loops) are ignored.
+		std::vector<RTLIL::Cell*> sorted_cells;
+		std::vector<char> cell_state(GetSize(cells)); // 0 = new, 1 = on stack, 2 = done
+		std::vector<std::pair<int, int>> dfs_stack;
+		sorted_cells.reserve(GetSize(cells));
+
+		for (int root = 0; root < GetSize(cells); root++)
+		{
+			if (cell_state[root] != 0)
+				continue;
 
-		for (auto &it_right : cell_to_inbit)
-		for (auto &it_sigbit : it_right.second)
-		for (auto &it_left : outbit_to_cell[it_sigbit])
-			cells.edge(it_left, it_right.first);
+			cell_state[root] = 1;
+			dfs_stack.push_back(std::pair<int, int>(root, 0));
 
-		cells.sort();
+			while (!dfs_stack.empty())
+			{
+				int n = dfs_stack.back().first;
+				int &edge_idx = dfs_stack.back().second;
+
+				if (edge_idx < GetSize(cell_drivers[n])) {
+					int left_n = cell_drivers[n][edge_idx++];
+					if (cell_state[left_n] == 0) {
+						cell_state[left_n] = 1;
+						dfs_stack.push_back(std::pair<int, int>(left_n, 0));
+					}
+					continue;
+				}
+
+				cell_state[n] = 2;
+				sorted_cells.push_back(cells[n]);
+				dfs_stack.pop_back();
+			}
+		}
 
-		for (auto cell : cells.sorted)
+		for (auto cell : sorted_cells)
 		{
 			log_assert(handled_cells.count(cell) == 0);
 			log_assert(cell == module->cell(cell->name));
 			bool mapped_cell = false;
 
-			std::string cell_type = cell->type.str();
-
-			if (in_recursion && cell_type.substr(0, 2) == "\\$")
+			RTLIL::IdString cell_type = cell->type;
+			if (in_recursion && cell_type.begins_with("\\$"))
 				cell_type = cell_type.substr(1);
 
 			for (auto &tpl_name : celltypeMap.at(cell_type))
 			{
 				RTLIL::IdString derived_name = tpl_name;
 				RTLIL::Module *tpl = map->modules_[tpl_name];
-				std::map<RTLIL::IdString, RTLIL::Const> parameters(cell->parameters.begin(), cell->parameters.end());
+				dict<RTLIL::IdString, RTLIL::Const> parameters(cell->parameters);
 
 				if (tpl->get_blackbox_attribute(ignore_wb))
 					continue;
@@ -636,7 +698,7 @@ struct TechmapWorker
 					}
 
 					int unique_bit_id_counter = 0;
-					std::map<RTLIL::SigBit, int> unique_bit_id;
+					dict<RTLIL::SigBit, int> unique_bit_id;
 					unique_bit_id[RTLIL::State::S0] = unique_bit_id_counter++;
 					unique_bit_id[RTLIL::State::S1] = unique_bit_id_counter++;
 					unique_bit_id[RTLIL::State::Sx] = unique_bit_id_counter++;
@@ -674,13 +736,14 @@ struct TechmapWorker
 			use_wrapper_tpl:;
 					// do not register techmap_wrap modules with techmap_cache
 				} else {
-					std::pair<RTLIL::IdString, std::map<RTLIL::IdString, RTLIL::Const>> key(tpl_name, parameters);
-					if (techmap_cache.count(key) > 0) {
-						tpl = techmap_cache[key];
+					std::pair<RTLIL::IdString, dict<RTLIL::IdString, RTLIL::Const>> key(tpl_name, parameters);
+					auto cache_it = techmap_cache.find(key);
+					if (cache_it != techmap_cache.end()) {
+						tpl = cache_it->second;
 					} else {
 						if (parameters.size() != 0) {
 							mkdebug.on();
-							derived_name = tpl->derive(map, dict<RTLIL::IdString, RTLIL::Const>(parameters.begin(), parameters.end()));
+							derived_name = tpl->derive(map, parameters);
 							tpl = map->module(derived_name);
 							log_continue = true;
 						}
@@ -917,6 +980,47 @@ struct TechmapWorker
 	}
 };
 
+// A map library that has been loaded by an earlier techmap call, together with
+// the templates that have been derived and checked for it so far. Libraries
+// are looked up by the map file names and loader options, and are only reused
+// when the contents of all files read while loading them are unchanged.
+struct TechmapLibrary
+{
+	RTLIL::Design *map;
+	TechmapWorker::CelltypeMap celltypeMap;
+	dict<std::pair<RTLIL::IdString, dict<RTLIL::IdString, RTLIL::Const>>, RTLIL::Module*> techmap_cache;
+	dict<RTLIL::Module*, bool> techmap_do_cache;
+	std::map<std::string, std::string> file_hashes;
+	bool cacheable;
+
+	TechmapLibrary() : map(new RTLIL::Design), cacheable(true) { }
+	~TechmapLibrary() { delete map; }
+
+	static bool hash_file(const std::string &filename, std::string &hash)
+	{
+		std::ifstream f(filename.c_str(), std::ifstream::binary);
+		if (f.fail())
+			return false;
+		std::stringstream buffer;
+		buffer << f.rdbuf();
+		hash = sha1(buffer.str());
+		return true;
+	}
+
+	bool up_to_date() const
+	{
+		std::string hash;
+		for (auto &it : file_hashes)
+			if (!hash_file(it.first, hash) || hash != it.second)
+				return false;
+		return true;
+	}
+};
+
+// most recently used library last
+std::vector<std::pair<std::string, std::unique_ptr<TechmapLibrary>>> techmap_libraries;
+const int techmap_max_libraries = 8;
+
 struct TechmapPass : public Pass {
 	TechmapPass() : Pass("techmap", "generic technology mapper") { }
 	void help() YS_OVERRIDE
@@ -966,6 +1070,17 @@ struct TechmapPass : public Pass {
 		log("        map file. Note that the Verilog frontend is also called with the\n");
 		log("        '-nooverwrite' option set.\n");
 		log("\n");
+		log("    -nocache\n");
+		log("        do not keep the loaded map library in memory (see below).\n");
+		log("\n");
+		log("Map files loaded from disk (and the builtin library) are kept in memory after\n");
+		log("the pass has finished, together with all parametric and constmapped variants\n");
+		log("of map modules that have been created. A later techmap call with the same map\n");
+		log("files and -D/-I options reuses this library instead of parsing the files again,\n");
+		log("as long as the contents of the map files and of all files included by them are\n");
+		log("unchanged. At most %d libraries are kept, and 'design -reset' drops all of\n", techmap_max_libraries);
+		log("them. Map designs given as -map %%<design-name> are never kept.\n");
+		log("\n");
 		log("When a module in the map file has the 'techmap_celltype' attribute set, it will\n");
 		log("match cells with a type that match the text value of this attribute. Otherwise\n");
 		log("the module name will be used to match the cell.\n");
@@ -1053,6 +1168,65 @@ struct TechmapPass : public Pass {
 		log("essentially techmap but using the design itself as map library).\n");
 		log("\n");
 	}
+
+	std::unique_ptr<TechmapLibrary> load_library(RTLIL::Design *design, const std::vector<std::string> &map_files, const std::string &verilog_frontend)
+	{
+		std::unique_ptr<TechmapLibrary> lib(new TechmapLibrary);
+		RTLIL::Design *map = lib->map;
+
+		// collect the files read by the frontend (including `include files) separately
+		std::set<std::string> old_input_files;
+		old_input_files.swap(yosys_input_files);
+
+		if (map_files.empty()) {
+			std::istringstream f(stdcells_code);
+			Frontend::frontend_call(map, &f, "<techmap.v>", verilog_frontend);
+		} else {
+			for (auto &fn : map_files)
+				if (fn.substr(0, 1) == "%") {
+					if (!saved_designs.count(fn.substr(1))) {
+						yosys_input_files.insert(old_input_files.begin(), old_input_files.end());
+						log_cmd_error("Can't saved design `%s'.\n", fn.c_str()+1);
+					}
+					for (auto mod : saved_designs.at(fn.substr(1))->modules())
+						if (!map->has(mod->name))
+							map->add(mod->clone());
+				} else {
+					std::ifstream f;
+					f.open(fn.c_str());
+					yosys_input_files.insert(fn);
+					if (f.fail()) {
+						yosys_input_files.insert(old_input_files.begin(), old_input_files.end());
+						log_cmd_error("Can't open map file `%s'\n", fn.c_str());
+					}
+					Frontend::frontend_call(map, &f, fn, (fn.size() > 3 && fn.substr(fn.size()-3) == ".il") ? "ilang" : verilog_frontend);
+				}
+		}
+
+		for (auto &fn : yosys_input_files)
+			if (!TechmapLibrary::hash_file(fn, lib->file_hashes[fn]))
+				lib->cacheable = false;
+		yosys_input_files.insert(old_input_files.begin(), old_input_files.end());
+
+		log_header(design, "Continuing TECHMAP pass.\n");
+
+		for (auto &it : map->modules_) {
+			if (it.second->attributes.count("\\techmap_celltype") && !it.second->attributes.at("\\techmap_celltype").bits.empty()) {
+				char *p = strdup(it.second->attributes.at("\\techmap_celltype").decode_string().c_str());
+				for (char *q = strtok(p, " \t\r\n"); q; q = strtok(NULL, " \t\r\n"))
+					lib->celltypeMap[RTLIL::escape_id(q)].insert(it.first);
+				free(p);
+			} else {
+				string module_name = it.first.str();
+				if (module_name.substr(0, 2) == "\\$")
+					module_name = module_name.substr(1);
+				lib->celltypeMap[module_name].insert(it.first);
+			}
+		}
+
+		return lib;
+	}
+
 	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
 	{
 		log_header(design, "Executing TECHMAP pass (map to technology primitives).\n");
@@ -1064,6 +1238,7 @@ struct TechmapPass : public Pass {
 		std::vector<std::string> map_files;
 		std::string verilog_frontend = "verilog -nooverwrite -noblackbox";
 		int max_iter = -1;
+		bool cache_mode = true;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -1103,52 +1278,57 @@ struct TechmapPass : public Pass {
 				worker.ignore_wb = true;
 				continue;
 			}
+			if (args[argidx] == "-nocache") {
+				cache_mode = false;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
-		RTLIL::Design *map = new RTLIL::Design;
-		if (map_files.empty()) {
-			std::istringstream f(stdcells_code);
-			Frontend::frontend_call(map, &f, "<techmap.v>", verilog_frontend);
-		} else {
+		for (auto &fn : map_files)
+			if (fn.substr(0, 1) == "%")
+				cache_mode = false;
+			else
+				rewrite_filename(fn);
+
+		// the templates in a library are modified by RECURSION, -recursive and
+		// -autoproc, so those options select a different library as well
+		std::string cache_key;
+		if (cache_mode) {
+			cache_key = verilog_frontend;
+			for (auto &arg : VERILOG_FRONTEND::verilog_defaults)
+				cache_key += " " + arg;
+			cache_key += stringf("|%d%d%d%d", worker.extern_mode, worker.recursive_mode, worker.autoproc_mode, worker.ignore_wb);
 			for (auto &fn : map_files)
-				if (fn.substr(0, 1) == "%") {
-					if (!saved_designs.count(fn.substr(1))) {
-						delete map;
-						log_cmd_error("Can't saved design `%s'.\n", fn.c_str()+1);
-					}
-					for (auto mod : saved_designs.at(fn.substr(1))->modules())
-						if (!map->has(mod->name))
-							map->add(mod->clone());
-				} else {
-					std::ifstream f;
-					rewrite_filename(fn);
-					f.open(fn.c_str());
-					yosys_input_files.insert(fn);
-					if (f.fail())
-						log_cmd_error("Can't open map file `%s'\n", fn.c_str());
-					Frontend::frontend_call(map, &f, fn, (fn.size() > 3 && fn.substr(fn.size()-3) == ".il") ? "ilang" : verilog_frontend);
-				}
+				cache_key += "|" + fn;
 		}
 
-		log_header(design, "Continuing TECHMAP pass.\n");
-
-		std::map<RTLIL::IdString, std::set<RTLIL::IdString, RTLIL::sort_by_id_str>> celltypeMap;
-		for (auto &it : map->modules_) {
-			if (it.second->attributes.count("\\techmap_celltype") && !it.second->attributes.at("\\techmap_celltype").bits.empty()) {
-				char *p = strdup(it.second->attributes.at("\\techmap_celltype").decode_string().c_str());
-				for (char *q = strtok(p, " \t\r\n"); q; q = strtok(NULL, " \t\r\n"))
-					celltypeMap[RTLIL::escape_id(q)].insert(it.first);
-				free(p);
-			} else {
-				string module_name = it.first.str();
-				if (module_name.substr(0, 2) == "\\$")
-					module_name = module_name.substr(1);
-				celltypeMap[module_name].insert(it.first);
+		std::unique_ptr<TechmapLibrary> lib;
+		for (auto it = techmap_libraries.begin(); cache_mode && it != techmap_libraries.end(); ++it) {
+			if (it->first != cache_key)
+				continue;
+			if (it->second->up_to_date()) {
+				lib = std::move(it->second);
+				log("Reusing cached map library (%d modules).\n", GetSize(lib->map->modules_));
+				for (auto &hash_it : lib->file_hashes)
+					yosys_input_files.insert(hash_it.first);
 			}
+			techmap_libraries.erase(it);
+			break;
 		}
 
+		if (lib == nullptr) {
+			lib = load_library(design, map_files, verilog_frontend);
+			if (!lib->cacheable)
+				cache_mode = false;
+		}
+
+		RTLIL::Design *map = lib->map;
+		auto &celltypeMap = lib->celltypeMap;
+		worker.techmap_cache.swap(lib->techmap_cache);
+		worker.techmap_do_cache.swap(lib->techmap_do_cache);
+
 		for (auto module : design->modules())
 			worker.module_queue.insert(module);
 
@@ -1158,7 +1338,7 @@ struct TechmapPass : public Pass {
 			worker.module_queue.erase(module);
 
 			bool did_something = true;
-			std::set<RTLIL::Cell*> handled_cells;
+			pool<RTLIL::Cell*> handled_cells;
 			while (did_something) {
 				did_something = false;
 					if (worker.techmap_module(design, module, map, handled_cells, celltypeMap, false))
@@ -1171,10 +1351,27 @@ struct TechmapPass : public Pass {
 		}
 
 		log("No more expansions possible.\n");
-		delete map;
+
+		if (cache_mode) {
+			worker.techmap_cache.swap(lib->techmap_cache);
+			worker.techmap_do_cache.swap(lib->techmap_do_cache);
+			techmap_libraries.emplace_back(cache_key, std::move(lib));
+			if (GetSize(techmap_libraries) > techmap_max_libraries)
+				techmap_libraries.erase(techmap_libraries.begin());
+		}
 
 		log_pop();
 	}
+
+	void on_shutdown() YS_OVERRIDE
+	{
+		techmap_libraries.clear();
+	}
+
+	void on_design_reset() YS_OVERRIDE
+	{
+		techmap_libraries.clear();
+	}
 } TechmapPass;
 
 struct FlattenPass : public Pass {
@@ -1215,7 +1412,7 @@ struct FlattenPass : public Pass {
 		extra_args(args, argidx, design);
 
 
-		std::map<RTLIL::IdString, std::set<RTLIL::IdString, RTLIL::sort_by_id_str>> celltypeMap;
+		TechmapWorker::CelltypeMap celltypeMap;
 		for (auto module : design->modules())
 			celltypeMap[module->name].insert(module->name);
 
@@ -1225,7 +1422,7 @@ struct FlattenPass : public Pass {
 				if (mod->get_bool_attribute("\\top"))
 					top_mod = mod;
 
-		std::set<RTLIL::Cell*> handled_cells;
+		pool<RTLIL::Cell*> handled_cells;
 		if (top_mod != NULL) {
 			worker.flatten_do_list.insert(top_mod->name);
 			while (!worker.flatten_do_list.empty()) {
@@ -0,0 +1,193 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include <chrono>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct IdStringBenchWorker
+{
+	const std::vector<std::string> &names;
+	std::vector<RTLIL::IdString> ids;
+	int rounds, thread_idx;
+	int errors;
+
+	IdStringBenchWorker(const std::vector<std::string> &names, int rounds, int thread_idx) :
+			names(names), ids(names.begin(), names.end()), rounds(rounds), thread_idx(thread_idx), errors(0) { }
+
+	// look up existing names
+	void intern()
+	{
+		for (int r = 0; r < rounds; r++)
+			for (auto &name : names) {
+				RTLIL::IdString id(name);
+				if (id.empty())
+					errors++;
+			}
+	}
+
+	// copy existing ids, i.e. reference counting only
+	void copy()
+	{
+		std::vector<RTLIL::IdString> copies(ids.size());
+		for (int r = 0; r < rounds; r++)
+			for (int i = 0; i < GetSize(ids); i++)
+				copies[i] = ids[i];
+		for (int i = 0; i < GetSize(ids); i++)
+			if (copies[i] != ids[i] || ids[i] != names[i])
+				errors++;
+	}
+
+	// create and release new names
+	void create()
+	{
+		for (int r = 0; r < rounds; r++)
+			for (int i = 0; i < GetSize(names); i++) {
+				std::string name = stringf("$bench$%d$%d$%d", thread_idx, r, i);
+				RTLIL::IdString id(name);
+				if (id != name)
+					errors++;
+			}
+	}
+};
+
+struct TestIdStringPass : public Pass {
+	TestIdStringPass() : Pass("test_idstring", "benchmark and check the IdString table") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_idstring [options]\n");
+		log("\n");
+		log("Measure the time it takes to look up, copy and create IdStrings, using the\n");
+		log("names of all wires, cells, cell types and ports in the current design. The\n");
+		log("IdString table is checked for consistency afterwards.\n");
+		log("\n");
+		log("    -r <num>\n");
+		log("        run every benchmark <num> times over all names (default = 10).\n");
+		log("\n");
+		log("    -j <num>\n");
+		log("        run the benchmarks in <num> threads concurrently (default = 1).\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		int rounds = 10;
+		int num_threads = 1;
+
+		log_header(design, "Executing TEST_IDSTRING pass.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-r" && argidx+1 < args.size()) {
+				rounds = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_threads = atoi(args[++argidx].c_str());
+				if (num_threads < 1)
+					log_cmd_error("Invalid number of threads: %s\n", args[argidx].c_str());
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+#ifndef YOSYS_ENABLE_THREADS
+		if (num_threads > 1) {
+			log_warning("Yosys was built without thread support, ignoring -j.\n");
+			num_threads = 1;
+		}
+#endif
+
+		pool<RTLIL::IdString> name_pool;
+		for (auto module : design->selected_modules()) {
+			name_pool.insert(module->name);
+			for (auto wire : module->selected_wires())
+				name_pool.insert(wire->name);
+			for (auto cell : module->selected_cells()) {
+				name_pool.insert(cell->name);
+				name_pool.insert(cell->type);
+				for (auto &conn : cell->connections())
+					name_pool.insert(conn.first);
+			}
+		}
+
+		std::vector<std::string> names;
+		int num_immortal = 0;
+		for (auto &id : name_pool) {
+			names.push_back(id.str());
+			if (RTLIL::IdString::global_id_immortal(id.index_))
+				num_immortal++;
+		}
+
+		if (names.empty())
+			log_cmd_error("No names found in the selected part of the design.\n");
+
+		log("Using %d names (%d immortal), %d rounds, %d threads.\n", GetSize(names), num_immortal, rounds, num_threads);
+
+		std::vector<IdStringBenchWorker> workers;
+		for (int i = 0; i < num_threads; i++)
+			workers.push_back(IdStringBenchWorker(names, rounds, i));
+
+		auto run_benchmark = [&](const char *title, void (IdStringBenchWorker::*func)())
+		{
+			auto begin = std::chrono::steady_clock::now();
+#ifdef YOSYS_ENABLE_THREADS
+			if (num_threads > 1) {
+				RTLIL::IdString::global_id_threaded_ = true;
+				std::vector<std::thread> threads;
+				for (auto &worker : workers)
+					threads.push_back(std::thread(func, &worker));
+				for (auto &t : threads)
+					t.join();
+				RTLIL::IdString::global_id_threaded_ = false;
+			} else
+#endif
+				(workers.front().*func)();
+			auto end = std::chrono::steady_clock::now();
+
+			double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+			double ops = double(GetSize(names)) * rounds * num_threads;
+			log("  %-8s %10.3f ms  %8.2f ns/op\n", title, ns * 1e-6, ns / ops);
+		};
+
+		run_benchmark("lookup", &IdStringBenchWorker::intern);
+		run_benchmark("copy", &IdStringBenchWorker::copy);
+		run_benchmark("create", &IdStringBenchWorker::create);
+
+		int errors = 0;
+		for (auto &worker : workers)
+			errors += worker.errors;
+
+		for (auto &name : names)
+			if (RTLIL::IdString(name).str() != name)
+				errors++;
+
+		if (errors)
+			log_error("Found %d inconsistencies in the IdString table.\n", errors);
+
+		log("IdString table is consistent.\n");
+	}
+} TestIdStringPass;
+
+PRIVATE_NAMESPACE_END
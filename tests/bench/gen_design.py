@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+#
+# Generate a random word-level ilang design for the benchmarks in this
+# directory: gen_design.py <cells> [<seed> [<modules>]]
+#
+# The cells ($and, $or, $xor, $not, $mux, $add, $eq, $dff) are 4 bits wide
+# and mostly read recently created signals, and some cells are exact
+# duplicates of earlier ones, so that opt has something to do.
+
+import random, sys
+
+num_cells = int(sys.argv[1])
+seed = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+num_modules = int(sys.argv[3]) if len(sys.argv) > 3 else 1
+W = 4
+
+binary_params = ["parameter \\A_SIGNED 0", "parameter \\A_WIDTH %d" % W, "parameter \\B_SIGNED 0", "parameter \\B_WIDTH %d" % W]
+out = []
+
+for m in range(num_modules):
+    out.append("module \\top%s" % ("" if num_modules == 1 else m))
+    out.append("  wire input 1 \\clk")
+    for i in range(8):
+        out.append("  wire width %d input %d \\in%d" % (W, i+2, i))
+    sigs = ["\\in%d" % i for i in range(8)] + ["%d'0000" % W, "%d'1111" % W, "%d'0101" % W]
+
+    for c in range(num_cells):
+        random.seed(seed * 7919 + c + m * 100003 - 1)
+        y = "\\n%d" % c if c % 7 == 0 else "$n%d" % c
+        out.append("  wire width %d %s" % (W, y))
+        t = random.choice(["$and", "$or", "$xor", "$not", "$mux", "$add", "$eq", "$dff", "$and", "$or", "dup"])
+        if t == "dup":
+            # reuse the random state of an earlier cell, so that it is duplicated
+            t = random.choice(["$and", "$or", "$xor"])
+            random.seed(seed * 1000 + c % 50)
+        a = random.choice(sigs[-40:] if random.random() < 0.7 else sigs)
+        b = random.choice(sigs[-40:] if random.random() < 0.7 else sigs)
+        out.append("  cell %s $c%d" % (t, c))
+        if t in ("$and", "$or", "$xor", "$add", "$eq"):
+            out += ["    " + p for p in binary_params]
+            out.append("    parameter \\Y_WIDTH %d" % (1 if t == "$eq" else W))
+            out += ["    connect \\A %s" % a, "    connect \\B %s" % b, "    connect \\Y %s" % (y + " [0]" if t == "$eq" else y)]
+        elif t == "$not":
+            out += ["    parameter \\A_SIGNED 0", "    parameter \\A_WIDTH %d" % W, "    parameter \\Y_WIDTH %d" % W]
+            out += ["    connect \\A %s" % a, "    connect \\Y %s" % y]
+        elif t == "$mux":
+            s = random.choice(sigs)
+            s = s + " [0]" if not s[0].isdigit() else random.choice(["1'0", "1'1"])
+            out += ["    parameter \\WIDTH %d" % W, "    connect \\A %s" % a, "    connect \\B %s" % b, "    connect \\S %s" % s, "    connect \\Y %s" % y]
+        elif t == "$dff":
+            out += ["    parameter \\CLK_POLARITY 1", "    parameter \\WIDTH %d" % W, "    connect \\CLK \\clk", "    connect \\D %s" % a, "    connect \\Q %s" % y]
+        out.append("  end")
+        if t == "$eq":
+            out.append("  connect %s [%d:1] %d'%s" % (y, W-1, W-1, "0"*(W-1)))
+        sigs.append(y)
+
+    for i in range(16):
+        out.append("  wire width %d output %d \\out%d" % (W, i+10, i))
+        out.append("  connect \\out%d %s" % (i, sigs[-1-i*3]))
+    out.append("end")
+
+print("\n".join(out))
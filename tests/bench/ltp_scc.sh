@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Time ltp and scc on a long chain of inverters (with and without a feedback
+# loop). This is the large version of tests/various/ltp_scc.sh; set
+# LTP_SCC_DEPTH to change the length of the chain and YOSYS to compare different
+# binaries. Run from this directory.
+
+set -e
+
+N=${LTP_SCC_DEPTH:-50000}
+YOSYS=${YOSYS:-../../yosys}
+TIMEFORMAT="    %3R s"
+
+for loop in 0 1; do
+	python3 - $N $loop > ltp_scc_bench.il << EOT
+import sys
+n, loop = int(sys.argv[1]), int(sys.argv[2])
+print("module \\\\top")
+print("  wire input 1 \\\\a")
+print("  wire output 2 \\\\y")
+for i in range(n+1):
+    print("  wire \\\\w%d" % i)
+if loop:
+    print("  cell \$_XOR_ \\\\fb")
+    print("    connect \\\\A \\\\a")
+    print("    connect \\\\B \\\\w%d" % n)
+    print("    connect \\\\Y \\\\w0")
+    print("  end")
+for i in range(n):
+    print("  cell \$_NOT_ \\\\inv%d" % i)
+    print("    connect \\\\A \\\\w%d" % i)
+    print("    connect \\\\Y \\\\w%d" % (i+1))
+    print("  end")
+if not loop:
+    print("  connect \\\\w0 \\\\a")
+print("  connect \\\\y \\\\w%d" % n)
+print("end")
+EOT
+	echo "  read_ilang of a chain of $N inverters (loop=$loop):"
+	time $YOSYS -q -p "read_ilang ltp_scc_bench.il"
+	echo "  read_ilang; ltp; scc on a chain of $N inverters (loop=$loop):"
+	time $YOSYS -q -p "read_ilang ltp_scc_bench.il; ltp -noff; scc -expect $loop"
+done
+
+rm -f ltp_scc_bench.il
@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# Time loading the same AIGER and BLIF netlists from a regular file (mapped
+# into memory) and from a pipe (read through the stream). Set
+# NETLIST_LOAD_WIDTH to scale the design and YOSYS to compare different
+# binaries. Run from this directory.
+
+set -e
+
+W=${NETLIST_LOAD_WIDTH:-256}
+YOSYS=${YOSYS:-../../yosys}
+TIMEFORMAT="    %3R s"
+
+cat > netlist_load_bench.v << EOT
+module top (input [$W-1:0] a, b, output [2*$W-1:0] y, output z);
+	assign y = a * b;
+	assign z = ^(a + b);
+endmodule
+EOT
+
+$YOSYS -q -p 'read_verilog netlist_load_bench.v; synth -flatten -noabc -top top; aigmap; opt_clean
+		write_aiger netlist_load_bench.aig; write_aiger -ascii netlist_load_bench.aag; write_blif netlist_load_bench.blif'
+
+for fmt in aig aag blif; do
+	if [ $fmt = blif ]; then
+		cmd="read_blif"
+	else
+		cmd="read_aiger -module_name top"
+	fi
+	echo "  $cmd (mapped file, $fmt):"
+	time $YOSYS -q -p "$cmd netlist_load_bench.$fmt"
+	echo "  $cmd (pipe, $fmt):"
+	time cat netlist_load_bench.$fmt | $YOSYS -q -p "$cmd /dev/stdin"
+done
+
+rm -f netlist_load_bench.v netlist_load_bench.aig netlist_load_bench.aag netlist_load_bench.blif
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Time opt_merge, opt and opt -incremental on a random word-level design (see
+# gen_design.py). Set OPT_CELLS to change the size of the design and YOSYS to
+# compare different binaries. Run from this directory.
+
+set -e
+
+N=${OPT_CELLS:-200000}
+YOSYS=${YOSYS:-../../yosys}
+TIMEFORMAT="    %3R s"
+
+python3 gen_design.py $N > opt_bench.il
+
+echo "  read_ilang ($N cells):"
+time $YOSYS -q -p "read_ilang opt_bench.il"
+for cmd in "opt_merge" "opt_merge -share_all" "opt" "opt -incremental"; do
+	echo "  read_ilang; $cmd ($N cells):"
+	time $YOSYS -q -p "read_ilang opt_bench.il; $cmd"
+done
+
+rm -f opt_bench.il
@@ -0,0 +1,56 @@
+#!/bin/bash
+
+# Compare load and write times of write_ilang/read_ilang with the binary
+# checkpoint format on a random gate level design. Set RTLIL_BIN_CELLS to
+# change the number of cells and YOSYS to compare different binaries. Run from
+# this directory.
+
+set -e
+
+N=${RTLIL_BIN_CELLS:-500000}
+YOSYS=${YOSYS:-../../yosys}
+TIMEFORMAT="    %3R s"
+
+python3 - $N > rtlil_bin_bench.il << EOT
+import random, sys
+n = int(sys.argv[1])
+random.seed(1)
+print("module \\\\top")
+print("  wire input 1 \\\\clk")
+print("  wire width 64 input 2 \\\\a")
+print("  wire width 64 output 3 \\\\y")
+sigs = ["\\\\a [%d]" % i for i in range(64)]
+for i in range(n):
+    t = random.choice(["\$_AND_", "\$_OR_", "\$_XOR_", "\$_MUX_", "\$_DFF_P_"])
+    a, b, s = (random.choice(sigs[-1000:]) for _ in range(3))
+    print("  wire \\\\w%d" % i)
+    print("  cell %s \$g%d" % (t, i))
+    if t == "\$_DFF_P_":
+        print("    connect \\\\C \\\\clk")
+        print("    connect \\\\D %s" % a)
+        print("    connect \\\\Q \\\\w%d" % i)
+    else:
+        print("    connect \\\\A %s" % a)
+        print("    connect \\\\B %s" % b)
+        if t == "\$_MUX_":
+            print("    connect \\\\S %s" % s)
+        print("    connect \\\\Y \\\\w%d" % i)
+    print("  end")
+    sigs.append("\\\\w%d" % i)
+print("  connect \\\\y { %s }" % " ".join(sigs[-64:]))
+print("end")
+EOT
+
+$YOSYS -q -p "read_ilang rtlil_bin_bench.il; write_rtlil_bin rtlil_bin_bench.bin"
+ls -l rtlil_bin_bench.il rtlil_bin_bench.bin | awk '{ print "  " $9 ": " $5 " bytes" }'
+
+echo "  read_ilang ($N cells):"
+time $YOSYS -q -p "read_ilang rtlil_bin_bench.il"
+echo "  read_rtlil_bin ($N cells):"
+time $YOSYS -q -p "read_rtlil_bin rtlil_bin_bench.bin"
+echo "  read_rtlil_bin; write_ilang ($N cells):"
+time $YOSYS -q -p "read_rtlil_bin rtlil_bin_bench.bin; write_ilang rtlil_bin_bench_out.il"
+echo "  read_rtlil_bin; write_rtlil_bin ($N cells):"
+time $YOSYS -q -p "read_rtlil_bin rtlil_bin_bench.bin; write_rtlil_bin rtlil_bin_bench_out.bin"
+
+rm -f rtlil_bin_bench.il rtlil_bin_bench.bin rtlil_bin_bench_out.il rtlil_bin_bench_out.bin
@@ -0,0 +1,58 @@
+#!/bin/bash
+
+# Time 'sat -seq' with and without -unroll on a deep sequential property: a
+# 16 bit counter next to SAT_UNROLL_LANES lanes of word-level logic that is
+# imported at every time step but does not affect the property. Set
+# SAT_UNROLL_DEPTHS to change the depths and YOSYS to compare different
+# binaries. Run from this directory.
+
+set -e
+
+L=${SAT_UNROLL_LANES:-100}
+DEPTHS=${SAT_UNROLL_DEPTHS:-"25 50 100"}
+YOSYS=${YOSYS:-../../yosys}
+TIMEFORMAT="    %3R s"
+
+python3 - $L > sat_unroll_bench.il << EOT
+import sys
+n = int(sys.argv[1])
+def cell(type, name, conns, **params):
+    print("  cell \$%s \$%s" % (type, name))
+    for k, v in params.items():
+        print("    parameter \\\\%s %d" % (k, v))
+    for k, v in conns:
+        print("    connect \\\\%s %s" % (k, v))
+    print("  end")
+def binop(type, name, a, b, y, w=16, yw=16):
+    cell(type, name, [("A", a), ("B", b), ("Y", y)], A_SIGNED=0, B_SIGNED=0, A_WIDTH=w, B_WIDTH=w, Y_WIDTH=yw)
+def dff(name, d, q):
+    cell("dff", name, [("CLK", "\\\\clk"), ("D", d), ("Q", q)], CLK_POLARITY=1, WIDTH=16)
+print("module \\\\top")
+print("  wire input 1 \\\\clk")
+print("  wire width 16 input 2 \\\\in")
+print("  wire output 3 \\\\ok")
+print("  wire width 16 \\\\cnt")
+print("  wire width 16 \\\\cnt_next")
+dff("cnt_reg", "\\\\cnt_next", "\\\\cnt")
+binop("add", "cnt_add", "\\\\cnt", "16'0000000000000001", "\\\\cnt_next")
+binop("ne", "cnt_ne", "\\\\cnt", "16'1111111111111111", "\\\\ok", yw=1)
+prev = "\\\\in"
+for i in range(n):
+    print("  wire width 16 \\\\x%d" % i)
+    print("  wire width 16 \\\\s%d" % i)
+    print("  wire width 16 \\\\t%d" % i)
+    binop("add", "add%d" % i, "\\\\x%d" % i, prev, "\\\\s%d" % i)
+    binop("xor", "xor%d" % i, "\\\\s%d" % i, "\\\\cnt", "\\\\t%d" % i)
+    dff("reg%d" % i, "\\\\t%d" % i, "\\\\x%d" % i)
+    prev = "\\\\x%d" % i
+print("end")
+EOT
+
+for d in $DEPTHS; do
+	echo "  sat -seq $d ($L lanes):"
+	time $YOSYS -q -p "read_ilang sat_unroll_bench.il; sat -seq $d -set-init-zero -prove ok 1 -verify"
+	echo "  sat -seq $d -unroll ($L lanes):"
+	time $YOSYS -q -p "read_ilang sat_unroll_bench.il; sat -seq $d -unroll -set-init-zero -prove ok 1 -verify"
+done
+
+rm -f sat_unroll_bench.il
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# Time techmap (and a typical fine-grained flow) on a random word-level design
+# (see gen_design.py). Set TECHMAP_CELLS to change the size of the design and
+# YOSYS to compare different binaries. Run from this directory.
+#
+# The first runs use a small ilang map library that forwards the gate-level
+# cells to simplemap, so they only measure the techmap worker itself and also
+# work with a yosys built without the verilog frontend.
+
+set -e
+
+N=${TECHMAP_CELLS:-100000}
+YOSYS=${YOSYS:-../../yosys}
+TIMEFORMAT="    %3R s"
+
+python3 gen_design.py $N > techmap_bench.il
+for t in and or xor not mux eq dff; do
+	printf 'attribute \\techmap_simplemap 1\nmodule $%s\nend\n' $t
+done > techmap_bench_map.il
+
+echo "  read_ilang ($N cells):"
+time $YOSYS -q -p "read_ilang techmap_bench.il"
+echo "  read_ilang; techmap -map techmap_bench_map.il ($N cells):"
+time $YOSYS -q -p "read_ilang techmap_bench.il; techmap -map techmap_bench_map.il"
+echo "  read_ilang; techmap ($N cells):"
+time $YOSYS -q -p "read_ilang techmap_bench.il; techmap"
+echo "  read_ilang; opt; techmap; opt -fast; stat ($N cells):"
+time $YOSYS -q -p "read_ilang techmap_bench.il; opt; techmap; opt -fast; stat"
+
+rm -f techmap_bench.il techmap_bench_map.il
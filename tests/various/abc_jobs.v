@@ -0,0 +1,7 @@
+module abc_jobs(input clk1, clk2, en, input [3:0] a, b, output reg [3:0] x, y, output [3:0] z);
+	always @(posedge clk1)
+		x <= a + b;
+	always @(negedge clk2)
+		if (en) y <= x ^ b;
+	assign z = x & y;
+endmodule
@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# Map module b once after a plain abc run on module a, and once after an abc
+# run on a whose script leaves an alias behind in ABC. In YOSYS_LINK_ABC
+# builds all abc runs execute in the yosys process, so this checks that a run
+# does not see the state of the previous one: both mappings of b must match.
+
+trap 'echo "ERROR in abc_reuse.sh" >&2; exit 1' ERR
+
+cat > abc_reuse.v <<EOT
+module a(input [3:0] x, y, output [3:0] z);
+	assign z = (x & y) ^ (x | ~y);
+endmodule
+module b(input [3:0] x, y, output [3:0] z);
+	assign z = x + y;
+endmodule
+EOT
+
+cat > abc_reuse.abc <<EOT
+alias &dch &ps
+strash
+&get -n
+&dch -f
+&nf
+&put
+EOT
+
+../../yosys -q -p "read_verilog abc_reuse.v; proc; techmap; opt -fast; abc -g AND a; abc -g AND b; tee -q -o abc_reuse_1.log stat b"
+../../yosys -q -p "read_verilog abc_reuse.v; proc; techmap; opt -fast; abc -g AND -script abc_reuse.abc a; abc -g AND b; tee -q -o abc_reuse_2.log stat b"
+cmp abc_reuse_1.log abc_reuse_2.log
+
+rm -f abc_reuse.v abc_reuse.abc abc_reuse_1.log abc_reuse_2.log
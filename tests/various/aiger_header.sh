@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# AIGER files with header counts far larger than the file itself must be
+# rejected with a parse error, not run out of memory reserving the tables.
+
+trap 'echo "ERROR in aiger_header.sh" >&2; exit 1' ERR
+
+printf 'aag 1000000000 0 0 0 1000000000\n2 0 0\n' > aiger_header.aag
+printf 'aig 1000000000 0 1000000000 0 0\n2\n' > aiger_header.aig
+
+for fmt in aag aig; do
+	if ../../yosys -q -p "read_aiger aiger_header.$fmt" > aiger_header.log 2>&1; then
+		echo "read_aiger accepted aiger_header.$fmt" >&2
+		false
+	fi
+	grep -q "cannot be interpreted as" aiger_header.log
+done
+
+rm -f aiger_header.aag aiger_header.aig aiger_header.log
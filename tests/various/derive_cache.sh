@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# Elaborate a design with parametric submodules twice using the same derive
+# cache directory. The second run must load the derived modules from the cache
+# and produce the same design as the first one.
+
+trap 'echo "ERROR in derive_cache.sh" >&2; exit 1' ERR
+
+rm -rf derive_cache.d
+mkdir derive_cache.d
+
+cat > derive_cache.v << EOT
+module sub #(parameter W = 4, parameter [W-1:0] K = 1) (input [W-1:0] a, output [W-1:0] y);
+	reg [W-1:0] r;
+	integer i;
+	always @* begin
+		r = a;
+		for (i = 0; i < W; i = i + 1)
+			r = r ^ (a >> i) ^ K;
+	end
+	assign y = r;
+endmodule
+
+module top (input [15:0] a, output [15:0] y, output [7:0] z);
+	sub #(.W(16), .K(16'h1234)) s0 (a, y);
+	sub #(.W(8), .K(8'h5a)) s1 (a[7:0], z);
+endmodule
+EOT
+
+../../yosys -q -l derive_cache_1.log -p 'read_verilog -derive_cache derive_cache.d derive_cache.v; hierarchy -top top; write_ilang derive_cache_1.il'
+test $(ls derive_cache.d | wc -l) -eq 2
+test $(grep -c "from \`derive_cache.d/" derive_cache_1.log) -eq 0
+
+../../yosys -q -l derive_cache_2.log -p 'read_verilog -derive_cache derive_cache.d derive_cache.v; hierarchy -top top; write_ilang derive_cache_2.il'
+test $(grep -c "from \`derive_cache.d/" derive_cache_2.log) -eq 2
+cmp derive_cache_1.il derive_cache_2.il
+
+# a change of the module source must not hit the cache
+sed -i 's/r ^ (a >> i)/r ^ (a << i)/' derive_cache.v
+../../yosys -q -l derive_cache_3.log -p 'read_verilog -derive_cache derive_cache.d derive_cache.v; hierarchy -top top'
+test $(grep -c "from \`derive_cache.d/" derive_cache_3.log) -eq 0
+test $(ls derive_cache.d | wc -l) -eq 4
+
+rm -rf derive_cache.d derive_cache.v derive_cache_[123].log derive_cache_[12].il
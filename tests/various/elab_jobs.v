@@ -0,0 +1,19 @@
+module elab_add #(parameter W = 4) (input [W-1:0] a, b, output [W:0] y);
+	assign y = a + b;
+endmodule
+
+module elab_mem #(parameter W = 4, D = 8) (input clk, we, input [2:0] addr, input [W-1:0] d, output reg [W-1:0] q);
+	reg [W-1:0] mem [0:D-1];
+	always @(posedge clk) begin
+		if (we) mem[addr] <= d;
+		q <= mem[addr];
+	end
+endmodule
+
+module elab_jobs (input clk, we, input [2:0] addr, input [7:0] a, b, output [8:0] y8, output [4:0] y4, output [2:0] y2, output [7:0] q);
+	elab_add #(.W(8)) add8 (.a(a), .b(b), .y(y8));
+	elab_add add4 (.a(a[3:0]), .b(b[3:0]), .y(y4));
+	elab_add #(2) add2 (.a(a[1:0]), .b(b[1:0]), .y(y2));
+	elab_add #(.W(8)) add8b (.a(b), .b(a), .y());
+	elab_mem #(.W(8)) mem (.clk(clk), .we(we), .addr(addr), .d(a), .q(q));
+endmodule
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# Run extract (map and mine mode, and map mode with -cell_attr) on a
+# gate-level design with one and with several threads and check that the
+# results are the same.
+
+trap 'echo "ERROR in extract_jobs.sh" >&2; exit 1' ERR
+
+cat > extract_jobs_map.v << EOT
+module halfadd (input a, b, output s, c);
+	assign s = a ^ b, c = a & b;
+endmodule
+EOT
+
+cat > extract_jobs.v << EOT
+module top (input [127:0] a, b, c, output [127:0] x, y);
+	assign x = a + b;
+	assign y = (a ^ c) & (b | c);
+endmodule
+EOT
+
+for j in 1 4; do
+	../../yosys -q -p "read_verilog extract_jobs_map.v; proc; techmap; opt_clean; setattr -set group 1 t:*; design -stash map
+			read_verilog extract_jobs.v; synth -run coarse; techmap; opt_clean
+			setattr -set group 1 w:x %ci* t:* %i
+			design -save gates
+			extract -j $j -map %map; write_ilang extract_jobs_$j.il
+			design -load gates
+			extract -j $j -cell_attr group -map %map; write_ilang extract_jobs_attr_$j.il
+			design -load gates
+			extract -j $j -mine extract_jobs_mine_$j.il -mine_cells_span 2 3 -mine_min_freq 20"
+done
+
+cmp extract_jobs_1.il extract_jobs_4.il
+cmp extract_jobs_attr_1.il extract_jobs_attr_4.il
+cmp extract_jobs_mine_1.il extract_jobs_mine_4.il
+test $(grep -c "cell \\\\halfadd" extract_jobs_1.il) -gt 0
+test $(grep -c "cell \\\\halfadd" extract_jobs_attr_1.il) -gt 0
+
+rm -f extract_jobs_map.v extract_jobs.v extract_jobs_[14].il extract_jobs_attr_[14].il extract_jobs_mine_[14].il
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Run ltp and scc on a long chain of inverters (with and without a feedback
+# loop). This used to overflow the stack with the recursive implementations.
+# The stack is limited to 1 MB, so that a chain of 10000 cells is enough to
+# show this; tests/bench/ltp_scc.sh times a much longer chain.
+
+trap 'echo "ERROR in ltp_scc.sh" >&2; exit 1' ERR
+
+N=${LTP_SCC_DEPTH:-10000}
+ulimit -s 1024
+
+for loop in 0 1; do
+	{
+		echo 'module \top'
+		echo '  wire input 1 \a'
+		echo '  wire output 2 \y'
+		for ((i = 0; i <= N; i++)); do
+			echo "  wire \\w$i"
+		done
+		if [ $loop = 1 ]; then
+			printf '  cell $_XOR_ \\fb\n    connect \\A \\a\n    connect \\B \\w%d\n    connect \\Y \\w0\n  end\n' $N
+		else
+			echo '  connect \w0 \a'
+		fi
+		for ((i = 0; i < N; i++)); do
+			printf '  cell $_NOT_ \\inv%d\n    connect \\A \\w%d\n    connect \\Y \\w%d\n  end\n' $i $i $((i+1))
+		done
+		echo "  connect \\y \\w$N"
+		echo 'end'
+	} > ltp_scc.il
+	../../yosys -q -l ltp_scc.log -p "read_ilang ltp_scc.il; ltp -n 2; scc -expect $loop"
+	if [ $loop = 0 ]; then
+		grep -q "Longest topological path in top (length=$N):" ltp_scc.log
+		grep -q "Path 1 to " ltp_scc.log
+	else
+		grep -q "Detected loop at" ltp_scc.log
+	fi
+done
+
+rm -f ltp_scc.il ltp_scc.log
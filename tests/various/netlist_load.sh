@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# Load the same AIGER and BLIF netlists from a regular file (mapped into
+# memory) and from a pipe (read through the stream) and check that both give
+# the same design. tests/bench/netlist_load.sh times both on a larger design.
+
+trap 'echo "ERROR in netlist_load.sh" >&2; exit 1' ERR
+
+W=16
+
+cat > netlist_load.v << EOT
+module top (input [$W-1:0] a, b, output [2*$W-1:0] y, output z);
+	assign y = a * b;
+	assign z = ^(a + b);
+endmodule
+EOT
+
+../../yosys -q -p 'read_verilog netlist_load.v; synth -flatten -noabc -top top; aigmap; opt_clean
+		write_aiger netlist_load.aig; write_aiger -ascii netlist_load.aag; write_blif netlist_load.blif'
+
+for fmt in aig aag blif; do
+	if [ $fmt = blif ]; then
+		cmd="read_blif"
+	else
+		cmd="read_aiger -module_name top"
+	fi
+	../../yosys -q -p "$cmd netlist_load.$fmt; write_ilang netlist_load_1.il"
+	cat netlist_load.$fmt | ../../yosys -q -p "$cmd /dev/stdin; write_ilang netlist_load_2.il"
+	cmp netlist_load_1.il netlist_load_2.il
+done
+
+rm -f netlist_load.v netlist_load.aig netlist_load.aag netlist_load.blif netlist_load_[12].il
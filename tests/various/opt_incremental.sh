@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# Run "opt" and "opt -incremental" on the same design and check that both
+# give the same cell counts and equivalent circuits.
+
+trap 'echo "ERROR in opt_incremental.sh" >&2; exit 1' ERR
+
+cat > opt_incremental.v << EOT
+module top (input clk, input [15:0] a, b, input [3:0] s, output [15:0] x, y, z, output reg [15:0] q, output r);
+	wire [15:0] c = 16'h00ff;
+	wire [15:0] chain [0:8];
+	assign chain[0] = a;
+	genvar i;
+	generate for (i = 0; i < 8; i = i+1) begin:stage
+		wire [15:0] t1 = (chain[i] & c) | (chain[i] & ~c);
+		wire [15:0] t2 = (chain[i] & c) | (chain[i] & ~c);
+		assign chain[i+1] = s[i % 4] ? t1 ^ b : t2 ^ b;
+	end endgenerate
+	assign x = chain[8];
+	assign y = s[0] ? (s[0] ? a : b) : (s[1] ? a + 0 : a * 1);
+	assign z = {a[7:0], a[7:0]} == {b[7:0], b[7:0]} ? a - b : b - a;
+	reg [15:0] d;
+	always @(posedge clk) begin
+		d <= 0;
+		q <= d | (a & b);
+	end
+	assign r = |{x, y, z} || |{x, z};
+endmodule
+EOT
+
+for mode in "" "-incremental"; do
+	../../yosys -q -p "read_verilog opt_incremental.v; proc; opt $mode; tee -q -o opt_incremental$mode.log stat; write_ilang opt_incremental$mode.il"
+	grep '^ ' opt_incremental$mode.log > opt_incremental$mode.txt
+done
+cmp opt_incremental.txt opt_incremental-incremental.txt
+
+../../yosys -q -p "read_ilang opt_incremental.il; rename top gold; read_ilang opt_incremental-incremental.il; rename top gate
+		equiv_make gold gate equiv; hierarchy -top equiv; equiv_simple -seq 2; equiv_induct; equiv_status -assert"
+
+rm -f opt_incremental.v opt_incremental*.log opt_incremental*.txt opt_incremental*.il
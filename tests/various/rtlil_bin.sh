@@ -0,0 +1,37 @@
+#!/bin/bash
+
+trap 'echo "ERROR in rtlil_bin.sh" >&2; exit 1' ERR
+
+cat > rtlil_bin.v << "EOT"
+module sub #(parameter W = 4) (input clk, input [W-1:0] a, b, output reg [W-1:0] y);
+	(* keep *) wire [W-1:0] t = a ^ b;
+	always @(posedge clk)
+		case (a[1:0])
+			2'b00: y <= t;
+			2'b01: y <= 'bx;
+			default: y <= a - b;
+		endcase
+endmodule
+
+module top (input clk, input [7:0] addr, data, output [7:0] q, output [3:0] r);
+	reg [7:0] mem [0:255];
+	reg [7:0] q_reg;
+	always @(posedge clk) begin
+		mem[addr] <= data;
+		q_reg <= mem[addr];
+	end
+	assign q = q_reg;
+	sub #(.W(4)) u (.clk(clk), .a(addr[7:4]), .b(4'b1x0z), .y(r));
+endmodule
+EOT
+
+# round trip before and after proc/memory, compared through write_ilang
+../../yosys -q -p 'read_verilog rtlil_bin.v; write_ilang rtlil_bin_1.il; write_rtlil_bin rtlil_bin_1.bin'
+../../yosys -q -p 'read_rtlil_bin rtlil_bin_1.bin; write_ilang rtlil_bin_2.il'
+cmp rtlil_bin_1.il rtlil_bin_2.il
+
+../../yosys -q -p 'read_verilog rtlil_bin.v; synth -top top; write_ilang rtlil_bin_3.il; write_rtlil_bin rtlil_bin_3.bin'
+../../yosys -q -p 'read_rtlil_bin rtlil_bin_3.bin; write_ilang rtlil_bin_4.il'
+cmp rtlil_bin_3.il rtlil_bin_4.il
+
+rm -f rtlil_bin.v rtlil_bin_[1-4].il rtlil_bin_[13].bin
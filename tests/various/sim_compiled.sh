@@ -0,0 +1,48 @@
+#!/bin/bash
+
+# Simulate the same design with the default engine and with "sim -compiled"
+# and check that both write the same VCD file.
+
+trap 'echo "ERROR in sim_compiled.sh" >&2; exit 1' ERR
+
+cat > sim_compiled.v << EOT
+module sim_sub (input clk, input [7:0] a, b, output [7:0] y, output reg [7:0] q);
+	reg [7:0] mem [0:3];
+	assign y = (a + b) ^ {a[3:0], b[7:4]};
+	always @(posedge clk) begin
+		mem[a[1:0]] <= y;
+		q <= mem[b[1:0]];
+	end
+endmodule
+
+module top (input clk, rst, output [7:0] y1, y2, q1, output eq, output reg [2:0] st,
+		output [69:0] w_and, w_or, w_xor, w_xnor, w_mux);
+	reg [7:0] cnt, lfsr;
+	always @(posedge clk) begin
+		cnt <= rst ? 8'd0 : cnt + 8'd3;
+		lfsr <= rst ? 8'd1 : {lfsr[6:0], lfsr[7] ^ lfsr[5] ^ lfsr[4] ^ lfsr[3]};
+		case (st)
+			0: st <= rst ? 0 : 1;
+			1: st <= lfsr[0] ? 2 : 3;
+			2: st <= cnt[1] ? 0 : 3;
+			default: st <= 0;
+		endcase
+	end
+	sim_sub u1 (.clk(clk), .a(cnt), .b(lfsr), .y(y1), .q(q1));
+	sim_sub u2 (.clk(clk), .a(lfsr), .b(y1), .y(y2), .q());
+	assign eq = cnt[3:0] == lfsr[3:0] && !st;
+
+	// bitwise cells and muxes wider than one word of packed nets
+	wire [69:0] wa = {cnt, lfsr, y1, y2, q1, cnt, lfsr, y1, 6'b101101} + {lfsr, 62'd12345};
+	wire [69:0] wb = {lfsr, y2, cnt, q1, y1, lfsr, cnt, 6'b010011, y2} - {cnt, 62'd999};
+	assign w_and = wa & wb, w_or = wa | ~wb, w_xor = wa ^ wb, w_xnor = wa ~^ {w_and[69:4], 4'bx1z0};
+	assign w_mux = st[0] ? w_or : st[1] ? w_xor : wb;
+endmodule
+EOT
+
+../../yosys -q -p "read_verilog sim_compiled.v; proc; memory -nomap; opt_clean
+		sim -clock clk -reset rst -n 50 -vcd sim_compiled_1.vcd top
+		sim -compiled -clock clk -reset rst -n 50 -vcd sim_compiled_2.vcd top"
+cmp sim_compiled_1.vcd sim_compiled_2.vcd
+
+rm -f sim_compiled.v sim_compiled_[12].vcd
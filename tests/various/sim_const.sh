@@ -0,0 +1,69 @@
+#!/bin/bash
+
+# Cells with constant inputs (and instances with constant input ports) must be
+# evaluated at the start of the simulation, also when none of their inputs
+# ever changes. Check this for both sim engines.
+
+trap 'echo "ERROR in sim_const.sh" >&2; exit 1' ERR
+
+cat > sim_const.il << EOT
+module \sub
+  wire input 1 \a
+  wire output 2 \y
+  cell \$not \$not
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 1
+    parameter \Y_WIDTH 1
+    connect \A \a
+    connect \Y \y
+  end
+end
+module \top
+  wire input 1 \clk
+  wire input 2 \a
+  wire output 3 \y1
+  wire output 4 \y2
+  wire output 5 \y3
+  cell \$not \$not
+    parameter \A_SIGNED 0
+    parameter \A_WIDTH 1
+    parameter \Y_WIDTH 1
+    connect \A 1'0
+    connect \Y \y1
+  end
+  cell \$and \$and
+    parameter \A_SIGNED 0
+    parameter \B_SIGNED 0
+    parameter \A_WIDTH 1
+    parameter \B_WIDTH 1
+    parameter \Y_WIDTH 1
+    connect \A \a
+    connect \B 1'0
+    connect \Y \y2
+  end
+  cell \sub \u
+    connect \a 1'1
+    connect \y \y3
+  end
+end
+EOT
+
+# value of a top-level signal at time 0
+value_at_0() {
+	awk -v name=$2 '/^\$scope module u /{ in_u = 1 } /^\$upscope/{ in_u = 0 }
+		$1 == "$var" && $5 == name && !in_u { id = $4 } /^#/{ t = $1 }
+		t == "#0" && $2 == id { print $1 }' $1
+}
+
+../../yosys -q -p "read_ilang sim_const.il; hierarchy -top top
+		sim -clock clk -n 2 -vcd sim_const_1.vcd top
+		sim -compiled -clock clk -n 2 -vcd sim_const_2.vcd top"
+
+for vcd in sim_const_1.vcd sim_const_2.vcd; do
+	test "$(value_at_0 $vcd y1)" = b1
+	test "$(value_at_0 $vcd y2)" = b0
+	test "$(value_at_0 $vcd y3)" = b0
+done
+cmp sim_const_1.vcd sim_const_2.vcd
+
+rm -f sim_const.il sim_const_[12].vcd
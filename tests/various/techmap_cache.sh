@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# Run techmap several times with the same map file in one session and
+# check that the loaded map library is reused, that it is loaded again once a
+# file included by the map file has changed, that -nocache neither uses nor
+# keeps it, and that 'design -reset' drops it.
+
+trap 'echo "ERROR in techmap_cache.sh" >&2; exit 1' ERR
+
+cat > techmap_cache_inc.vh << EOT
+localparam USE_OR = 0;
+EOT
+
+cat > techmap_cache_map.v << EOT
+(* techmap_celltype = "\$add" *)
+module map_add (A, B, Y);
+	parameter A_SIGNED = 0;
+	parameter B_SIGNED = 0;
+	parameter A_WIDTH = 1;
+	parameter B_WIDTH = 1;
+	parameter Y_WIDTH = 1;
+	\`include "techmap_cache_inc.vh"
+	input [A_WIDTH-1:0] A;
+	input [B_WIDTH-1:0] B;
+	output [Y_WIDTH-1:0] Y;
+	assign Y = USE_OR ? A | B : A ^ B;
+endmodule
+EOT
+
+cat > techmap_cache.ys << EOT
+read_verilog -noopt << EOV
+module top (input [3:0] a, b, c, output [3:0] x, output [7:0] y);
+	assign x = a + b;
+	assign y = b + c;
+endmodule
+EOV
+design -save gold
+techmap -map techmap_cache_map.v
+select -assert-none t:\$add
+select -assert-count 2 t:\$xor
+design -load gold
+techmap -map techmap_cache_map.v
+select -assert-count 2 t:\$xor
+design -load gold
+techmap -nocache -map techmap_cache_map.v
+select -assert-count 2 t:\$xor
+!sed -i 's/USE_OR = 0/USE_OR = 1/' techmap_cache_inc.vh
+design -load gold
+techmap -map techmap_cache_map.v
+select -assert-count 2 t:\$or
+design -reset
+design -load gold
+techmap -map techmap_cache_map.v
+select -assert-count 2 t:\$or
+EOT
+
+../../yosys -ql techmap_cache.log techmap_cache.ys
+test $(grep -c "Reusing cached map library" techmap_cache.log) -eq 1
+
+rm -f techmap_cache_inc.vh techmap_cache_map.v techmap_cache.ys techmap_cache.log
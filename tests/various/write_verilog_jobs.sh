@@ -0,0 +1,19 @@
+#!/bin/bash
+
+trap 'echo "ERROR in write_verilog_jobs.sh" >&2; exit 1' ERR
+
+cat > write_verilog_jobs.v << "EOT"
+module top (input clk, input [31:0] a, b, input [4:0] s, output reg [63:0] p, output [31:0] x);
+	always @(posedge clk)
+		p <= a * b;
+	assign x = a >> s;
+endmodule
+EOT
+
+# the multiplier has several thousand gates, so the cells are split into
+# many chunks, the output must not depend on the number of threads
+../../yosys -q -p 'read_verilog write_verilog_jobs.v; synth -top top; write_verilog -j 1 write_verilog_jobs_1.v; write_verilog -j 4 write_verilog_jobs_4.v; write_verilog -noexpr -j 4 write_verilog_jobs_4n.v; write_verilog -noexpr -j 1 write_verilog_jobs_1n.v'
+cmp write_verilog_jobs_1.v write_verilog_jobs_4.v
+cmp write_verilog_jobs_1n.v write_verilog_jobs_4n.v
+
+rm -f write_verilog_jobs.v write_verilog_jobs_[14].v write_verilog_jobs_[14]n.v